@@ -1230,8 +1230,31 @@ ${eventDescription}`)) {
     setupSliderDisplay('volInterval', 'volIntervalValue', 'min');
 
 
+    /**
+     * @function subscribeLiveEvents
+     * @brief Refreshes the schedule list when the controller pushes a schedule or lock change.
+     *
+     * Listens on the `/api/events` Server-Sent Events stream. Deltas carry revision counters
+     * (`schedulesRev`, `locksRev`); the list is refetched only when one of them is present,
+     * and the current selection is kept. EventSource reconnects on its own after a drop and
+     * receives a fresh "snapshot" event.
+     */
+    function subscribeLiveEvents() {
+        if (!window.EventSource) return;
+        const source = new EventSource('/api/events');
+        source.addEventListener('delta', async (e) => {
+            const delta = JSON.parse(e.data);
+            if (delta.schedulesRev === undefined && delta.locksRev === undefined) return;
+            if (DEBUG_SCHEDULE) console.log('[subscribeLiveEvents] Schedule/lock change pushed:', delta);
+            const selected = scheduleSelect.value;
+            await fetchSchedules();
+            scheduleSelect.value = selected;
+        });
+    }
+
     // --- Initial Load ---
     fetchSchedules();
+    subscribeLiveEvents();
     hideEditSection(); // Ensure edit section is hidden and state is reset initially
 
 });
\ No newline at end of file
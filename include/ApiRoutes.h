@@ -2,12 +2,25 @@
 #define API_ROUTES_H
 
 #include <ESPAsyncWebServer.h>
+#include <FS.h>
 #include <ArduinoJson.h>
 #include "UserManager.h"
 #include "SessionManager.h"
 #include "ScheduleManager.h"
 #include "LockManager.h"
+#include "StaticAssetHandler.h"
 #include "DebugConfig.h" // Include for API_DEBUG macros
+#include <memory>
+#include <atomic>
+
+// Largest accepted schedule POST/PUT body; larger bodies are rejected with 413
+#define SCHEDULE_BODY_MAX_SIZE 10240
+// Number of schedule uploads that can be received concurrently (one slot each)
+#define SCHEDULE_BODY_SLOTS 2
+// Largest accepted bulk import body; it is spooled to flash, not held in RAM
+#define SCHEDULE_IMPORT_MAX_SIZE (128UL * 1024)
+// Spool file of the bulk import being received (one import at a time)
+#define SCHEDULE_IMPORT_SPOOL_PATH "/schedule_import.tmp"
 
 /**
  * @class ApiRoutes
@@ -45,6 +58,40 @@ private:
     ScheduleManager& scheduleManager; ///< Reference to the schedule management service.
     LockManager& lockManager;         ///< Reference to the resource lock management service.
     bool httpsEnabled;                ///< Flag indicating if HTTPS is enabled (for secure cookies).
+    StaticAssetHandler staticAssets;  ///< Precompressed /www assets (registered ahead of serveStatic).
+
+    // Fixed arena for schedule POST/PUT bodies, allocated once with this object
+    struct BodySlot {
+        AsyncWebServerRequest* owner = nullptr; ///< Request currently receiving into this slot, nullptr if free.
+        size_t length = 0;                     ///< Bytes received so far.
+        char data[SCHEDULE_BODY_MAX_SIZE];    ///< Body bytes (never logged: they may hold user data).
+    };
+    BodySlot bodySlots[SCHEDULE_BODY_SLOTS];
+
+    // Bulk import body being spooled to SCHEDULE_IMPORT_SPOOL_PATH (async TCP task only)
+    AsyncWebServerRequest* importOwner = nullptr; ///< Request currently uploading, nullptr if none.
+    File importSpool;
+
+    // Login verified on the UserManager worker. The worker only fills in the result; the
+    // response is built from it on the async TCP task (see DeferredResponse).
+    struct PendingLogin {
+        std::atomic<bool> done{false};      ///< Set by the worker once result and user are written
+        std::atomic<bool> cancelled{false}; ///< Client disconnected: the worker drops the job
+        LoginResult result = LoginResult::INVALID_CREDENTIALS;
+        UserAccount user;
+    };
+
+    // Spooled bulk import parsed and saved on the PersistenceWorker, so its flash writes
+    // stay off the async TCP task. The worker fills in status and body; the response is
+    // built from them on the async TCP task (see DeferredResponse).
+    struct PendingImport {
+        ApiRoutes* routes = nullptr;
+        SessionData session;           ///< Importing session, copied when the upload completed
+        std::atomic<bool> done{false}; ///< Set by the worker once status and body are written
+        int status = 500;
+        String body;
+    };
+    std::atomic<bool> importRunning{false}; ///< A spooled import is queued or running on the worker
 
     // --- Private Helper Functions ---
     /**
@@ -52,15 +99,44 @@ private:
      * @param response Pointer to the AsyncWebServerResponse object.
      */
     void addSecurityHeaders(AsyncWebServerResponse *response);
+    /**
+     * @brief Writes a String as a quoted, escaped JSON string to a stream.
+     *        GET handlers stream their payload into an AsyncResponseStream piece by piece
+     *        so peak memory does not scale with the response size.
+     * @param out The stream to write to.
+     * @param value The string value to encode.
+     */
+    static void streamJsonString(Print& out, const String& value);
+
+    /** @brief Claims a free body slot for @p request, or returns nullptr if all are busy. */
+    BodySlot* acquireBodySlot(AsyncWebServerRequest *request);
+    /** @brief Returns the body slot owned by @p request, or nullptr. */
+    BodySlot* findBodySlot(AsyncWebServerRequest *request);
+    /** @brief Frees the body slot owned by @p request (no-op if it owns none). */
+    void releaseBodySlot(AsyncWebServerRequest *request);
+    /** @brief Closes and removes the import spool if @p request owns it (no-op otherwise). */
+    void releaseImportSpool(AsyncWebServerRequest *request);
+    /** @brief PersistenceWorker job; @p context is a heap std::shared_ptr<PendingImport>. */
+    static void scheduleImportJob(void* context);
+    /** @brief Imports SCHEDULE_IMPORT_SPOOL_PATH into @p pending's result; PersistenceWorker task only. */
+    void runScheduleImport(PendingImport& pending);
 
     // --- Private Request Handlers ---
     // These will be bound to the server routes
     /** @brief Handles POST requests to /api/login for user authentication. */
     void handleLogin(AsyncWebServerRequest *request);
+    /** @brief Builds the login result response (session cookie on success); async TCP task only. */
+    AsyncWebServerResponse* buildLoginResponse(AsyncWebServerRequest *request, LoginResult result, const UserAccount& user);
     /** @brief Handles POST requests to /api/logout to invalidate the user session. */
     void handleLogout(AsyncWebServerRequest *request);
     /** @brief Handles GET requests to /api/user to retrieve current user information. */
     void handleGetUserInfo(AsyncWebServerRequest *request);
+    /** @brief Handles GET requests to /api/logs?since=... to read the in-RAM log ring (owner only). */
+    void handleGetLogs(AsyncWebServerRequest *request);
+    /** @brief Handles GET requests to /api/metrics (Prometheus text format, no session required). */
+    void handleGetMetrics(AsyncWebServerRequest *request);
+    /** @brief Handles GET requests to /api/history?point=...&from=...&to=... (streamed samples of one point). */
+    void handleGetHistory(AsyncWebServerRequest *request);
 
     // Schedule API Handlers
     /** @brief Handles GET requests to /api/schedules to list all available schedules. */
@@ -71,7 +147,8 @@ private:
     void handleDeleteSchedule(AsyncWebServerRequest *request);
     /**
      * @brief Handles the body content for POST and PUT requests to /api/schedule.
-     *        Used for creating (POST) or updating (PUT) a schedule.
+     *        Used for creating (POST) or updating (PUT) a schedule. Chunks are received
+     *        into a fixed arena slot (see SCHEDULE_BODY_SLOTS) and parsed in place.
      * @param request Pointer to the request object.
      * @param data Pointer to the data chunk.
      * @param len Length of the data chunk.
@@ -85,6 +162,22 @@ private:
     /** @brief Handles DELETE requests to /api/schedule/lock?uid=... to release an edit lock. */
     void handleScheduleLockDelete(AsyncWebServerRequest *request); // Handler for DELETE /api/schedule/lock
 
+    // Bulk schedule API
+    /** @brief Handles GET requests to /api/schedules/export (all schedules as one JSON array, streamed). */
+    void handleScheduleExport(AsyncWebServerRequest *request);
+    /**
+     * @brief Handles the body of POST /api/schedules/import (JSON array of schedules).
+     *        Chunks are spooled to flash; on the last chunk the array is parsed one
+     *        schedule at a time and answered with one result per item.
+     */
+    void handleScheduleImportBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total);
+    /**
+     * @brief Validates one imported schedule object into @p schedule.
+     * @param error Set to the reason when the item is rejected.
+     * @return True if the schedule can be saved.
+     */
+    bool buildImportedSchedule(JsonObject item, const SessionData& session, Schedule& schedule, String& error);
+
     // Add other handlers if needed...
 };
 
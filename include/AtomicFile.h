@@ -0,0 +1,108 @@
+#ifndef ATOMIC_FILE_H
+#define ATOMIC_FILE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <ArduinoJson.h>
+
+// Crash-safe file writes shared by all persistence code.
+//
+// Content is written to "<path>.tmp" and renamed over the target once complete, so a
+// power cut leaves either the old or the new file, never a truncated one. Writes are
+// collected in a page-sized buffer and handed to LittleFS in whole chunks instead of
+// the byte-wise File writes ArduinoJson would otherwise issue.
+//
+// With a CRC the file ends in a trailer line "\n#crc32=xxxxxxxx\n" over all preceding
+// bytes. ArduinoJson stops reading at the end of the top-level value, so files with a
+// trailer still parse with plain deserializeJson(); readJsonFile() verifies it.
+
+// Suffix of the temporary file a write goes to before the rename
+#define ATOMIC_FILE_TEMP_SUFFIX ".tmp"
+// Write buffer size: one SPI flash program page (also the LittleFS cache size)
+#define ATOMIC_FILE_CHUNK_SIZE 256
+// Length of the CRC trailer "\n#crc32=xxxxxxxx\n"
+#define ATOMIC_FILE_CRC_TRAILER_LENGTH 17
+// Files up to this size are read with one read() call (and CRC-checked);
+// larger ones are parsed from the stream without the check
+#define ATOMIC_FILE_MAX_BUFFERED_READ 16384
+
+/**
+ * @enum FileReadResult
+ * @brief Outcome of readJsonFile().
+ */
+enum class FileReadResult {
+    OK,
+    NOT_FOUND, ///< Neither the file nor a complete temporary copy exists
+    CORRUPT    ///< Unreadable, CRC mismatch or invalid JSON
+};
+
+/**
+ * @class AtomicFileWriter
+ * @brief Print sink that writes a file via temp file + rename.
+ *
+ * Usage: open(), print/serializeJson into it, then commit(). Destroying the writer
+ * without commit() discards the temporary file and leaves the target untouched.
+ */
+class AtomicFileWriter : public Print {
+public:
+    explicit AtomicFileWriter(bool withCrc = false);
+    ~AtomicFileWriter();
+
+    AtomicFileWriter(const AtomicFileWriter&) = delete;
+    AtomicFileWriter& operator=(const AtomicFileWriter&) = delete;
+
+    bool open(const String& path);
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+
+    /**
+     * @brief Flushes, appends the CRC trailer (if enabled) and renames over the target.
+     * @return True if the complete file is in place, false if any write failed
+     *         (the previous target file, if any, is kept).
+     */
+    bool commit();
+    // Discards the temporary file; no-op after commit()
+    void abort();
+
+    // Size of the committed file, CRC trailer included
+    size_t fileSize() const { return _total; }
+
+private:
+    String _path;
+    String _tempPath;
+    File _file;
+    bool _withCrc;
+    bool _open = false;
+    bool _failed = false;
+    uint32_t _crc = 0;
+    size_t _total = 0;
+    size_t _used = 0;
+    uint8_t _buffer[ATOMIC_FILE_CHUNK_SIZE];
+
+    bool flushBuffer();
+};
+
+/**
+ * @brief Serializes a document to @p path atomically (see AtomicFileWriter).
+ * @param path Target file path.
+ * @param doc Document to write.
+ * @param withCrc Append a CRC trailer that readJsonFile() verifies.
+ * @param fileSize Optional; receives the size of the written file.
+ * @return True if the file was written completely and renamed into place.
+ */
+bool writeJsonFileAtomic(const String& path, const JsonDocument& doc, bool withCrc = false, size_t* fileSize = nullptr);
+
+/**
+ * @brief Reads and parses a JSON file written by writeJsonFileAtomic() (or by hand).
+ *
+ * A CRC trailer, if present, must match. If @p path is missing but a complete
+ * temporary copy exists (power loss between the two steps of a non-atomic rename),
+ * the copy is moved into place and read.
+ *
+ * @param path File path.
+ * @param doc Populated on success.
+ * @param fileSize Optional; receives the size of the file on disk.
+ */
+FileReadResult readJsonFile(const String& path, JsonDocument& doc, size_t* fileSize = nullptr);
+
+#endif // ATOMIC_FILE_H
@@ -3,6 +3,9 @@
 
 #include <Arduino.h>
 
+/** @brief Longest salt (in bytes) accepted by AuthUtils::hashPassword. */
+#define AUTH_MAX_SALT_BYTES 64
+
 /**
  * @namespace AuthUtils
  * @brief Provides utility functions for secure password handling and data conversion.
@@ -0,0 +1,106 @@
+#ifndef AUTOPILOT_ENGINE_H
+#define AUTOPILOT_ENGINE_H
+
+#include <Arduino.h>
+#include <vector>
+#include "PointRegistry.h"
+#include "ScheduleData.h"
+
+struct OutputCommand;
+
+// Zones share the task's 32-bit notification value: bit i wakes zone i, the top bit all zones
+#define AUTOPILOT_MAX_ZONES 16
+#define AUTOPILOT_WAKE_ALL (1UL << 31)
+// Input role in ActiveCycleConfiguration::associatedInputs that drives the autopilot
+#define AUTOPILOT_INPUT_ROLE "AUTOPILOT_CONTROL"
+// Tension must fall this far below the window's matricTension before a new crossing counts
+#define AUTOPILOT_TENSION_HYSTERESIS 0.5f
+
+/**
+ * @struct AutopilotZone
+ * @brief One active cycle under tension control: its sensor, valves and autopilot windows.
+ */
+struct AutopilotZone {
+    String cycleId;
+    String scheduleUID;
+    PointHandle input = INVALID_POINT_HANDLE; ///< First resolvable AUTOPILOT_CONTROL input
+    std::vector<PointHandle> outputs;         ///< Relays opened together for a dose
+    std::vector<AutopilotWindow> windows;     ///< Sorted by startTime
+    int watchId = -1;                         ///< InputPointManager threshold watch, -1 for a free slot
+    int activeWindow = -1;                    ///< Index into windows, -1 outside all windows
+    bool settling = false;
+    uint32_t settleUntilMs = 0;               ///< millis() when the settling period ends
+    uint32_t wakeAtMs = 0;                    ///< Next timer-driven evaluation
+    uint32_t handledCrossingUs = 0;           ///< Crossing already measured
+    uint32_t doses = 0;
+};
+
+/**
+ * @struct AutopilotDoseLog
+ * @brief A dose decision, logged once the commands are queued and zoneMutex is released.
+ */
+struct AutopilotDoseLog {
+    String cycleId;
+    float tension = 0.0f;
+    float threshold = 0.0f;
+    uint32_t volumeMl = 0;
+    int doseDuration = 0;
+    bool dosed = false;     ///< False if the window has nothing to dose and only settles
+    uint32_t doses = 0;     ///< Zone's dose count
+    int windowStart = 0;    ///< Window startTime (minutes)
+};
+
+/**
+ * @class AutopilotEngine
+ * @brief Doses a zone when its tensiometer reading crosses the active window's matricTension.
+ *
+ * Each zone registers one threshold watch on its control input. The task blocks on its
+ * notification value and wakes only when a watch reports a crossing (bit per zone), when a
+ * settling period or window boundary is due (timeout), or when schedules change; on a wake
+ * only the flagged or due zones are evaluated. A dose opens all of the zone's relays with
+ * TURN_ON_TIMED for doseDuration seconds (TURN_ON_VOLUME for doseVolume mL on relays with a
+ * flow meter), after which the zone settles for doseDuration plus settlingTime minutes
+ * before the reading is considered again.
+ *
+ * Reaction time (crossing published by the sampler -> dose queued) is recorded in
+ * RuntimeMetrics (snr_autopilot_reaction_us). It is bounded by one sampler period plus the
+ * task's wake-up, since the task runs above the schedule engine and evaluates only the
+ * zones that flagged a change.
+ */
+class AutopilotEngine {
+public:
+    // Loads zones from the active cycles and starts the task.
+    // Call after the IO managers, ScheduleManager and the calibration curves are ready.
+    bool begin();
+
+    // Called by ScheduleManager after a schedule file was written / removed
+    void onScheduleSaved(const String& scheduleUID);
+    // Called by CycleManager when a cycle enters a new step. Adds, rebinds or removes the
+    // cycle's zone: a cycle is a zone while its step has a schedule (non-empty UID) and it
+    // has an AUTOPILOT_CONTROL input.
+    void rebindCycle(const String& cycleId, const String& scheduleUID,
+                     const std::vector<String>& inputIds, const std::vector<String>& outputIds);
+
+    size_t zoneCount() const;
+
+private:
+    // Guarded by zoneMutex. Slot i owns notification bit i, so a removed zone leaves a free
+    // slot (watchId -1) that the next added zone reuses.
+    std::vector<AutopilotZone> zones;
+    void* zoneMutex = nullptr;        // FreeRTOS mutex (opaque type)
+    void* taskHandle = nullptr;       // FreeRTOS task handle (opaque type)
+
+    void loadZones();
+    void addZone(const String& cycleId, const String& scheduleUID, const std::vector<String>& inputIds,
+                 const std::vector<String>& outputIds, const std::vector<AutopilotWindow>& windows);
+    void removeZone(AutopilotZone& zone);
+    AutopilotZone* findZone(const String& cycleId);
+    static std::vector<AutopilotWindow> readWindows(const String& scheduleUID);
+    static void taskWrapper(void* parameter);
+    void task();
+    uint32_t evaluateZone(AutopilotZone& zone, uint32_t secondOfDay, uint32_t nowMs,
+                          std::vector<OutputCommand>& commands, std::vector<uint32_t>& reactionStarts,
+                          std::vector<AutopilotDoseLog>& doseLogs);
+};
+
+#endif // AUTOPILOT_ENGINE_H
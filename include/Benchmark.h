@@ -0,0 +1,79 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <Arduino.h>
+
+// Benchmark builds (pio run -e esp32dev_bench) set SNR_BENCHMARK=1. In normal builds
+// the BENCH_* macros compile to nothing and no recorder storage is allocated.
+#ifndef SNR_BENCHMARK
+#define SNR_BENCHMARK 0
+#endif
+
+// Samples kept per recorder (newest win); percentiles are computed over these
+#define BENCH_MAX_SAMPLES 512
+// Iterations of each synthetic benchmark run by the benchmark task
+#define BENCH_ITERATIONS 50
+// Period of the recurring report (passive recorders fill from real traffic)
+#define BENCH_REPORT_PERIOD_MS (60UL * 1000)
+
+#if SNR_BENCHMARK
+
+#include <freertos/FreeRTOS.h>
+
+/**
+ * @class LatencyRecorder
+ * @brief Fixed-size store of microsecond timings with percentile reporting.
+ *
+ * record() is safe from any task (short critical section, no allocation).
+ * report() copies the samples and sorts the copy, so it never blocks recorders
+ * for longer than the copy.
+ */
+class LatencyRecorder {
+public:
+    explicit LatencyRecorder(const char* name);
+
+    void record(uint32_t micros);
+    void reset();
+    // Prints: name, count, min, p50, p90, p99, max (us)
+    void report(Print& out);
+
+private:
+    const char* name;
+    uint32_t samples[BENCH_MAX_SAMPLES];
+    uint32_t total = 0;     ///< Samples recorded since reset (may exceed BENCH_MAX_SAMPLES)
+    portMUX_TYPE lock;
+};
+
+/** @brief Records the lifetime of the object into a LatencyRecorder. */
+struct BenchScope {
+    LatencyRecorder& recorder;
+    int64_t startUs;
+    explicit BenchScope(LatencyRecorder& r);
+    ~BenchScope();
+};
+
+// Recorders fed by the instrumented code paths
+extern LatencyRecorder benchLoadSchedule;
+extern LatencyRecorder benchSaveSchedule;
+extern LatencyRecorder benchAcquireLock;
+extern LatencyRecorder benchValidateSession;
+extern LatencyRecorder benchRelayLatch;   ///< Command enqueue -> shift register latch
+
+// Starts the benchmark task: runs the synthetic benchmarks once, then reports periodically
+void startBenchmarks();
+
+#define BENCH_CONCAT_INNER(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_INNER(a, b)
+/** @brief Times the rest of the enclosing scope into @p recorder. */
+#define BENCH_SCOPE(recorder) BenchScope BENCH_CONCAT(benchScope_, __LINE__)(recorder)
+/** @brief Records one explicit timing in microseconds. */
+#define BENCH_RECORD(recorder, micros) (recorder).record(micros)
+
+#else
+
+#define BENCH_SCOPE(recorder) ((void)0)
+#define BENCH_RECORD(recorder, micros) ((void)0)
+
+#endif // SNR_BENCHMARK
+
+#endif // BENCHMARK_H
@@ -6,6 +6,12 @@
 #include <vector>
 #include "IOConfig.h"
 #include "OutputTypeData.h"
+#include "ModbusData.h"
+
+// Board I/O layout parsed by loadBoardIOConfig()
+#define BOARD_CONFIG_PATH "/board_config.json"
+// Relay type catalogue parsed by loadRelayTypes()
+#define RELAY_TYPES_PATH "/data/relay_types.json"
 
 // Structure to hold application configuration
 struct AppConfig {
@@ -53,12 +59,28 @@ public:
     AppConfig& getConfig();
 
     // === Step 2: I/O Foundation Methods ===
+    /**
+     * @brief Fast-boot load of the board I/O configuration and the relay types.
+     *
+     * Decodes the binary snapshot (ConfigSnapshot.h) when it was built from the current
+     * board_config.json and relay_types.json; otherwise parses both with
+     * loadBoardIOConfig() / loadRelayTypes() and rewrites the snapshot. The relay types
+     * are kept for getOutputTypes().
+     * @return False only if no board configuration could be loaded.
+     */
+    bool loadIOConfig(IOConfiguration& ioConfig);
+    // Relay types from the last loadIOConfig()
+    const std::vector<OutputTypeDefinition>& getOutputTypes() const { return outputTypes; }
+
     bool loadBoardIOConfig(IOConfiguration& ioConfig);
     bool loadRelayTypes(std::vector<OutputTypeDefinition>& outputTypes);
+    // Loads /modbus_profiles/<profileId>.json
+    bool loadModbusProfile(const String& profileId, ModbusDeviceProfile& profile);
 
 private:
     AppConfig config; ///< Internal structure holding the currently loaded configuration data.
     String _configFilePath; ///< Path to the configuration file in the filesystem.
+    std::vector<OutputTypeDefinition> outputTypes; ///< Relay types from loadIOConfig().
 
     // Helper to create a default config file if it doesn't exist
     /**
@@ -0,0 +1,65 @@
+#ifndef CONFIG_SNAPSHOT_H
+#define CONFIG_SNAPSHOT_H
+
+#include <Arduino.h>
+#include <vector>
+#include "IOConfig.h"
+#include "OutputTypeData.h"
+
+// Binary snapshot of the parsed board I/O configuration and relay types
+// (/config_snapshot.bin). Written by ConfigManager::loadIOConfig() after parsing the
+// JSON sources; on the next boot it is decoded instead, as long as both sources still
+// have the size and CRC-32 recorded in the header. File mtimes are not used: the clock
+// is unset at boot, so LittleFS timestamps do not tell two edits apart.
+//
+// File layout: ConfigSnapshotHeader, then payloadSize bytes of length-prefixed fields
+// in declaration order of the structs (see ConfigSnapshot.cpp), covered by payloadCrc.
+
+#define CONFIG_SNAPSHOT_PATH    "/config_snapshot.bin"
+#define CONFIG_SNAPSHOT_MAGIC   0x43524E53UL // "SNRC" little-endian
+// Bump whenever a field is added to IOConfig.h / OutputTypeData.h or the encoding changes
+#define CONFIG_SNAPSHOT_VERSION 3
+// Larger snapshots are rejected before allocating the payload buffer
+#define CONFIG_SNAPSHOT_MAX_PAYLOAD 16384
+
+/** @brief Identity of one JSON source file; size 0 means the file is missing. */
+struct ConfigSourceStamp {
+    uint32_t size;
+    uint32_t crc; ///< CRC-32 of the whole file
+};
+
+/** @brief Fixed header at offset 0 of the snapshot file. */
+struct ConfigSnapshotHeader {
+    uint32_t magic;              ///< CONFIG_SNAPSHOT_MAGIC
+    uint16_t version;            ///< CONFIG_SNAPSHOT_VERSION
+    uint16_t headerSize;         ///< sizeof(ConfigSnapshotHeader)
+    uint32_t payloadSize;
+    uint32_t payloadCrc;
+    ConfigSourceStamp board;     ///< board_config.json the snapshot was built from
+    ConfigSourceStamp relayTypes;///< relay_types.json the snapshot was built from
+};
+
+static_assert(sizeof(ConfigSnapshotHeader) == 32, "ConfigSnapshotHeader layout changed");
+
+/**
+ * @brief Computes the stamp of a source file (one streaming pass, no parsing).
+ * @return False if the file does not exist; @p stamp is then {0, 0}.
+ */
+bool stampConfigSource(const String& path, ConfigSourceStamp& stamp);
+
+/**
+ * @brief Writes the snapshot atomically (temp file + rename).
+ * @return True if the complete file is in place.
+ */
+bool writeConfigSnapshot(const String& path, const ConfigSourceStamp& board, const ConfigSourceStamp& relayTypes,
+                         const IOConfiguration& ioConfig, const std::vector<OutputTypeDefinition>& outputTypes);
+
+/**
+ * @brief Decodes the snapshot if it was built from exactly these sources.
+ * @return False if it is missing, stale, corrupt or from another version; the
+ *         outputs are then unspecified and the caller parses the JSON instead.
+ */
+bool readConfigSnapshot(const String& path, const ConfigSourceStamp& board, const ConfigSourceStamp& relayTypes,
+                        IOConfiguration& ioConfig, std::vector<OutputTypeDefinition>& outputTypes);
+
+#endif // CONFIG_SNAPSHOT_H
@@ -59,7 +59,7 @@ enum CycleState {
 };
 
 // Helper function to convert CycleState enum to String
-String cycleStateToString(CycleState state) {
+inline String cycleStateToString(CycleState state) {
     switch (state) {
         case DRAFT: return "DRAFT";
         case SAVED_DORMANT: return "SAVED_DORMANT";
@@ -73,7 +73,7 @@ String cycleStateToString(CycleState state) {
 }
 
 // Helper function to convert String to CycleState enum
-CycleState stringToCycleState(const String& stateStr) {
+inline CycleState stringToCycleState(const String& stateStr) {
     if (stateStr.equalsIgnoreCase("DRAFT")) return DRAFT;
     if (stateStr.equalsIgnoreCase("SAVED_DORMANT")) return SAVED_DORMANT;
     if (stateStr.equalsIgnoreCase("SAVED_ACTIVE")) return SAVED_ACTIVE;
@@ -0,0 +1,106 @@
+#ifndef CYCLE_MANAGER_H
+#define CYCLE_MANAGER_H
+
+#include <Arduino.h>
+#include <vector>
+#include <unordered_set>
+#include <ctime>
+#include "CycleData.h"
+
+// Lock resource prefix used by ApiRoutes for schedules ("schedule_<uid>")
+#define CYCLE_SCHEDULE_RESOURCE_PREFIX "schedule_"
+
+/**
+ * @struct CycleRuntime
+ * @brief An active cycle with its precomputed day -> step table.
+ */
+struct CycleRuntime {
+    String cycleId;
+    String filePath;                    ///< Active cycle JSON, rewritten when the step advances
+    int32_t startDay = 0;               ///< cycleStartDate as days since 1970-01-01
+    std::vector<uint8_t> stepByDay;     ///< Day index into the cycle -> index into steps
+    std::vector<ActiveCycleStep> steps; ///< cycleSequence
+    std::vector<String> outputIds;
+    std::vector<String> controlInputIds; ///< associatedInputs with role AUTOPILOT_INPUT_ROLE, in file order
+    int currentIndex = -1;              ///< Index into steps, -1 before the start / once completed
+    bool persistPending = false;        ///< Step change not yet written (persistence worker)
+    int32_t persistDay = 0;             ///< Day of that step change
+};
+
+/**
+ * @struct CycleBinding
+ * @brief What a cycle runs right now: the schedule of its current step and its points.
+ */
+struct CycleBinding {
+    String cycleId;
+    String scheduleUID;                  ///< Library schedule of the current step
+    std::vector<String> outputIds;
+    std::vector<String> controlInputIds; ///< AUTOPILOT_CONTROL inputs
+};
+
+/**
+ * @class CycleManager
+ * @brief Advances SAVED_ACTIVE cycles through their step sequence at local midnight.
+ *
+ * begin() parses each active cycle once and expands its sequence into stepByDay (one
+ * byte per day of the cycle), so "what runs on day N" is a single array lookup; no cycle
+ * or template file is read again at rollover. When a cycle enters a new step its relays
+ * are rebound in ScheduleEngine and AutopilotEngine, and currentStep / stepStartDate are
+ * written back to the cycle file by the persistence worker. Past the last day the cycle
+ * is marked COMPLETED.
+ *
+ * Both engines run the library schedule of the step (libraryScheduleId) and take their
+ * boot-time bindings from currentBindings(). No per-cycle schedule copies are made:
+ * the schedules of the current steps are kept in a hash set of lock resource ids, and
+ * every write path checks it in O(1): LockManager::acquireLock() and the schedule PUT,
+ * DELETE and import routes refuse a running schedule.
+ */
+class CycleManager {
+public:
+    // Loads the active cycles. Call after ScheduleManager; steps are applied by onDayChanged().
+    bool begin();
+
+    /**
+     * @brief Moves every cycle to the step of the local day of @p now.
+     *
+     * Called by the ScheduleEngine task when the local day changes (and on its first
+     * run with a valid clock); a no-op for cycles already on the right step.
+     */
+    void onDayChanged(time_t now);
+
+    // O(1); safe from any task
+    bool isResourceInActiveCycle(const String& resourceId) const;
+
+    /**
+     * @brief Library schedule that @p cycleId runs on local day @p dayNumber (days since 1970-01-01).
+     * @return Empty if the cycle is unknown or not running on that day.
+     */
+    String scheduleForDay(const String& cycleId, int32_t dayNumber) const;
+
+    // Bindings of every cycle that is on a step, as loaded by begin(); read by the engines' begin()
+    std::vector<CycleBinding> currentBindings() const;
+
+    size_t cycleCount() const { return cycles.size(); }
+
+private:
+    // FNV-1a; Arduino String has no std::hash
+    struct StringHash {
+        size_t operator()(const String& s) const;
+    };
+
+    std::vector<CycleRuntime> cycles;                       // Guarded by cycleMutex
+    std::unordered_set<String, StringHash> activeResources; // Guarded by cycleMutex
+    void* cycleMutex = nullptr; // FreeRTOS mutex (opaque type)
+
+    bool loadCycle(const String& path, CycleRuntime& cycle);
+    void enterStep(CycleRuntime& cycle, int index);
+    bool persistStep(const CycleRuntime& cycle, int index, int32_t today);
+    void persistPendingSteps();
+    static void persistJob(void* context);
+    void rebuildActiveResources();
+    static int stepIndexForDay(const CycleRuntime& cycle, int32_t dayNumber);
+    static bool parseIsoDay(const String& iso, int32_t& dayNumber);
+    static String isoFromDay(int32_t dayNumber);
+};
+
+#endif // CYCLE_MANAGER_H
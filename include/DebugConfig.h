@@ -7,12 +7,47 @@
  * @brief Centralized configuration for conditional debug logging macros.
  *
  * This file defines preprocessor flags and macros to enable or disable
- * Serial debug output for specific modules (e.g., API routes, Schedule API).
- * To enable logging for a module, define its corresponding `ENABLE_..._DEBUG_LOGGING` flag.
- * To disable logging (e.g., for release builds), comment out or `#undef` the flag.
+ * debug output for specific modules (e.g., API routes, Schedule API).
+ * To enable logging for a module, define its corresponding `ENABLE_..._DEBUG_LOGGING` flag,
+ * or raise its `LOG_LEVEL_<MODULE>`. To disable logging (e.g., for release builds),
+ * comment out or `#undef` the flag / set the level to LOG_LEVEL_NONE.
  * When disabled, the logging macros compile to nothing, minimizing performance impact.
+ *
+ * Enabled messages are not printed on the calling task: they go into the LogBuffer
+ * ring and are written to Serial by its low-priority drain task (and can be read
+ * through /api/logs).
+ */
+#include <Arduino.h>
+#include "LogBuffer.h"
+
+// --- Per-module log levels ---
+// Each can be overridden from platformio.ini, e.g. build_flags = -DLOG_LEVEL_OUTPUTS=LOG_LEVEL_DEBUG
+// (module names avoid Arduino's INPUT/OUTPUT macros, which would expand inside LOGx()).
+#ifndef LOG_LEVEL_OUTPUTS
+#define LOG_LEVEL_OUTPUTS LOG_LEVEL_INFO  ///< OutputPointManager
+#endif
+#ifndef LOG_LEVEL_INPUTS
+#define LOG_LEVEL_INPUTS LOG_LEVEL_INFO   ///< InputPointManager
+#endif
+#ifndef LOG_LEVEL_SCHEDULE
+#define LOG_LEVEL_SCHEDULE LOG_LEVEL_INFO ///< ScheduleManager / ScheduleEngine / AutopilotEngine / CycleManager
+#endif
+#ifndef LOG_LEVEL_MODBUS
+#define LOG_LEVEL_MODBUS LOG_LEVEL_INFO   ///< ModbusMaster
+#endif
+
+/**
+ * @def LOG_AT
+ * @brief Logs a printf-style message for @p module if @p level is enabled for it.
+ *        The condition is a compile-time constant, so disabled calls (including their
+ *        argument evaluation) are removed by the compiler.
  */
-#include <Arduino.h> // Required for Serial
+#define LOG_AT(module, level, ...) \
+    do { if ((level) <= LOG_LEVEL_##module) logPrintf((level), #module, __VA_ARGS__); } while (0)
+#define LOGE(module, ...) LOG_AT(module, LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOGW(module, ...) LOG_AT(module, LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOGI(module, ...) LOG_AT(module, LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOGD(module, ...) LOG_AT(module, LOG_LEVEL_DEBUG, __VA_ARGS__)
 
 // --- Conditional Debug Logging for API Routes ---
 // Define this flag to enable detailed logging in ApiRoutes.
@@ -22,15 +57,15 @@
  * @brief Define this macro to enable detailed Serial logging within the ApiRoutes class.
  *        Comment out or undefine for release builds to disable these logs.
  */
-#define ENABLE_API_DEBUG_LOGGING
+// #define ENABLE_API_DEBUG_LOGGING
 
 #ifdef ENABLE_API_DEBUG_LOGGING
-  /** @brief Prints debug messages via Serial (enabled). */
-  #define API_DEBUG_PRINT(...)    Serial.print(__VA_ARGS__)
-  /** @brief Prints debug messages with a newline via Serial (enabled). */
-  #define API_DEBUG_PRINTLN(...)  Serial.println(__VA_ARGS__)
-  /** @brief Prints formatted debug messages via Serial (enabled). */
-  #define API_DEBUG_PRINTF(...)   Serial.printf(__VA_ARGS__)
+  /** @brief Logs debug messages to the log ring (enabled). */
+  #define API_DEBUG_PRINT(text)   logPrint(LOG_LEVEL_DEBUG, "API", text)
+  /** @brief Logs debug messages to the log ring (enabled); one record per call. */
+  #define API_DEBUG_PRINTLN(text) logPrint(LOG_LEVEL_DEBUG, "API", text)
+  /** @brief Logs formatted debug messages to the log ring (enabled). */
+  #define API_DEBUG_PRINTF(...)   logPrintf(LOG_LEVEL_DEBUG, "API", __VA_ARGS__)
 #else
   // Define as empty when the flag is not set (compiler optimizes away)
   /** @brief Prints debug messages (disabled, compiles to nothing). */
@@ -53,12 +88,12 @@
 #define ENABLE_SCHEDULE_API_DEBUG_LOGGING
 
 #ifdef ENABLE_SCHEDULE_API_DEBUG_LOGGING
-  /** @brief Prints schedule API debug messages via Serial (enabled). */
-  #define SCH_API_DEBUG_PRINT(...)    Serial.print(__VA_ARGS__)
-  /** @brief Prints schedule API debug messages with a newline via Serial (enabled). */
-  #define SCH_API_DEBUG_PRINTLN(...)  Serial.println(__VA_ARGS__)
-  /** @brief Prints formatted schedule API debug messages via Serial (enabled). */
-  #define SCH_API_DEBUG_PRINTF(...)   Serial.printf(__VA_ARGS__)
+  /** @brief Logs schedule API debug messages to the log ring (enabled). */
+  #define SCH_API_DEBUG_PRINT(text)   logPrint(LOG_LEVEL_DEBUG, "SCH_API", text)
+  /** @brief Logs schedule API debug messages to the log ring (enabled); one record per call. */
+  #define SCH_API_DEBUG_PRINTLN(text) logPrint(LOG_LEVEL_DEBUG, "SCH_API", text)
+  /** @brief Logs formatted schedule API debug messages to the log ring (enabled). */
+  #define SCH_API_DEBUG_PRINTF(...)   logPrintf(LOG_LEVEL_DEBUG, "SCH_API", __VA_ARGS__)
 #else
   /** @brief Prints schedule API debug messages (disabled, compiles to nothing). */
   #define SCH_API_DEBUG_PRINT(...)    ((void)0)
@@ -0,0 +1,97 @@
+#ifndef FLOW_METER_MANAGER_H
+#define FLOW_METER_MANAGER_H
+
+#include <Arduino.h>
+#include "IOConfig.h"
+#include "PointRegistry.h"
+
+// PCNT units used for flow meters (units 0..FLOW_MAX_METERS-1)
+#define FLOW_MAX_METERS 4
+// Counter window of an idle meter; the 16-bit PCNT counter restarts at this limit
+#define FLOW_PCNT_MAX_WINDOW 32000
+// Glitch filter in APB cycles (80 MHz, at most 1023): pulses shorter than ~12 us are ignored
+#define FLOW_PCNT_FILTER_CYCLES 1000
+// Safety timeout of a volume dose that has no precomputed duration
+#define FLOW_DOSE_DEFAULT_TIMEOUT_MS (30UL * 60 * 1000)
+// Safety timeout of a volume dose relative to its precomputed (flow-rate based) duration
+#define FLOW_DOSE_TIMEOUT_FACTOR 2
+
+/**
+ * @class FlowMeterManager
+ * @brief Counts flow meter pulses in the PCNT peripheral and ends volume doses in its interrupt.
+ *
+ * Pulses are counted by hardware, with no CPU time per pulse. The counter's high
+ * limit is the dose watch-point: when a dose is armed the limit is set to the pulses
+ * still missing (in windows of at most FLOW_PCNT_MAX_WINDOW), and the limit interrupt
+ * that completes the dose calls OutputPointManager::endVolumeDose() under flowMux, which
+ * switches a local relay off right there (a Modbus coil is only staged). Once flowMux
+ * is released, volumeDoseEnded() commits the staged write and hands the bookkeeping
+ * (safety timer, live events) to a task. Dose accuracy therefore depends on
+ * interrupt latency only, not on task scheduling. The interrupt is allocated on the
+ * core that calls begin() (setup(), on IO_CORE); it is not IRAM-resident, so a flash
+ * write delays it by the duration of the write.
+ *
+ * Doses are armed and cancelled by the OutputPointManager command processor
+ * (RelayCommandType::TURN_ON_VOLUME); ScheduleEngine and AutopilotEngine send such
+ * commands for relays that have a meter. Each meter measures one relay
+ * (board_config.json directIO.flowMeters[].outputPointId).
+ */
+class FlowMeterManager {
+public:
+    // Registers the FLOW_METER points and configures one PCNT unit per meter.
+    // Call after OutputPointManager::begin() (meters resolve their relay).
+    bool begin(const IOConfiguration& ioConfig);
+
+    // Meter index measuring relay @p relayIndex / relay point @p output, -1 if none. O(meters).
+    int meterForRelay(int relayIndex) const;
+    int meterForOutput(PointHandle output) const;
+
+    // Pulses counted since boot on a FLOW_METER point, in litres; -1 for other points
+    float getTotalLiters(PointHandle meterPoint) const;
+
+    /**
+     * @brief Arms the volume watch-point for the meter of @p relayIndex.
+     *
+     * Called by the command processor with the relay already staged on. When @p volumeMl
+     * has passed the meter, OutputPointManager::endVolumeDose(@p relayIndex) is called from
+     * the PCNT interrupt, then volumeDoseEnded(@p relayIndex, @p doseSeq). Replaces a dose
+     * still running on that meter.
+     * @return False if the relay has no meter.
+     */
+    bool armDose(int relayIndex, uint32_t volumeMl, uint16_t doseSeq);
+
+    // Disarms the dose of @p relayIndex, if any; true if one was running
+    bool cancelDose(int relayIndex);
+
+    size_t meterCount() const { return count; }
+
+private:
+    struct FlowMeter {
+        PointHandle point = INVALID_POINT_HANDLE;
+        int unit = 0;                  ///< PCNT unit
+        float pulsesPerLiter = 0.0f;
+        int16_t relayIndex = -1;       ///< Relay measured by this meter, -1 if none
+        // Guarded by flowMux (the PCNT interrupt and the tasks arming / reading)
+        uint32_t totalPulses = 0;      ///< Pulses of all completed counter windows
+        int16_t windowLimit = FLOW_PCNT_MAX_WINDOW; ///< High limit of the running window
+        bool dosing = false;
+        uint32_t doseRemaining = 0;    ///< Dose pulses still missing at the start of the window
+        uint16_t doseSeq = 0;          ///< Of the armed dose
+        bool endPending = false;       ///< Dose finished, volumeDoseEnded() not called yet
+        uint16_t endedSeq = 0;         ///< doseSeq of that dose
+    };
+    FlowMeter meters[FLOW_MAX_METERS];
+    size_t count = 0;
+    mutable portMUX_TYPE flowMux = portMUX_INITIALIZER_UNLOCKED;
+    void* isrHandle = nullptr; // pcnt_isr_handle_t (opaque type)
+
+    int meterSlot(PointHandle meterPoint) const;
+    void foldPendingWindow(FlowMeter& meter);
+    void restartWindow(FlowMeter& meter);
+    void finishDose(FlowMeter& meter);
+    void onWindowEnd(FlowMeter& meter);
+    void reportFinishedDoses();
+    static void pcntIsr(void* arg);
+};
+
+#endif // FLOW_METER_MANAGER_H
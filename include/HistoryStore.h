@@ -0,0 +1,162 @@
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <vector>
+#include "PointRegistry.h"
+
+// Root directory; one subdirectory per recorded point
+#define HISTORY_DIR "/history"
+// Flash budget: HISTORY_MAX_POINTS x (segments x HISTORY_SEGMENT_BYTES + rollup file),
+// about 54 KB per point with the defaults
+#ifndef HISTORY_MAX_POINTS
+#define HISTORY_MAX_POINTS 8
+#endif
+#ifndef HISTORY_SEGMENTS_PER_POINT
+#define HISTORY_SEGMENTS_PER_POINT 8
+#endif
+// Raw segment file size; the oldest segment of a point is removed when a new one starts
+#define HISTORY_SEGMENT_BYTES 4096
+// Sampling period (a periodic job on the persistence worker)
+#define HISTORY_SAMPLE_INTERVAL_MS 1000
+// Values are stored as fixed point with this many steps per engineering unit
+#define HISTORY_VALUE_SCALE 100
+// An unchanged value is recorded again after this long, so a gap in the data means "not sampled"
+#define HISTORY_HEARTBEAT_S 300
+// Encoded samples are buffered in RAM per point and appended when full or this often
+#define HISTORY_WRITE_BUFFER_BYTES 128
+#define HISTORY_FLUSH_INTERVAL_MS (60UL * 1000)
+// Rollup (min / max / mean) bucket length and buckets kept per point: 14 days
+#define HISTORY_ROLLUP_BUCKET_S 900
+#define HISTORY_ROLLUP_BUCKETS 1344
+
+/**
+ * @struct HistorySample
+ * @brief One result of a range query. Raw samples have min == max == value.
+ */
+struct HistorySample {
+    uint32_t epoch; ///< Seconds since 1970 (rollup: bucket start)
+    float value;    ///< Sample value (rollup: mean)
+    float min;
+    float max;
+};
+
+/**
+ * @struct HistoryPointState
+ * @brief Writer state of one recorded point (fixed size, no heap after begin()).
+ */
+struct HistoryPointState {
+    PointHandle point = INVALID_POINT_HANDLE;
+    String dir;                 ///< HISTORY_DIR/<pointId>
+    bool rollupSkipsUnknown = false; ///< Analog / Modbus: -1 ("unknown") is kept out of the rollup
+
+    // Segment ring: files firstSeq..lastSeq exist; guarded by the store mutex for readers
+    uint32_t firstSeq = 0;
+    uint32_t lastSeq = 0;
+    bool hasSegments = false;
+
+    // Current segment (open for appends once started)
+    bool segmentStarted = false;
+    bool segmentOnFlash = false; ///< False until the header has been written
+    size_t segmentBytes = 0;     ///< Flushed plus buffered bytes of the current segment
+    uint32_t lastEpoch = 0;
+    int32_t lastValue = 0;       ///< Fixed point
+    uint8_t buffer[HISTORY_WRITE_BUFFER_BYTES];
+    size_t bufferUsed = 0;
+
+    // Rollup accumulator for the current bucket
+    uint32_t bucketStart = 0;
+    float bucketMin = 0, bucketMax = 0;
+    double bucketSum = 0;
+    uint32_t bucketCount = 0;
+};
+
+class HistoryStore;
+
+/**
+ * @class HistoryCursor
+ * @brief Reads one point's samples in [from, to] in time order, a few hundred bytes at a time.
+ *
+ * Raw queries decode the segment files; rollup queries read the fixed-size bucket
+ * records. Samples still in the writer's RAM buffer (at most HISTORY_FLUSH_INTERVAL_MS
+ * old) are not returned.
+ */
+class HistoryCursor {
+public:
+    bool open(HistoryStore& store, PointHandle point, uint32_t from, uint32_t to, bool rollup);
+    bool next(HistorySample& sample);
+
+private:
+    String dir;
+    uint32_t from = 0, to = 0;
+    bool rollup = false;
+    File file;
+    uint8_t buffer[256];
+    size_t bufferLength = 0, bufferPos = 0;
+
+    // Raw
+    uint32_t seq = 0, lastSeq = 0;
+    bool segmentOpen = false;
+    bool haveBase = false;   ///< Header sample not yet returned
+    uint32_t epoch = 0;
+    int32_t value = 0;
+
+    // Rollup
+    uint32_t bucket = 0, lastBucket = 0;
+
+    bool openSegment(uint32_t segmentSeq);
+    bool readByte(uint8_t& byte);
+    bool readVarint(uint32_t& out);
+};
+
+/**
+ * @class HistoryStore
+ * @brief Append-only time-series history of analog, Modbus, relay and digital points on LittleFS.
+ *
+ * The persistence worker reads the current values once per HISTORY_SAMPLE_INTERVAL_MS, so
+ * all history flash writes happen on that one low-priority task and the IO samplers are
+ * never blocked by it. A value is recorded when it changed (at the
+ * HISTORY_VALUE_SCALE resolution) or after HISTORY_HEARTBEAT_S, as a varint time delta
+ * plus a zigzag varint value delta (typically 2 bytes). Samples are buffered per point
+ * and appended to fixed-size segment files; each point keeps a ring of
+ * HISTORY_SEGMENTS_PER_POINT segments, so the flash use is bounded and writes rotate
+ * over the files. A 15-minute min / max / mean rollup is kept per point in a
+ * fixed-record ring file for ranges longer than the raw data.
+ *
+ * Nothing is recorded until the wall clock is set.
+ */
+class HistoryStore {
+public:
+    // Selects the points, scans existing segments and registers the sampling job.
+    // Call after the IO managers and ModbusMaster registered their points.
+    bool begin();
+
+    // Appends all buffered samples (e.g. before a restart)
+    void flush();
+
+    // False for points without history (queries of them return nothing)
+    bool isRecorded(PointHandle point) const;
+
+private:
+    friend class HistoryCursor;
+
+    std::vector<HistoryPointState> points; // Fixed after begin()
+    void* storeMutex = nullptr;            ///< Guards the segment ring bounds and file rotation (FreeRTOS mutex)
+    uint32_t lastFlushMs = 0;
+
+    static void sampleJob(void* context);
+    void sample();
+    void addPoint(PointHandle point);
+    void scanSegments(HistoryPointState& state);
+    void recordSample(HistoryPointState& state, uint32_t epoch, float value);
+    void startSegment(HistoryPointState& state, uint32_t epoch, int32_t value);
+    void flushPoint(HistoryPointState& state);
+    void addToRollup(HistoryPointState& state, uint32_t epoch, float value);
+    void writeRollup(HistoryPointState& state);
+    float readPoint(PointHandle point) const;
+    const HistoryPointState* findPoint(PointHandle point) const;
+    static String segmentPath(const String& dir, uint32_t seq);
+};
+
+#endif // HISTORY_STORE_H
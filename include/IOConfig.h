@@ -18,6 +18,7 @@ struct DirectRelayConfig {
     int count = 0;
     String controlMethod; // e.g., "ShiftRegister", "DirectGPIO"
     RelayControlPins pins;
+    std::vector<int> gpioPins; // DirectGPIO: one output pin per relay ("gpioPins" array)
     String pointIdPrefix;
     int pointIdStartIndex = 0;
 };
@@ -50,18 +51,21 @@ struct DirectAnalogOutputConfig {
     int pointIdStartIndex = 0;
 };
 
+// Corresponds to an object within the "flowMeters" array (pulse output, counted by PCNT)
+struct DirectFlowMeterConfig {
+    String pointId;
+    int pin = -1;
+    float pulsesPerLiter = 0.0f; // Sensor K-factor
+    String outputPointId;        // Relay whose water passes this meter (volume doses)
+};
+
 // Corresponds to the "directIO" object
 struct DirectIOConfig {
     DirectRelayConfig relayOutputs;
     DirectDigitalInputConfig digitalInputs;
     std::vector<DirectAnalogInputConfig> analogInputs;
     std::vector<DirectAnalogOutputConfig> analogOutputs;
-};
-
-// === Step 2: Aggregated I/O Configuration for Output/Input Managers ===
-struct IOConfiguration {
-    DirectIOConfig directIO;
-    // Future: Add Modbus config, boardName, etc. as needed
+    std::vector<DirectFlowMeterConfig> flowMeters;
 };
 
 // Corresponds to an object within the "modbusInterfaces" array
@@ -86,6 +90,14 @@ struct ModbusDeviceConfig {
     String overrideDescription; // Optional
 };
 
+// === Step 2: Aggregated I/O Configuration for Output/Input Managers ===
+struct IOConfiguration {
+    DirectIOConfig directIO;
+    std::vector<ModbusInterfaceConfig> modbusInterfaces;
+    std::vector<ModbusDeviceConfig> modbusDevices;
+    // Future: Add boardName, etc. as needed
+};
+
 // Corresponds to the root object of board_config.json
 struct BoardConfig {
     String boardName;
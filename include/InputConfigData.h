@@ -90,20 +90,57 @@ struct InputPointConfig {
             Serial.println(error.c_str());
             return false;
         }
-        if (!doc["pointId"].is<const char*>() || !doc["inputConfig"].is<JsonObject>()) {
+        return deserialize(doc.as<JsonObjectConst>());
+    }
+
+    // Populates the config from an already parsed root object
+    bool deserialize(JsonObjectConst root) {
+        if (!root["pointId"].is<const char*>() || !root["inputConfig"].is<JsonObjectConst>()) {
             Serial.println(F("InputPointConfig JSON missing 'pointId' or 'inputConfig'"));
             return false;
         }
-        pointId = doc["pointId"].as<String>();
-        JsonObject configObj = doc["inputConfig"].as<JsonObject>();
+        pointId = root["pointId"].as<String>();
+        JsonObjectConst configObj = root["inputConfig"].as<JsonObjectConst>();
         inputConfig.type = configObj["type"] | "";
         inputConfig.subtype = configObj["subtype"] | "";
         inputConfig.name = configObj["name"] | "";
         inputConfig.manufacturer = configObj["manufacturer"] | "";
         inputConfig.model = configObj["model"] | "";
         inputConfig.unit = configObj["unit"] | "";
-        // ... (rest of deserialization for nested objects/arrays as needed)
-        // For brevity, not all fields are deserialized here.
+
+        JsonObjectConst scalingObj = configObj["input_scaling"];
+        InputScalingConfig& scaling = inputConfig.input_scaling;
+        scaling.reference_type = scalingObj["reference_type"] | "";
+        scaling.offset = scalingObj["offset"] | 0.0f;
+        scaling.multiplier = scalingObj["multiplier"] | 1.0f;
+        scaling.divisor = scalingObj["divisor"] | 1.0f;
+        scaling.integration_control = scalingObj["integration_control"] | "";
+        deserializeRange(scalingObj["input_range"], scaling.input_range);
+        deserializeRange(scalingObj["output_range"], scaling.output_range);
+        scaling.display_unit = scalingObj["display_unit"] | "";
+
+        JsonObjectConst calibrationObj = configObj["calibration"];
+        CalibrationConfig& calibration = inputConfig.calibration;
+        calibration.enabled = calibrationObj["enabled"] | false;
+        deserializePoints(calibrationObj["data_points"], calibration.data_points);
+        deserializePoints(calibrationObj["custom_points"], calibration.custom_points);
+
+        JsonObjectConst tempObj = configObj["temperature_compensation"];
+        TempCompensationConfig& temp = inputConfig.temperature_compensation;
+        temp.enabled = tempObj["enabled"] | false;
+        temp.source_pointId = tempObj["source_pointId"] | "";
+        temp.center_point = tempObj["center_point"] | 25.0f;
+        temp.slope = tempObj["slope"] | 0.0f;
+        temp.offset = tempObj["offset"] | 0.0f;
+        temp.update_interval_minutes = tempObj["update_interval_minutes"] | 15;
+
+        JsonObjectConst alarmsObj = configObj["alarms"];
+        AlarmConfig& alarms = inputConfig.alarms;
+        alarms.enabled = alarmsObj["enabled"] | false;
+        alarms.low_limit = alarmsObj["low_limit"] | 0.0f;
+        alarms.high_limit = alarmsObj["high_limit"] | 0.0f;
+        alarms.delay_time_minutes = alarmsObj["delay_time_minutes"] | 0;
+        alarms.priority = alarmsObj["priority"] | "";
         return true;
     }
 
@@ -118,12 +155,80 @@ struct InputPointConfig {
         configObj["manufacturer"] = inputConfig.manufacturer;
         configObj["model"] = inputConfig.model;
         configObj["unit"] = inputConfig.unit;
-        // ... (rest of serialization for nested objects/arrays as needed)
-        // For brevity, not all fields are serialized here.
+
+        const InputScalingConfig& scaling = inputConfig.input_scaling;
+        JsonObject scalingObj = configObj["input_scaling"].to<JsonObject>();
+        scalingObj["reference_type"] = scaling.reference_type;
+        scalingObj["offset"] = scaling.offset;
+        scalingObj["multiplier"] = scaling.multiplier;
+        scalingObj["divisor"] = scaling.divisor;
+        scalingObj["integration_control"] = scaling.integration_control;
+        JsonObject inputRange = scalingObj["input_range"].to<JsonObject>();
+        inputRange["min_voltage"] = scaling.input_range.min_voltage;
+        inputRange["max_voltage"] = scaling.input_range.max_voltage;
+        JsonObject outputRange = scalingObj["output_range"].to<JsonObject>();
+        outputRange["min_pressure"] = scaling.output_range.min_pressure;
+        outputRange["max_pressure"] = scaling.output_range.max_pressure;
+        scalingObj["display_unit"] = scaling.display_unit;
+
+        const CalibrationConfig& calibration = inputConfig.calibration;
+        JsonObject calibrationObj = configObj["calibration"].to<JsonObject>();
+        calibrationObj["enabled"] = calibration.enabled;
+        serializePoints(calibrationObj["data_points"].to<JsonArray>(), calibration.data_points);
+        serializePoints(calibrationObj["custom_points"].to<JsonArray>(), calibration.custom_points);
+
+        const TempCompensationConfig& temp = inputConfig.temperature_compensation;
+        JsonObject tempObj = configObj["temperature_compensation"].to<JsonObject>();
+        tempObj["enabled"] = temp.enabled;
+        tempObj["source_pointId"] = temp.source_pointId;
+        tempObj["center_point"] = temp.center_point;
+        tempObj["slope"] = temp.slope;
+        tempObj["offset"] = temp.offset;
+        tempObj["update_interval_minutes"] = temp.update_interval_minutes;
+
+        const AlarmConfig& alarms = inputConfig.alarms;
+        JsonObject alarmsObj = configObj["alarms"].to<JsonObject>();
+        alarmsObj["enabled"] = alarms.enabled;
+        alarmsObj["low_limit"] = alarms.low_limit;
+        alarmsObj["high_limit"] = alarms.high_limit;
+        alarmsObj["delay_time_minutes"] = alarms.delay_time_minutes;
+        alarmsObj["priority"] = alarms.priority;
+
         String output;
         serializeJsonPretty(doc, output);
         return output;
     }
+
+private:
+    // The files use min/max_voltage for input ranges and min/max_pressure for output ranges
+    static void deserializeRange(JsonObjectConst obj, Range& range) {
+        range.min_voltage = obj["min_voltage"] | 0.0f;
+        range.max_voltage = obj["max_voltage"] | 0.0f;
+        range.min_pressure = obj["min_pressure"] | 0.0f;
+        range.max_pressure = obj["max_pressure"] | 0.0f;
+    }
+
+    static void deserializePoints(JsonArrayConst array, std::vector<CalibrationPoint>& points) {
+        points.clear();
+        for (JsonObjectConst obj : array) {
+            CalibrationPoint point;
+            point.voltage = obj["voltage"] | 0.0f;
+            point.pressure = obj["pressure"] | 0.0f;
+            point.timestamp = obj["timestamp"] | "";
+            point.notes = obj["notes"] | "";
+            points.push_back(point);
+        }
+    }
+
+    static void serializePoints(JsonArray array, const std::vector<CalibrationPoint>& points) {
+        for (const CalibrationPoint& point : points) {
+            JsonObject obj = array.add<JsonObject>();
+            obj["voltage"] = point.voltage;
+            obj["pressure"] = point.pressure;
+            obj["timestamp"] = point.timestamp;
+            if (point.notes.length() > 0) obj["notes"] = point.notes;
+        }
+    }
 };
 
 #endif // INPUT_CONFIG_DATA_H
\ No newline at end of file
@@ -6,44 +6,182 @@
 #include <map>
 #include "IOConfig.h"
 #include "InputConfigData.h"
+#include "PointRegistry.h"
 
 // InputPointManager handles direct input (DI/AI) initialization, mapping, periodic reading, and persistence.
 // All ArduinoJSON usage follows the rules in how_to_upgrade_from_ArduinoJSON6_to_ArduinoJSON7.md.
 
+// Capacity of the sampling engine (DI states are packed into one 32-bit word)
+#define INPUT_MAX_DIGITAL_INPUTS 32
+#define INPUT_MAX_ANALOG_INPUTS 16
+// Sampler period and number of ADC reads averaged per analog channel per period
+#define INPUT_SAMPLE_PERIOD_MS 100
+#define INPUT_AI_OVERSAMPLE 8
+// Every N sampler periods the DI word is re-read from the pins (catches missed edges)
+#define INPUT_DI_RESYNC_PERIODS 10
+// Values published by remote sources (Modbus); slots are handed out by registerRemotePoint()
+#define INPUT_MAX_REMOTE_POINTS 64
+// ADC scale used for "dc_voltage" inputs (12-bit reading, 11 dB attenuation)
+#define INPUT_ADC_MAX_COUNT 4095
+#define INPUT_ADC_REFERENCE_VOLTS 3.3f
+// Most piecewise-linear segments per compiled calibration curve (one less than its points)
+#define INPUT_CAL_MAX_SEGMENTS 8
+// Curve lookup: the raw reading >> this shift indexes a table of starting segments
+#define INPUT_CAL_BUCKET_SHIFT 7
+#define INPUT_CAL_BUCKETS ((INPUT_ADC_MAX_COUNT >> INPUT_CAL_BUCKET_SHIFT) + 1)
+// Threshold watches (see addThresholdWatch()); checked once per published value
+#define INPUT_MAX_WATCHES 16
+
 class InputPointManager {
 public:
     InputPointManager();
 
-    // Initialize with parsed IOConfiguration
+    // Initialize with parsed IOConfiguration, register points in the PointRegistry,
+    // attach DI interrupts and start the sampler task
     bool begin(const IOConfiguration& ioConfig);
 
-    // Get the last read value for an analog input pointId (raw ADC value)
-    float getCurrentValue(const String& pointId);
+    // Get the last sampled value for an analog input in engineering units (scaling, calibration
+    // and temperature compensation applied; the raw ADC value if the point has no config), -1 if
+    // unknown. O(1) and lock-free by handle; the pointId overload resolves the handle first.
+    float getCurrentValue(PointHandle handle) const;
+    float getCurrentValue(const String& pointId) const;
+    // Averaged raw ADC value of an analog input (for calibrating), -1 if unknown
+    float getRawValue(PointHandle handle) const;
+
+    // Get the last state for a digital input (true=HIGH, false=LOW). O(1), lock-free by handle.
+    bool getCurrentState(PointHandle handle) const;
+    bool getCurrentState(const String& pointId) const;
+
+    // Copies a consistent frame of all raw analog values (same sampler pass); returns the count copied
+    int getAnalogSnapshot(uint16_t* out, int maxCount) const;
+
+    // Remote points (PointKind::MODBUS_INPUT): the polling engine registers a point once,
+    // then publishes scaled values by handle. getCurrentValue/getCurrentState serve them like
+    // direct inputs; a point reads as unknown (-1 / false) until its first valid value.
+    PointHandle registerRemotePoint(const String& pointId);
+    void publishRemoteValue(PointHandle handle, float value);
+    void invalidateRemoteValue(PointHandle handle); // e.g. device stopped answering
 
-    // Get the last read state for a digital input pointId (true=HIGH, false=LOW)
-    bool getCurrentState(const String& pointId);
+    /**
+     * @brief Notifies a task whenever a point's value crosses a threshold (either direction).
+     *
+     * Checked by the producer right after a value is published (sampler frame for analog
+     * inputs, publishRemoteValue() for Modbus points), so a subscriber can block until
+     * something changes instead of polling. A value at or above @p threshold reads as
+     * "above"; it reads as "below" again once it drops under threshold - hysteresis.
+     * Unknown values (-1) never cross.
+     *
+     * @param point Analog or Modbus input.
+     * @param task FreeRTOS task handle to notify (opaque type).
+     * @param notifyBits Bits set on the task's notification value (eSetBits).
+     * @return Watch id, or -1 if the point is not an analog input or no watch is free.
+     */
+    int addThresholdWatch(PointHandle point, float threshold, float hysteresis, void* task, uint32_t notifyBits);
+    // Moves the threshold; the state is re-evaluated (and notified) with the next value
+    void setWatchThreshold(int watchId, float threshold);
+    void removeThresholdWatch(int watchId);
+    // Current side of the threshold
+    bool isAboveThreshold(int watchId) const;
+    // esp_timer_get_time() (low 32 bits) of the last crossing, for reaction-time measurement
+    uint32_t watchCrossedUs(int watchId) const;
 
-    // Persistence for input point configs (ArduinoJSON 7 compliant)
+    // Loads the config file of every analog input and compiles its calibration curve.
+    // Call once the other point sources are registered (temperature sources are resolved here).
+    void loadCalibrations();
+
+    // Persistence for input point configs (ArduinoJSON 7 compliant); saving recompiles the curve
     bool saveInputPointConfig(const InputPointConfig& config);
     bool loadInputPointConfig(const String& pointId, InputPointConfig& config);
     void inputReaderTask();
 
 private:
     IOConfiguration ioConfig;
-    std::map<String, int> directDIPointIdToPinMap;
-    std::map<String, int> directAIPointIdToPinMap;
 
-    // Mutex and task handles (opaque types for now)
-    void* valueMutex;
-    void* inputReaderTaskHandle;
+    // Point tables indexed by the registry entry's localIndex, built once in begin()
+    std::vector<int> diPins;
+    std::vector<int> aiPins;
+
+    // Per-pin ISR argument (DI bit + pin), so the ISR does no lookups
+    struct DigitalIsrContext {
+        InputPointManager* manager;
+        uint8_t bit;
+        uint8_t pin;
+    };
+    DigitalIsrContext diIsrContexts[INPUT_MAX_DIGITAL_INPUTS];
 
-    std::map<String, bool> lastDIStates;
-    std::map<String, int> lastAIRawValues;
+    // DI states: bit = DI localIndex. Written by the GPIO ISR and the resync pass, read lock-free.
+    volatile uint32_t diStateBits = 0;
+    void* diStateLock; // portMUX_TYPE* guarding read-modify-write of diStateBits
+
+    // AI double buffer: the sampler fills the back frame, then flips aiFrontIndex.
+    // aiFrameSeq is bumped on every flip so whole-frame readers can detect a concurrent flip.
+    uint16_t aiFrames[2][INPUT_MAX_ANALOG_INPUTS];
+    float aiScaled[2][INPUT_MAX_ANALOG_INPUTS]; // Engineering values of the same frames
+    volatile uint8_t aiFrontIndex = 0;
+    volatile uint32_t aiFrameSeq = 0;
+
+    /**
+     * @brief One analog input's scaling, calibration and compensation, compiled to raw ADC counts.
+     *
+     * value = slope[s] * raw + intercept[s] + tempCorrection, where segment s is found via
+     * bucketSegment[raw >> INPUT_CAL_BUCKET_SHIFT] (at most a step or two further). Fixed size
+     * and heap-free, so a recompiled curve is swapped in under curveLock with a plain copy.
+     */
+    struct AnalogCurve {
+        uint8_t segmentCount = 0;                        ///< 0: no config, the raw value is used
+        uint16_t segmentStart[INPUT_CAL_MAX_SEGMENTS];   ///< First raw count of each segment
+        float slope[INPUT_CAL_MAX_SEGMENTS];
+        float intercept[INPUT_CAL_MAX_SEGMENTS];
+        uint8_t bucketSegment[INPUT_CAL_BUCKETS];
+        PointHandle tempSource = INVALID_POINT_HANDLE;   ///< Temperature point, if compensated
+        float tempCenter = 25.0f;
+        float tempSlope = 0.0f;
+        float tempOffset = 0.0f;
+        uint32_t tempIntervalMs = 0;
+        uint32_t tempUpdatedMs = 0;
+        bool tempPending = true;                         ///< No correction computed yet
+        float tempCorrection = 0.0f;                     ///< Refreshed every tempIntervalMs only
+    };
+    AnalogCurve aiCurves[INPUT_MAX_ANALOG_INPUTS];
+    void* curveLock; // portMUX_TYPE* guarding aiCurves (swap vs. the sampler's scaling pass)
+
+    // Threshold watches; each is written by the single producer of its point
+    struct ThresholdWatch {
+        volatile bool active = false;
+        PointHandle point = INVALID_POINT_HANDLE;
+        volatile float threshold = 0.0f;
+        float hysteresis = 0.0f;
+        volatile bool above = false;
+        volatile uint32_t crossedUs = 0;
+        void* task = nullptr;
+        uint32_t notifyBits = 0;
+    };
+    ThresholdWatch watches[INPUT_MAX_WATCHES];
+
+    // Remote point values by localIndex; single aligned 32-bit stores, read lock-free
+    volatile float remoteValues[INPUT_MAX_REMOTE_POINTS];
+    volatile bool remoteValid[INPUT_MAX_REMOTE_POINTS];
+    int remoteCount = 0;
+
+    // Task handle (opaque type)
+    void* inputReaderTaskHandle;
 
     void initializeDirectInputHardware();
     void buildDirectInputMaps();
+    int analogSlot(PointHandle handle) const;
+    int remoteSlot(PointHandle handle) const;
     bool readDirectDIState(int pin);
     int readDirectAIValueRaw(int pin);
+    void resyncDigitalInputs();
+    void sampleAnalogInputs();
+    void scaleAnalogFrame(uint8_t frame);
+    void updateTempCompensation(AnalogCurve& curve, uint32_t nowMs);
+    void evaluateWatch(ThresholdWatch& watch, float value);
+    void checkWatches(PointHandle point, float value);
+    void checkAnalogWatches();
+    static bool compileCurve(const InputPointConfig& config, AnalogCurve& curve);
+    void applyCalibration(const InputPointConfig& config);
+    static void digitalInputIsr(void* arg);
     static void inputReaderTaskWrapper(void* parameter);
 
     // Persistence helpers (ArduinoJSON 7 compliant)
@@ -0,0 +1,89 @@
+#ifndef LIVE_EVENTS_H
+#define LIVE_EVENTS_H
+
+#include <Arduino.h>
+#include <vector>
+#include <atomic>
+#include <functional>
+
+class AsyncWebServer;
+class AsyncWebServerRequest;
+
+// URL of the Server-Sent Events stream
+#define LIVE_EVENTS_PATH "/api/events"
+// Minimum time between two broadcasts; changes inside the window are merged into one delta
+#ifndef LIVE_EVENTS_MIN_INTERVAL_MS
+#define LIVE_EVENTS_MIN_INTERVAL_MS 250
+#endif
+// Broadcast messages kept for the client streams; a client further behind gets a new snapshot
+#define LIVE_EVENTS_OUTBOX_LENGTH 8
+// While clients are connected, inputs are compared against the last broadcast this often
+#define LIVE_EVENTS_INPUT_CHECK_MS 1000
+// Smallest change of an analog / Modbus value that is pushed (engineering units; an
+// uncalibrated analog input reports raw ADC counts)
+#define LIVE_EVENTS_ANALOG_DEADBAND 0.1f
+
+// Change bits passed to LiveEvents::notify()
+#define LIVE_CHANGE_RELAYS    (1UL << 0)
+#define LIVE_CHANGE_INPUTS    (1UL << 1)
+#define LIVE_CHANGE_SCHEDULES (1UL << 2)
+#define LIVE_CHANGE_LOCKS     (1UL << 3)
+#define LIVE_CHANGE_CONNECT   (1UL << 4) ///< A client connected and needs the full state
+
+/**
+ * @class LiveEvents
+ * @brief Push channel (Server-Sent Events on LIVE_EVENTS_PATH) for point, schedule and lock state.
+ *
+ * Producers only call notify(), which sets bits on the publisher task's notification
+ * value and never blocks. The publisher task waits out LIVE_EVENTS_MIN_INTERVAL_MS after
+ * each broadcast, then compares every point against what it last sent and serializes the
+ * differences once into a small outbox (LIVE_EVENTS_OUTBOX_LENGTH messages).
+ *
+ * Each client is a chunked text/event-stream response. Its filler runs on the async TCP
+ * task, on the connection's ack or poll, and copies the outbox messages the client has
+ * not seen yet, so the web server objects are only touched by that task.
+ *
+ * Events:
+ * - "snapshot": full state, broadcast when a client connects.
+ * - "delta": only the points that changed, e.g.
+ *   {"points":{"DirectRelay_0":1,"AI_1":2034},"schedulesRev":3}. Schedule and lock
+ *   changes carry a revision counter; clients refetch the lists when it moves.
+ */
+class LiveEvents {
+public:
+    /**
+     * @brief Registers the stream handler on @p server.
+     * @param authorize Called for each connecting request; returning false answers 401.
+     */
+    void attach(AsyncWebServer& server, std::function<bool(AsyncWebServerRequest*)> authorize);
+
+    // Starts the publisher task. Call after the IO managers registered their points.
+    bool begin();
+
+    // Records a change; safe from any task (not from ISRs). No-op before begin().
+    void notify(uint32_t changeBits);
+
+private:
+    struct ClientStream;
+
+    void* publisherTaskHandle = nullptr; ///< FreeRTOS task handle (opaque type)
+    void* outboxMutex = nullptr;         ///< Guards outbox and outboxSeq (FreeRTOS mutex, opaque type)
+    String outbox[LIVE_EVENTS_OUTBOX_LENGTH]; ///< Message seq lives in outbox[seq % LIVE_EVENTS_OUTBOX_LENGTH]
+    uint32_t outboxSeq = 0;              ///< Sequence number of the next message
+    std::atomic<int> clientCount{0};     ///< Open streams; the publisher idles at 0
+
+    std::vector<float> sentValues; ///< Last broadcast value per PointHandle (NAN: never sent)
+    uint32_t schedulesRev = 0;
+    uint32_t locksRev = 0;
+    uint32_t eventId = 0;
+
+    static void publisherTaskWrapper(void* parameter);
+    void publisherTask();
+    void broadcast(uint32_t changeBits);
+    void publish(String frame);
+    size_t fillClient(ClientStream& client, uint8_t* buffer, size_t maxLen);
+    float readPoint(size_t handle) const;
+    bool valueChanged(size_t handle, float value) const;
+};
+
+#endif // LIVE_EVENTS_H
@@ -3,6 +3,8 @@
 
 #include <Arduino.h>
 #include <vector>
+#include <map> // For the in-memory lock table
+#include <atomic>
 #include "FileLock.h"
 #include "SessionData.h" // To get session info for acquiring locks
 
@@ -20,15 +22,29 @@
  *        Default: 5 minutes.
  */
 #define LOCK_CLEANUP_INTERVAL_MS (5 * 60 * 1000)
+// Define how long lock table changes may stay unwritten (e.g., 30 seconds)
+/**
+ * @def LOCK_FLUSH_INTERVAL_MS
+ * @brief Defines the maximum time (in milliseconds) that changes to the in-memory lock table
+ *        may remain unwritten before the persistence worker flushes them to the lock file.
+ *        Several acquire/release operations within this window cost a single file write.
+ *        Default: 30 seconds.
+ */
+#define LOCK_FLUSH_INTERVAL_MS (30 * 1000)
+// How often the persistence worker checks whether a flush is due
+#define LOCK_FLUSH_CHECK_MS 1000
 
 
 /**
  * @class LockManager
- * @brief Manages exclusive locks on resources using a persistent JSON file.
+ * @brief Manages exclusive locks on resources using an in-memory table backed by a JSON file.
  *
  * This class provides mechanisms to acquire, release, and check locks on resources
  * identified by string IDs (e.g., "schedule_abc"). Locks are associated with user
- * sessions and stored persistently in a JSON file (`/locks/active_locks.json` by default).
+ * sessions and held in an in-memory map keyed by resource ID, which is the source of
+ * truth for all lock checks. Changes are written behind to a JSON file
+ * (`/locks/active_locks.json` by default) in batches, at most once per `LOCK_FLUSH_INTERVAL_MS`,
+ * or immediately via `flushLocks()` (e.g., before a restart).
  * It includes functionality to automatically clean up expired locks based on a timeout.
  */
 class LockManager {
@@ -44,7 +60,8 @@ public:
     /**
      * @brief Initializes the LockManager.
      *
-     * Ensures the lock file exists (creating an empty one if necessary) and its parent directory.
+     * Ensures the lock file exists (creating an empty one if necessary) and its parent directory,
+     * then loads any persisted locks into the in-memory lock table.
      * @return True if initialization is successful, false on critical failure (e.g., cannot create directory/file).
      */
     bool begin();
@@ -56,7 +73,7 @@ public:
      * @brief Attempts to acquire an exclusive lock for a given resource by a specific session.
      *
      * Checks if the resource is already locked by another session. If successful, the lock
-     * information is recorded persistently. If the lock is already held by the same session,
+     * is recorded in the in-memory table and scheduled for the next flush. If the lock is already held by the same session,
      * the timestamp is updated (idempotent).
      *
      * @param resourceId The unique identifier of the resource to lock.
@@ -72,7 +89,7 @@ public:
     /**
      * @brief Releases a specific lock held by a specific session.
      *
-     * Removes the lock entry from the persistent store if the provided sessionId matches
+     * Removes the lock entry from the in-memory table if the provided sessionId matches
      * the one holding the lock for the given resourceId.
      *
      * @param resourceId The unique identifier of the resource whose lock is to be released.
@@ -103,7 +120,7 @@ public:
      * @param resourceId The unique identifier of the resource to check.
      * @param lockInfo Optional. If provided (not nullptr) and the resource is locked,
      *                 this pointer will be populated with the details of the current lock.
-     * @return True if the resource is currently locked, false otherwise or if an error occurs reading locks.
+     * @return True if the resource is currently locked, false otherwise.
      */
     bool isLocked(const String& resourceId, FileLock* lockInfo = nullptr);
 
@@ -126,38 +143,66 @@ public:
      *
      * This function should be called periodically (e.g., in the main loop). It checks if the
      * `LOCK_CLEANUP_INTERVAL_MS` has passed and, if so, removes any locks whose timestamp
-     * indicates they have expired. Only runs if `LOCK_TIMEOUT_MS` is greater than 0.
+     * indicates they have expired (only if `LOCK_TIMEOUT_MS` is greater than 0). It never
+     * touches the filesystem; the resulting changes are flushed by the persistence worker.
      */
     void cleanupExpiredLocks();
 
+    // Writes pending lock table changes to the lock file immediately.
+    /**
+     * @brief Writes the in-memory lock table to the lock file if it has unflushed changes.
+     *
+     * Call before a planned restart or shutdown so the on-disk copy matches the table.
+     * @return True if the table was clean or was written successfully, false if the write failed
+     *         (the table stays marked dirty and the write is retried on the next flush).
+     */
+    bool flushLocks();
+
 private:
     String _lockFilePath; ///< Path to the file storing active locks.
-    unsigned long lastCleanupTime = 0; ///< Timestamp of the last expired lock cleanup check.
+    std::atomic<unsigned long> lastCleanupTime{0}; ///< Timestamp of the last expired lock cleanup check; read without `tableMutex`.
+    std::map<String, FileLock> activeLocks; ///< In-memory lock table, keyed by resource ID. Source of truth for all lock checks.
+    bool locksDirty = false; ///< True if `activeLocks` has changes not yet written to the lock file.
+    unsigned long firstDirtyTime = 0; ///< Timestamp of the first change since the last successful flush.
+    uint32_t tableGeneration = 0; ///< Bumped by every change; a write only clears `locksDirty` if none came in meanwhile.
+    void* tableMutex = nullptr; ///< FreeRTOS mutex guarding `activeLocks` (web server task vs. main loop).
+    void* fileMutex = nullptr;  ///< FreeRTOS mutex serializing lock file writes (an older copy never overwrites a newer one).
 
-    // Internal helper to load all active locks from the JSON file.
+    // Internal helper to flag the table as changed and start the flush window.
+    /**
+     * @brief Internal helper to mark the in-memory lock table as changed.
+     *
+     * Records the time of the first unflushed change so `cleanupExpiredLocks` can
+     * batch subsequent changes into a single write. Caller must hold `tableMutex`.
+     */
+    void markDirty();
+
+    // Internal helper to load all active locks from the JSON file into the table.
     // Returns true on success, false on failure (file read/parse error).
-    // Populates the provided vector. Clears the vector first.
     /**
-     * @brief Internal helper to load all active locks from the JSON file.
+     * @brief Internal helper to load all active locks from the JSON file into `activeLocks`.
      *
-     * Reads the lock file and parses the JSON array into the provided vector.
-     * Clears the vector before loading.
-     * @param locks Reference to a vector to store the loaded FileLock objects.
+     * Reads the lock file and parses the JSON array into the in-memory table.
+     * Clears the table before loading. Called once from `begin()`.
      * @return True on success (file read and parsed, even if empty), false on failure.
      */
-    bool loadAllLocks(std::vector<FileLock>& locks); // Note: Corrected to &
+    bool loadAllLocks();
+
+    // Write-behind: runs on the persistence worker every LOCK_FLUSH_CHECK_MS
+    void flushIfDue();
+    static void flushJob(void* context);
 
     // Internal helper to save all active locks to the JSON file.
     // Returns true on success, false on failure (file write/serialize error).
     /**
-     * @brief Internal helper to save all active locks to the JSON file.
+     * @brief Internal helper to save the in-memory lock table to the JSON file.
      *
-     * Serializes the provided vector of FileLock objects into a JSON array and
-     * overwrites the lock file.
-     * @param locks Constant reference to a vector containing the FileLock objects to save.
+     * Serializes all FileLock entries in `activeLocks` into a JSON array under
+     * `tableMutex`, then overwrites the lock file outside it. Caller must not hold
+     * `tableMutex`.
      * @return True on success, false on failure.
      */
-    bool saveAllLocks(const std::vector<FileLock>& locks); // Note: Corrected to &
+    bool saveAllLocks();
 };
 
 #endif // LOCK_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,86 @@
+#ifndef LOG_BUFFER_H
+#define LOG_BUFFER_H
+
+#include <Arduino.h>
+#include <stdarg.h>
+
+// Number of records kept in RAM; the oldest record is overwritten when full
+#define LOG_BUFFER_RECORDS 64
+// Longest message text per record (longer messages are truncated)
+#define LOG_RECORD_TEXT_LENGTH 112
+// Drain task period; the task forwards new records to Serial
+#define LOG_DRAIN_PERIOD_MS 50
+// Set to 0 to keep messages only in RAM (readable via /api/logs) and never write them to Serial
+#ifndef LOG_SERIAL_SINK
+#define LOG_SERIAL_SINK 1
+#endif
+
+// Log levels, lower is more severe. A module logs a message if its level is <= the module's LOG_LEVEL_<MODULE>.
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+/**
+ * @struct LogRecord
+ * @brief One message in the log ring.
+ */
+struct LogRecord {
+    volatile uint32_t seq;   ///< Sequence number of the message in this slot, 0 while being written
+    uint32_t timestampMs;    ///< millis() when the message was logged
+    uint8_t level;           ///< LOG_LEVEL_*
+    const char* module;      ///< Module tag (string literal)
+    char text[LOG_RECORD_TEXT_LENGTH]; ///< Message without trailing newline
+};
+
+/**
+ * @class LogBuffer
+ * @brief Lock-free, overwrite-oldest ring of log messages.
+ *
+ * Writers (any task) claim a sequence number with one atomic increment and fill the
+ * slot it maps to; nothing blocks and nothing is printed on the caller's task. Readers
+ * never consume: each keeps its own cursor and copies records by sequence number,
+ * detecting slots that were overwritten in the meantime. The drain task is one such
+ * reader (forwarding to Serial), /api/logs is another.
+ *
+ * All members are zero-initialised statics, so messages logged before begin() (during
+ * early setup) are kept and printed once the drain task runs.
+ */
+class LogBuffer {
+public:
+    // Starts the low-priority drain task. Safe to log before this is called.
+    bool begin();
+
+    // Appends a formatted message; never blocks
+    void write(uint8_t level, const char* module, const char* format, va_list args);
+
+    // Sequence number of the newest record (0 if nothing was logged yet)
+    uint32_t latestSeq() const { return __atomic_load_n(&nextSeq, __ATOMIC_ACQUIRE); }
+    // Oldest sequence number still held in the ring
+    uint32_t oldestSeq() const;
+    /**
+     * @brief Copies the record with sequence @p seq.
+     * @return 1 if copied, 0 if it is still being written (retry later),
+     *         -1 if it was already overwritten.
+     */
+    int read(uint32_t seq, LogRecord& out) const;
+
+    static const char* levelName(uint8_t level);
+
+private:
+    LogRecord records[LOG_BUFFER_RECORDS];
+    uint32_t nextSeq;          ///< Last claimed sequence number
+    uint32_t drainCursor;      ///< Next sequence number the Serial drain prints
+    void* drainTaskHandle;     ///< FreeRTOS task handle (opaque type)
+
+    static void drainTaskWrapper(void* parameter);
+    void drainTask();
+};
+
+// printf-style entry points used by the logging macros in DebugConfig.h
+void logPrintf(uint8_t level, const char* module, const char* format, ...) __attribute__((format(printf, 3, 4)));
+void logPrint(uint8_t level, const char* module, const char* text);
+void logPrint(uint8_t level, const char* module, const String& text);
+
+#endif // LOG_BUFFER_H
@@ -15,6 +15,7 @@ struct ModbusPointParams {
     float scaleFactor = 1.0;
     float offset = 0.0;
     String units;        // Optional
+    String wordOrder;    // Optional, 32-bit types only: "BigEndian" (default, high word first) or "LittleEndian"
 };
 
 // Corresponds to an object within the "points" array in a Modbus profile
@@ -24,6 +25,7 @@ struct ModbusProfilePoint {
     String description;
     ModbusPointParams modbus;
     bool readOnly = false;
+    long updateIntervalMs = 0; // Optional per-point poll rate; 0 = device pollingIntervalMs
 };
 
 // Corresponds to the root object of a Modbus device profile JSON
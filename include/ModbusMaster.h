@@ -0,0 +1,208 @@
+#ifndef MODBUS_MASTER_H
+#define MODBUS_MASTER_H
+
+#include <Arduino.h>
+#include <vector>
+#include "IOConfig.h"
+#include "ModbusData.h"
+#include "PointRegistry.h"
+
+class ConfigManager;
+
+// Largest read per request allowed by the Modbus spec (FC03/FC04 registers, FC01/FC02 bits)
+#define MODBUS_MAX_READ_REGISTERS 125
+#define MODBUS_MAX_READ_BITS 2000
+// Unused registers/bits tolerated between two points to still read them in one request.
+// One extra register costs 2 bytes; a separate request costs ~13 bytes plus turnaround.
+#define MODBUS_MAX_BLOCK_GAP 8
+// Slave response timeout per request
+#define MODBUS_RESPONSE_TIMEOUT_MS 200
+// Failed requests in a row before a device is marked offline (its points read as unknown)
+#define MODBUS_MAX_CONSECUTIVE_ERRORS 3
+// Offline devices are only retried this often, so dead slaves do not eat bus time with timeouts
+#define MODBUS_OFFLINE_RETRY_MS 10000
+// Fastest accepted poll interval for a point
+#define MODBUS_MIN_INTERVAL_MS 100
+// Largest FC15 (Write Multiple Coils) request allowed by the Modbus spec
+#define MODBUS_MAX_WRITE_COILS 1968
+// A failed coil write stays pending and is retried after this long (online device)
+#define MODBUS_WRITE_RETRY_MS 1000
+
+/**
+ * @enum ModbusDataType
+ * @brief Decoded profile dataType of a polled point.
+ */
+enum class ModbusDataType : uint8_t { BOOLEAN, UINT16, INT16, UINT32, INT32, FLOAT32 };
+
+/**
+ * @struct ModbusPollPoint
+ * @brief One profile point inside a read block.
+ */
+struct ModbusPollPoint {
+    PointHandle handle;     ///< MODBUS_INPUT handle (value store in InputPointManager)
+    uint16_t blockOffset;   ///< Register/bit offset from the block's start address
+    ModbusDataType type;
+    bool swapWords;         ///< 32-bit types: low word first
+    float scaleFactor;
+    float offset;
+};
+
+/**
+ * @struct ModbusReadBlock
+ * @brief One contiguous FC01/02/03/04 read covering several points of a device.
+ */
+struct ModbusReadBlock {
+    uint8_t deviceIndex;    ///< Index into ModbusBus::devices
+    uint8_t functionCode;
+    uint16_t startAddress;  ///< Zero-based protocol address
+    uint16_t count;         ///< Registers (FC03/04) or bits (FC01/02)
+    uint32_t intervalMs;    ///< Fastest update rate of the points in the block
+    uint32_t nextDueMs;
+    std::vector<ModbusPollPoint> points;
+};
+
+/**
+ * @struct ModbusCoilBlock
+ * @brief One run of consecutive DO coils of a device, written with one FC15 request.
+ */
+struct ModbusCoilBlock {
+    uint8_t deviceIndex;    ///< Index into ModbusBus::devices
+    uint16_t startAddress;  ///< Zero-based protocol address
+    uint16_t count;         ///< Coils in the run
+    // Guarded by ModbusBus::coilMux (staged by OutputPointManager, written by the bus task)
+    std::vector<uint8_t> staged; ///< Bit (i % 8) of byte (i / 8) is coil startAddress + i
+    bool dirty = true;      ///< Staged image not written yet; starts true so boot writes all off
+    uint32_t retryAtMs = 0; ///< Earliest next write after a failure
+};
+
+/**
+ * @struct ModbusPolledDevice
+ * @brief Runtime state of one configured slave.
+ */
+struct ModbusPolledDevice {
+    String deviceId;
+    uint8_t slaveAddress;
+    uint8_t consecutiveErrors = 0;
+    bool online = true;
+};
+
+/**
+ * @struct ModbusBusStats
+ * @brief Counters for one RS-485 line (see ModbusMaster::getBusStats).
+ */
+struct ModbusBusStats {
+    String interfaceId;
+    uint32_t requests;       ///< Requests sent since boot
+    uint32_t failures;       ///< Timeouts, CRC errors and exception responses
+    uint16_t blocks;         ///< Read blocks scheduled on this line
+    uint16_t points;         ///< Points covered by those blocks
+    uint16_t utilisationPermille; ///< Time the line was busy with transactions, last window
+    uint32_t stackHighWaterBytes; ///< Least free stack the bus task has had, 0 if not running
+};
+
+/**
+ * @struct ModbusBus
+ * @brief One Modbus RTU master on a UART, with its devices and compiled read blocks.
+ */
+struct ModbusBus {
+    class ModbusMaster* owner = nullptr;
+    ModbusInterfaceConfig config;
+    HardwareSerial* serial = nullptr;
+    uint32_t interFrameUs = 0;  ///< t3.5 silent interval before each request
+    std::vector<ModbusPolledDevice> devices;
+    std::vector<ModbusReadBlock> blocks;
+    std::vector<ModbusCoilBlock> coilBlocks;
+    portMUX_TYPE coilMux = portMUX_INITIALIZER_UNLOCKED;
+    volatile bool coilsStaged = false; ///< Changes staged since the last commitCoils()
+    void* taskHandle = nullptr; ///< FreeRTOS task handle (opaque type)
+
+    // Statistics, written by the bus task only
+    volatile uint32_t requests = 0;
+    volatile uint32_t failures = 0;
+    uint64_t busyUs = 0;
+    uint64_t windowStartUs = 0;
+    volatile uint16_t utilisationPermille = 0;
+
+    uint8_t rxBuffer[256];      ///< Largest RTU frame
+    uint8_t txBuffer[256];      ///< FC15 request being sent
+};
+
+/**
+ * @struct ModbusCoilOutput
+ * @brief A DO point of a device profile; OutputPointManager drives it as a relay.
+ */
+struct ModbusCoilOutput {
+    String pointId;
+    ModbusBus* bus;
+    uint16_t blockIndex;    ///< Index into ModbusBus::coilBlocks
+    uint16_t bit;           ///< Coil offset inside the block
+};
+
+/**
+ * @class ModbusMaster
+ * @brief Polls the configured Modbus RTU devices, one task per RS-485 interface.
+ *
+ * At begin() each enabled device's profile points (AI/DI) are sorted by function
+ * code and address and merged into contiguous read blocks, so a device is read
+ * with one request per block instead of one per point. Each block runs at the
+ * fastest update rate of its points (profile "updateIntervalMs", else the device's
+ * pollingIntervalMs). The bus task always runs the block that is due next and
+ * publishes the scaled values to InputPointManager, where they are read by handle
+ * like direct inputs.
+ *
+ * Addresses in Modicon notation (40001, 30001, 10001) are converted to protocol
+ * addresses; smaller values are used as-is.
+ *
+ * DO points with registerType "Coil" are not polled: they are exposed as coil outputs
+ * that OutputPointManager registers as relays. Consecutive coils of a device form a
+ * coil block; OutputPointManager stages a whole command batch with stageCoil() and
+ * calls commitCoils() once, and the bus task then writes each changed block with a
+ * single FC15 request ahead of its next poll. A batch switching 32 coils on one
+ * device therefore costs one bus transaction, not 32.
+ */
+class ModbusMaster {
+public:
+    ModbusMaster();
+
+    // Builds the read blocks, registers the points and starts one task per interface.
+    // Call after InputPointManager::begin(). Returns false only on a configuration error;
+    // a board without Modbus devices is a successful no-op.
+    bool begin(const IOConfiguration& ioConfig, ConfigManager& configManager);
+
+    // Number of RS-485 interfaces with at least one read or coil block
+    size_t busCount() const { return buses.size(); }
+
+    // DO coils of the enabled devices, in the order OutputPointManager appends them as relays
+    size_t coilOutputCount() const { return coilOutputs.size(); }
+    const String& coilOutputPointId(size_t index) const { return coilOutputs[index].pointId; }
+    // Stages one coil state for the next commitCoils(). Spinlock only: safe from ISRs.
+    void stageCoil(size_t index, bool on);
+    // Wakes the bus tasks that have staged changes. Safe from ISRs, but notifies a task:
+    // never call it inside a critical section.
+    void commitCoils();
+    // Copies the counters of one interface; false if the index is out of range
+    bool getBusStats(size_t busIndex, ModbusBusStats& out) const;
+
+private:
+    std::vector<ModbusBus*> buses; ///< Heap allocated; bus tasks hold the pointer
+    std::vector<ModbusCoilOutput> coilOutputs;
+
+    bool addDevice(ModbusBus& bus, const ModbusDeviceConfig& device, const ModbusDeviceProfile& profile);
+    static bool parseRegisterType(const String& registerType, int address, uint8_t& functionCode, uint16_t& protocolAddress);
+    static bool parseDataType(const String& dataType, ModbusDataType& type);
+    static uint16_t valueWidth(uint8_t functionCode, ModbusDataType type);
+    static uint32_t serialConfig(const String& config);
+    static uint16_t crc16(const uint8_t* data, size_t length);
+
+    static void busTaskWrapper(void* parameter);
+    void busTask(ModbusBus& bus);
+    void sendRequest(ModbusBus& bus, const uint8_t* request, size_t length);
+    bool readBlock(ModbusBus& bus, const ModbusReadBlock& block);
+    uint32_t writeStagedCoils(ModbusBus& bus);
+    bool writeCoilBlock(ModbusBus& bus, const ModbusCoilBlock& block, size_t dataBytes);
+    void recordDeviceResult(ModbusBus& bus, uint8_t deviceIndex, bool success);
+    void publishBlock(ModbusBus& bus, const ModbusReadBlock& block);
+    void recordResult(ModbusBus& bus, ModbusReadBlock& block, bool success);
+};
+
+#endif // MODBUS_MASTER_H
@@ -0,0 +1,115 @@
+#ifndef OUTPUT_BACKEND_H
+#define OUTPUT_BACKEND_H
+
+#include <Arduino.h>
+#include <vector>
+#include "IOConfig.h"
+
+// Number of 74HC595s on the board's chain (relay byte plus two unused registers)
+#define RELAY_SHIFT_CHAIN_MIN_BYTES 3
+
+/**
+ * @class OutputBackend
+ * @brief Drives one contiguous range of OutputPointManager's relay indices.
+ *
+ * OutputPointManager stages commands in its relay image (bit i % 8 of byte i / 8 is
+ * relay i) and calls flush() once per command batch on each backend with a staged
+ * change. A backend writes its whole range in one go, so a batch costs one shift
+ * pass / one bus request per device however many relays it switches.
+ */
+class OutputBackend {
+public:
+    OutputBackend(int firstRelay, int relayCount) : first(firstRelay), count(relayCount) {}
+    virtual ~OutputBackend() {}
+
+    int firstRelay() const { return first; }
+    int relayCount() const { return count; }
+    bool owns(int relayIndex) const { return relayIndex >= first && relayIndex < first + count; }
+
+    // Drives every relay of the range off. Runs before the RTOS objects exist.
+    virtual void begin() = 0;
+    // Writes the range of @p image. Caller holds OutputPointManager's stateMutex.
+    virtual void flush(const std::vector<uint8_t>& image) = 0;
+    // Switches one relay off without writing the other staged changes (volume dose end).
+    // Spinlock only: safe from ISRs and critical sections. A backend that cannot write
+    // from there only stages the change; commit() then sends it.
+    virtual void switchOff(int relayIndex) = 0;
+    // Sends what switchOff() staged. May notify a task: never call it inside a critical
+    // section (ISRs are fine).
+    virtual void commit() {}
+    // Backend name for logs
+    virtual const char* name() const = 0;
+
+protected:
+    int first;
+    int count;
+
+    static bool relayBit(const std::vector<uint8_t>& image, int relayIndex) {
+        return (image[relayIndex / 8] & (1 << (relayIndex % 8))) != 0;
+    }
+};
+
+/**
+ * @class ShiftRegisterBackend
+ * @brief Relays on a chain of 74HC595s: the whole N-byte chain is shifted in one pass
+ * and latched once.
+ */
+class ShiftRegisterBackend : public OutputBackend {
+public:
+    ShiftRegisterBackend(int firstRelay, int relayCount, const RelayControlPins& pins);
+
+    void begin() override;
+    void flush(const std::vector<uint8_t>& image) override;
+    void switchOff(int relayIndex) override;
+    const char* name() const override { return "ShiftRegister"; }
+
+private:
+    int dataPin;
+    int clockPin;
+    int latchPin;
+    int oePin;
+    int chainBytes;
+    std::vector<uint8_t> latched; // Image last shifted into the chain (relay first = bit 0)
+    portMUX_TYPE shiftMux = portMUX_INITIALIZER_UNLOCKED;
+
+    void shiftOutLatched();
+    void shiftOutByte(uint8_t dat);
+};
+
+/**
+ * @class DirectGpioBackend
+ * @brief One GPIO per relay (board_config.json relayOutputs.gpioPins, in relay order).
+ * OutputPointManager only creates it with a valid pin for every relay.
+ */
+class DirectGpioBackend : public OutputBackend {
+public:
+    DirectGpioBackend(int firstRelay, const std::vector<int>& relayPins)
+        : OutputBackend(firstRelay, (int)relayPins.size()), pins(relayPins) {}
+
+    void begin() override;
+    void flush(const std::vector<uint8_t>& image) override;
+    void switchOff(int relayIndex) override;
+    const char* name() const override { return "DirectGPIO"; }
+
+private:
+    std::vector<int> pins; // Output pin per relay, relay `first` at index 0
+};
+
+/**
+ * @class ModbusCoilBackend
+ * @brief DO coils of Modbus devices (ModbusMaster coil outputs, in order). flush()
+ * stages the coils and wakes the bus task, which writes each changed coil block with
+ * one FC15 request, so a batch never waits for the bus. switchOff() only stages.
+ */
+class ModbusCoilBackend : public OutputBackend {
+public:
+    ModbusCoilBackend(int firstRelay, int relayCount) : OutputBackend(firstRelay, relayCount) {}
+
+    void begin() override {} // ModbusMaster writes every coil block off at start
+    void flush(const std::vector<uint8_t>& image) override;
+    void switchOff(int relayIndex) override;
+    void commit() override;
+    const char* name() const override { return "ModbusCoils"; }
+};
+
+#endif // OUTPUT_BACKEND_H
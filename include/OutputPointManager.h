@@ -4,61 +4,152 @@
 #include <Arduino.h>
 #include <vector>
 #include <map>
+#include <memory>
 #include "IOConfig.h"
+#include "OutputBackend.h"
 #include "OutputDefData.h"
 #include "OutputTypeData.h"
+#include "PointRegistry.h"
+#include "Benchmark.h"
+#include <type_traits>
+
+// Depth of the relay command queue; also the largest batch sendCommands() accepts
+#define OUTPUT_COMMAND_QUEUE_LENGTH 16
+// Max time the processor waits for the rest of an announced batch before latching
+#define OUTPUT_BATCH_WAIT_MS 20
+// Finished volume doses waiting for the command processor's bookkeeping
+#define OUTPUT_DOSE_END_QUEUE_LENGTH 8
+// Output definitions give valve flow in US gallons per hour (flowRateGPH)
+#define OUTPUT_ML_PER_GALLON 3785.41f
 
 // Enum for relay command types
 enum class RelayCommandType {
     TURN_ON,
     TURN_OFF,
-    TURN_ON_TIMED
+    TURN_ON_TIMED,
+    TURN_ON_VOLUME // On until volumeMl passed the relay's flow meter (FlowMeterManager)
 };
 
-// Command struct for the queue
+// Command struct for the queue (fixed-size and trivially copyable: FreeRTOS queues memcpy items)
 struct OutputCommand {
-    String pointId;
-    RelayCommandType commandType;
-    unsigned long durationMs; // For timed ON, 0 otherwise
+    PointHandle point = INVALID_POINT_HANDLE; // Resolve once via pointRegistry.resolve(pointId)
+    RelayCommandType commandType = RelayCommandType::TURN_OFF;
+    uint32_t durationMs = 0;    // For timed ON, 0 otherwise; safety timeout of TURN_ON_VOLUME
+    uint32_t volumeMl = 0;      // TURN_ON_VOLUME target, 0 otherwise
+    uint8_t batchRemaining = 0; // Set by sendCommands(): commands still to follow in the same latch
+#if SNR_BENCHMARK
+    int64_t enqueuedUs = 0;     // Stamped on enqueue; the processor records enqueue -> latch latency
+#endif
 };
+static_assert(std::is_trivially_copyable<OutputCommand>::value, "OutputCommand is copied with memcpy by the queue");
 
+/**
+ * @class OutputPointManager
+ * @brief Queued relay commands, off-deadlines and the relay image, for all relay backends.
+ *
+ * Relay indices (RELAY_OUTPUT localIndex) are the direct relays first, then the Modbus
+ * DO coils in ModbusMaster order. Each contiguous range belongs to one OutputBackend;
+ * commands only stage the image, and every backend with a change is flushed once per
+ * batch.
+ */
 class OutputPointManager {
 public:
     OutputPointManager();
 
-    // Initialize with parsed IOConfiguration
+    // Drives every direct relay off (outputs disabled while shifting). Call first in
+    // setup(), before any slow initialisation; begin() then skips the hardware init.
+    void enterSafeState(const IOConfiguration& ioConfig);
+
+    // Initialize with parsed IOConfiguration. Call after ModbusMaster::begin(): its DO
+    // coils are appended as relays.
     bool begin(const IOConfiguration& ioConfig);
 
-    // Send a command to the output point (by pointId)
+    // Send a command to the output point (by handle)
     bool sendCommand(const OutputCommand& command);
+    // Convenience overload: resolves pointId (one map lookup) and sends
+    bool sendCommand(const String& pointId, RelayCommandType commandType, uint32_t durationMs = 0);
+
+    // Send several commands that take effect together (one flush per backend).
+    // All-or-nothing: fails if the batch does not fit in the command queue.
+    bool sendCommands(const std::vector<OutputCommand>& commands);
+
+    // Current (last staged) state of a relay output; false for unknown handles. Lock-free.
+    bool getRelayState(PointHandle handle) const;
+
+    // Volume dose end, called by FlowMeterManager (from the PCNT interrupt or a task).
+    // endVolumeDose() switches the relay off at once where the backend can (local
+    // relays) and only stages it otherwise; spinlock only, safe from ISR and critical
+    // sections. volumeDoseEnded() must follow outside the critical section: it commits
+    // the staged write (Modbus coils) and defers the bookkeeping (safety timer, live
+    // event) to a task. ISR-safe.
+    void endVolumeDose(int relayIndex);
+    void volumeDoseEnded(int relayIndex, uint16_t doseSeq);
+
+    // Queue statistics for /api/metrics
+    size_t getQueueDepth() const;                                  // Commands waiting right now
+    size_t getQueuePeakDepth() const { return queuePeakDepth; }    // Deepest the queue has been
+    uint32_t getRejectedCommands() const { return rejectedCommands; } // Sends refused because the queue was full
 
     // Persistence for output point definitions
     bool saveOutputPointDefinition(const OutputPointDefinition& definition, const JsonObject& configValues);
     bool loadOutputPointDefinition(const String& pointId, OutputPointDefinition& definition, JsonObject& configValuesOut);
+    // Configured flow of a relay (flowRateGPH x emittersPerPlant of its output definition) in
+    // mL/s; 0 if the definition is missing or has no flow rate. Reads flash.
+    float getConfiguredFlowMlPerSec(const String& pointId);
 
 private:
     IOConfiguration ioConfig;
     int directRelayCount = 0;
-    std::map<String, int> directRelayPointIdToIndexMap;
+    int relayCount = 0; // Direct relays, then Modbus coils
+
+    // Relay state image: bit (i % 8) of byte (i / 8) is relay i. Guarded by stateMutex;
+    // byte updates also hold relayMux, which endVolumeDose() takes alone.
+    std::vector<uint8_t> relayImage;
+    portMUX_TYPE relayMux = portMUX_INITIALIZER_UNLOCKED;
+    std::vector<std::unique_ptr<OutputBackend>> backends;
+    std::vector<uint8_t> relayBackend; // Backend index per relay index
+    std::vector<bool> backendDirty;    // Staged changes not flushed yet; guarded by stateMutex
+    bool hardwareInitialized = false;  // Set by enterSafeState()
 
     // FreeRTOS handles (opaque types for now)
     void* stateMutex;
-    void* timerListMutex;
+    void* sendMutex;       // Keeps batches contiguous in the queue
     void* commandQueue;
-    void* commandProcessorTaskHandle;
-    std::vector<void*> activeTimerTasks;
+    void* doseEndQueue;    // Packed (doseSeq << 16 | relayIndex) of finished volume doses
+    void* commandProcessorTaskHandle; // Woken by task notification bits (OUTPUT_EVENT_*)
+    volatile size_t queuePeakDepth = 0;     // Updated under sendMutex
+    volatile uint32_t rejectedCommands = 0; // Updated under sendMutex
+
+    // Timed-off scheduling: one esp_timer armed for the earliest deadline of a
+    // binary min-heap of relay indices (O(log n) insert/cancel, no per-relay tasks).
+    // Owned by the command processor task: the timer callback only notifies it.
+    void* offTimer;                          // esp_timer_handle_t
+    std::vector<int> timerHeap;              // Relay indices, ordered by off-deadline
+    std::vector<int> timerHeapPos;           // Heap slot per relay index, -1 if not scheduled
+    std::vector<int64_t> relayOffDeadlineUs; // Off-deadline per relay index (esp_timer_get_time() base)
+    std::vector<uint16_t> relayDoseSeq;      // Bumped per command; a stale volume dose end is ignored
 
     // Internal helpers
-    void initializeDirectRelayHardware();
-    void buildDirectRelayMap();
-    void setDirectRelayStatePhysical(int relayIndex, bool on);
+    void addBackend(OutputBackend* backend);
+    void registerRelayPoints();
+    void stageRelayState(int relayIndex, bool on);
+    void latchRelayImage();
+    void applyCommand(const OutputCommand& cmd);
+    void noteQueueDepth(bool accepted);
     static void commandProcessorTaskWrapper(void* parameter);
     void processCommandQueueTask();
-    void startTimerTaskForDirectRelay(int relayIndex, unsigned long durationMs);
-    void cancelTimerTaskForDirectRelay(int relayIndex);
-    static void timedOffTaskWrapper(void* parameter);
-    void Send_74HC595(uint8_t relayData, int dataPin, int clockPin, int latchPin);
-    void Send_Bytes(uint8_t dat, int dataPin, int clockPin);
+    void scheduleRelayOff(int relayIndex, unsigned long durationMs);
+    void cancelRelayOff(int relayIndex);
+    void armOffTimer();
+    static void offTimerCallback(void* parameter);
+    void notifyProcessor(uint32_t events);
+    void processExpiredRelayTimers();
+    void processEndedDoses();
+    bool timerHeapLess(size_t a, size_t b) const;
+    void timerHeapSwap(size_t a, size_t b);
+    void timerHeapSiftUp(size_t pos);
+    void timerHeapSiftDown(size_t pos);
+    void timerHeapRemoveAt(size_t pos);
 
     // Persistence helpers
     String getOutputDefinitionPath(const String& pointId);
@@ -0,0 +1,60 @@
+#ifndef PERSISTENCE_WORKER_H
+#define PERSISTENCE_WORKER_H
+
+#include <Arduino.h>
+
+// Depth of the job queue; submit() fails (and the caller retries later) when it is full
+#define PERSISTENCE_QUEUE_LENGTH 16
+// Periodic jobs that can be registered with addPeriodic()
+#define PERSISTENCE_MAX_PERIODIC 4
+
+/**
+ * @struct PersistenceJob
+ * @brief One unit of background flash work: a function and its context.
+ */
+struct PersistenceJob {
+    void (*run)(void* context) = nullptr;
+    void* context = nullptr;
+};
+
+/**
+ * @class PersistenceWorker
+ * @brief The one task that performs background LittleFS writes (see TaskConfig.h).
+ *
+ * Producers on any core hand work over with submit(), which never blocks; write-behind
+ * state (lock table, history buffers, cycle steps) stays with its owner, which submits
+ * a flush job when it becomes dirty and uses its own flag so the same flush is queued
+ * at most once. Periodic jobs (addPeriodic()) run on the same task between queued
+ * jobs. Long flash work whose outcome goes back to an HTTP client (bulk schedule
+ * import) is submitted too; the web server answers once the job published its result.
+ */
+class PersistenceWorker {
+public:
+    // Creates the queue and starts the worker task on SERVICE_CORE.
+    bool begin();
+
+    // Queues @p run(@p context); false if the worker is not running or the queue is full.
+    bool submit(void (*run)(void*), void* context);
+
+    // Runs @p run(@p context) about every @p periodMs on the worker task. Safe before and after begin().
+    bool addPeriodic(void (*run)(void*), void* context, uint32_t periodMs);
+
+private:
+    struct PeriodicJob {
+        PersistenceJob job;
+        uint32_t periodMs = 0;
+        uint32_t lastRunMs = 0;
+    };
+    PeriodicJob periodic[PERSISTENCE_MAX_PERIODIC]; // Entries below periodicCount are immutable except lastRunMs
+    size_t periodicCount = 0;
+    portMUX_TYPE periodicMux = portMUX_INITIALIZER_UNLOCKED;
+
+    void* jobQueue = nullptr;   // FreeRTOS queue (opaque type)
+    void* taskHandle = nullptr; // FreeRTOS task handle (opaque type)
+
+    static void taskWrapper(void* parameter);
+    void task();
+    uint32_t runDuePeriodic();
+};
+
+#endif // PERSISTENCE_WORKER_H
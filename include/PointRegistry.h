@@ -0,0 +1,90 @@
+#ifndef POINT_REGISTRY_H
+#define POINT_REGISTRY_H
+
+#include <Arduino.h>
+#include <vector>
+#include <map>
+
+// Compact integer handle for an IO point. Handles are dense (0..size()-1) and are
+// assigned by the IO managers' begin() calls; they stay valid until reboot.
+typedef int16_t PointHandle;
+#define INVALID_POINT_HANDLE ((PointHandle)-1)
+
+/**
+ * @enum PointKind
+ * @brief Identifies which IO manager owns a registered point.
+ */
+enum class PointKind : uint8_t {
+    RELAY_OUTPUT,  ///< Direct relay owned by OutputPointManager
+    DIGITAL_INPUT, ///< Direct digital input owned by InputPointManager
+    ANALOG_INPUT,  ///< Direct analog input owned by InputPointManager
+    MODBUS_INPUT,  ///< Modbus AI/DI polled by ModbusMaster; value stored in InputPointManager
+    FLOW_METER     ///< PCNT pulse counter owned by FlowMeterManager; value is total litres
+};
+
+/**
+ * @struct PointEntry
+ * @brief Registry record for one IO point.
+ */
+struct PointEntry {
+    String pointId;      ///< Configured point identifier (e.g., "DirectRelay_0")
+    PointKind kind;      ///< Owning manager / point type
+    int16_t localIndex;  ///< Index inside the owning manager's arrays (relay index, DI bit, AI slot)
+};
+
+/**
+ * @class PointRegistry
+ * @brief Resolves pointId strings to dense PointHandles once, at configuration time.
+ *
+ * IO managers register their points in begin(). Everything after that (queues,
+ * dispatch, value reads) works on PointHandles, which index straight into the
+ * entry table. Registration is only done during setup(); afterwards the registry
+ * is read-only and safe to read from any task without locking.
+ */
+class PointRegistry {
+public:
+    /**
+     * @brief Registers a point and assigns it the next free handle.
+     * @param pointId The configured point identifier.
+     * @param kind The point type / owning manager.
+     * @param localIndex Index of the point inside the owning manager.
+     * @return The new handle, the existing handle if the same point was already registered
+     *         with the same kind, or INVALID_POINT_HANDLE if the pointId is empty or taken
+     *         by a point of a different kind.
+     */
+    PointHandle registerPoint(const String& pointId, PointKind kind, int16_t localIndex);
+
+    /**
+     * @brief Looks up the handle of a pointId (one map lookup; do this once, not per command).
+     * @param pointId The configured point identifier.
+     * @return The handle, or INVALID_POINT_HANDLE if the point is unknown.
+     */
+    PointHandle resolve(const String& pointId) const;
+
+    /**
+     * @brief Looks up the handle of a pointId and checks its kind.
+     * @param pointId The configured point identifier.
+     * @param kind The expected point kind.
+     * @return The handle, or INVALID_POINT_HANDLE if unknown or of another kind.
+     */
+    PointHandle resolve(const String& pointId, PointKind kind) const;
+
+    /**
+     * @brief Returns the entry for a handle in O(1).
+     * @param handle The point handle.
+     * @return Pointer to the entry, or nullptr if the handle is out of range.
+     */
+    const PointEntry* get(PointHandle handle) const {
+        if (handle < 0 || handle >= (PointHandle)entries.size()) return nullptr;
+        return &entries[handle];
+    }
+
+    /** @brief Returns the number of registered points (handles are 0..size()-1). */
+    size_t size() const { return entries.size(); }
+
+private:
+    std::vector<PointEntry> entries;                  ///< Indexed by PointHandle
+    std::map<String, PointHandle> handleByPointId;    ///< Used only by resolve()
+};
+
+#endif // POINT_REGISTRY_H
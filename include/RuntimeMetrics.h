@@ -0,0 +1,92 @@
+#ifndef RUNTIME_METRICS_H
+#define RUNTIME_METRICS_H
+
+#include <Arduino.h>
+
+// Number of finite latency histogram buckets; bounds are in RuntimeMetrics.cpp (plus one +Inf bucket)
+#define METRICS_LATENCY_BUCKETS 9
+
+/**
+ * @enum MetricRoute
+ * @brief API routes with their own request counter and latency histogram.
+ */
+enum class MetricRoute : uint8_t {
+    LOGIN,
+    LOGOUT,
+    USER,
+    LOGS,
+    METRICS,
+    SCHEDULES,
+    SCHEDULE_GET,
+    SCHEDULE_SAVE,
+    SCHEDULE_DELETE,
+    SCHEDULE_LOCK,
+    SCHEDULE_UNLOCK,
+    HISTORY,
+    SCHEDULE_IMPORT,
+    SCHEDULE_EXPORT,
+    COUNT
+};
+
+/**
+ * @class RuntimeMetrics
+ * @brief Lock-free counters behind GET /api/metrics.
+ *
+ * Handlers record their latency (time spent on the async TCP task) per route; the
+ * persistence code records LittleFS reads and writes with their byte counts. Every
+ * update is a handful of relaxed atomic increments, so recording is cheap enough for
+ * every request, and nothing is allocated. Gauges (heap, task stacks, queue depths)
+ * are sampled only when the endpoint is read.
+ *
+ * All members are zero-initialised statics, so recording before setup() is safe.
+ */
+class RuntimeMetrics {
+public:
+    // Records one handled request. @p micros is the handler's own run time.
+    void recordRoute(MetricRoute route, uint32_t micros);
+    // Records one LittleFS read/write operation (an open-and-read or open-and-write of a file)
+    void recordFsRead(size_t bytes);
+    void recordFsWrite(size_t bytes);
+    // Records one autopilot reaction: threshold crossing published -> dose command queued
+    void recordAutopilotReaction(uint32_t micros);
+
+    /**
+     * @brief Writes all metrics in the Prometheus text exposition format.
+     *        Counters and histograms come from this object; heap, task stack and
+     *        queue gauges are sampled from the other services while writing.
+     */
+    void writeText(Print& out) const;
+
+    static const char* routeName(MetricRoute route);
+
+private:
+    struct RouteCounters {
+        uint32_t count;
+        uint32_t sumUs;  ///< Wraps after ~71 min of cumulative handler time; rate() handles resets
+        uint32_t maxUs;
+        uint32_t buckets[METRICS_LATENCY_BUCKETS + 1]; ///< Non-cumulative; the last is +Inf
+    };
+    RouteCounters routes[(size_t)MetricRoute::COUNT];
+    RouteCounters autopilotReaction;
+    uint32_t fsReads;
+    uint32_t fsReadBytes;
+    uint32_t fsWrites;
+    uint32_t fsWriteBytes;
+
+    static void record(RouteCounters& counters, uint32_t micros);
+    void writeRoutes(Print& out) const;
+    void writeAutopilot(Print& out) const;
+    static void writeTasks(Print& out);
+};
+
+/**
+ * @brief Times the enclosing scope into the route's histogram (RAII).
+ */
+struct RouteTimer {
+    MetricRoute route;
+    int64_t startUs;
+    explicit RouteTimer(MetricRoute r);
+    ~RouteTimer();
+};
+
+#endif // RUNTIME_METRICS_H
@@ -0,0 +1,125 @@
+#ifndef SCHEDULE_BINARY_H
+#define SCHEDULE_BINARY_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "ScheduleData.h"
+
+// Packed binary sidecar for schedule files (/daily_schedules/<uid>.bin).
+// Written next to the JSON file by ScheduleManager::saveSchedule(). JSON remains the
+// interchange format for the web UI; the sidecar lets runtime code read fixed-size,
+// pre-sorted event records straight from flash without JSON parsing.
+//
+// File layout: ScheduleBinHeader, then apCount autopilot records, durCount duration
+// records and volCount volume records, each array sorted by start time.
+
+#define SCHEDULE_BIN_MAGIC   0x42524E53UL // "SNRB" little-endian
+#define SCHEDULE_BIN_VERSION 2
+#define SCHEDULE_BIN_EXTENSION ".bin"
+
+/** @brief Fixed header at offset 0 of a schedule sidecar file. */
+struct ScheduleBinHeader {
+    uint32_t magic;          ///< SCHEDULE_BIN_MAGIC
+    uint16_t version;        ///< SCHEDULE_BIN_VERSION
+    uint16_t headerSize;     ///< sizeof(ScheduleBinHeader), allows appending fields later
+    uint32_t jsonSize;       ///< Size of the JSON file this sidecar was written with (staleness check)
+    uint32_t jsonCrc;        ///< CRC-32 of that whole JSON file (staleness check)
+    int16_t lightsOnTime;    ///< Minutes from midnight
+    int16_t lightsOffTime;   ///< Minutes from midnight
+    uint16_t apCount;        ///< Number of autopilot window records
+    uint16_t durCount;       ///< Number of duration event records
+    uint16_t volCount;       ///< Number of volume event records
+    uint16_t reserved;
+};
+
+/** @brief On-flash record for an AutopilotWindow. */
+struct ScheduleBinAutopilot {
+    uint16_t startTime;
+    uint16_t endTime;
+    float matricTension;
+    float doseVolume;
+    uint16_t settlingTime;
+    uint16_t doseDuration;
+};
+
+/** @brief On-flash record for a DurationEvent. */
+struct ScheduleBinDuration {
+    uint16_t startTime;
+    uint16_t endTime;
+    uint32_t duration;       ///< Seconds
+};
+
+/** @brief On-flash record for a VolumeEvent. */
+struct ScheduleBinVolume {
+    uint16_t startTime;
+    uint16_t reserved;
+    float doseVolume;
+    int32_t calculatedDuration; ///< Seconds, -1 in templates
+};
+
+static_assert(sizeof(ScheduleBinHeader) == 28, "ScheduleBinHeader layout changed");
+static_assert(sizeof(ScheduleBinAutopilot) == 16, "ScheduleBinAutopilot layout changed");
+static_assert(sizeof(ScheduleBinDuration) == 8, "ScheduleBinDuration layout changed");
+static_assert(sizeof(ScheduleBinVolume) == 12, "ScheduleBinVolume layout changed");
+
+/**
+ * @brief Writes the packed binary sidecar for a schedule.
+ *
+ * Event arrays are copied and sorted by start time before writing, so the
+ * caller's schedule is not modified.
+ *
+ * @param path Path of the sidecar file to (over)write.
+ * @param schedule The schedule to encode.
+ * @param jsonSize Size in bytes of the JSON file written for the same schedule.
+ * @param jsonCrc CRC-32 of that JSON file (stampConfigSource()).
+ * @return True if the whole file was written, false otherwise.
+ */
+bool writeScheduleBinary(const String& path, const Schedule& schedule, uint32_t jsonSize, uint32_t jsonCrc);
+
+/**
+ * @class ScheduleBinaryReader
+ * @brief Lazy, record-at-a-time reader for a schedule sidecar file.
+ *
+ * Only the header is read on open(); each read*() call seeks to and reads a
+ * single fixed-size record, so no event vectors are allocated.
+ */
+class ScheduleBinaryReader {
+public:
+    ScheduleBinaryReader() = default;
+    ~ScheduleBinaryReader() { close(); }
+    ScheduleBinaryReader(const ScheduleBinaryReader&) = delete;
+    ScheduleBinaryReader& operator=(const ScheduleBinaryReader&) = delete;
+
+    /**
+     * @brief Opens a sidecar file and validates its header.
+     * @param path Path of the sidecar file.
+     * @param expectedJsonSize Current size of the matching JSON file.
+     * @param expectedJsonCrc Current CRC-32 of the matching JSON file. The sidecar is
+     *                        rejected as stale if it was written for another size or CRC.
+     * @return True if the file is present, well-formed and current.
+     */
+    bool open(const String& path, uint32_t expectedJsonSize, uint32_t expectedJsonCrc);
+    /** @brief Closes the underlying file. Safe to call when not open. */
+    void close();
+    /** @brief Returns true if a valid sidecar is open. */
+    bool isOpen() const { return _open; }
+
+    /** @brief Returns the header of the open sidecar. Only meaningful if isOpen(). */
+    const ScheduleBinHeader& header() const { return _header; }
+
+    /** @brief Reads autopilot window @p index (sorted by start time). */
+    bool readAutopilotWindow(uint16_t index, AutopilotWindow& out);
+    /** @brief Reads duration event @p index (sorted by start time). */
+    bool readDurationEvent(uint16_t index, DurationEvent& out);
+    /** @brief Reads volume event @p index (sorted by start time). */
+    bool readVolumeEvent(uint16_t index, VolumeEvent& out);
+
+private:
+    File _file;
+    ScheduleBinHeader _header = {};
+    bool _open = false;
+
+    bool readRecord(size_t offset, void* dst, size_t len);
+};
+
+#endif // SCHEDULE_BINARY_H
@@ -0,0 +1,104 @@
+#ifndef SCHEDULE_ENGINE_H
+#define SCHEDULE_ENGINE_H
+
+#include <Arduino.h>
+#include <vector>
+#include "PointRegistry.h"
+
+// Directory holding Active Cycle configurations (see CycleData.h)
+#define SCHEDULE_ENGINE_CYCLE_DIR "/active_cycles"
+// Upper bound on one sleep; guards against RTC drift and clock changes
+#define SCHEDULE_ENGINE_MAX_SLEEP_MS (60UL * 60 * 1000)
+// Re-check interval while the wall clock has not been set yet
+#define SCHEDULE_ENGINE_CLOCK_RETRY_MS (60UL * 1000)
+// Events found up to this many seconds late (e.g. after a long flash write) still fire
+#define SCHEDULE_ENGINE_LATE_GRACE_S 60
+// time() values below this are treated as "clock not set" (2021-01-01T00:00:00Z)
+#define SCHEDULE_ENGINE_MIN_VALID_EPOCH 1609459200L
+
+/**
+ * @struct ScheduleTimelineEntry
+ * @brief One relay action on the compiled daily timeline.
+ */
+struct ScheduleTimelineEntry {
+    uint32_t secondOfDay;  ///< Local time the action starts, 0..86399
+    uint16_t bindingIndex; ///< Binding that produced the entry (recompile key)
+    PointHandle point;     ///< Relay output to drive
+    uint32_t durationMs;   ///< TURN_ON_TIMED duration; safety timeout of a volume entry
+    uint32_t volumeMl;     ///< TURN_ON_VOLUME target in mL, 0 for timed entries
+};
+
+/**
+ * @struct ScheduleBinding
+ * @brief Links a schedule to the relay output it drives.
+ */
+struct ScheduleBinding {
+    String scheduleUID;  ///< Schedule in /daily_schedules/
+    String sourceId;     ///< Who created the binding (cycleId), for logging
+    PointHandle point = INVALID_POINT_HANDLE;
+    bool active = false; ///< False once unbound; the slot keeps its index
+};
+
+/**
+ * @class ScheduleEngine
+ * @brief Executes bound schedules from one precompiled, time-sorted daily timeline.
+ *
+ * Each binding's duration and volume events are read from the schedule's packed
+ * sidecar (ScheduleBinary.h) and merged into the timeline. The engine task sleeps
+ * until the next entry is due (or until it is notified of a timeline change), sends
+ * all entries due in the same second as one OutputPointManager batch, and goes back
+ * to sleep, so wake-ups scale with the number of events. When a schedule is saved
+ * only the entries of its bindings are recompiled.
+ *
+ * Volume events on a relay with a flow meter (FlowMeterManager) are sent as
+ * TURN_ON_VOLUME and end on the measured volume; calculatedDuration, if present, only
+ * sets the safety timeout. On other relays they run for calculatedDuration if present,
+ * otherwise for doseVolume over the relay's configured flow (output definition
+ * flowRateGPH x emittersPerPlant, read when the binding is compiled); events on a relay
+ * without either are skipped with a warning. Autopilot windows are not part of the timeline.
+ */
+class ScheduleEngine {
+public:
+    ScheduleEngine();
+
+    // Loads bindings from the active cycles, compiles the timeline and starts the task.
+    // Call after ScheduleManager, OutputPointManager and CycleManager are initialized.
+    bool begin();
+
+    // Binds a schedule to a relay output and compiles its entries
+    bool bindSchedule(const String& scheduleUID, const String& pointId, const String& sourceId = "");
+    // Removes all bindings of a schedule and its timeline entries
+    void unbindSchedule(const String& scheduleUID);
+    // Removes all bindings created by @p sourceId (a cycle changing step) and their entries
+    void unbindSource(const String& sourceId);
+
+    // Called by ScheduleManager after a schedule file was written / removed
+    void onScheduleSaved(const String& scheduleUID);
+    void onScheduleDeleted(const String& scheduleUID);
+
+    // Number of compiled timeline entries (diagnostics)
+    size_t timelineSize() const;
+
+private:
+    std::vector<ScheduleBinding> bindings;
+    std::vector<ScheduleTimelineEntry> timeline; // Sorted by secondOfDay; guarded by timelineMutex
+
+    // Dispatch cursor: entries before cursorSecond have already run on cursorDay
+    uint32_t cursorSecond = 0;
+    int cursorDay = -1;
+
+    // FreeRTOS handles (opaque types)
+    void* timelineMutex = nullptr;
+    void* engineTaskHandle = nullptr;
+
+    void loadActiveCycleBindings();
+    bool compileBinding(uint16_t bindingIndex, std::vector<ScheduleTimelineEntry>& out);
+    void replaceBindingEntries(uint16_t bindingIndex, std::vector<ScheduleTimelineEntry>& entries);
+    void wakeEngineTask();
+    static bool entryEarlier(const ScheduleTimelineEntry& a, const ScheduleTimelineEntry& b);
+    static void engineTaskWrapper(void* parameter);
+    void engineTask();
+    uint32_t dispatchDueEntries(uint32_t nowSecond, int today);
+};
+
+#endif // SCHEDULE_ENGINE_H
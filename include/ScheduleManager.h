@@ -3,8 +3,28 @@
 
 #include <Arduino.h>
 #include <vector>
+#include <memory>
 #include "ScheduleData.h" // Include the data structures
 
+class ScheduleBinaryReader;
+
+// Append-only journal of index changes, written next to the index file
+// (allSchedules.json -> allSchedules.journal) and folded into it by compaction.
+#define SCHEDULE_INDEX_JOURNAL_EXTENSION ".journal"
+// Journal records after which the index is rewritten and the journal truncated
+#define SCHEDULE_INDEX_JOURNAL_MAX_RECORDS 64
+// RAM budget for parsed schedules kept by ScheduleManager::getSchedule() (estimated bytes)
+#define SCHEDULE_CACHE_BUDGET_BYTES 16384
+
+/**
+ * @brief Shared, immutable parsed schedule.
+ *
+ * Readers (web API, ScheduleEngine) hold the same instance without copying its
+ * vectors; the cache dropping its reference never invalidates a snapshot in use.
+ * To modify, copy into a Schedule and save it (copy-on-write).
+ */
+typedef std::shared_ptr<const Schedule> ScheduleSnapshot;
+
 // Forward declaration if needed, or include directly
 // class LockManager;
 
@@ -28,6 +48,8 @@ struct ScheduleFile {
  * This class handles interactions with schedule files stored in LittleFS, maintains an
  * index of available schedules (`allSchedules.json`), and provides methods for manipulating
  * schedule data, including adding and validating different types of irrigation events.
+ * The index, its journal and the bulk save state are guarded by one mutex (held only
+ * for in-memory index updates and their journal records); callers get copies.
  */
 class ScheduleManager {
 public:
@@ -43,8 +65,9 @@ public:
     /**
      * @brief Initializes the ScheduleManager.
      *
-     * Ensures the schedule directory exists, loads the schedule index, and performs
-     * maintenance to synchronize the index with filesystem contents.
+     * Ensures the schedule directory exists, loads the schedule index and replays its
+     * journal. The directory is only rescanned after an unclean shutdown or when the
+     * index is missing or corrupt.
      * @return True on successful initialization, false on critical failure (e.g., cannot create directory).
      */
     bool begin();
@@ -54,7 +77,7 @@ public:
     /**
      * @brief Gets the current list of schedules from the in-memory index.
      *
-     * Updates the dynamic lock status (`lockedBy`) from LockManager before returning the list.
+     * Copies the index, then sets the dynamic lock status (`lockedBy`) of the copy from LockManager.
      * @param list Reference to a vector that will be populated with ScheduleFile entries.
      * @return True if the list was successfully retrieved (assumes index is valid after begin()).
      */
@@ -70,17 +93,60 @@ public:
      */
     bool loadSchedule(const String& uid, Schedule& schedule);
 
+    /**
+     * @brief Returns the parsed schedule, from the snapshot cache when possible.
+     *
+     * On a miss the JSON file is read and parsed once and the result cached
+     * (LRU, bounded by SCHEDULE_CACHE_BUDGET_BYTES). Saves and deletes drop the entry.
+     * @param uid The unique identifier of the schedule.
+     * @return The snapshot, or nullptr if the file is missing or invalid.
+     */
+    ScheduleSnapshot getSchedule(const String& uid);
+    /** @brief Returns the cached snapshot without touching flash, or nullptr if it is not cached. */
+    ScheduleSnapshot peekCachedSchedule(const String& uid);
+
+    // Opens the packed binary sidecar (<uid>.bin) for runtime reads without JSON parsing.
+    /**
+     * @brief Opens the packed binary sidecar of a schedule for lazy, record-at-a-time reads.
+     *
+     * Rebuilds the sidecar from the JSON file if it is missing or stale.
+     * @param uid The unique identifier of the schedule.
+     * @param reader Reader to open on the sidecar file.
+     * @return True if the reader is open on a current sidecar, false otherwise.
+     */
+    bool openScheduleBinary(const String& uid, ScheduleBinaryReader& reader);
+
+    /** @brief Path of the JSON file for @p uid (the file may not exist). _scheduleDir is fixed at construction. */
+    String scheduleFilePath(const String& uid) const { return _scheduleDir + uid + ".json"; }
+
     // Saves a schedule to its corresponding file.
     // Returns true on success, false on write/serialization error.
     /**
      * @brief Saves a schedule object to its corresponding JSON file.
      *
      * Validates the schedule data before saving. If the schedule is new, it also updates the index.
+     * Also writes the packed binary sidecar (<uid>.bin) next to the JSON file.
+     * Running bindings of the schedule are recompiled by the ScheduleEngine afterwards.
      * @param schedule Constant reference to the Schedule object to save.
      * @return True on successful save, false if the schedule data is invalid or a write/serialization error occurs.
      */
     bool saveSchedule(const Schedule& schedule);
 
+    /**
+     * @brief Starts a bulk save (schedule import).
+     *
+     * Until endBulkSave(), saveSchedule() still writes each schedule's files once but
+     * journals only the '~' record of a new schedule; its index entry is added in
+     * memory and allSchedules.json is rewritten once by endBulkSave().
+     */
+    void beginBulkSave();
+    /**
+     * @brief Ends a bulk save and commits the index once if it changed.
+     * @return True if the index was written (or did not change). On failure the '~'
+     *         journal records let the next boot repair the index from the files.
+     */
+    bool endBulkSave();
+
     // Deletes a schedule file and updates the index.
     // Returns true on success, false on file deletion error or index save error.
     /**
@@ -170,7 +236,34 @@ public:
 private:
     String _scheduleDir; ///< Path to the directory containing schedule files.
     String _indexFile;   ///< Path to the schedule index file (allSchedules.json).
-    std::vector<ScheduleFile> _scheduleIndex; ///< In-memory cache of the schedule index.
+    String _journalFile; ///< Path to the index journal (allSchedules.journal).
+    size_t _journalRecords = 0; ///< Records appended to the journal since the last compaction.
+    bool _bulkSave = false;         ///< Between beginBulkSave() and endBulkSave()
+    bool _bulkIndexChanged = false; ///< A bulk save added index entries not yet committed
+    std::vector<ScheduleFile> _scheduleIndex; ///< In-memory schedule index, sorted by scheduleUID.
+    void* _indexMutex = nullptr; ///< FreeRTOS mutex (opaque type) guarding the index, journal and bulk flags
+
+    /** @brief One snapshot cache entry. */
+    struct CachedSchedule {
+        String uid;
+        ScheduleSnapshot snapshot;
+        size_t bytes = 0;      ///< Estimated RAM held by the snapshot
+        uint32_t lastUsed = 0; ///< _cacheClock value of the last hit (LRU key)
+    };
+    std::vector<CachedSchedule> _scheduleCache; ///< Guarded by _cacheMutex
+    size_t _cacheBytes = 0;
+    uint32_t _cacheClock = 0;
+    uint32_t _cacheGeneration = 0; ///< Bumped by every invalidation; a load that raced one is not cached
+    void* _cacheMutex = nullptr;   ///< FreeRTOS mutex (opaque type); API and engine tasks share the cache
+
+    /** @brief Reads and parses the schedule file (no cache). @return True if the schedule is valid. */
+    bool readScheduleFile(const String& uid, Schedule& schedule);
+    /** @brief Inserts a snapshot, evicting least recently used entries to stay within budget. */
+    void cacheSchedule(const String& uid, const ScheduleSnapshot& snapshot, uint32_t generation);
+    /** @brief Drops @p uid from the snapshot cache (readers keep their snapshot). */
+    void invalidateCachedSchedule(const String& uid);
+    /** @brief Estimated heap bytes held by a parsed schedule. */
+    static size_t estimateScheduleBytes(const Schedule& schedule);
 
     // Loads the index file into _scheduleIndex. Returns true on success.
     /**
@@ -184,13 +277,40 @@ private:
      * @return True on successful save, false otherwise.
      */
     bool saveScheduleIndex();
-    // Syncs _scheduleIndex with files on disk and lock status.
+    // Full rescan: syncs _scheduleIndex with files on disk. Only needed after an unclean shutdown.
     /**
-     * @brief Internal helper to synchronize the _scheduleIndex with actual files on disk and update lock status.
-     *        Saves the index if changes were detected.
+     * @brief Internal helper to synchronize the _scheduleIndex with actual files on disk.
+     *        Compacts the index if changes were detected.
      */
     void maintainScheduleIndex();
 
+    /**
+     * @brief Internal helper to apply the index journal on top of the loaded index.
+     * @param needsRescan Set to true if the journal is torn or holds an unknown record.
+     * @return True if the journal was read (or does not exist), false if it could not be opened.
+     */
+    bool replayIndexJournal(bool& needsRescan);
+    /**
+     * @brief Internal helper to append one record to the index journal.
+     * @param op '~' (change in progress), '+' (add/update) or '-' (remove).
+     * @param uid The schedule UID the record refers to.
+     * @param lockLevel Persistent lock level stored with '+' records.
+     * @return True if the record was written.
+     */
+    bool appendIndexJournal(char op, const String& uid, int lockLevel = 0);
+    /**
+     * @brief Internal helper to rewrite the index file and truncate the journal.
+     * @return True on success, false if the index could not be saved (journal is kept).
+     */
+    bool compactScheduleIndex();
+    // Index helpers below (and the journal/compaction helpers above) expect _indexMutex held
+    /** @brief Binary-searches the sorted index. @return The entry, or nullptr if not indexed. */
+    ScheduleFile* findIndexEntry(const String& uid);
+    /** @brief Inserts an entry at its sorted position. @return False if the UID was already indexed. */
+    bool insertIndexEntry(const ScheduleFile& sf);
+    /** @brief Removes an entry from the sorted index. @return False if the UID was not indexed. */
+    bool removeIndexEntry(const String& uid);
+
     // Generates a unique ID for a new schedule.
     /**
      * @brief Internal helper to generate a unique ID for a new schedule based on name and timestamp.
@@ -4,22 +4,30 @@
 #include <Arduino.h>
 #include "UserAccount.h" // Include UserRole enum
 
+/** @brief Length of a raw session ID in bytes (sent to the client as 64 hex chars). */
+#define SESSION_ID_BYTES 32
+/** @brief Length of the hex-encoded session ID, excluding the terminator. */
+#define SESSION_ID_HEX_LENGTH (SESSION_ID_BYTES * 2)
+/** @brief Maximum username length that can hold a session, excluding the terminator. */
+#define SESSION_USERNAME_MAX_LENGTH 47
+
 // Structure to hold active session information
 /**
  * @struct SessionData
  * @brief Represents the data associated with an active user session.
  *
- * Stores the unique session ID, associated username and role, timestamps for
- * creation and last activity, and a client fingerprint for basic security checks.
- * Used by SessionManager to track logged-in users.
+ * Stores the unique session ID, associated username and role, and timestamps for
+ * creation and last activity. Used by SessionManager to track logged-in users.
+ * All fields are fixed-size so sessions live entirely inside SessionManager's
+ * pool without heap allocations. The client fingerprint is kept (as raw hash
+ * bytes) in the pool slot, not here.
  */
 struct SessionData {
-    String sessionId = "";      ///< Unique, high-entropy session identifier (e.g., 64 hex chars).
-    String username = "";       ///< Username associated with this session.
+    char sessionId[SESSION_ID_HEX_LENGTH + 1] = ""; ///< Unique, high-entropy session identifier (64 hex chars, NUL-terminated).
+    char username[SESSION_USERNAME_MAX_LENGTH + 1] = ""; ///< Username associated with this session.
     UserRole userRole = UNKNOWN; ///< Role (e.g., OWNER, MANAGER, VIEWER) of the logged-in user.
     unsigned long creationTime = 0; ///< Timestamp (millis()) when the session was created.
     unsigned long lastHeartbeat = 0; ///< Timestamp (millis()) of the last validated request associated with this session.
-    String fingerprint = "";    ///< Client fingerprint (e.g., SHA-256 hash of IP address + User-Agent string).
 
     // Basic validation
     /**
@@ -28,8 +36,8 @@ struct SessionData {
      *         and timestamps are positive. False otherwise.
      */
     bool isValid() const {
-        return !sessionId.isEmpty() && !username.isEmpty() && userRole != UNKNOWN && creationTime > 0 && lastHeartbeat > 0;
+        return sessionId[0] != '\0' && username[0] != '\0' && userRole != UNKNOWN && creationTime > 0 && lastHeartbeat > 0;
     }
 };
 
-#endif // SESSION_DATA_H
\ No newline at end of file
+#endif // SESSION_DATA_H
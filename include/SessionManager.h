@@ -2,7 +2,6 @@
 #define SESSION_MANAGER_H
 
 #include <Arduino.h>
-#include <map> // For storing sessions in memory
 #include "SessionData.h"
 #include <ESPAsyncWebServer.h> // For accessing request details
 
@@ -21,13 +20,32 @@
  */
 #define SESSION_CLEANUP_INTERVAL_MS (1 * 60 * 1000)
 
+/**
+ * @def SESSION_POOL_CAPACITY
+ * @brief Number of slots in the open-addressed session table. Must be a power of two.
+ */
+#define SESSION_POOL_CAPACITY 16
+/**
+ * @def SESSION_MAX_ACTIVE
+ * @brief Maximum number of concurrent sessions. Kept below the pool capacity so
+ *        probe sequences stay short; when full, the least recently active session is evicted.
+ */
+#define SESSION_MAX_ACTIVE 12
+/** @brief Size of the raw SHA-256 client fingerprint in bytes. */
+#define SESSION_FINGERPRINT_BYTES 32
+
+static_assert((SESSION_POOL_CAPACITY & (SESSION_POOL_CAPACITY - 1)) == 0, "SESSION_POOL_CAPACITY must be a power of two");
+static_assert(SESSION_MAX_ACTIVE < SESSION_POOL_CAPACITY, "SESSION_MAX_ACTIVE must leave free slots in the pool");
+
 /**
  * @class SessionManager
  * @brief Manages active user sessions in memory.
  *
  * Handles the creation, validation (including timeout and fingerprint checks),
  * invalidation, and periodic cleanup of user sessions. Sessions are stored
- * in an in-memory map. Interacts with LockManager to release locks when sessions end.
+ * in a fixed-capacity, open-addressed hash table keyed by the raw 32-byte
+ * session ID (linear probing, tombstones on removal so slots never move). Validating a request allocates no heap
+ * memory. Interacts with LockManager to release locks when sessions end.
  */
 class SessionManager {
 public:
@@ -36,6 +54,15 @@ public:
      */
     SessionManager();
 
+    /**
+     * @brief Initializes the SessionManager.
+     *
+     * Creates the mutex guarding the session table. Must be called once from setup()
+     * before the web server starts.
+     * @return True on success, false if the mutex could not be created.
+     */
+    bool begin();
+
     // Creates a new session for a user.
     // Returns the generated SessionData (including the new session ID).
     // Returns an invalid SessionData (empty sessionId) on failure.
@@ -43,7 +70,8 @@ public:
      * @brief Creates a new session for a user upon successful login.
      *
      * Generates a unique session ID and fingerprint, stores the session data
-     * (username, role, timestamps) in the active sessions map.
+     * (username, role, timestamps) in a free pool slot. If SESSION_MAX_ACTIVE sessions
+     * already exist, the least recently active one is evicted first.
      * @param username The username of the logged-in user.
      * @param role The UserRole of the logged-in user.
      * @param request Pointer to the AsyncWebServerRequest object (used for fingerprinting).
@@ -55,17 +83,19 @@ public:
     // Validates a session based on the session ID from a request cookie.
     // Checks for existence, expiry, and fingerprint match.
     // Updates the last heartbeat timestamp if valid.
-    // Returns a pointer to the valid SessionData if found and valid, nullptr otherwise.
+    // Returns a copy of the valid SessionData, or an invalid one (isValid() false).
     /**
      * @brief Validates a session based on the session ID cookie from a request.
      *
      * Checks for session existence, expiration (based on last heartbeat and SESSION_TIMEOUT_MS),
-     * and matches the client fingerprint. Updates the last heartbeat timestamp if valid.
+     * and matches the client fingerprint. The fingerprint is only recomputed when the
+     * request arrives on a different TCP connection than the last verified one.
+     * Updates the last heartbeat timestamp if valid.
      * @param request Pointer to the AsyncWebServerRequest object containing the session cookie.
-     * @return A pointer to the valid SessionData within the internal map if validation succeeds,
-     *         nullptr otherwise. The pointer is only valid until the session expires or is invalidated.
+     * @return A copy of the session (taken under the pool mutex) if validation succeeds,
+     *         an invalid SessionData (isValid() false) otherwise.
      */
-    SessionData* validateSession(AsyncWebServerRequest *request);
+    SessionData validateSession(AsyncWebServerRequest *request);
 
     // Invalidates/removes a specific session by ID.
     // Returns true if the session was found and removed, false otherwise.
@@ -104,34 +134,80 @@ public:
     /**
      * @brief Static utility function to generate a client fingerprint from request details.
      *
-     * Creates a hash (SHA-256) based on the client's IP address and User-Agent string.
+     * Creates a SHA-256 hash of the client's raw IPv4 address and User-Agent string.
+     * mbedtls uses the ESP32 SHA accelerator for this.
      * @param request Pointer to the AsyncWebServerRequest object.
-     * @return A hexadecimal string representation of the fingerprint hash.
+     * @param out Receives the SESSION_FINGERPRINT_BYTES raw hash bytes.
+     * @return True on success, false if the request is null.
      */
-    static String generateFingerprint(AsyncWebServerRequest *request);
+    static bool generateFingerprint(AsyncWebServerRequest *request, uint8_t out[SESSION_FINGERPRINT_BYTES]);
 
     // Generates a secure, high-entropy session ID
     /**
      * @brief Static utility function to generate a secure, high-entropy session ID.
      *
-     * Uses `esp_fill_random` to generate random bytes and converts them to a hex string.
-     * @return A unique session ID string (typically 64 hex characters).
+     * Uses `esp_fill_random` to fill SESSION_ID_BYTES random bytes.
+     * @param out Receives the raw session ID bytes.
      */
-    static String generateSessionId();
+    static void generateSessionId(uint8_t out[SESSION_ID_BYTES]);
 
 private:
-    std::map<String, SessionData> activeSessions; ///< In-memory map storing active sessions, keyed by session ID.
+    /** @brief State of a session pool slot. */
+    enum SlotState : uint8_t {
+        SLOT_EMPTY,   ///< Never used since boot; terminates probe sequences.
+        SLOT_USED,    ///< Holds an active session.
+        SLOT_DELETED  ///< Tombstone; reusable on insert, skipped on lookup.
+    };
+
+    /**
+     * @struct SessionSlot
+     * @brief One entry of the open-addressed session table.
+     */
+    struct SessionSlot {
+        SlotState state = SLOT_EMPTY;
+        uint8_t id[SESSION_ID_BYTES];                   ///< Raw session ID (hash key).
+        uint8_t fingerprint[SESSION_FINGERPRINT_BYTES]; ///< Raw SHA-256 of IP + User-Agent.
+        const void* verifiedClient = nullptr;           ///< AsyncClient whose fingerprint was last verified.
+        uint32_t verifiedIp = 0;                        ///< Remote IPv4 of verifiedClient.
+        uint16_t verifiedPort = 0;                      ///< Remote port of verifiedClient.
+        SessionData data;                               ///< Public view handed out to callers.
+    };
+
+    SessionSlot pool[SESSION_POOL_CAPACITY]; ///< Open-addressed session table.
+    uint8_t activeCount = 0; ///< Number of SLOT_USED entries.
     unsigned long lastCleanupTime = 0; ///< Timestamp of the last expired session cleanup check.
+    void* poolMutex = nullptr; ///< FreeRTOS mutex guarding `pool` (web server task vs. main loop).
+
+    /**
+     * @brief Extracts the session_id cookie from a request and decodes it to raw bytes.
+     * @param request The request to read the Cookie header from.
+     * @param out Receives the decoded SESSION_ID_BYTES bytes.
+     * @return True if a well-formed 64-hex-char session_id cookie was found.
+     */
+    static bool parseSessionCookie(AsyncWebServerRequest *request, uint8_t out[SESSION_ID_BYTES]);
+
+    /**
+     * @brief Finds the slot holding a session ID. Caller must hold `poolMutex`.
+     * @return The slot index, or -1 if not present.
+     */
+    int findSlot(const uint8_t id[SESSION_ID_BYTES]) const;
+
+    /**
+     * @brief Finds the slot an ID should be inserted at (first tombstone or empty slot
+     *        on its probe sequence). Caller must hold `poolMutex`.
+     * @return The slot index, or -1 if the table has no free slot.
+     */
+    int findInsertSlot(const uint8_t id[SESSION_ID_BYTES]) const;
 
     // Internal helper to remove a session and trigger associated cleanup (like lock release)
     /**
-     * @brief Internal helper to remove a session from the map and trigger associated cleanup.
+     * @brief Internal helper to remove a session from the pool and trigger associated cleanup.
      *
-     * This function handles the actual removal from the `activeSessions` map and calls
-     * `LockManager::releaseLocksForSession` to ensure resource locks are freed.
-     * @param sessionId The ID of the session to remove.
+     * Calls `LockManager::releaseLocksForSession` to ensure resource locks are freed,
+     * then turns the slot into a tombstone. Caller must hold `poolMutex`.
+     * @param slotIndex Index of the slot to remove.
      */
-    void removeSessionInternal(const String& sessionId);
+    void removeSessionInternal(int slotIndex);
 };
 
 #endif // SESSION_MANAGER_H
\ No newline at end of file
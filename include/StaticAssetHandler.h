@@ -0,0 +1,67 @@
+#ifndef STATIC_ASSET_HANDLER_H
+#define STATIC_ASSET_HANDLER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <ESPAsyncWebServer.h>
+#include <vector>
+
+// Manifest written by tools/build_www.py next to the precompressed assets
+#define STATIC_ASSET_MANIFEST "assets.manifest"
+// Length of the content-hash ETags in the manifest (hex digits)
+#define STATIC_ASSET_ETAG_LENGTH 16
+// Cache-Control for URLs carrying the current ?v=<etag> (content can never change)
+#define STATIC_ASSET_IMMUTABLE_CACHE "public, max-age=31536000, immutable"
+// Cache-Control for everything else: browser keeps it but revalidates (cheap 304)
+#define STATIC_ASSET_REVALIDATE_CACHE "no-cache"
+
+/**
+ * @struct StaticAsset
+ * @brief One precompressed asset from the manifest.
+ */
+struct StaticAsset {
+    String path;                               ///< URL path, e.g. "/js/schedule.js"
+    char etag[STATIC_ASSET_ETAG_LENGTH + 3];   ///< Quoted ETag as sent on the wire
+    const char* contentType;                   ///< MIME type derived from the extension
+};
+
+/**
+ * @class StaticAssetHandler
+ * @brief Serves the gzip-precompressed /www assets with ETag and Cache-Control headers.
+ *
+ * The asset list and ETags are loaded once from the manifest into a sorted table,
+ * so conditional requests (If-None-Match) are answered with 304 without touching
+ * flash. Full responses stream the stored .gz file as-is with Content-Encoding: gzip.
+ * Requests for unknown paths, or from clients that do not accept gzip, are left to
+ * the next handler (the plain serveStatic fallback registered by ApiRoutes).
+ */
+class StaticAssetHandler : public AsyncWebHandler {
+public:
+    StaticAssetHandler();
+
+    /**
+     * @brief Loads the asset manifest.
+     * @param fs The filesystem holding the assets.
+     * @param root Directory of the assets, e.g. "/www".
+     * @return True if a manifest was found and at least one asset listed, false otherwise
+     *         (the image was built without tools/build_www.py).
+     */
+    bool begin(fs::FS& fs, const char* root);
+
+    /** @brief Returns the number of assets in the table. */
+    size_t size() const { return assets.size(); }
+
+    bool canHandle(AsyncWebServerRequest *request) override;
+    void handleRequest(AsyncWebServerRequest *request) override;
+    bool isRequestHandlerTrivial() override { return true; }
+
+private:
+    fs::FS* fs = nullptr;
+    String root;
+    std::vector<StaticAsset> assets; ///< Sorted by path
+
+    const StaticAsset* findAsset(const String& url) const;
+    static const char* contentTypeFor(const String& path);
+};
+
+#endif // STATIC_ASSET_HANDLER_H
@@ -0,0 +1,51 @@
+#ifndef TASK_CONFIG_H
+#define TASK_CONFIG_H
+
+// Task topology: every xTaskCreatePinnedToCore() in the firmware takes its core and
+// priority from here, so the plan can be read (and changed) in one place.
+//
+// Core 1 (APP_CPU, IO_CORE) runs actuation and sampling only. None of its tasks serve
+// HTTP or write flash, so a large schedule being serialized on core 0 never delays a
+// relay latch or a sample; the only file reads left there are the schedule rebinds at
+// day rollover. The Arduino loopTask also lives on core 1
+// (priority 1) and only does RAM bookkeeping.
+//
+// Core 0 (PRO_CPU, SERVICE_CORE) runs WiFi/lwIP, async_tcp (pinned with
+// CONFIG_ASYNC_TCP_RUNNING_CORE in platformio.ini), JSON work and the single
+// persistence worker that performs all background flash writes. The esp_timer task
+// (priority 22) is pinned to core 0 by the framework and preempts all of the above;
+// the relay off-deadline callback only notifies the output command task on core 1.
+//
+// Flash erase/write still disables the instruction cache on both cores for a few
+// milliseconds; batching background writes in one low-priority worker keeps those
+// windows short and rare.
+
+#define IO_CORE 1
+#define SERVICE_CORE 0
+
+// --- Core 1: IO ---
+// Relay command queue consumer; latches batches of relay changes, expired relay
+// timers and volume dose ends
+#define TASK_PRIORITY_OUTPUT_COMMANDS 6
+// Analog / digital input sampler
+#define TASK_PRIORITY_INPUT_SAMPLER 5
+// Modbus RTU bus pollers (one task per bus)
+#define TASK_PRIORITY_MODBUS 4
+// Tension-driven dosing; acts on a crossing before timeline work
+#define TASK_PRIORITY_AUTOPILOT 3
+// Daily timeline dispatch and cycle step rollover
+#define TASK_PRIORITY_SCHEDULE_ENGINE 2
+
+// --- Core 0: services (async_tcp runs at 3) ---
+// Push channel serializer
+#define TASK_PRIORITY_LIVE_EVENTS 2
+// Password hashing for logins
+#define TASK_PRIORITY_LOGIN 1
+// Background flash writes (lock table, history, cycle state)
+#define TASK_PRIORITY_PERSISTENCE 1
+// Serial log drain: printing waits for everything else
+#define TASK_PRIORITY_LOG_DRAIN 1
+// Synthetic benchmark load (benchmark builds only)
+#define TASK_PRIORITY_BENCHMARK 1
+
+#endif // TASK_CONFIG_H
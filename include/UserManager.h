@@ -4,6 +4,35 @@
 #include <Arduino.h>
 #include "UserAccount.h" // Include the UserAccount structure definition
 #include <vector>       // To potentially return lists of users
+#include <functional>
+
+// Number of recently authenticated accounts kept in RAM (LRU replacement)
+#define USER_CACHE_CAPACITY 8
+// Login verifications that can wait for the worker task; further logins get 503
+#define LOGIN_QUEUE_LENGTH 4
+
+/**
+ * @enum LoginResult
+ * @brief Outcome of an asynchronous login verification.
+ */
+enum class LoginResult {
+    OK,                  ///< Username found and password verified
+    INVALID_CREDENTIALS, ///< Unknown username or wrong password
+    ACCOUNT_CORRUPTED    ///< Account file exists but has no hash or salt
+};
+
+/**
+ * @brief Completion callback for UserManager::verifyLoginAsync.
+ *        Runs on the login worker task, not on the web server task.
+ *        The account is only populated when the result is LoginResult::OK.
+ */
+typedef std::function<void(LoginResult result, const UserAccount& account)> LoginCallback;
+
+/**
+ * @brief Optional check for UserManager::verifyLoginAsync, run on the worker before
+ *        hashing. Returning true drops the job (the client went away).
+ */
+typedef std::function<bool()> LoginCancelledCheck;
 
 /**
  * @class UserManager
@@ -13,6 +42,13 @@
  * Each user account is stored as a separate JSON file in the specified directory
  * (default: "/users"). Includes functionality to create a default owner account
  * on first initialization if no users exist.
+ *
+ * Recently used accounts are kept in a small RAM cache (USER_CACHE_CAPACITY) that is
+ * updated by saveUser() and invalidated by deleteUser(), so repeated logins do not
+ * re-read and re-parse the account file. Password verification for logins runs on a
+ * dedicated worker task (verifyLoginAsync) so hashing never blocks the web server.
+ * The cache is only updated through this class; editing files in /users behind its
+ * back requires a reboot to be picked up.
  */
 class UserManager {
 public:
@@ -26,8 +62,9 @@ public:
     /**
      * @brief Initializes the UserManager.
      *
-     * Ensures the user directory exists. If no user files are found, it creates
-     * a default owner account with predefined credentials.
+     * Creates the cache mutex and the login worker task, ensures the user directory
+     * exists and, if no user files are found, creates a default owner account with
+     * predefined credentials.
      * @return True if initialization is successful, false on critical failure (e.g., cannot create directory or default user).
      */
     bool begin();
@@ -59,13 +96,31 @@ public:
     /**
      * @brief Finds a user by username and populates the 'account' structure.
      *
-     * This is primarily a convenience wrapper around `loadUser`.
+     * Served from the user cache when possible; otherwise falls back to `loadUser`
+     * and caches the result.
      * @param username The username of the account to find.
      * @param account Reference to a UserAccount struct to be populated if the user is found.
      * @return True if the user was found and loaded successfully, false otherwise.
      */
     bool findUserByUsername(const String& username, UserAccount& account);
 
+    /**
+     * @brief Queues a login verification for the worker task.
+     *
+     * The worker looks the user up (cache first), verifies the password against the
+     * stored hash and calls @p callback with the result. The callback runs on the
+     * worker task; it must not block for long or touch web server objects.
+     * @param username The username to authenticate.
+     * @param password The plain text password to verify.
+     * @param callback Invoked exactly once if this call returns true, unless @p cancelled
+     *        reports true when the worker picks the job up.
+     * @param cancelled Optional; checked before the password is hashed.
+     * @return True if the job was queued, false if the queue is full or begin() has not run
+     *         (the callback is then never called).
+     */
+    bool verifyLoginAsync(const String& username, const String& password, LoginCallback callback,
+                          LoginCancelledCheck cancelled = LoginCancelledCheck());
+
     // Adds a new user. Hashes the password before saving.
     // Checks for existing username.
     // Returns true on success, false if user exists or save fails.
@@ -125,6 +180,38 @@ public:
 private:
     String _userDir; ///< Directory path where user account JSON files are stored.
 
+    /** @brief One user cache entry. */
+    struct CachedUser {
+        bool used = false;     ///< Slot holds a valid account
+        uint32_t lastUsed = 0; ///< cacheClock value of the last hit (LRU key)
+        UserAccount account;   ///< Copy of the account as last loaded or saved
+    };
+    CachedUser userCache[USER_CACHE_CAPACITY];
+    uint32_t cacheClock = 0;
+
+    /** @brief Login verification handed to the worker task (heap allocated, owned by the task once queued). */
+    struct LoginJob {
+        String username;
+        String password;
+        LoginCallback callback;
+        LoginCancelledCheck cancelled;
+    };
+
+    // FreeRTOS handles (opaque types)
+    void* cacheMutex = nullptr;      ///< Guards userCache and cacheClock
+    void* loginQueue = nullptr;      ///< Queue of LoginJob* pointers
+    void* loginTaskHandle = nullptr;
+
+    /** @brief Copies a cached account into @p account. @return True on a cache hit. */
+    bool lookupCachedUser(const String& username, UserAccount& account);
+    /** @brief Inserts or refreshes @p account in the cache, evicting the least recently used entry. */
+    void cacheUser(const UserAccount& account);
+    /** @brief Drops @p username from the cache (no-op if it is not cached). */
+    void invalidateCachedUser(const String& username);
+
+    static void loginTaskWrapper(void* parameter);
+    void loginTask();
+
     // Helper to get the full path for a user file
     /**
      * @brief Internal helper to construct the full file path for a user account file.
@@ -5,6 +5,188 @@
 #include "AuthUtils.h" // For password verification
 #include <Arduino.h>   // For Serial
 #include <functional>  // For std::bind or lambdas
+#include <algorithm>   // For std::min
+#include "RuntimeMetrics.h"
+#include "LiveEvents.h"
+#include "HistoryStore.h"
+#include "PointRegistry.h"
+#include "PersistenceWorker.h"
+#include "CycleManager.h"
+
+extern LogBuffer logBuffer;
+extern RuntimeMetrics runtimeMetrics;
+extern LiveEvents liveEvents;
+extern HistoryStore historyStore;
+extern PointRegistry pointRegistry;
+extern PersistenceWorker persistenceWorker;
+extern CycleManager cycleManager;
+
+// Most records returned by one /api/logs request
+#define API_LOGS_MAX_RECORDS LOG_BUFFER_RECORDS
+// /api/history answers ranges up to this long from the raw samples unless told otherwise
+#define API_HISTORY_RAW_MAX_RANGE_S (24UL * 60 * 60)
+
+namespace {
+// Response finished by another task. AsyncWebServer objects may only be touched on the
+// async TCP task, so a worker never sends: it publishes its result, and the server
+// polls this response (on every ACK and on the TCP poll timer, about every 500 ms)
+// until build() returns the real response, which is then started and driven from
+// here. The request owns this object; if the client disconnects it is simply deleted.
+class DeferredResponse : public AsyncWebServerResponse {
+public:
+    typedef std::function<AsyncWebServerResponse*(AsyncWebServerRequest*)> Builder;
+
+    explicit DeferredResponse(Builder builder) : build(builder) {}
+    ~DeferredResponse() override { delete inner; }
+
+    bool _sourceValid() const override { return true; }
+    void _respond(AsyncWebServerRequest* request) override { startIfReady(request); }
+    size_t _ack(AsyncWebServerRequest* request, size_t len, uint32_t time) override {
+        if (inner) return inner->_ack(request, len, time);
+        startIfReady(request);
+        return 0;
+    }
+    bool _started() const override { return inner && inner->_started(); }
+    bool _finished() const override { return inner && inner->_finished(); }
+    bool _failed() const override { return inner && inner->_failed(); }
+
+private:
+    Builder build;
+    AsyncWebServerResponse* inner = nullptr;
+
+    void startIfReady(AsyncWebServerRequest* request) {
+        inner = build(request);
+        if (!inner) return;
+        if (!inner->_sourceValid()) {
+            delete inner;
+            inner = request->beginResponse(500, "text/plain", "Internal Server Error");
+        }
+        inner->_respond(request);
+    }
+};
+
+// Chunked /api/history body: one cursor step per sample, formatted into each TCP buffer
+struct HistoryStream {
+    HistoryCursor cursor;
+    bool rollup = false;
+    String head;          ///< Prefix up to the samples array, sent first
+    char line[64];        ///< Formatted sample not yet copied out
+    size_t lineLength = 0, linePos = 0;
+    bool first = true;
+    bool done = false;
+
+    size_t fill(uint8_t* buffer, size_t maxLen) {
+        size_t used = 0;
+        while (used < maxLen) {
+            if (linePos < lineLength) {
+                size_t n = std::min(maxLen - used, lineLength - linePos);
+                memcpy(buffer + used, line + linePos, n);
+                used += n;
+                linePos += n;
+                continue;
+            }
+            if (done) break;
+            linePos = 0;
+            if (!head.isEmpty()) {
+                lineLength = 0;
+                size_t n = std::min(maxLen - used, (size_t)head.length());
+                memcpy(buffer + used, head.c_str(), n);
+                used += n;
+                head.remove(0, n);
+                continue;
+            }
+            HistorySample sample;
+            if (!cursor.next(sample)) {
+                lineLength = snprintf(line, sizeof(line), "]}");
+                done = true;
+                continue;
+            }
+            const char* sep = first ? "" : ",";
+            first = false;
+            if (rollup) {
+                lineLength = snprintf(line, sizeof(line), "%s[%lu,%.2f,%.2f,%.2f]", sep,
+                                      (unsigned long)sample.epoch, sample.value, sample.min, sample.max);
+            } else {
+                lineLength = snprintf(line, sizeof(line), "%s[%lu,%.2f]", sep, (unsigned long)sample.epoch, sample.value);
+            }
+        }
+        return used; // 0 once everything was sent ends the chunked response
+    }
+};
+
+// Same layout as GET /api/schedule, so an export can be imported again unchanged
+void scheduleToJson(const Schedule& schedule, JsonDocument& doc) {
+    doc.clear();
+    doc["scheduleName"] = schedule.scheduleName;
+    doc["lightsOnTime"] = schedule.lightsOnTime;
+    doc["lightsOffTime"] = schedule.lightsOffTime;
+    doc["scheduleUID"] = schedule.scheduleUID;
+    JsonArray apArray = doc["autopilotWindows"].to<JsonArray>();
+    for (const auto& apw : schedule.autopilotWindows) {
+        JsonObject item = apArray.add<JsonObject>();
+        item["startTime"] = apw.startTime; item["endTime"] = apw.endTime; item["matricTension"] = apw.matricTension; item["doseVolume"] = apw.doseVolume; item["settlingTime"] = apw.settlingTime; item["doseDuration"] = apw.doseDuration;
+    }
+    JsonArray durArray = doc["durationEvents"].to<JsonArray>();
+    for (const auto& de : schedule.durationEvents) {
+        JsonObject item = durArray.add<JsonObject>();
+        item["startTime"] = de.startTime; item["duration"] = de.duration; item["endTime"] = de.endTime;
+    }
+    JsonArray volArray = doc["volumeEvents"].to<JsonArray>();
+    for (const auto& ve : schedule.volumeEvents) {
+        JsonObject item = volArray.add<JsonObject>();
+        item["startTime"] = ve.startTime; item["doseVolume"] = ve.doseVolume;
+    }
+}
+
+// Chunked /api/schedules/export body: one schedule is loaded and serialized per step
+struct ScheduleExportStream {
+    ScheduleManager* manager = nullptr;
+    std::vector<String> uids; ///< Index at the time of the request
+    size_t next = 0;
+    String pending;           ///< Serialized text not yet copied out
+    size_t pendingPos = 0;
+    bool first = true;
+    bool done = false;
+
+    size_t fill(uint8_t* buffer, size_t maxLen) {
+        size_t used = 0;
+        while (used < maxLen) {
+            if (pendingPos < pending.length()) {
+                size_t n = std::min(maxLen - used, (size_t)pending.length() - pendingPos);
+                memcpy(buffer + used, pending.c_str() + pendingPos, n);
+                used += n;
+                pendingPos += n;
+                continue;
+            }
+            if (done) break;
+            pending = "";
+            pendingPos = 0;
+            if (next >= uids.size()) {
+                pending = first ? "[]" : "]";
+                done = true;
+                continue;
+            }
+            ScheduleSnapshot schedule = manager->getSchedule(uids[next++]);
+            if (!schedule) continue; // Deleted or unreadable since the request started
+            JsonDocument doc;
+            scheduleToJson(*schedule, doc);
+            pending = first ? "[" : ",";
+            first = false;
+            serializeJson(doc, pending);
+        }
+        return used; // 0 once everything was sent ends the chunked response
+    }
+};
+
+// Imported UIDs become file names: same character set as ScheduleManager::sanitizeFilename()
+bool isValidScheduleUID(const String& uid) {
+    if (uid.isEmpty() || uid.length() > 64) return false;
+    for (char c : uid) {
+        if (!isalnum((unsigned char)c) && c != '_' && c != '-') return false;
+    }
+    return true;
+}
+} // namespace
 
 // Constructor implementation
 /**
@@ -55,23 +237,89 @@ void ApiRoutes::addSecurityHeaders(AsyncWebServerResponse *response) {
     response->addHeader("Permissions-Policy", "microphone=(), geolocation=()");
 }
 
+// Writes a JSON string literal (quoted and escaped) to a response stream
+/**
+ * @brief Writes a String as a quoted, escaped JSON string to a stream.
+ *
+ * Used by the streaming GET handlers to emit string members without building
+ * a full JsonDocument for the response.
+ *
+ * @param out The stream to write to (e.g., an AsyncResponseStream).
+ * @param value The string value to encode.
+ */
+void ApiRoutes::streamJsonString(Print& out, const String& value) {
+    JsonDocument doc;
+    doc.set(value);
+    serializeJson(doc, out);
+}
+
+
+// --- Request Body Arena ---
+// Body handlers and disconnect callbacks all run on the async TCP task, so the
+// slot table needs no locking.
+
+/**
+ * @brief Claims a free body slot for a request.
+ *
+ * Registers a disconnect callback so the slot is returned even if the client
+ * aborts the upload before the last chunk arrives.
+ *
+ * @param request The request that will own the slot.
+ * @return Pointer to the claimed slot, or nullptr if all slots are in use.
+ */
+ApiRoutes::BodySlot* ApiRoutes::acquireBodySlot(AsyncWebServerRequest *request) {
+    for (BodySlot& slot : bodySlots) {
+        if (slot.owner == nullptr) {
+            slot.owner = request;
+            slot.length = 0;
+            request->onDisconnect([this, request]() { this->releaseBodySlot(request); });
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Finds the body slot owned by a request.
+ * @param request The owning request.
+ * @return Pointer to the slot, or nullptr if the request owns none.
+ */
+ApiRoutes::BodySlot* ApiRoutes::findBodySlot(AsyncWebServerRequest *request) {
+    for (BodySlot& slot : bodySlots) {
+        if (slot.owner == request) return &slot;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Returns a request's body slot to the arena. Safe to call more than once.
+ * @param request The owning request.
+ */
+void ApiRoutes::releaseBodySlot(AsyncWebServerRequest *request) {
+    BodySlot* slot = findBodySlot(request);
+    if (slot) {
+        slot->owner = nullptr;
+        slot->length = 0;
+    }
+}
+
 
 // --- Private Request Handlers ---
 
 /**
  * @brief Handles POST requests to the /api/login endpoint.
  *
- * Attempts to authenticate a user based on the provided username and password
- * in the POST request body. If authentication is successful, it creates a new
- * session, sets a session cookie (HttpOnly, SameSite=Strict, Secure if HTTPS),
- * and sends a success response. If authentication fails or parameters are missing,
- * it sends an appropriate error response (400 Bad Request, 401 Unauthorized,
- * 500 Internal Server Error).
+ * Queues the username and password from the POST request body for verification
+ * on the UserManager login worker and answers with a DeferredResponse; once the
+ * worker has published the result, the response is built on the async TCP task
+ * (see buildLoginResponse). Missing parameters get 400 Bad Request, a full login
+ * queue gets 503 Service Unavailable.
  *
  * @param request Pointer to the AsyncWebServerRequest object containing the login request details.
  *                Expects 'username' and 'password' as POST parameters.
  */
 void ApiRoutes::handleLogin(AsyncWebServerRequest *request) {
+    RouteTimer routeTimer(MetricRoute::LOGIN);
     API_DEBUG_PRINTLN("API: handleLogin request received.");
     if (!request->hasParam("username", true) || !request->hasParam("password", true)) {
         API_DEBUG_PRINTLN("API: handleLogin - Bad Request: Missing username or password.");
@@ -80,50 +328,69 @@ void ApiRoutes::handleLogin(AsyncWebServerRequest *request) {
     }
     String username = request->getParam("username", true)->value();
     String password = request->getParam("password", true)->value();
-    API_DEBUG_PRINTF("API: handleLogin - Attempting login for user: %s\n", username.c_str());
-
-    UserAccount user;
-    API_DEBUG_PRINTF("API: handleLogin - Address of this->userManager: %p\n", &(this->userManager)); // Check address
-    API_DEBUG_PRINTLN("API: handleLogin - Calling findUserByUsername...");
-    bool userFound = this->userManager.findUserByUsername(username, user);
-    API_DEBUG_PRINTF("API: handleLogin - findUserByUsername returned: %s\n", userFound ? "true" : "false");
-
-    if (userFound) {
-        API_DEBUG_PRINTLN("API: handleLogin - User found. Calling verifyPassword...");
-        // Add checks for potentially null pointers before calling verifyPassword
-        if (user.hashedPassword.isEmpty() || user.salt.isEmpty()) {
-             API_DEBUG_PRINTLN("API: handleLogin - Error: User found but has empty password or salt!");
-             request->send(500, "text/plain", "Internal Server Error: User data corrupted.");
-             return; // Prevent calling verifyPassword with invalid data
-        }
-        bool passwordVerified = AuthUtils::verifyPassword(password, user.hashedPassword, user.salt);
-        API_DEBUG_PRINTF("API: handleLogin - verifyPassword returned: %s\n", passwordVerified ? "true" : "false");
-
-        if (passwordVerified) {
-            API_DEBUG_PRINTF("API: handleLogin - Login successful for user: %s\n", username.c_str());
-            SessionData newSession = this->sessionManager.createSession(user.username, user.role, request);
-            if (newSession.isValid()) {
-                API_DEBUG_PRINTF("API: handleLogin - Session created: %s\n", newSession.sessionId.c_str());
-                AsyncResponseStream *response = request->beginResponseStream("text/plain");
-                String cookieHeader = "session_id=" + newSession.sessionId + "; Path=/; Max-Age=900; HttpOnly; SameSite=Strict";
-                if (this->httpsEnabled) { cookieHeader += "; Secure"; }
-                response->addHeader("Set-Cookie", cookieHeader);
-                this->addSecurityHeaders(response); // Use class method
-                response->print("Login Successful");
-                request->send(response);
-            } else {
-                API_DEBUG_PRINTLN("API: handleLogin - Failed to create session.");
-                request->send(500, "text/plain", "Internal Server Error: Could not create session.");
-            }
-            return;
-        } else {
-            API_DEBUG_PRINTF("API: handleLogin - Login failed: Incorrect password for user: %s\n", username.c_str());
-            request->send(401, "text/plain", "Unauthorized: Invalid credentials.");
-        }
-    } else {
-        API_DEBUG_PRINTF("API: handleLogin - Login failed: User not found: %s\n", username.c_str());
-        request->send(401, "text/plain", "Unauthorized: Invalid credentials.");
+    API_DEBUG_PRINTF("API: handleLogin - Queueing login for user: %s\n", username.c_str());
+
+    // The worker never sees the request: it only writes into 'pending'
+    std::shared_ptr<PendingLogin> pending = std::make_shared<PendingLogin>();
+    request->onDisconnect([pending]() {
+        pending->cancelled = true;
+    });
+    bool queued = this->userManager.verifyLoginAsync(username, password,
+        [pending](LoginResult result, const UserAccount& user) {
+            pending->result = result;
+            pending->user = user;
+            pending->done.store(true, std::memory_order_release);
+        },
+        [pending]() { return pending->cancelled.load(); });
+
+    if (!queued) {
+        API_DEBUG_PRINTLN("API: handleLogin - Login queue full.");
+        request->send(503, "text/plain", "Service Unavailable: Too many concurrent logins, try again.");
+        return;
     }
+    request->send(new DeferredResponse([this, pending](AsyncWebServerRequest* r) -> AsyncWebServerResponse* {
+        if (!pending->done.load(std::memory_order_acquire)) return nullptr;
+        return this->buildLoginResponse(r, pending->result, pending->user);
+    }));
+}
+
+/**
+ * @brief Builds the response for a finished login verification.
+ *
+ * On success creates the session and sets the session cookie (HttpOnly,
+ * SameSite=Strict, Secure if HTTPS). Runs on the async TCP task (from the
+ * DeferredResponse poll), so the session pool and the request are only ever
+ * touched there.
+ *
+ * @param request The login request (still connected).
+ * @param result Outcome reported by UserManager::verifyLoginAsync.
+ * @param user The verified account (only meaningful for LoginResult::OK).
+ * @return The response to start; not sent yet.
+ */
+AsyncWebServerResponse* ApiRoutes::buildLoginResponse(AsyncWebServerRequest *request, LoginResult result, const UserAccount& user) {
+    if (result == LoginResult::ACCOUNT_CORRUPTED) {
+        API_DEBUG_PRINTLN("API: handleLogin - Error: User found but has empty password or salt!");
+        return request->beginResponse(500, "text/plain", "Internal Server Error: User data corrupted.");
+    }
+    if (result != LoginResult::OK) {
+        API_DEBUG_PRINTLN("API: handleLogin - Login failed: Invalid credentials.");
+        return request->beginResponse(401, "text/plain", "Unauthorized: Invalid credentials.");
+    }
+
+    API_DEBUG_PRINTF("API: handleLogin - Login successful for user: %s\n", user.username.c_str());
+    SessionData newSession = this->sessionManager.createSession(user.username, user.role, request);
+    if (!newSession.isValid()) {
+        API_DEBUG_PRINTLN("API: handleLogin - Failed to create session.");
+        return request->beginResponse(500, "text/plain", "Internal Server Error: Could not create session.");
+    }
+    API_DEBUG_PRINTF("API: handleLogin - Session created: %s\n", newSession.sessionId);
+    AsyncResponseStream *response = request->beginResponseStream("text/plain");
+    String cookieHeader = String("session_id=") + newSession.sessionId + "; Path=/; Max-Age=900; HttpOnly; SameSite=Strict";
+    if (this->httpsEnabled) { cookieHeader += "; Secure"; }
+    response->addHeader("Set-Cookie", cookieHeader);
+    this->addSecurityHeaders(response); // Use class method
+    response->print("Login Successful");
+    return response;
 }
 
 /**
@@ -137,6 +404,7 @@ void ApiRoutes::handleLogin(AsyncWebServerRequest *request) {
  *                Uses the 'session_id' cookie to identify the session to invalidate.
  */
 void ApiRoutes::handleLogout(AsyncWebServerRequest *request) {
+    RouteTimer routeTimer(MetricRoute::LOGOUT);
      API_DEBUG_PRINTLN("API: handleLogout request received.");
     this->sessionManager.invalidateSession(request);
     AsyncResponseStream *response = request->beginResponseStream("text/plain");
@@ -163,17 +431,18 @@ void ApiRoutes::handleLogout(AsyncWebServerRequest *request) {
  *                Uses the 'session_id' cookie for session validation.
  */
 void ApiRoutes::handleGetUserInfo(AsyncWebServerRequest *request) {
+    RouteTimer routeTimer(MetricRoute::USER);
     API_DEBUG_PRINTLN("API: handleGetUserInfo request received.");
-    SessionData* session = this->sessionManager.validateSession(request);
-    if (!session) {
+    SessionData session = this->sessionManager.validateSession(request);
+    if (!session.isValid()) {
         API_DEBUG_PRINTLN("API: handleGetUserInfo - Not authenticated.");
         request->send(401, "application/json", "{\"error\":\"Not authenticated\"}");
         return;
     }
-    API_DEBUG_PRINTF("API: handleGetUserInfo - User: %s, Role: %s\n", session->username.c_str(), roleToString(session->userRole).c_str());
+    API_DEBUG_PRINTF("API: handleGetUserInfo - User: %s, Role: %s\n", session.username, roleToString(session.userRole).c_str());
     JsonDocument doc;
-    doc["username"] = session->username;
-    doc["role"] = roleToString(session->userRole);
+    doc["username"] = session.username;
+    doc["role"] = roleToString(session.userRole);
     String jsonResponse;
     serializeJson(doc, jsonResponse);
     AsyncWebServerResponse *response = request->beginResponse(200, "application/json", jsonResponse);
@@ -181,6 +450,129 @@ void ApiRoutes::handleGetUserInfo(AsyncWebServerRequest *request) {
     request->send(response);
 }
 
+/**
+ * @brief Handles GET requests to the /api/logs endpoint.
+ *
+ * Returns the log records newer than the optional 'since' sequence number as
+ * {"next":N,"dropped":D,"records":[{"seq","ms","level","module","text"}...]}.
+ * Poll again with since=next to follow the log; 'dropped' counts records that were
+ * overwritten before they could be returned. Reading does not consume records, so
+ * the Serial drain and any number of clients see the same log. Requires an owner
+ * session (401 / 403 otherwise).
+ *
+ * @param request Pointer to the AsyncWebServerRequest object. Optional 'since' query parameter.
+ */
+void ApiRoutes::handleGetLogs(AsyncWebServerRequest *request) {
+    RouteTimer routeTimer(MetricRoute::LOGS);
+    SessionData session = this->sessionManager.validateSession(request);
+    if (!session.isValid()) { request->send(401, "application/json", "{\"error\":\"Not authenticated\"}"); return; }
+    if (session.userRole != OWNER) { request->send(403, "application/json", "{\"error\":\"Forbidden\"}"); return; }
+
+    uint32_t since = request->hasParam("since") ? (uint32_t)strtoul(request->getParam("since")->value().c_str(), nullptr, 10) : 0;
+    uint32_t latest = logBuffer.latestSeq();
+    uint32_t oldest = logBuffer.oldestSeq();
+    uint32_t seq = since + 1;
+    uint32_t dropped = 0;
+    if (seq < oldest) {
+        dropped = (since > 0) ? oldest - seq : 0;
+        seq = oldest;
+    }
+
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    response->print("{\"records\":[");
+    LogRecord record;
+    bool first = true;
+    uint32_t returned = 0;
+    for (; seq <= latest && returned < API_LOGS_MAX_RECORDS; ++seq) {
+        int result = logBuffer.read(seq, record);
+        if (result == 0) break; // Still being written; the client gets it on the next poll
+        if (result < 0) { ++dropped; continue; }
+        if (!first) response->print(',');
+        response->printf("{\"seq\":%lu,\"ms\":%lu,\"level\":\"%s\",\"module\":",
+                         (unsigned long)record.seq, (unsigned long)record.timestampMs, LogBuffer::levelName(record.level));
+        streamJsonString(*response, record.module);
+        response->print(",\"text\":");
+        streamJsonString(*response, record.text);
+        response->print('}');
+        first = false;
+        ++returned;
+    }
+    response->printf("],\"next\":%lu,\"dropped\":%lu}", (unsigned long)(seq - 1), (unsigned long)dropped);
+    this->addSecurityHeaders(response); // Use class method
+    request->send(response);
+}
+
+/**
+ * @brief Handles GET requests to the /api/history endpoint.
+ *
+ * Streams the recorded samples of one point, oldest first, as
+ * {"point":"AI_1","resolution":"raw","samples":[[epoch,value],...]} or, with
+ * resolution=rollup, [[bucketStart,mean,min,max],...] per HISTORY_ROLLUP_BUCKET_S bucket.
+ * Without 'resolution', ranges longer than API_HISTORY_RAW_MAX_RANGE_S use the rollup.
+ * The body is produced sample by sample as the client reads it, so memory use does
+ * not depend on the range. Requires a session (401 otherwise).
+ *
+ * @param request Pointer to the AsyncWebServerRequest object. Query parameters: 'point'
+ *                (required), 'from' / 'to' (epoch seconds, default: the last hour) and
+ *                'resolution' (raw | rollup).
+ */
+void ApiRoutes::handleGetHistory(AsyncWebServerRequest *request) {
+    RouteTimer routeTimer(MetricRoute::HISTORY);
+    if (!this->sessionManager.validateSession(request).isValid()) { request->send(401, "application/json", "{\"error\":\"Not authenticated\"}"); return; }
+    if (!request->hasParam("point")) { request->send(400, "application/json", "{\"error\":\"Missing point parameter\"}"); return; }
+
+    String pointId = request->getParam("point")->value();
+    PointHandle point = pointRegistry.resolve(pointId);
+    if (point == INVALID_POINT_HANDLE || !historyStore.isRecorded(point)) {
+        request->send(404, "application/json", "{\"error\":\"No history for this point\"}");
+        return;
+    }
+    uint32_t to = request->hasParam("to") ? (uint32_t)strtoul(request->getParam("to")->value().c_str(), nullptr, 10) : (uint32_t)time(nullptr);
+    uint32_t from = request->hasParam("from") ? (uint32_t)strtoul(request->getParam("from")->value().c_str(), nullptr, 10) : (to > 3600 ? to - 3600 : 0);
+    if (from > to) { request->send(400, "application/json", "{\"error\":\"from is after to\"}"); return; }
+    bool rollup = to - from > API_HISTORY_RAW_MAX_RANGE_S;
+    if (request->hasParam("resolution")) rollup = request->getParam("resolution")->value() == "rollup";
+
+    std::shared_ptr<HistoryStream> stream = std::make_shared<HistoryStream>();
+    stream->rollup = rollup;
+    stream->cursor.open(historyStore, point, from, to, rollup);
+    JsonDocument headDoc;
+    headDoc["point"] = pointId;
+    headDoc["resolution"] = rollup ? "rollup" : "raw";
+    serializeJson(headDoc, stream->head);
+    stream->head.remove(stream->head.length() - 1); // Reopen the object for the samples array
+    stream->head += ",\"samples\":[";
+
+    AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+        [stream](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            (void)index;
+            return stream->fill(buffer, maxLen);
+        });
+    this->addSecurityHeaders(response); // Use class method
+    request->send(response);
+}
+
+// GET /api/metrics - Runtime metrics for collectors
+/**
+ * @brief Handles GET requests to the /api/metrics endpoint.
+ *
+ * Streams the runtime metrics (per-route request latency histograms, LittleFS
+ * operation counts, relay queue depth, task stack high-water marks, heap) in the
+ * Prometheus text format. No session is required so collectors can scrape it; the
+ * payload holds no user or schedule data. Every value is read from counters or
+ * sampled directly, so the handler does no file I/O.
+ *
+ * @param request Pointer to the AsyncWebServerRequest object.
+ */
+void ApiRoutes::handleGetMetrics(AsyncWebServerRequest *request) {
+    RouteTimer routeTimer(MetricRoute::METRICS);
+    AsyncResponseStream *response = request->beginResponseStream("text/plain; version=0.0.4");
+    response->addHeader("Cache-Control", "no-store");
+    runtimeMetrics.writeText(*response);
+    this->addSecurityHeaders(response);
+    request->send(response);
+}
+
 // --- Schedule API Handlers ---
 
 // GET /api/schedules - List all schedules
@@ -195,20 +587,28 @@ void ApiRoutes::handleGetUserInfo(AsyncWebServerRequest *request) {
  * @param request Pointer to the AsyncWebServerRequest object.
  */
 void ApiRoutes::handleGetSchedules(AsyncWebServerRequest *request) {
+    RouteTimer routeTimer(MetricRoute::SCHEDULES);
     SCH_API_DEBUG_PRINTLN("API: handleGetSchedules request received.");
-    SessionData* session = this->sessionManager.validateSession(request);
-    if (!session) { SCH_API_DEBUG_PRINTLN("API: handleGetSchedules - Not authenticated."); request->send(401, "application/json", "{\"error\":\"Not authenticated\"}"); return; }
+    SessionData session = this->sessionManager.validateSession(request);
+    if (!session.isValid()) { SCH_API_DEBUG_PRINTLN("API: handleGetSchedules - Not authenticated."); request->send(401, "application/json", "{\"error\":\"Not authenticated\"}"); return; }
 
     std::vector<ScheduleFile> scheduleList;
     if (!this->scheduleManager.getScheduleList(scheduleList)) { SCH_API_DEBUG_PRINTLN("API: handleGetSchedules - Failed to load schedule list."); request->send(500, "application/json", "{\"error\":\"Failed to load schedule list\"}"); return; }
 
     SCH_API_DEBUG_PRINTF("API: handleGetSchedules - Found %d schedules.\n", scheduleList.size());
-    JsonDocument doc;
-    JsonArray array = doc.to<JsonArray>();
-    for (const auto& sf : scheduleList) { JsonObject obj = array.add<JsonObject>(); obj["uid"] = sf.scheduleUID; obj["locked"] = sf.persistentLockLevel; obj["lockedBy"] = sf.lockedBy; }
-    String jsonResponse;
-    serializeJson(doc, jsonResponse);
-    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", jsonResponse);
+    // Stream one small object at a time instead of building the whole array in a document
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    response->print('[');
+    JsonDocument item;
+    bool first = true;
+    for (const auto& sf : scheduleList) {
+        item.clear();
+        item["uid"] = sf.scheduleUID; item["locked"] = sf.persistentLockLevel; item["lockedBy"] = sf.lockedBy;
+        if (!first) response->print(',');
+        serializeJson(item, *response);
+        first = false;
+    }
+    response->print(']');
     this->addSecurityHeaders(response); // Use class method
     request->send(response);
 }
@@ -226,35 +626,50 @@ void ApiRoutes::handleGetSchedules(AsyncWebServerRequest *request) {
  * @param request Pointer to the AsyncWebServerRequest object. Expects 'uid' query parameter.
  */
 void ApiRoutes::handleGetSchedule(AsyncWebServerRequest *request) {
+    RouteTimer routeTimer(MetricRoute::SCHEDULE_GET);
     SCH_API_DEBUG_PRINTLN("API: handleGetSchedule request received.");
-    SessionData* session = this->sessionManager.validateSession(request);
-    if (!session) { SCH_API_DEBUG_PRINTLN("API: handleGetSchedule - Not authenticated."); request->send(401, "application/json", "{\"error\":\"Not authenticated\"}"); return; }
+    SessionData session = this->sessionManager.validateSession(request);
+    if (!session.isValid()) { SCH_API_DEBUG_PRINTLN("API: handleGetSchedule - Not authenticated."); request->send(401, "application/json", "{\"error\":\"Not authenticated\"}"); return; }
     if (!request->hasParam("uid")) { SCH_API_DEBUG_PRINTLN("API: handleGetSchedule - Missing UID parameter."); request->send(400, "application/json", "{\"error\":\"Missing schedule UID parameter\"}"); return; }
 
     String uid = request->getParam("uid")->value();
     SCH_API_DEBUG_PRINTF("API: handleGetSchedule - Requesting schedule UID: %s\n", uid.c_str());
-    Schedule schedule;
-    if (!this->scheduleManager.loadSchedule(uid, schedule)) { SCH_API_DEBUG_PRINTF("API: handleGetSchedule - Schedule not found or failed to load: %s\n", uid.c_str()); request->send(404, "application/json", "{\"error\":\"Schedule not found or failed to load\"}"); return; }
-
-    // *** ADDED DEBUG LOG ***
-    SCH_API_DEBUG_PRINTF("API: handleGetSchedule - Loaded schedule object event counts: AP=%d, DUR=%d, VOL=%d\n",
-                         schedule.autopilotWindows.size(),
-                         schedule.durationEvents.size(),
-                         schedule.volumeEvents.size());
-    // ***********************
-
-    SCH_API_DEBUG_PRINTF("API: handleGetSchedule - Loaded schedule: %s\n", schedule.scheduleName.c_str());
-    JsonDocument doc;
-    doc["scheduleName"] = schedule.scheduleName; doc["lightsOnTime"] = schedule.lightsOnTime; doc["lightsOffTime"] = schedule.lightsOffTime; doc["scheduleUID"] = schedule.scheduleUID;
-    JsonArray apArray = doc["autopilotWindows"].to<JsonArray>();
-    for (const auto& apw : schedule.autopilotWindows) { JsonObject apObj = apArray.add<JsonObject>(); apObj["startTime"] = apw.startTime; apObj["endTime"] = apw.endTime; apObj["matricTension"] = apw.matricTension; apObj["doseVolume"] = apw.doseVolume; apObj["settlingTime"] = apw.settlingTime; }
-    JsonArray durArray = doc["durationEvents"].to<JsonArray>();
-    for (const auto& de : schedule.durationEvents) { JsonObject durObj = durArray.add<JsonObject>(); durObj["startTime"] = de.startTime; durObj["duration"] = de.duration; durObj["endTime"] = de.endTime; }
-    JsonArray volArray = doc["volumeEvents"].to<JsonArray>();
-    for (const auto& ve : schedule.volumeEvents) { JsonObject volObj = volArray.add<JsonObject>(); volObj["startTime"] = ve.startTime; volObj["doseVolume"] = ve.doseVolume; }
-    String jsonResponse;
-    serializeJson(doc, jsonResponse);
-    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", jsonResponse);
+    // Shared snapshot: a cache hit streams the resident copy without touching flash
+    ScheduleSnapshot schedule = this->scheduleManager.getSchedule(uid);
+    if (!schedule) { SCH_API_DEBUG_PRINTF("API: handleGetSchedule - Schedule not found or failed to load: %s\n", uid.c_str()); request->send(404, "application/json", "{\"error\":\"Schedule not found or failed to load\"}"); return; }
+
+    SCH_API_DEBUG_PRINTF("API: handleGetSchedule - Loaded schedule: %s\n", schedule->scheduleName.c_str());
+    // Stream the object piecewise; only one event is held in a document at a time
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    response->print("{\"scheduleName\":"); streamJsonString(*response, schedule->scheduleName);
+    response->printf(",\"lightsOnTime\":%d,\"lightsOffTime\":%d", schedule->lightsOnTime, schedule->lightsOffTime);
+    response->print(",\"scheduleUID\":"); streamJsonString(*response, schedule->scheduleUID);
+    JsonDocument item;
+    response->print(",\"autopilotWindows\":[");
+    for (size_t i = 0; i < schedule->autopilotWindows.size(); ++i) {
+        const auto& apw = schedule->autopilotWindows[i];
+        item.clear();
+        item["startTime"] = apw.startTime; item["endTime"] = apw.endTime; item["matricTension"] = apw.matricTension; item["doseVolume"] = apw.doseVolume; item["settlingTime"] = apw.settlingTime; item["doseDuration"] = apw.doseDuration;
+        if (i > 0) response->print(',');
+        serializeJson(item, *response);
+    }
+    response->print("],\"durationEvents\":[");
+    for (size_t i = 0; i < schedule->durationEvents.size(); ++i) {
+        const auto& de = schedule->durationEvents[i];
+        item.clear();
+        item["startTime"] = de.startTime; item["duration"] = de.duration; item["endTime"] = de.endTime;
+        if (i > 0) response->print(',');
+        serializeJson(item, *response);
+    }
+    response->print("],\"volumeEvents\":[");
+    for (size_t i = 0; i < schedule->volumeEvents.size(); ++i) {
+        const auto& ve = schedule->volumeEvents[i];
+        item.clear();
+        item["startTime"] = ve.startTime; item["doseVolume"] = ve.doseVolume;
+        if (i > 0) response->print(',');
+        serializeJson(item, *response);
+    }
+    response->print("]}");
     this->addSecurityHeaders(response); // Use class method
     request->send(response);
 }
@@ -265,7 +680,8 @@ void ApiRoutes::handleGetSchedule(AsyncWebServerRequest *request) {
  *
  * Deletes a specific schedule identified by the 'uid' query parameter.
  * Requires an authenticated session with MANAGER or ADMIN role.
- * Checks for persistent locks (template/cycle) and edit locks before deletion.
+ * Checks for persistent locks (template/cycle), the schedules of running cycle steps
+ * and edit locks before deletion.
  * Releases any edit lock held by the requesting user upon successful deletion.
  * Returns 401 if not authenticated, 403 if permission denied (role or lock),
  * 400 if 'uid' is missing, 404 if schedule not found, 409 if locked by another user,
@@ -274,26 +690,29 @@ void ApiRoutes::handleGetSchedule(AsyncWebServerRequest *request) {
  * @param request Pointer to the AsyncWebServerRequest object. Expects 'uid' query parameter.
  */
 void ApiRoutes::handleDeleteSchedule(AsyncWebServerRequest *request) {
+    RouteTimer routeTimer(MetricRoute::SCHEDULE_DELETE);
     SCH_API_DEBUG_PRINTLN("API: handleDeleteSchedule request received.");
-    SessionData* session = this->sessionManager.validateSession(request);
-    if (!session) { SCH_API_DEBUG_PRINTLN("API: handleDeleteSchedule - Not authenticated."); request->send(401, "application/json", "{\"error\":\"Not authenticated\"}"); return; }
-    if (session->userRole < MANAGER) { SCH_API_DEBUG_PRINTF("API: handleDeleteSchedule - Permission denied for user %s (role %d).\n", session->username.c_str(), session->userRole); request->send(403, "application/json", "{\"error\":\"Permission denied\"}"); return; }
+    SessionData session = this->sessionManager.validateSession(request);
+    if (!session.isValid()) { SCH_API_DEBUG_PRINTLN("API: handleDeleteSchedule - Not authenticated."); request->send(401, "application/json", "{\"error\":\"Not authenticated\"}"); return; }
+    if (session.userRole < MANAGER) { SCH_API_DEBUG_PRINTF("API: handleDeleteSchedule - Permission denied for user %s (role %d).\n", session.username, session.userRole); request->send(403, "application/json", "{\"error\":\"Permission denied\"}"); return; }
     if (!request->hasParam("uid")) { SCH_API_DEBUG_PRINTLN("API: handleDeleteSchedule - Missing UID parameter."); request->send(400, "application/json", "{\"error\":\"Missing schedule UID parameter\"}"); return; }
 
     String uid = request->getParam("uid")->value();
-    SCH_API_DEBUG_PRINTF("API: handleDeleteSchedule - Attempting to delete schedule UID: %s by user %s\n", uid.c_str(), session->username.c_str());
+    SCH_API_DEBUG_PRINTF("API: handleDeleteSchedule - Attempting to delete schedule UID: %s by user %s\n", uid.c_str(), session.username);
     String resourceId = "schedule_" + uid;
     int persistentLockLevel = this->scheduleManager.getPersistentLockLevel(uid);
 
     if (persistentLockLevel == 1 || persistentLockLevel == 2) { SCH_API_DEBUG_PRINTF("API: handleDeleteSchedule - Schedule %s is locked by template/cycle.\n", uid.c_str()); request->send(403, "application/json", "{\"error\":\"Schedule is locked by a template or active cycle and cannot be deleted.\"}"); return; }
     if (persistentLockLevel < 0) { SCH_API_DEBUG_PRINTF("API: handleDeleteSchedule - Schedule %s not found in index.\n", uid.c_str()); request->send(404, "application/json", "{\"error\":\"Schedule not found in index.\"}"); return; }
+    // The index level does not cover running cycles: a current step's schedule must stay
+    if (cycleManager.isResourceInActiveCycle(resourceId)) { SCH_API_DEBUG_PRINTF("API: handleDeleteSchedule - Schedule %s is run by an active cycle.\n", uid.c_str()); request->send(403, "application/json", "{\"error\":\"Schedule is run by an active cycle and cannot be deleted.\"}"); return; }
 
     FileLock lockInfo;
-    if (this->lockManager.isLocked(resourceId, &lockInfo) && lockInfo.sessionId != session->sessionId) { SCH_API_DEBUG_PRINTF("API: handleDeleteSchedule - Schedule %s is locked by user %s.\n", uid.c_str(), lockInfo.username.c_str()); request->send(409, "application/json", "{\"error\":\"Schedule is currently being edited by " + lockInfo.username + "\"}"); return; }
+    if (this->lockManager.isLocked(resourceId, &lockInfo) && lockInfo.sessionId != session.sessionId) { SCH_API_DEBUG_PRINTF("API: handleDeleteSchedule - Schedule %s is locked by user %s.\n", uid.c_str(), lockInfo.username.c_str()); request->send(409, "application/json", "{\"error\":\"Schedule is currently being edited by " + lockInfo.username + "\"}"); return; }
 
     if (this->scheduleManager.deleteSchedule(uid)) {
         SCH_API_DEBUG_PRINTF("API: handleDeleteSchedule - Schedule %s deleted successfully.\n", uid.c_str());
-        this->lockManager.releaseLock(resourceId, session->sessionId); // Release edit lock if held
+        this->lockManager.releaseLock(resourceId, session.sessionId); // Release edit lock if held
         request->send(200, "application/json", "{\"message\":\"Schedule deleted successfully\"}");
     } else {
         SCH_API_DEBUG_PRINTF("API: handleDeleteSchedule - Failed to delete schedule %s.\n", uid.c_str());
@@ -306,7 +725,7 @@ void ApiRoutes::handleDeleteSchedule(AsyncWebServerRequest *request) {
  * @brief Handles the body content for POST and PUT requests to /api/schedule.
  *
  * This function is registered as the body handler for schedule creation (POST)
- * and updates (PUT). It accumulates the request body chunks into a buffer.
+ * and updates (PUT). It accumulates the request body chunks into a fixed arena slot.
  * Once the entire body is received, it parses the JSON content.
  *
  * For POST: Creates a new schedule with the provided name and data. Requires
@@ -319,7 +738,7 @@ void ApiRoutes::handleDeleteSchedule(AsyncWebServerRequest *request) {
  *
  * Handles authentication, authorization, JSON parsing errors, payload size limits,
  * lock conflicts, and file system errors, returning appropriate HTTP status codes.
- * Cleans up the allocated buffer after processing.
+ * Returns the arena slot as soon as the body has been parsed (or on disconnect).
  *
  * @param request Pointer to the AsyncWebServerRequest object.
  * @param data Pointer to the current chunk of body data.
@@ -329,82 +748,77 @@ void ApiRoutes::handleDeleteSchedule(AsyncWebServerRequest *request) {
  */
 void ApiRoutes::handleSchedulePostPutBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
 
-    String* buffer = nullptr; // Pointer to the buffer stored in request context
+    BodySlot* slot = nullptr; // Arena slot owned by this request
 
-    // --- Buffer Allocation and Data Appending ---
+    // --- Slot Acquisition and Data Appending ---
     if (index == 0) { // First chunk
          SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - START for %s %s (Total: %d)\n", request->methodToString(), request->url().c_str(), total);
-         if (total > 10240) { // Example limit: 10KB
+         if (total > SCHEDULE_BODY_MAX_SIZE) {
              SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - Body too large: %d bytes. Aborting.\n", total);
              request->send(413, "text/plain", "Payload Too Large"); // Send 413 Payload Too Large
-             // No buffer allocated yet, just return
+             // No slot acquired yet, just return
              return;
          }
-        buffer = new (std::nothrow) String(); // Allocate buffer safely
-        if (buffer) {
-            buffer->reserve(total); // Reserve space
-            request->_tempObject = buffer; // Store pointer in request context
-        } else {
-            SCH_API_DEBUG_PRINTLN("API: handleSchedulePostPutBody - Failed to allocate buffer for request body!");
-            request->send(500, "text/plain", "Internal Server Error: Failed to allocate buffer");
+        slot = this->acquireBodySlot(request);
+        if (!slot) {
+            SCH_API_DEBUG_PRINTLN("API: handleSchedulePostPutBody - All body slots busy!");
+            request->send(503, "text/plain", "Service Unavailable: Too many concurrent uploads");
             return; // Stop processing
         }
     } else {
-        buffer = (String*)request->_tempObject; // Retrieve buffer from context
+        slot = this->findBodySlot(request); // Retrieve slot owned by this request
     }
 
-    if (!buffer) {
-        SCH_API_DEBUG_PRINTLN("API: handleSchedulePostPutBody - Invalid buffer pointer retrieved.");
-        // If buffer is null here, something went wrong earlier, but we might not be able to send a response if the request is already handled.
+    if (!slot) {
+        SCH_API_DEBUG_PRINTLN("API: handleSchedulePostPutBody - No body slot for this request.");
+        // Earlier chunk was rejected (413/503) and a response is already queued.
         return;
-    } // Stop if buffer is invalid
+    } // Stop if no slot
 
-    // Append data chunk to buffer
-    if (buffer->length() + len <= 10240) { // Check limit again during append
-         buffer->concat((char*)data, len);
+    // Append data chunk to slot
+    if (slot->length + len <= SCHEDULE_BODY_MAX_SIZE) { // Check limit again during append
+         memcpy(slot->data + slot->length, data, len);
+         slot->length += len;
     } else {
          SCH_API_DEBUG_PRINTLN("API: handleSchedulePostPutBody - Body buffer overflow during reception!");
-         delete buffer; // Clean up allocated buffer
-         request->_tempObject = nullptr; // Nullify context pointer
+         this->releaseBodySlot(request);
          request->send(413, "text/plain", "Payload Too Large during reception"); // Try to send error
          return; // Stop processing
     }
-    // API_DEBUG_PRINTF("Body chunk: index=%d, len=%d, total=%d. Buffer size=%d\n", index, len, total, buffer->length()); // Verbose Debug
+    // API_DEBUG_PRINTF("Body chunk: index=%d, len=%d, total=%d. Slot size=%d\n", index, len, total, slot->length); // Verbose Debug
 
     // --- Process Request ONLY on the LAST chunk ---
     if (index + len == total) {
-        SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - END. Final size: %d\n", buffer->length());
-        SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - Received Body: %s\n", buffer->c_str()); // Log the full body
+        RouteTimer routeTimer(MetricRoute::SCHEDULE_SAVE); // Parse + save; chunk reception is not counted
+        SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - END. Final size: %d\n", slot->length);
 
         // --- Start of processing logic ---
-        SessionData* session = this->sessionManager.validateSession(request);
-        if (!session) {
+        SessionData session = this->sessionManager.validateSession(request);
+        if (!session.isValid()) {
             SCH_API_DEBUG_PRINTLN("API: handleSchedulePostPutBody - Not authenticated.");
             request->send(401, "application/json", "{\"error\":\"Not authenticated\"}");
-            delete buffer; request->_tempObject = nullptr; return;
+            this->releaseBodySlot(request); return;
         }
-        if (session->userRole < MANAGER) {
-            SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - Permission denied for user %s (role %d).\n", session->username.c_str(), session->userRole);
+        if (session.userRole < MANAGER) {
+            SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - Permission denied for user %s (role %d).\n", session.username, session.userRole);
             request->send(403, "application/json", "{\"error\":\"Permission denied\"}");
-            delete buffer; request->_tempObject = nullptr; return;
+            this->releaseBodySlot(request); return;
         }
 
-        // Parse the buffered body
+        // Parse straight from the slot (read-only input, no intermediate String)
         JsonDocument doc;
-        DeserializationError error = deserializeJson(doc, *buffer);
-
-        // Clean up buffer *after* parsing, *before* returning in error cases below
-        String bodyContent = *buffer; // Copy buffer content if needed for later logging
-        delete buffer;
-        request->_tempObject = nullptr;
+        DeserializationError error = deserializeJson(doc, (const char*)slot->data, slot->length);
 
         if (error) {
             SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - JSON Deserialization error: %s\n", error.c_str());
-            SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - Invalid JSON received: %s\n", bodyContent.c_str());
+            this->releaseBodySlot(request);
             request->send(400, "application/json", "{\"error\":\"Invalid JSON body\"}");
             return;
         }
 
+        // The document holds its own copy of the strings, so the slot can be reused now
+        this->releaseBodySlot(request);
+
         JsonObject bodyJson = doc.as<JsonObject>();
 
         // --- Handle POST (Create) ---
@@ -430,7 +844,7 @@ void ApiRoutes::handleSchedulePostPutBody(AsyncWebServerRequest *request, uint8_
                         // *** PARSE EVENTS FROM RECEIVED JSON ***
                         SCH_API_DEBUG_PRINTLN("API: handleSchedulePostPutBody - Parsing events for new schedule...");
                         JsonArray apArray = bodyJson["autopilotWindows"];
-                        if (!apArray.isNull()) { for (JsonObject apObj : apArray) { AutopilotWindow apw; apw.startTime = apObj["startTime"] | 0; apw.endTime = apObj["endTime"] | 0; apw.matricTension = apObj["matricTension"] | 0.0f; apw.doseVolume = apObj["doseVolume"] | 0; apw.settlingTime = apObj["settlingTime"] | 0; if (apw.isValid()) newSchedule.autopilotWindows.push_back(apw); else { SCH_API_DEBUG_PRINTLN("API: handleSchedulePostPutBody - Invalid AP Window data received during create.");} } }
+                        if (!apArray.isNull()) { for (JsonObject apObj : apArray) { AutopilotWindow apw; apw.startTime = apObj["startTime"] | 0; apw.endTime = apObj["endTime"] | 0; apw.matricTension = apObj["matricTension"] | 0.0f; apw.doseVolume = apObj["doseVolume"] | 0; apw.settlingTime = apObj["settlingTime"] | 0; apw.doseDuration = apObj["doseDuration"] | 0; if (apw.isValid()) newSchedule.autopilotWindows.push_back(apw); else { SCH_API_DEBUG_PRINTLN("API: handleSchedulePostPutBody - Invalid AP Window data received during create.");} } }
                         JsonArray durArray = bodyJson["durationEvents"];
                         if (!durArray.isNull()) { for (JsonObject durObj : durArray) { DurationEvent de; de.startTime = durObj["startTime"] | 0; de.duration = durObj["duration"] | 0; de.endTime = de.startTime + (int)ceil(de.duration / 60.0); if (de.endTime > 1439) de.endTime = 1439; if (de.isValid()) newSchedule.durationEvents.push_back(de); else { SCH_API_DEBUG_PRINTLN("API: handleSchedulePostPutBody - Invalid Duration Event data received during create.");} } }
                         JsonArray volArray = bodyJson["volumeEvents"];
@@ -481,14 +895,18 @@ void ApiRoutes::handleSchedulePostPutBody(AsyncWebServerRequest *request, uint8_
                 } else if (persistentLockLevel < 0) {
                     SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - Schedule %s not found in index for PUT.\n", uid.c_str());
                     request->send(404, "application/json", "{\"error\":\"Schedule not found in index.\"}");
+                } else if (cycleManager.isResourceInActiveCycle(resourceId)) {
+                    // Also when the edit lock was taken before the cycle reached this step
+                    SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - Schedule %s is run by an active cycle.\n", uid.c_str());
+                    request->send(403, "application/json", "{\"error\":\"Schedule is run by an active cycle and cannot be edited.\"}");
                 } else {
                     // Acquire lock (Check if we already have it from the frontend's explicit lock call)
                     FileLock currentLockInfo;
-                    bool hasImplicitLock = this->lockManager.getLockInfo(resourceId, currentLockInfo) && currentLockInfo.sessionId == session->sessionId;
+                    bool hasImplicitLock = this->lockManager.getLockInfo(resourceId, currentLockInfo) && currentLockInfo.sessionId == session.sessionId;
 
                     if (!hasImplicitLock) {
-                         SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - Attempting implicit lock acquire for PUT on %s by %s\n", uid.c_str(), session->username.c_str());
-                         if (!this->lockManager.acquireLock(resourceId, EDITING_SCHEDULE, *session)) {
+                         SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - Attempting implicit lock acquire for PUT on %s by %s\n", uid.c_str(), session.username);
+                         if (!this->lockManager.acquireLock(resourceId, EDITING_SCHEDULE, session)) {
                              FileLock lockInfo; // Re-fetch lock info in case someone else got it
                              if (this->lockManager.getLockInfo(resourceId, lockInfo)) { SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - Schedule %s locked by %s.\n", uid.c_str(), lockInfo.username.c_str()); request->send(409, "application/json", "{\"error\":\"Schedule is currently being edited by " + lockInfo.username + "\"}"); }
                              else { SCH_API_DEBUG_PRINTLN("API: handleSchedulePostPutBody - Failed to acquire implicit editing lock."); request->send(500, "application/json", "{\"error\":\"Failed to acquire editing lock\"}"); }
@@ -497,33 +915,32 @@ void ApiRoutes::handleSchedulePostPutBody(AsyncWebServerRequest *request, uint8_
                          SCH_API_DEBUG_PRINTLN("API: handleSchedulePostPutBody - Implicit lock acquired.");
                          hasImplicitLock = true; // Mark that we acquired it implicitly
                     } else {
-                         SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - User %s already holds lock for %s.\n", session->username.c_str(), uid.c_str());
+                         SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - User %s already holds lock for %s.\n", session.username, uid.c_str());
                     }
 
 
                     // Lock acquired (implicitly or explicitly), proceed with update
-                    Schedule updatedSchedule;
-                    // Load existing schedule to preserve UID and potentially other fields if needed
-                    // Although the JS sends the full object, loading ensures consistency
-                    if (!this->scheduleManager.loadSchedule(uid, updatedSchedule)) {
+                    // Copy-on-write: only the scalar fields are taken from the shared snapshot,
+                    // the event lists are rebuilt from the body below
+                    ScheduleSnapshot existing = this->scheduleManager.getSchedule(uid);
+                    if (!existing) {
                          SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - Failed to load schedule %s for update after acquiring lock.\n", uid.c_str());
-                         this->lockManager.releaseLock(resourceId, session->sessionId); // Release lock
+                         this->lockManager.releaseLock(resourceId, session.sessionId); // Release lock
                          request->send(500, "application/json", "{\"error\":\"Failed to load schedule for update\"}");
                          return;
                     }
 
 
-                    updatedSchedule.scheduleName = bodyJson["scheduleName"] | updatedSchedule.scheduleName; // Use existing if not provided
-                    updatedSchedule.lightsOnTime = bodyJson["lightsOnTime"] | updatedSchedule.lightsOnTime;
-                    updatedSchedule.lightsOffTime = bodyJson["lightsOffTime"] | updatedSchedule.lightsOffTime;
-                    // UID is already set from loadSchedule
-                    updatedSchedule.autopilotWindows.clear();
-                    updatedSchedule.durationEvents.clear();
-                    updatedSchedule.volumeEvents.clear();
+                    Schedule updatedSchedule;
+                    updatedSchedule.scheduleUID = existing->scheduleUID;
+                    updatedSchedule.scheduleName = bodyJson["scheduleName"] | existing->scheduleName; // Use existing if not provided
+                    updatedSchedule.lightsOnTime = bodyJson["lightsOnTime"] | existing->lightsOnTime;
+                    updatedSchedule.lightsOffTime = bodyJson["lightsOffTime"] | existing->lightsOffTime;
+                    existing.reset(); // Drop our reference before saveSchedule() replaces it
 
                     // Parse arrays...
                     JsonArray apArray = bodyJson["autopilotWindows"];
-                    if (!apArray.isNull()) { for (JsonObject apObj : apArray) { AutopilotWindow apw; apw.startTime = apObj["startTime"] | 0; apw.endTime = apObj["endTime"] | 0; apw.matricTension = apObj["matricTension"] | 0.0f; apw.doseVolume = apObj["doseVolume"] | 0; apw.settlingTime = apObj["settlingTime"] | 0; if (apw.isValid()) updatedSchedule.autopilotWindows.push_back(apw); else { SCH_API_DEBUG_PRINTLN("API: handleSchedulePostPutBody - Invalid AP Window data received.");} } }
+                    if (!apArray.isNull()) { for (JsonObject apObj : apArray) { AutopilotWindow apw; apw.startTime = apObj["startTime"] | 0; apw.endTime = apObj["endTime"] | 0; apw.matricTension = apObj["matricTension"] | 0.0f; apw.doseVolume = apObj["doseVolume"] | 0; apw.settlingTime = apObj["settlingTime"] | 0; apw.doseDuration = apObj["doseDuration"] | 0; if (apw.isValid()) updatedSchedule.autopilotWindows.push_back(apw); else { SCH_API_DEBUG_PRINTLN("API: handleSchedulePostPutBody - Invalid AP Window data received.");} } }
                     JsonArray durArray = bodyJson["durationEvents"];
                     if (!durArray.isNull()) { for (JsonObject durObj : durArray) { DurationEvent de; de.startTime = durObj["startTime"] | 0; de.duration = durObj["duration"] | 0; de.endTime = de.startTime + (int)ceil(de.duration / 60.0); if (de.endTime > 1439) de.endTime = 1439; if (de.isValid()) updatedSchedule.durationEvents.push_back(de); else { SCH_API_DEBUG_PRINTLN("API: handleSchedulePostPutBody - Invalid Duration Event data received.");} } }
                     JsonArray volArray = bodyJson["volumeEvents"];
@@ -540,12 +957,12 @@ void ApiRoutes::handleSchedulePostPutBody(AsyncWebServerRequest *request, uint8_
                     if (this->scheduleManager.saveSchedule(updatedSchedule)) {
                         SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - Schedule %s updated successfully.\n", uid.c_str());
                         // Keep lock? The JS releases it on success. Let's keep it consistent and NOT release here.
-                        // this->lockManager.releaseLock(resourceId, session->sessionId);
+                        // this->lockManager.releaseLock(resourceId, session.sessionId);
                         request->send(200, "application/json", "{\"message\":\"Schedule updated successfully\"}");
                     } else {
                         SCH_API_DEBUG_PRINTF("API: handleSchedulePostPutBody - Failed to save updated schedule %s.\n", uid.c_str());
                         // Don't release lock on failure, user might want to retry
-                        // this->lockManager.releaseLock(resourceId, session->sessionId);
+                        // this->lockManager.releaseLock(resourceId, session.sessionId);
                         request->send(500, "application/json", "{\"error\":\"Failed to save updated schedule\"}");
                     }
                     // } // End lock acquired block <-- This was incorrect, lock handling is inside now
@@ -557,7 +974,7 @@ void ApiRoutes::handleSchedulePostPutBody(AsyncWebServerRequest *request, uint8_
              request->send(405, "application/json", "{\"error\":\"Method not allowed for this body handler\"}");
         }
 
-        // Buffer cleanup is now done earlier after parsing
+        // Slot is released right after parsing
 
     } // End if last chunk
 }
@@ -579,22 +996,23 @@ void ApiRoutes::handleSchedulePostPutBody(AsyncWebServerRequest *request, uint8_
  * @param request Pointer to the AsyncWebServerRequest object. Expects 'uid' query parameter.
  */
 void ApiRoutes::handleScheduleLockPost(AsyncWebServerRequest *request) {
+    RouteTimer routeTimer(MetricRoute::SCHEDULE_LOCK);
     SCH_API_DEBUG_PRINTLN("API: handleScheduleLockPost request received.");
 
-    SessionData* session = this->sessionManager.validateSession(request);
-    if (!session) { SCH_API_DEBUG_PRINTLN("API: handleScheduleLockPost - Not authenticated."); request->send(401, "application/json", "{\"error\":\"Not authenticated\"}"); return; }
-    if (session->userRole < MANAGER) { SCH_API_DEBUG_PRINTF("API: handleScheduleLockPost - Permission denied for user %s (role %d).\n", session->username.c_str(), session->userRole); request->send(403, "application/json", "{\"error\":\"Permission denied\"}"); return; }
+    SessionData session = this->sessionManager.validateSession(request);
+    if (!session.isValid()) { SCH_API_DEBUG_PRINTLN("API: handleScheduleLockPost - Not authenticated."); request->send(401, "application/json", "{\"error\":\"Not authenticated\"}"); return; }
+    if (session.userRole < MANAGER) { SCH_API_DEBUG_PRINTF("API: handleScheduleLockPost - Permission denied for user %s (role %d).\n", session.username, session.userRole); request->send(403, "application/json", "{\"error\":\"Permission denied\"}"); return; }
     if (!request->hasParam("uid")) { SCH_API_DEBUG_PRINTLN("API: handleScheduleLockPost - Missing UID parameter."); request->send(400, "application/json", "{\"error\":\"Missing schedule UID parameter\"}"); return; }
 
     String uid = request->getParam("uid")->value();
     String resourceId = "schedule_" + uid;
-    SCH_API_DEBUG_PRINTF("API: handleScheduleLockPost - Action for UID: %s by User: %s\n", uid.c_str(), session->username.c_str());
+    SCH_API_DEBUG_PRINTF("API: handleScheduleLockPost - Action for UID: %s by User: %s\n", uid.c_str(), session.username);
 
     int persistentLockLevel = this->scheduleManager.getPersistentLockLevel(uid);
     if (persistentLockLevel == 1 || persistentLockLevel == 2) { SCH_API_DEBUG_PRINTF("API: handleScheduleLockPost - Schedule %s locked by template/cycle.\n", uid.c_str()); request->send(403, "application/json", "{\"error\":\"Schedule is locked by a template or active cycle and cannot be edited.\"}"); return; }
     if (persistentLockLevel < 0) { SCH_API_DEBUG_PRINTF("API: handleScheduleLockPost - Schedule %s not found in index for lock.\n", uid.c_str()); request->send(404, "application/json", "{\"error\":\"Schedule not found in index.\"}"); return; }
 
-    if (this->lockManager.acquireLock(resourceId, EDITING_SCHEDULE, *session)) {
+    if (this->lockManager.acquireLock(resourceId, EDITING_SCHEDULE, session)) {
         SCH_API_DEBUG_PRINTLN("API: handleScheduleLockPost - Lock acquired successfully.");
         request->send(200, "application/json", "{\"message\":\"Lock acquired successfully\"}");
     } else {
@@ -618,25 +1036,26 @@ void ApiRoutes::handleScheduleLockPost(AsyncWebServerRequest *request) {
  * @param request Pointer to the AsyncWebServerRequest object. Expects 'uid' query parameter.
  */
 void ApiRoutes::handleScheduleLockDelete(AsyncWebServerRequest *request) {
+    RouteTimer routeTimer(MetricRoute::SCHEDULE_UNLOCK);
     SCH_API_DEBUG_PRINTLN("API: handleScheduleLockDelete request received.");
 
-    SessionData* session = this->sessionManager.validateSession(request);
-    if (!session) { SCH_API_DEBUG_PRINTLN("API: handleScheduleLockDelete - Not authenticated."); request->send(401, "application/json", "{\"error\":\"Not authenticated\"}"); return; }
-    if (session->userRole < MANAGER) { SCH_API_DEBUG_PRINTF("API: handleScheduleLockDelete - Permission denied for user %s (role %d).\n", session->username.c_str(), session->userRole); request->send(403, "application/json", "{\"error\":\"Permission denied\"}"); return; }
+    SessionData session = this->sessionManager.validateSession(request);
+    if (!session.isValid()) { SCH_API_DEBUG_PRINTLN("API: handleScheduleLockDelete - Not authenticated."); request->send(401, "application/json", "{\"error\":\"Not authenticated\"}"); return; }
+    if (session.userRole < MANAGER) { SCH_API_DEBUG_PRINTF("API: handleScheduleLockDelete - Permission denied for user %s (role %d).\n", session.username, session.userRole); request->send(403, "application/json", "{\"error\":\"Permission denied\"}"); return; }
     if (!request->hasParam("uid")) { SCH_API_DEBUG_PRINTLN("API: handleScheduleLockDelete - Missing UID parameter."); request->send(400, "application/json", "{\"error\":\"Missing schedule UID parameter\"}"); return; }
 
     String uid = request->getParam("uid")->value();
     String resourceId = "schedule_" + uid;
-    SCH_API_DEBUG_PRINTF("API: handleScheduleLockDelete - Action for UID: %s by User: %s\n", uid.c_str(), session->username.c_str());
+    SCH_API_DEBUG_PRINTF("API: handleScheduleLockDelete - Action for UID: %s by User: %s\n", uid.c_str(), session.username);
 
-     if (this->lockManager.releaseLock(resourceId, session->sessionId)) {
+     if (this->lockManager.releaseLock(resourceId, session.sessionId)) {
          SCH_API_DEBUG_PRINTLN("API: handleScheduleLockDelete - Lock released successfully.");
          request->send(200, "application/json", "{\"message\":\"Lock released successfully\"}");
     } else {
         // Check if lock exists at all or is held by someone else
         FileLock lockInfo;
         if (this->lockManager.getLockInfo(resourceId, lockInfo)) {
-             SCH_API_DEBUG_PRINTF("API: handleScheduleLockDelete - Failed to release lock (held by %s, not %s).\n", lockInfo.username.c_str(), session->username.c_str());
+             SCH_API_DEBUG_PRINTF("API: handleScheduleLockDelete - Failed to release lock (held by %s, not %s).\n", lockInfo.username.c_str(), session.username);
              request->send(403, "application/json", "{\"error\":\"Failed to release lock (held by another user)\"}"); // Forbidden
         } else {
              SCH_API_DEBUG_PRINTLN("API: handleScheduleLockDelete - Failed to release lock (not found).");
@@ -646,12 +1065,313 @@ void ApiRoutes::handleScheduleLockDelete(AsyncWebServerRequest *request) {
 }
 
 
+// --- Bulk Schedule API ---
+
+// GET /api/schedules/export - All schedules as one JSON array
+/**
+ * @brief Handles GET requests to the /api/schedules/export endpoint.
+ *
+ * Streams every indexed schedule, in the layout of GET /api/schedule, as one JSON
+ * array. The response is chunked and holds only one parsed schedule at a time, so
+ * memory does not grow with the number of schedules. The output is accepted as is by
+ * POST /api/schedules/import. Returns 401 if not authenticated.
+ *
+ * @param request Pointer to the AsyncWebServerRequest object.
+ */
+void ApiRoutes::handleScheduleExport(AsyncWebServerRequest *request) {
+    RouteTimer routeTimer(MetricRoute::SCHEDULE_EXPORT);
+    if (!this->sessionManager.validateSession(request).isValid()) { request->send(401, "application/json", "{\"error\":\"Not authenticated\"}"); return; }
+
+    std::vector<ScheduleFile> scheduleList;
+    if (!this->scheduleManager.getScheduleList(scheduleList)) { request->send(500, "application/json", "{\"error\":\"Failed to load schedule list\"}"); return; }
+
+    std::shared_ptr<ScheduleExportStream> stream = std::make_shared<ScheduleExportStream>();
+    stream->manager = &this->scheduleManager;
+    stream->uids.reserve(scheduleList.size());
+    for (const auto& sf : scheduleList) stream->uids.push_back(sf.scheduleUID);
+
+    AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+        [stream](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            (void)index;
+            return stream->fill(buffer, maxLen);
+        });
+    this->addSecurityHeaders(response);
+    request->send(response);
+}
+
+/**
+ * @brief Closes and deletes the import spool file owned by a request. Safe to call more than once.
+ * @param request The owning request.
+ */
+void ApiRoutes::releaseImportSpool(AsyncWebServerRequest *request) {
+    if (this->importOwner != request) return;
+    if (this->importSpool) this->importSpool.close();
+    LittleFS.remove(SCHEDULE_IMPORT_SPOOL_PATH);
+    this->importOwner = nullptr;
+}
+
+/**
+ * @brief Validates one item of a bulk import and builds the schedule to save.
+ *
+ * An item with a known `scheduleUID` updates that schedule; it is rejected if the
+ * schedule is locked by a template/cycle, run by the current step of an active cycle
+ * or being edited by another session (no edit lock is taken). An unknown but well-formed `scheduleUID` is created as given, so an
+ * export restores with its UIDs; without one a new UID is generated. Events go through
+ * ScheduleManager::validateAndAddEvent()/validateAndAddEvents() (bounds, overlaps and
+ * the event limit), one call per event list.
+ *
+ * @param item The schedule object from the import array.
+ * @param session The importing session.
+ * @param schedule Receives the validated schedule.
+ * @param error Receives the reason if the item is rejected.
+ * @return True if the schedule is valid and may be saved.
+ */
+bool ApiRoutes::buildImportedSchedule(JsonObject item, const SessionData& session, Schedule& schedule, String& error) {
+    if (item.isNull()) { error = "Item is not a JSON object"; return false; }
+    String uid = item["scheduleUID"] | "";
+    String name = item["scheduleName"] | (item["name"] | "");
+
+    schedule = Schedule();
+    if (uid.isEmpty()) {
+        if (!this->scheduleManager.createSchedule(name, schedule)) { error = "Missing scheduleName"; return false; }
+    } else {
+        if (!isValidScheduleUID(uid)) { error = "Invalid scheduleUID"; return false; }
+        int persistentLockLevel = this->scheduleManager.getPersistentLockLevel(uid);
+        if (persistentLockLevel == 1 || persistentLockLevel == 2) { error = "Schedule is locked by a template or active cycle"; return false; }
+        // Same rule as LockManager::acquireLock(): a running cycle step's schedule stays as it is
+        if (cycleManager.isResourceInActiveCycle("schedule_" + uid)) { error = "Schedule is run by an active cycle"; return false; }
+        FileLock lockInfo;
+        if (this->lockManager.isLocked("schedule_" + uid, &lockInfo) && lockInfo.sessionId != session.sessionId) {
+            error = "Schedule is currently being edited by " + lockInfo.username;
+            return false;
+        }
+        if (name.isEmpty() && persistentLockLevel >= 0) {
+            ScheduleSnapshot existing = this->scheduleManager.getSchedule(uid);
+            if (existing) name = existing->scheduleName; // Keep the name, as PUT does
+        }
+        if (name.isEmpty()) { error = "Missing scheduleName"; return false; }
+        schedule.scheduleUID = uid;
+        schedule.scheduleName = name;
+    }
+    schedule.lightsOnTime = item["lightsOnTime"] | 0;
+    schedule.lightsOffTime = item["lightsOffTime"] | 0;
+
+    JsonArray apArray = item["autopilotWindows"];
+    size_t apIndex = 0;
+    for (JsonObject apObj : apArray) {
+        AutopilotWindow apw; apw.startTime = apObj["startTime"] | 0; apw.endTime = apObj["endTime"] | 0; apw.matricTension = apObj["matricTension"] | 0.0f; apw.doseVolume = apObj["doseVolume"] | 0; apw.settlingTime = apObj["settlingTime"] | 0; apw.doseDuration = apObj["doseDuration"] | 0;
+        if (!this->scheduleManager.validateAndAddEvent(schedule, apw)) {
+            error = "autopilotWindows[" + String(apIndex) + "] is invalid or overlaps another window";
+            return false;
+        }
+        ++apIndex;
+    }
+    std::vector<DurationEvent> durations;
+    JsonArray durArray = item["durationEvents"];
+    for (JsonObject durObj : durArray) {
+        DurationEvent de; de.startTime = durObj["startTime"] | 0; de.duration = durObj["duration"] | 0; de.endTime = de.startTime + (int)ceil(de.duration / 60.0); if (de.endTime > 1439) de.endTime = 1439;
+        durations.push_back(de);
+    }
+    if (!durations.empty() && !this->scheduleManager.validateAndAddEvents(schedule, durations)) {
+        error = "durationEvents are invalid, overlap or exceed the event limit";
+        return false;
+    }
+    std::vector<VolumeEvent> volumes;
+    JsonArray volArray = item["volumeEvents"];
+    for (JsonObject volObj : volArray) {
+        VolumeEvent ve; ve.startTime = volObj["startTime"] | 0; ve.doseVolume = volObj["doseVolume"] | 0;
+        volumes.push_back(ve);
+    }
+    if (!volumes.empty() && !this->scheduleManager.validateAndAddEvents(schedule, volumes)) {
+        error = "volumeEvents are invalid, overlap or exceed the event limit";
+        return false;
+    }
+    if (!schedule.isValid()) { error = "Invalid schedule"; return false; }
+    return true;
+}
+
+// Body handler for POST /api/schedules/import
+/**
+ * @brief Handles the body of POST requests to /api/schedules/import.
+ *
+ * The body is a JSON array of schedule objects (the format of GET /api/schedules/export).
+ * The session is validated once, on the first chunk, before anything is spooled; chunks
+ * are appended to SCHEDULE_IMPORT_SPOOL_PATH. On the last chunk the spool is handed to
+ * the PersistenceWorker (runScheduleImport), which parses the array one element at a
+ * time, validates each schedule and writes its files once, and commits the schedule
+ * index once at the end (ScheduleManager bulk save); the response is a DeferredResponse
+ * sent when the job is done. Items fail individually; a JSON syntax error stops the
+ * import at that item (earlier items stay saved). Requires MANAGER or ADMIN role.
+ *
+ * Responds 200 with `{"results":[{"index":i,"scheduleUID":...}|{"index":i,"error":...}],"saved":n,"failed":m,"indexSaved":b}`;
+ * 401/403 for the session, 400 if the body is not an array, 409 if another import is
+ * being received or run, 413 if the body exceeds SCHEDULE_IMPORT_MAX_SIZE, 503 if the
+ * persistence queue is full, 507 if it does not fit in flash.
+ *
+ * @param request Pointer to the AsyncWebServerRequest object.
+ * @param data Pointer to the current chunk of body data.
+ * @param len Length of the current data chunk.
+ * @param index Starting index of the current data chunk in the total body.
+ * @param total Total expected length of the request body.
+ */
+void ApiRoutes::handleScheduleImportBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+    if (index == 0) {
+        SessionData session = this->sessionManager.validateSession(request);
+        if (!session.isValid()) { request->send(401, "application/json", "{\"error\":\"Not authenticated\"}"); return; }
+        if (session.userRole < MANAGER) { request->send(403, "application/json", "{\"error\":\"Permission denied\"}"); return; }
+        if (total > SCHEDULE_IMPORT_MAX_SIZE) { request->send(413, "text/plain", "Payload Too Large"); return; }
+        if (this->importOwner || this->importRunning) { request->send(409, "application/json", "{\"error\":\"Another schedule import is in progress\"}"); return; }
+        if (LittleFS.totalBytes() - LittleFS.usedBytes() < total * 2) { // Spool plus the schedule files it turns into
+            request->send(507, "application/json", "{\"error\":\"Not enough flash space for this import\"}");
+            return;
+        }
+        this->importSpool = LittleFS.open(SCHEDULE_IMPORT_SPOOL_PATH, "w");
+        if (!this->importSpool) { request->send(500, "application/json", "{\"error\":\"Failed to open import spool\"}"); return; }
+        this->importOwner = request;
+        request->onDisconnect([this, request]() { this->releaseImportSpool(request); });
+    }
+    if (this->importOwner != request) return; // First chunk was rejected, a response is already queued
+
+    if (this->importSpool.write(data, len) != len) {
+        this->releaseImportSpool(request);
+        request->send(507, "application/json", "{\"error\":\"Failed to spool import body\"}");
+        return;
+    }
+    runtimeMetrics.recordFsWrite(len);
+    if (index + len != total) return;
+
+    // --- Last chunk: hand the spool to the PersistenceWorker ---
+    this->importSpool.close();
+    std::shared_ptr<PendingImport> pending = std::make_shared<PendingImport>();
+    pending->routes = this;
+    pending->session = this->sessionManager.validateSession(request);
+    if (!pending->session.isValid()) { this->releaseImportSpool(request); request->send(401, "application/json", "{\"error\":\"Not authenticated\"}"); return; }
+    this->importOwner = nullptr; // The spool now belongs to the job, which removes it
+    this->importRunning = true;
+    std::shared_ptr<PendingImport>* context = new std::shared_ptr<PendingImport>(pending);
+    if (!persistenceWorker.submit(&ApiRoutes::scheduleImportJob, context)) {
+        delete context;
+        LittleFS.remove(SCHEDULE_IMPORT_SPOOL_PATH);
+        this->importRunning = false;
+        request->send(503, "application/json", "{\"error\":\"Persistence queue full, try again\"}");
+        return;
+    }
+    request->send(new DeferredResponse([this, pending](AsyncWebServerRequest* r) -> AsyncWebServerResponse* {
+        if (!pending->done.load(std::memory_order_acquire)) return nullptr;
+        AsyncWebServerResponse* response = r->beginResponse(pending->status, "application/json", pending->body);
+        this->addSecurityHeaders(response);
+        return response;
+    }));
+}
+
+/**
+ * @brief PersistenceWorker job of a bulk import: runs it, then publishes the result.
+ *
+ * Always removes the spool and clears importRunning, also when the client has gone
+ * (the result is then simply dropped with the last reference).
+ *
+ * @param context Heap-allocated std::shared_ptr<PendingImport>, deleted here.
+ */
+void ApiRoutes::scheduleImportJob(void* context) {
+    std::shared_ptr<PendingImport>* holder = static_cast<std::shared_ptr<PendingImport>*>(context);
+    std::shared_ptr<PendingImport> pending = *holder;
+    delete holder;
+    ApiRoutes* routes = pending->routes;
+    routes->runScheduleImport(*pending);
+    LittleFS.remove(SCHEDULE_IMPORT_SPOOL_PATH);
+    routes->importRunning = false;
+    pending->done.store(true, std::memory_order_release);
+}
+
+/**
+ * @brief Parses the import spool and saves one schedule at a time (PersistenceWorker task).
+ *
+ * Fills in @p pending's status and body: 200 with the results document, or 400 if
+ * the spool does not hold a JSON array. Never touches the request.
+ *
+ * @param pending The import; its session was validated when the upload completed.
+ */
+void ApiRoutes::runScheduleImport(PendingImport& pending) {
+    RouteTimer routeTimer(MetricRoute::SCHEDULE_IMPORT);
+    File spool = LittleFS.open(SCHEDULE_IMPORT_SPOOL_PATH, "r");
+    if (spool) runtimeMetrics.recordFsRead(spool.size());
+    if (!spool || !spool.find("[")) {
+        if (spool) spool.close();
+        pending.status = 400;
+        pending.body = "{\"error\":\"Body must be a JSON array of schedules\"}";
+        return;
+    }
+
+    String& out = pending.body;
+    out = "{\"results\":[";
+    JsonDocument item;
+    JsonDocument result;
+    std::vector<String> batchUids; // UIDs saved by this import (duplicates, generated UID clashes)
+    size_t saved = 0, failed = 0, itemIndex = 0;
+    while (spool.available() && isspace(spool.peek())) spool.read();
+    bool more = spool.available() && spool.peek() != ']';
+
+    this->scheduleManager.beginBulkSave();
+    while (more) {
+        DeserializationError parseError = deserializeJson(item, spool);
+        result.clear();
+        result["index"] = itemIndex;
+        if (parseError) {
+            result["error"] = String("Invalid JSON: ") + parseError.c_str() + "; import stopped";
+            more = false;
+        } else {
+            Schedule schedule;
+            String error;
+            bool generated = String(item["scheduleUID"] | "").isEmpty();
+            if (this->buildImportedSchedule(item.as<JsonObject>(), pending.session, schedule, error)) {
+                auto inBatch = [&batchUids](const String& uid) {
+                    return std::find(batchUids.begin(), batchUids.end(), uid) != batchUids.end();
+                };
+                if (generated) {
+                    String base = schedule.scheduleUID;
+                    for (int n = 2; inBatch(schedule.scheduleUID) || this->scheduleManager.getPersistentLockLevel(schedule.scheduleUID) >= 0; ++n) {
+                        schedule.scheduleUID = base + "_" + String(n);
+                    }
+                }
+                if (inBatch(schedule.scheduleUID)) {
+                    error = "Duplicate scheduleUID in import";
+                } else if (!this->scheduleManager.saveSchedule(schedule)) {
+                    error = "Failed to save schedule file";
+                } else {
+                    batchUids.push_back(schedule.scheduleUID);
+                }
+            }
+            if (error.isEmpty()) {
+                result["scheduleUID"] = schedule.scheduleUID;
+                ++saved;
+            } else {
+                result["error"] = error;
+            }
+            more = spool.findUntil(",", "]");
+        }
+        if (!result["error"].isNull()) ++failed;
+        if (itemIndex > 0) out += ',';
+        serializeJson(result, out); // Appends
+        ++itemIndex;
+    }
+    bool indexSaved = this->scheduleManager.endBulkSave();
+    spool.close();
+
+    char tail[64];
+    snprintf(tail, sizeof(tail), "],\"saved\":%u,\"failed\":%u,\"indexSaved\":%s}", (unsigned)saved, (unsigned)failed, indexSaved ? "true" : "false");
+    out += tail;
+    pending.status = 200;
+    SCH_API_DEBUG_PRINTF("API: handleScheduleImportBody - %u saved, %u failed.\n", (unsigned)saved, (unsigned)failed);
+}
+
+
 // Method to register all API routes
 /**
  * @brief Registers all API routes with the provided AsyncWebServer instance.
  *
  * Sets up handlers for authentication (/api/login, /api/logout), user information
- * (/api/user), and schedule management (/api/schedules, /api/schedule, /api/schedule/lock).
+ * (/api/user), and schedule management (/api/schedules, /api/schedule, /api/schedule/lock,
+ * bulk /api/schedules/export and /api/schedules/import).
  * Uses lambdas to capture the 'this' pointer, allowing member functions to be used
  * as request handlers. Also registers the static file server for the web interface
  * located in the "/www/" directory within the LittleFS filesystem.
@@ -671,6 +1391,27 @@ void ApiRoutes::registerRoutes(AsyncWebServer& server) {
     server.on("/api/user", HTTP_GET, [this](AsyncWebServerRequest *request) {
         this->handleGetUserInfo(request);
     });
+    server.on("/api/logs", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        this->handleGetLogs(request);
+    });
+    server.on("/api/metrics", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        this->handleGetMetrics(request);
+    });
+    server.on("/api/history", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        this->handleGetHistory(request);
+    });
+
+    // Bulk schedule routes, ahead of /api/schedules (which would also match them as a prefix)
+    server.on("/api/schedules/export", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        this->handleScheduleExport(request);
+    });
+    server.on("/api/schedules/import", HTTP_POST,
+        [](AsyncWebServerRequest *request){ /* Response is sent by the body handler */ },
+        NULL,
+        [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+            this->handleScheduleImportBody(request, data, len, index, total);
+        }
+    );
 
     // Schedule API Routes
     server.on("/api/schedules", HTTP_GET, [this](AsyncWebServerRequest *request) {
@@ -703,10 +1444,20 @@ void ApiRoutes::registerRoutes(AsyncWebServer& server) {
         this->handleDeleteSchedule(request); // Delete one by ?uid=...
     });
 
-    // Serve static files from /www directory - Keep this registration logic here for now
-    // It was part of the original registerRoutes function.
+    // Push channel (Server-Sent Events): one serialized delta per change for all open pages,
+    // instead of each page polling the REST endpoints. Same session cookie as the API.
+    liveEvents.attach(server, [this](AsyncWebServerRequest *request) {
+        return this->sessionManager.validateSession(request).isValid();
+    });
+
+    // Serve static files from /www directory. Images built with tools/build_www.py hold
+    // gzip copies plus a manifest; those are served with ETags and revalidated from RAM.
+    // serveStatic stays registered behind it for anything not in the manifest.
     API_DEBUG_PRINTLN("Registering static file serving for /www");
-    server.serveStatic("/", LittleFS, "/www/").setDefaultFile("index.html");
+    if (this->staticAssets.begin(LittleFS, "/www")) {
+        server.addHandler(&this->staticAssets);
+    }
+    server.serveStatic("/", LittleFS, "/www/").setDefaultFile("index.html").setCacheControl(STATIC_ASSET_REVALIDATE_CACHE);
 
     API_DEBUG_PRINTLN("API routes registration complete.");
 }
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include "AtomicFile.h"
+#include "RuntimeMetrics.h" // LittleFS op counters
+#include <LittleFS.h>
+#include <esp_rom_crc.h>
+#include <memory>
+#include <new>
+
+extern RuntimeMetrics runtimeMetrics;
+
+namespace {
+const char kCrcTrailerPrefix[] = "\n#crc32=";
+
+// Parses "\n#crc32=xxxxxxxx\n" at @p tail (ATOMIC_FILE_CRC_TRAILER_LENGTH bytes)
+bool parseCrcTrailer(const uint8_t* tail, uint32_t& crc) {
+    const size_t prefixLength = sizeof(kCrcTrailerPrefix) - 1;
+    if (memcmp(tail, kCrcTrailerPrefix, prefixLength) != 0) return false;
+    if (tail[ATOMIC_FILE_CRC_TRAILER_LENGTH - 1] != '\n') return false;
+    crc = 0;
+    for (size_t i = prefixLength; i < prefixLength + 8; ++i) {
+        char c = (char)tail[i];
+        uint8_t nibble;
+        if (c >= '0' && c <= '9') nibble = c - '0';
+        else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+        else return false;
+        crc = (crc << 4) | nibble;
+    }
+    return true;
+}
+
+FileReadResult readJsonFileAt(const String& path, JsonDocument& doc, size_t* fileSize) {
+    if (!LittleFS.exists(path)) return FileReadResult::NOT_FOUND; // Avoids the VFS "does not exist" error log
+    File file = LittleFS.open(path, "r");
+    if (!file) return FileReadResult::CORRUPT;
+    size_t size = file.size();
+    if (fileSize) *fileSize = size;
+    if (size == 0) {
+        file.close();
+        doc.clear();
+        return FileReadResult::OK; // Empty file: valid, null document
+    }
+
+    std::unique_ptr<uint8_t[]> buffer;
+    if (size <= ATOMIC_FILE_MAX_BUFFERED_READ) {
+        buffer.reset(new (std::nothrow) uint8_t[size]);
+    }
+    if (!buffer) {
+        // Too large (or no memory) for one buffer: parse from the stream, trailer unchecked
+        DeserializationError error = deserializeJson(doc, file);
+        runtimeMetrics.recordFsRead(size);
+        file.close();
+        if (error) {
+            Serial.printf("Failed to parse %s: %s\n", path.c_str(), error.c_str());
+            return FileReadResult::CORRUPT;
+        }
+        return FileReadResult::OK;
+    }
+
+    size_t got = file.read(buffer.get(), size);
+    file.close();
+    runtimeMetrics.recordFsRead(got);
+    if (got != size) {
+        Serial.printf("Short read on %s (%u of %u bytes).\n", path.c_str(), (unsigned)got, (unsigned)size);
+        return FileReadResult::CORRUPT;
+    }
+
+    size_t jsonLength = size;
+    uint32_t storedCrc;
+    if (size >= ATOMIC_FILE_CRC_TRAILER_LENGTH
+        && parseCrcTrailer(buffer.get() + size - ATOMIC_FILE_CRC_TRAILER_LENGTH, storedCrc)) {
+        jsonLength = size - ATOMIC_FILE_CRC_TRAILER_LENGTH;
+        uint32_t crc = esp_rom_crc32_le(0, buffer.get(), jsonLength);
+        if (crc != storedCrc) {
+            Serial.printf("CRC mismatch on %s (stored %08lx, computed %08lx).\n",
+                          path.c_str(), (unsigned long)storedCrc, (unsigned long)crc);
+            return FileReadResult::CORRUPT;
+        }
+    }
+
+    DeserializationError error = deserializeJson(doc, (const char*)buffer.get(), jsonLength);
+    if (error) {
+        Serial.printf("Failed to parse %s: %s\n", path.c_str(), error.c_str());
+        return FileReadResult::CORRUPT;
+    }
+    return FileReadResult::OK;
+}
+} // namespace
+
+// --- AtomicFileWriter Implementation ---
+
+AtomicFileWriter::AtomicFileWriter(bool withCrc) : _withCrc(withCrc) {}
+
+AtomicFileWriter::~AtomicFileWriter() {
+    abort();
+}
+
+/**
+ * @brief Creates (truncates) the temporary file for @p path.
+ * @return False if the temporary file cannot be created.
+ */
+bool AtomicFileWriter::open(const String& path) {
+    abort();
+    _path = path;
+    _tempPath = path + ATOMIC_FILE_TEMP_SUFFIX;
+    _file = LittleFS.open(_tempPath, "w");
+    if (!_file) {
+        Serial.printf("Failed to open %s for writing.\n", _tempPath.c_str());
+        return false;
+    }
+    _open = true;
+    _failed = false;
+    _crc = 0;
+    _total = 0;
+    _used = 0;
+    return true;
+}
+
+size_t AtomicFileWriter::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t AtomicFileWriter::write(const uint8_t* buffer, size_t size) {
+    if (!_open || _failed) return 0;
+    size_t remaining = size;
+    while (remaining > 0) {
+        size_t room = ATOMIC_FILE_CHUNK_SIZE - _used;
+        size_t n = remaining < room ? remaining : room;
+        memcpy(_buffer + _used, buffer, n);
+        _used += n;
+        buffer += n;
+        remaining -= n;
+        if (_used == ATOMIC_FILE_CHUNK_SIZE && !flushBuffer()) return 0;
+    }
+    return size;
+}
+
+// Hands the buffered chunk to LittleFS and folds it into the CRC
+bool AtomicFileWriter::flushBuffer() {
+    if (_used == 0) return true;
+    if (_withCrc) _crc = esp_rom_crc32_le(_crc, _buffer, _used);
+    size_t written = _file.write(_buffer, _used);
+    _total += written;
+    if (written != _used) {
+        _failed = true;
+        return false;
+    }
+    _used = 0;
+    return true;
+}
+
+bool AtomicFileWriter::commit() {
+    if (!_open) return false;
+    bool ok = !_failed && flushBuffer();
+    if (ok && _withCrc) {
+        char trailer[ATOMIC_FILE_CRC_TRAILER_LENGTH + 1];
+        snprintf(trailer, sizeof(trailer), "%s%08lx\n", kCrcTrailerPrefix, (unsigned long)_crc);
+        size_t written = _file.write((const uint8_t*)trailer, ATOMIC_FILE_CRC_TRAILER_LENGTH);
+        _total += written;
+        ok = (written == ATOMIC_FILE_CRC_TRAILER_LENGTH);
+    }
+    _file.close();
+    _open = false;
+    runtimeMetrics.recordFsWrite(_total);
+    if (!ok) {
+        Serial.printf("Write to %s failed; keeping the previous file.\n", _tempPath.c_str());
+        LittleFS.remove(_tempPath);
+        return false;
+    }
+
+    // LittleFS replaces an existing target atomically. Fall back to remove + rename if
+    // the VFS refuses; readJsonFile() recovers the temp file if power fails in between.
+    if (!LittleFS.rename(_tempPath, _path)) {
+        LittleFS.remove(_path);
+        if (!LittleFS.rename(_tempPath, _path)) {
+            Serial.printf("Failed to rename %s to %s.\n", _tempPath.c_str(), _path.c_str());
+            LittleFS.remove(_tempPath);
+            return false;
+        }
+    }
+    return true;
+}
+
+void AtomicFileWriter::abort() {
+    if (!_open) return;
+    _file.close();
+    _open = false;
+    LittleFS.remove(_tempPath);
+}
+
+// --- Free functions ---
+
+bool writeJsonFileAtomic(const String& path, const JsonDocument& doc, bool withCrc, size_t* fileSize) {
+    AtomicFileWriter writer(withCrc);
+    if (!writer.open(path)) return false;
+    if (serializeJson(doc, writer) == 0) {
+        Serial.printf("Failed to serialize JSON for %s.\n", path.c_str());
+        return false; // Writer destructor discards the temp file
+    }
+    if (!writer.commit()) return false;
+    if (fileSize) *fileSize = writer.fileSize();
+    return true;
+}
+
+FileReadResult readJsonFile(const String& path, JsonDocument& doc, size_t* fileSize) {
+    FileReadResult result = readJsonFileAt(path, doc, fileSize);
+    if (result != FileReadResult::NOT_FOUND) return result;
+
+    // The target can only be missing next to a temp file if the fallback rename was
+    // interrupted; a temp file that still parses (and passes its CRC) is complete.
+    String tempPath = path + ATOMIC_FILE_TEMP_SUFFIX;
+    if (!LittleFS.exists(tempPath)) return FileReadResult::NOT_FOUND;
+    result = readJsonFileAt(tempPath, doc, fileSize);
+    if (result == FileReadResult::OK && !doc.isNull()) {
+        if (LittleFS.rename(tempPath, path)) {
+            Serial.printf("Recovered %s from its temporary copy.\n", path.c_str());
+        }
+        return FileReadResult::OK;
+    }
+    return FileReadResult::NOT_FOUND;
+}
@@ -88,10 +88,10 @@ namespace AuthUtils {
      * @param password The plain text password String to hash.
      * @param saltHex The hexadecimal String representation of the salt to use.
      * @return A String containing the hexadecimal representation of the SHA-256 hash,
-     *         or an empty string if the salt is invalid or memory allocation fails.
+     *         or an empty string if the salt is invalid or longer than AUTH_MAX_SALT_BYTES.
      */
     String hashPassword(const String& password, const String& saltHex) {
-        unsigned char saltBytes[saltHex.length() / 2];
+        unsigned char saltBytes[AUTH_MAX_SALT_BYTES];
         size_t saltLen = hexToBytes(saltHex, saltBytes, sizeof(saltBytes));
 
         if (saltLen == 0) {
@@ -99,29 +99,17 @@ namespace AuthUtils {
             return "";
         }
 
-        // Combine password and salt: salt + password
+        // SHA-256 over salt + password. Fed as two updates, so no combined buffer is allocated.
         // Using salt first is a common practice, though order impact is debated.
-        size_t combinedLen = saltLen + password.length();
-        unsigned char* combinedInput = new unsigned char[combinedLen];
-        if (!combinedInput) {
-             Serial.println("Error: Memory allocation failed for combined input.");
-             return "";
-        }
-
-        memcpy(combinedInput, saltBytes, saltLen);
-        memcpy(combinedInput + saltLen, password.c_str(), password.length());
-
-        // SHA-256 Hash
         unsigned char hashOutput[32]; // SHA-256 produces a 32-byte hash
         mbedtls_sha256_context ctx;
         mbedtls_sha256_init(&ctx);
         mbedtls_sha256_starts(&ctx, 0); // 0 for SHA-256, 1 for SHA-224
-        mbedtls_sha256_update(&ctx, combinedInput, combinedLen);
+        mbedtls_sha256_update(&ctx, saltBytes, saltLen);
+        mbedtls_sha256_update(&ctx, (const unsigned char*)password.c_str(), password.length());
         mbedtls_sha256_finish(&ctx, hashOutput);
         mbedtls_sha256_free(&ctx);
 
-        delete[] combinedInput; // Clean up combined input buffer
-
         // Convert hash to hex string
         return bytesToHex(hashOutput, sizeof(hashOutput));
     }
@@ -146,10 +134,15 @@ namespace AuthUtils {
             return false; // Error during hashing
         }
 
-        // Compare the calculated hash with the stored hash
-        // Use a constant-time comparison if possible, though String comparison here isn't strictly constant-time.
-        // For embedded systems, this level might be acceptable, but be aware.
-        return calculatedHashHex.equals(storedHashHex);
+        // Compare the calculated hash with the stored hash in constant time
+        if (calculatedHashHex.length() != storedHashHex.length()) {
+            return false;
+        }
+        unsigned char diff = 0;
+        for (unsigned i = 0; i < calculatedHashHex.length(); ++i) {
+            diff |= (unsigned char)(calculatedHashHex[i] ^ storedHashHex[i]);
+        }
+        return diff == 0;
     }
 
 } // namespace AuthUtils
\ No newline at end of file
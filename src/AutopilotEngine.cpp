@@ -0,0 +1,359 @@
+#include "AutopilotEngine.h"
+#include "TaskConfig.h"
+#include "ScheduleEngine.h" // Wall clock constants shared with the timeline engine
+#include "ScheduleManager.h"
+#include "InputPointManager.h"
+#include "OutputPointManager.h"
+#include "FlowMeterManager.h"
+#include "CycleManager.h" // Active cycles and their current steps
+#include "RuntimeMetrics.h"
+#include "DebugConfig.h" // LOGx macros
+#include <algorithm>
+#include <cfloat>
+#include <ctime>
+#include <esp_timer.h>
+
+// FreeRTOS includes
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+extern ScheduleManager scheduleManager;
+extern InputPointManager inputManager;
+extern OutputPointManager outputManager;
+extern FlowMeterManager flowMeterManager;
+extern CycleManager cycleManager;
+extern PointRegistry pointRegistry;
+extern RuntimeMetrics runtimeMetrics;
+
+namespace {
+// Scoped helper that holds the zone mutex (web server task on schedule saves vs. the autopilot task)
+struct ZoneGuard {
+    SemaphoreHandle_t mutex;
+    explicit ZoneGuard(void* m) : mutex((SemaphoreHandle_t)m) {
+        if (mutex) xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+    ~ZoneGuard() {
+        if (mutex) xSemaphoreGive(mutex);
+    }
+};
+
+const uint32_t SECONDS_PER_DAY = 24UL * 60 * 60;
+} // namespace
+
+bool AutopilotEngine::begin() {
+    if (taskHandle) {
+        return true;
+    }
+    zoneMutex = xSemaphoreCreateMutex();
+    if (!zoneMutex) {
+        Serial.println("[Autopilot] Failed to create zone mutex.");
+        return false;
+    }
+    // The task exists before the zones: their threshold watches notify its handle
+    BaseType_t taskCreated = xTaskCreatePinnedToCore(
+        taskWrapper,
+        "AutopilotTask",
+        4096,
+        this,
+        TASK_PRIORITY_AUTOPILOT,
+        (TaskHandle_t*)&taskHandle,
+        IO_CORE
+    );
+    if (taskCreated != pdPASS) {
+        taskHandle = nullptr;
+        Serial.println("[Autopilot] Failed to create autopilot task.");
+        return false;
+    }
+    {
+        ZoneGuard guard(zoneMutex);
+        loadZones();
+    }
+    xTaskNotify((TaskHandle_t)taskHandle, AUTOPILOT_WAKE_ALL, eSetBits);
+    Serial.printf("[Autopilot] Started with %u zone(s).\n", (unsigned)zoneCount());
+    return true;
+}
+
+// Every active cycle on a step with a schedule and an AUTOPILOT_CONTROL input becomes a zone
+// (CycleManager parsed the cycle files). Caller holds zoneMutex.
+void AutopilotEngine::loadZones() {
+    for (const CycleBinding& binding : cycleManager.currentBindings()) {
+        if (binding.scheduleUID.isEmpty() || binding.controlInputIds.empty()) continue;
+        addZone(binding.cycleId, binding.scheduleUID, binding.controlInputIds, binding.outputIds,
+                readWindows(binding.scheduleUID));
+    }
+}
+
+// Caller holds zoneMutex
+void AutopilotEngine::addZone(const String& cycleId, const String& scheduleUID, const std::vector<String>& inputIds,
+                              const std::vector<String>& outputIds, const std::vector<AutopilotWindow>& windows) {
+    size_t slot = 0;
+    while (slot < zones.size() && zones[slot].watchId >= 0) ++slot;
+    if (slot >= AUTOPILOT_MAX_ZONES) {
+        Serial.printf("[Autopilot] Too many zones, ignoring cycle %s (max %d).\n", cycleId.c_str(), AUTOPILOT_MAX_ZONES);
+        return;
+    }
+    AutopilotZone zone;
+    zone.cycleId = cycleId;
+    zone.scheduleUID = scheduleUID;
+    // First control input that exists on this board; later ones are backups for CycleManager
+    for (const String& id : inputIds) {
+        PointHandle handle = pointRegistry.resolve(id);
+        const PointEntry* entry = pointRegistry.get(handle);
+        if (entry && (entry->kind == PointKind::ANALOG_INPUT || entry->kind == PointKind::MODBUS_INPUT)) {
+            zone.input = handle;
+            break;
+        }
+    }
+    for (const String& id : outputIds) {
+        PointHandle handle = pointRegistry.resolve(id, PointKind::RELAY_OUTPUT);
+        if (handle != INVALID_POINT_HANDLE) zone.outputs.push_back(handle);
+    }
+    if (zone.input == INVALID_POINT_HANDLE || zone.outputs.empty()) {
+        Serial.printf("[Autopilot] Cycle %s has no usable control input or relay output, skipped.\n", cycleId.c_str());
+        return;
+    }
+    // Parked at FLT_MAX until a window is active, so the sensor never wakes the task outside windows
+    zone.watchId = inputManager.addThresholdWatch(zone.input, FLT_MAX, AUTOPILOT_TENSION_HYSTERESIS,
+                                                  taskHandle, 1UL << slot);
+    if (zone.watchId < 0) {
+        return;
+    }
+    zone.windows = windows;
+    if (slot < zones.size()) zones[slot] = zone;
+    else zones.push_back(zone);
+}
+
+// Frees the zone's slot (and its bit) for the next added zone. Caller holds zoneMutex.
+void AutopilotEngine::removeZone(AutopilotZone& zone) {
+    inputManager.removeThresholdWatch(zone.watchId);
+    zone = AutopilotZone();
+}
+
+// Caller holds zoneMutex
+AutopilotZone* AutopilotEngine::findZone(const String& cycleId) {
+    for (AutopilotZone& zone : zones) {
+        if (zone.watchId >= 0 && zone.cycleId == cycleId) return &zone;
+    }
+    return nullptr;
+}
+
+size_t AutopilotEngine::zoneCount() const {
+    ZoneGuard guard(zoneMutex);
+    size_t count = 0;
+    for (const AutopilotZone& zone : zones) count += zone.watchId >= 0 ? 1 : 0;
+    return count;
+}
+
+std::vector<AutopilotWindow> AutopilotEngine::readWindows(const String& scheduleUID) {
+    ScheduleSnapshot schedule = scheduleManager.getSchedule(scheduleUID);
+    if (!schedule) {
+        return std::vector<AutopilotWindow>();
+    }
+    std::vector<AutopilotWindow> windows = schedule->autopilotWindows;
+    std::sort(windows.begin(), windows.end(),
+              [](const AutopilotWindow& a, const AutopilotWindow& b) { return a.startTime < b.startTime; });
+    return windows;
+}
+
+void AutopilotEngine::onScheduleSaved(const String& scheduleUID) {
+    if (!taskHandle) return;
+    bool used = false;
+    {
+        ZoneGuard guard(zoneMutex);
+        for (const AutopilotZone& zone : zones) used = used || (zone.watchId >= 0 && zone.scheduleUID == scheduleUID);
+    }
+    if (!used) return;
+    std::vector<AutopilotWindow> windows = readWindows(scheduleUID); // Outside the mutex (flash read)
+    {
+        ZoneGuard guard(zoneMutex);
+        for (AutopilotZone& zone : zones) {
+            if (zone.scheduleUID != scheduleUID) continue;
+            zone.windows = windows;
+            zone.activeWindow = -2; // Forces the threshold to be re-armed
+        }
+    }
+    xTaskNotify((TaskHandle_t)taskHandle, AUTOPILOT_WAKE_ALL, eSetBits);
+}
+
+void AutopilotEngine::rebindCycle(const String& cycleId, const String& scheduleUID,
+                                  const std::vector<String>& inputIds, const std::vector<String>& outputIds) {
+    if (!taskHandle) return;
+    bool controlled = !scheduleUID.isEmpty() && !inputIds.empty();
+    std::vector<AutopilotWindow> windows;
+    if (controlled) windows = readWindows(scheduleUID); // Outside the mutex (flash read)
+    {
+        ZoneGuard guard(zoneMutex);
+        AutopilotZone* zone = findZone(cycleId);
+        if (!controlled) {
+            if (zone) removeZone(*zone); // No step (or no control input) any more
+        } else if (!zone) {
+            addZone(cycleId, scheduleUID, inputIds, outputIds, windows); // Came onto a step with a schedule
+        } else {
+            zone->scheduleUID = scheduleUID;
+            zone->windows = windows;
+            zone->activeWindow = -2;
+            zone->settling = false;
+        }
+    }
+    xTaskNotify((TaskHandle_t)taskHandle, AUTOPILOT_WAKE_ALL, eSetBits);
+}
+
+void AutopilotEngine::taskWrapper(void* parameter) {
+    static_cast<AutopilotEngine*>(parameter)->task();
+}
+
+void AutopilotEngine::task() {
+    uint32_t bits = AUTOPILOT_WAKE_ALL;
+    bool clockWarningShown = false;
+    std::vector<OutputCommand> commands;
+    std::vector<uint32_t> reactionStarts;
+    std::vector<AutopilotDoseLog> doseLogs;
+    while (true) {
+        uint32_t sleepMs = SCHEDULE_ENGINE_MAX_SLEEP_MS;
+        time_t now = time(nullptr);
+        if (now < SCHEDULE_ENGINE_MIN_VALID_EPOCH) {
+            if (!clockWarningShown) {
+                Serial.println("[Autopilot] Wall clock not set; autopilot windows are paused until it is.");
+                clockWarningShown = true;
+            }
+            bits |= AUTOPILOT_WAKE_ALL; // Evaluate everything once the clock is set
+            sleepMs = SCHEDULE_ENGINE_CLOCK_RETRY_MS;
+        } else {
+            clockWarningShown = false;
+            struct tm local;
+            localtime_r(&now, &local);
+            uint32_t secondOfDay = (uint32_t)(local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec);
+            uint32_t nowMs = millis();
+            {
+                ZoneGuard guard(zoneMutex);
+                for (size_t i = 0; i < zones.size(); ++i) {
+                    AutopilotZone& zone = zones[i];
+                    if (zone.watchId < 0) continue; // Free slot
+                    bool due = (bits & (AUTOPILOT_WAKE_ALL | (1UL << i))) || (int32_t)(nowMs - zone.wakeAtMs) >= 0;
+                    if (due) {
+                        zone.wakeAtMs = nowMs + evaluateZone(zone, secondOfDay, nowMs, commands, reactionStarts, doseLogs);
+                    }
+                    int32_t untilWake = (int32_t)(zone.wakeAtMs - nowMs);
+                    sleepMs = std::min(sleepMs, (uint32_t)std::max(untilWake, (int32_t)0));
+                }
+            }
+            bits = 0;
+
+            if (!commands.empty()) {
+                for (size_t start = 0; start < commands.size(); start += OUTPUT_COMMAND_QUEUE_LENGTH) {
+                    size_t end = std::min(commands.size(), start + (size_t)OUTPUT_COMMAND_QUEUE_LENGTH);
+                    std::vector<OutputCommand> chunk(commands.begin() + start, commands.begin() + end);
+                    if (!outputManager.sendCommands(chunk)) {
+                        Serial.printf("[Autopilot] Failed to queue %u dose command(s).\n", (unsigned)chunk.size());
+                    }
+                }
+                uint32_t queuedUs = (uint32_t)esp_timer_get_time();
+                for (uint32_t crossedUs : reactionStarts) {
+                    runtimeMetrics.recordAutopilotReaction(queuedUs - crossedUs);
+                }
+                commands.clear();
+                reactionStarts.clear();
+            }
+            // Logged only now: formatting stays off the crossing -> valve command path
+            for (const AutopilotDoseLog& log : doseLogs) {
+                if (log.dosed) {
+                    LOGI(SCHEDULE, "Autopilot %s: tension %.2f >= %.2f, dosing %lu mL / %d s (dose #%lu).", log.cycleId.c_str(),
+                         log.tension, log.threshold, (unsigned long)log.volumeMl, log.doseDuration, (unsigned long)log.doses);
+                } else {
+                    LOGI(SCHEDULE, "Autopilot %s: window at %02d:%02d has no doseDuration (or metered doseVolume); settling only.",
+                         log.cycleId.c_str(), log.windowStart / 60, log.windowStart % 60);
+                }
+            }
+            doseLogs.clear();
+        }
+
+        // Sleep until a watch reports a crossing, a settling period / window boundary is due,
+        // or schedules change
+        uint32_t received = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &received, pdMS_TO_TICKS(sleepMs));
+        bits |= received;
+    }
+}
+
+/**
+ * @brief Re-arms the zone's threshold for the current window and doses if it reads dry.
+ * @return Milliseconds until the zone needs a timer-driven look again (settling end or the
+ *         next window boundary); crossings in between wake it through its watch.
+ */
+uint32_t AutopilotEngine::evaluateZone(AutopilotZone& zone, uint32_t secondOfDay, uint32_t nowMs,
+                                       std::vector<OutputCommand>& commands, std::vector<uint32_t>& reactionStarts,
+                                       std::vector<AutopilotDoseLog>& doseLogs) {
+    uint32_t minute = secondOfDay / 60;
+    int window = -1;
+    uint32_t boundarySecond = SECONDS_PER_DAY;
+    for (size_t w = 0; w < zone.windows.size(); ++w) {
+        const AutopilotWindow& candidate = zone.windows[w];
+        if (minute < (uint32_t)candidate.startTime) {
+            boundarySecond = (uint32_t)candidate.startTime * 60;
+            break;
+        }
+        if (minute < (uint32_t)candidate.endTime) {
+            window = (int)w;
+            boundarySecond = (uint32_t)candidate.endTime * 60;
+            break;
+        }
+    }
+    if (window != zone.activeWindow) {
+        zone.activeWindow = window;
+        inputManager.setWatchThreshold(zone.watchId, window >= 0 ? zone.windows[window].matricTension : FLT_MAX);
+    }
+    uint32_t untilBoundaryMs = (boundarySecond - secondOfDay) * 1000UL;
+
+    if (zone.settling) {
+        int32_t remaining = (int32_t)(zone.settleUntilMs - nowMs);
+        if (remaining > 0) return std::min(untilBoundaryMs, (uint32_t)remaining);
+        zone.settling = false;
+    }
+    if (window < 0 || !inputManager.isAboveThreshold(zone.watchId)) {
+        return untilBoundaryMs;
+    }
+
+    const AutopilotWindow& active = zone.windows[window];
+    // Metered relays dose doseVolume mL (doseDuration is then the safety margin), others doseDuration s
+    size_t queuedBefore = commands.size();
+    uint32_t volumeMl = active.doseVolume > 0.0f ? (uint32_t)std::max(1L, lroundf(active.doseVolume)) : 0;
+    for (PointHandle output : zone.outputs) {
+        OutputCommand cmd;
+        cmd.point = output;
+        if (volumeMl > 0 && flowMeterManager.meterForOutput(output) >= 0) {
+            cmd.commandType = RelayCommandType::TURN_ON_VOLUME;
+            cmd.volumeMl = volumeMl;
+            cmd.durationMs = active.doseDuration > 0 ? (uint32_t)active.doseDuration * 1000 * FLOW_DOSE_TIMEOUT_FACTOR
+                                                     : FLOW_DOSE_DEFAULT_TIMEOUT_MS;
+        } else if (active.doseDuration > 0) {
+            cmd.commandType = RelayCommandType::TURN_ON_TIMED;
+            cmd.durationMs = (uint32_t)active.doseDuration * 1000;
+        } else {
+            continue;
+        }
+        commands.push_back(cmd);
+    }
+    if (commands.size() > queuedBefore) {
+        uint32_t crossedUs = inputManager.watchCrossedUs(zone.watchId);
+        if (crossedUs != zone.handledCrossingUs) {
+            reactionStarts.push_back(crossedUs); // Re-doses after settling are not reactions
+            zone.handledCrossingUs = crossedUs;
+        }
+        ++zone.doses;
+    }
+    AutopilotDoseLog log;
+    log.cycleId = zone.cycleId;
+    log.tension = inputManager.getCurrentValue(zone.input);
+    log.threshold = active.matricTension;
+    log.volumeMl = volumeMl;
+    log.doseDuration = active.doseDuration;
+    log.dosed = commands.size() > queuedBefore;
+    log.doses = zone.doses;
+    log.windowStart = active.startTime;
+    doseLogs.push_back(log);
+    zone.settling = true;
+    uint32_t settleMs = (uint32_t)active.doseDuration * 1000UL + (uint32_t)active.settlingTime * 60000UL;
+    zone.settleUntilMs = nowMs + settleMs;
+    return std::min(untilBoundaryMs, settleMs);
+}
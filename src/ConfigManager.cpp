@@ -2,6 +2,8 @@
 #include <FS.h>
 #include <LittleFS.h>
 #include <ArduinoJson.h> // V7
+#include "AtomicFile.h" // Temp + rename writes, CRC-checked reads
+#include "ConfigSnapshot.h" // Binary snapshot of the parsed I/O configuration
 
 /**
  * @brief Constructs a ConfigManager object.
@@ -21,7 +23,7 @@ ConfigManager::ConfigManager(const char* configFilePath) : _configFilePath(confi
  * Attempts to open and read the configuration file from LittleFS.
  * If the file doesn't exist, it calls `createDefaultConfigFile()` to create one
  * with default settings.
- * If the file exists but cannot be opened or parsed (corrupted JSON), it logs
+ * If the file exists but cannot be opened or parsed (corrupted JSON or CRC mismatch), it logs
  * an error and attempts to create a default configuration file, overwriting the
  * potentially corrupted one.
  * Populates the internal `config` struct with values read from the file, using
@@ -33,28 +35,17 @@ ConfigManager::ConfigManager(const char* configFilePath) : _configFilePath(confi
  */
 bool ConfigManager::loadConfig() {
     Serial.printf("Attempting to load configuration from: %s\n", _configFilePath.c_str());
-    if (!LittleFS.exists(_configFilePath)) {
-        Serial.println("Config file not found. Creating default config.");
-        return createDefaultConfigFile();
-    }
-
-    File configFile = LittleFS.open(_configFilePath, "r");
-    if (!configFile) {
-        Serial.println("Failed to open config file for reading.");
-        return false;
-    }
-
     // V7: Use JsonDocument (or StaticJsonDocument if size is fixed)
     // StaticJsonDocument<1024> doc; // Example if using static
     JsonDocument doc;
 
-    // Deserialize the JSON document
-    DeserializationError error = deserializeJson(doc, configFile);
-    configFile.close(); // Close the file ASAP
-
-    if (error) {
-        Serial.print("deserializeJson() failed: ");
-        Serial.println(error.c_str());
+    // Read, CRC-check and deserialize the JSON document
+    FileReadResult result = readJsonFile(_configFilePath, doc);
+    if (result == FileReadResult::NOT_FOUND) {
+        Serial.println("Config file not found. Creating default config.");
+        return createDefaultConfigFile();
+    }
+    if (result != FileReadResult::OK || doc.isNull()) {
         Serial.println("Config file might be corrupted. Attempting to create default.");
         // Optionally, backup the corrupted file before overwriting
         return createDefaultConfigFile(); // Overwrite corrupted file with default
@@ -82,21 +73,15 @@ bool ConfigManager::loadConfig() {
 /**
  * @brief Saves the current application configuration to the specified file.
  *
- * Opens the configuration file in write mode (creating it if it doesn't exist,
- * truncating it if it does). Serializes the current state of the internal `config`
- * struct into JSON format and writes it to the file.
+ * Serializes the current state of the internal `config` struct into JSON and
+ * writes it through writeJsonFileAtomic() (temp file + rename, CRC trailer), so
+ * an interrupted save leaves the previous configuration in place.
  *
  * @return True if the configuration was saved successfully, false if file
  *         operations or JSON serialization failed.
  */
 bool ConfigManager::saveConfig() {
     Serial.printf("Attempting to save configuration to: %s\n", _configFilePath.c_str());
-    File configFile = LittleFS.open(_configFilePath, "w"); // Open for writing (creates if not exists, truncates if exists)
-    if (!configFile) {
-        Serial.println("Failed to open config file for writing.");
-        return false;
-    }
-
     // V7: Use JsonDocument (or StaticJsonDocument)
     // StaticJsonDocument<1024> doc;
     JsonDocument doc;
@@ -108,14 +93,12 @@ bool ConfigManager::saveConfig() {
     doc["ap_password"] = config.ap_password;
     // doc["device_name"] = config.device_name;
 
-    // Serialize JSON to file
-    if (serializeJson(doc, configFile) == 0) {
-        Serial.println("Failed to write to config file (serializeJson returned 0).");
-        configFile.close();
+    // Serialize JSON to a temp file and rename it into place (atomic, with CRC)
+    if (!writeJsonFileAtomic(_configFilePath, doc, true)) {
+        Serial.println("Failed to write to config file.");
         return false;
     }
 
-    configFile.close(); // Close the file
     Serial.println("Configuration saved successfully.");
     return true;
 }
@@ -152,10 +135,36 @@ bool ConfigManager::createDefaultConfigFile() {
 
 // === Step 2: I/O Foundation Methods ===
 
+bool ConfigManager::loadIOConfig(IOConfiguration& ioConfig) {
+    ConfigSourceStamp boardStamp, typesStamp;
+    if (!stampConfigSource(BOARD_CONFIG_PATH, boardStamp)) {
+        Serial.printf("Failed to open %s\n", BOARD_CONFIG_PATH);
+        return false;
+    }
+    stampConfigSource(RELAY_TYPES_PATH, typesStamp); // Optional; a missing file is stamped {0, 0}
+
+    uint32_t startMs = millis();
+    if (readConfigSnapshot(CONFIG_SNAPSHOT_PATH, boardStamp, typesStamp, ioConfig, outputTypes)) {
+        Serial.printf("I/O configuration loaded from snapshot in %lu ms.\n", (unsigned long)(millis() - startMs));
+        return true;
+    }
+
+    if (!loadBoardIOConfig(ioConfig)) {
+        return false;
+    }
+    if (typesStamp.size > 0 && !loadRelayTypes(outputTypes)) {
+        outputTypes.clear();
+    }
+    if (!writeConfigSnapshot(CONFIG_SNAPSHOT_PATH, boardStamp, typesStamp, ioConfig, outputTypes)) {
+        Serial.println("Config snapshot not written; the JSON is parsed again at the next boot.");
+    }
+    return true;
+}
+
 bool ConfigManager::loadBoardIOConfig(IOConfiguration& ioConfig) {
     ioConfig = IOConfiguration(); // Reset to defaults
 
-    File file = LittleFS.open("/board_config.json", "r");
+    File file = LittleFS.open(BOARD_CONFIG_PATH, "r");
     if (!file) {
         Serial.println("Failed to open /data/board_config.json");
         return false;
@@ -190,6 +199,11 @@ bool ConfigManager::loadBoardIOConfig(IOConfiguration& ioConfig) {
             ioConfig.directIO.relayOutputs.pins.latch = relayPins["latch"] | -1;
             ioConfig.directIO.relayOutputs.pins.oe = relayPins["oe"] | -1; 
         }
+        JsonArray gpioPins = relays["gpioPins"].is<JsonArray>() ? relays["gpioPins"].as<JsonArray>() : JsonArray();
+        ioConfig.directIO.relayOutputs.gpioPins.clear();
+        for (JsonVariant v : gpioPins) {
+            ioConfig.directIO.relayOutputs.gpioPins.push_back(v | -1);
+        }
     }
 
     // Parse digitalInputs
@@ -241,14 +255,101 @@ bool ConfigManager::loadBoardIOConfig(IOConfiguration& ioConfig) {
         ioConfig.directIO.analogOutputs.push_back(aoConfig);
     }
 
+    // Parse flowMeters (optional)
+    ioConfig.directIO.flowMeters.clear();
+    JsonArray flowMeters = directIO["flowMeters"].is<JsonArray>() ? directIO["flowMeters"].as<JsonArray>() : JsonArray();
+    for (JsonObject fm : flowMeters) {
+        DirectFlowMeterConfig fmConfig;
+        fmConfig.pointId = fm["pointId"] | "";
+        fmConfig.pin = fm["pin"] | -1;
+        fmConfig.pulsesPerLiter = fm["pulsesPerLiter"] | 0.0f;
+        fmConfig.outputPointId = fm["outputPointId"] | "";
+        ioConfig.directIO.flowMeters.push_back(fmConfig);
+    }
+
+    // Parse modbusInterfaces / modbusDevices (optional sections)
+    JsonArray modbusInterfaces = doc["modbusInterfaces"].is<JsonArray>() ? doc["modbusInterfaces"].as<JsonArray>() : JsonArray();
+    for (JsonObject mi : modbusInterfaces) {
+        ModbusInterfaceConfig miConfig;
+        miConfig.interfaceId = mi["interfaceId"] | "";
+        miConfig.uartPort = mi["uartPort"] | -1;
+        miConfig.baudRate = mi["baudRate"] | 9600L;
+        miConfig.config = mi["config"] | "SERIAL_8N1";
+        miConfig.txPin = mi["txPin"] | -1;
+        miConfig.rxPin = mi["rxPin"] | -1;
+        miConfig.rtsPin = mi["rtsPin"] | -1;
+        ioConfig.modbusInterfaces.push_back(miConfig);
+    }
+    JsonArray modbusDevices = doc["modbusDevices"].is<JsonArray>() ? doc["modbusDevices"].as<JsonArray>() : JsonArray();
+    for (JsonObject md : modbusDevices) {
+        ModbusDeviceConfig mdConfig;
+        mdConfig.deviceId = md["deviceId"] | "";
+        mdConfig.profileId = md["profileId"] | "";
+        mdConfig.interfaceId = md["interfaceId"] | "";
+        mdConfig.slaveAddress = md["slaveAddress"] | -1;
+        mdConfig.pollingIntervalMs = md["pollingIntervalMs"] | 10000L;
+        mdConfig.enabled = md["enabled"] | false;
+        mdConfig.overrideDescription = md["overrideDescription"] | "";
+        ioConfig.modbusDevices.push_back(mdConfig);
+    }
+
     Serial.println("Parsed directIO config from board_config.json successfully.");
     return true;
 }
 
+bool ConfigManager::loadModbusProfile(const String& profileId, ModbusDeviceProfile& profile) {
+    profile = ModbusDeviceProfile();
+    if (profileId.isEmpty() || profileId.indexOf('/') >= 0 || profileId.indexOf("..") >= 0) {
+        Serial.println("Invalid Modbus profileId");
+        return false;
+    }
+
+    String path = "/modbus_profiles/" + profileId + ".json";
+    File file = LittleFS.open(path, "r");
+    if (!file) {
+        Serial.printf("Failed to open Modbus profile %s\n", path.c_str());
+        return false;
+    }
+
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
+    if (error) {
+        Serial.printf("Failed to parse Modbus profile %s: %s\n", path.c_str(), error.c_str());
+        return false;
+    }
+
+    profile.profileId = doc["profileId"] | profileId.c_str();
+    profile.model = doc["model"] | "";
+    profile.manufacturer = doc["manufacturer"] | "";
+    profile.description = doc["description"] | "";
+    JsonArray points = doc["points"].is<JsonArray>() ? doc["points"].as<JsonArray>() : JsonArray();
+    for (JsonObject pt : points) {
+        ModbusProfilePoint point;
+        point.pointIdSuffix = pt["pointIdSuffix"] | "";
+        point.ioType = pt["ioType"] | "";
+        point.description = pt["description"] | "";
+        point.readOnly = pt["readOnly"] | false;
+        point.updateIntervalMs = pt["updateIntervalMs"] | 0L;
+        JsonObject mb = pt["modbus"];
+        if (!mb.isNull()) {
+            point.modbus.registerType = mb["registerType"] | "";
+            point.modbus.address = mb["address"] | -1;
+            point.modbus.dataType = mb["dataType"] | "UINT16";
+            point.modbus.scaleFactor = mb["scaleFactor"] | 1.0f;
+            point.modbus.offset = mb["offset"] | 0.0f;
+            point.modbus.units = mb["units"] | "";
+            point.modbus.wordOrder = mb["wordOrder"] | "BigEndian";
+        }
+        profile.points.push_back(point);
+    }
+    return true;
+}
+
 bool ConfigManager::loadRelayTypes(std::vector<OutputTypeDefinition>& outputTypes) {
     outputTypes.clear();
 
-    File file = LittleFS.open("/data/relay_types.json", "r");
+    File file = LittleFS.open(RELAY_TYPES_PATH, "r");
     if (!file) {
         Serial.println("Failed to open /data/relay_types.json");
         return false;
@@ -0,0 +1,379 @@
+#include "ConfigSnapshot.h"
+#include "AtomicFile.h"     // Temp + rename writes
+#include "RuntimeMetrics.h" // LittleFS op counters
+#include <LittleFS.h>
+#include <esp_rom_crc.h>
+#include <cstring>
+#include <memory>
+#include <new>
+
+extern RuntimeMetrics runtimeMetrics;
+
+namespace {
+// Appends little-endian scalars and u16-length-prefixed strings to a byte buffer
+struct SnapshotWriter {
+    std::vector<uint8_t> data;
+
+    void u8(uint8_t v) { data.push_back(v); }
+    void u16(uint16_t v) {
+        data.push_back((uint8_t)v);
+        data.push_back((uint8_t)(v >> 8));
+    }
+    void i32(int32_t v) {
+        for (int shift = 0; shift < 32; shift += 8) data.push_back((uint8_t)((uint32_t)v >> shift));
+    }
+    void f32(float v) {
+        uint32_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        i32((int32_t)bits);
+    }
+    void str(const String& s) {
+        uint16_t len = (uint16_t)min((unsigned)s.length(), 0xFFFFu);
+        u16(len);
+        data.insert(data.end(), (const uint8_t*)s.c_str(), (const uint8_t*)s.c_str() + len);
+    }
+    void ints(const std::vector<int>& values) {
+        u16((uint16_t)values.size());
+        for (int v : values) i32(v);
+    }
+};
+
+// Bounds-checked counterpart of SnapshotWriter; any overrun clears ok and yields zeros
+struct SnapshotReader {
+    const uint8_t* p;
+    size_t left;
+    bool ok = true;
+
+    SnapshotReader(const uint8_t* data, size_t size) : p(data), left(size) {}
+
+    bool take(size_t n) {
+        if (!ok || left < n) {
+            ok = false;
+            return false;
+        }
+        left -= n;
+        return true;
+    }
+    uint8_t u8() {
+        if (!take(1)) return 0;
+        return *p++;
+    }
+    uint16_t u16() {
+        if (!take(2)) return 0;
+        uint16_t v = (uint16_t)(p[0] | (p[1] << 8));
+        p += 2;
+        return v;
+    }
+    int32_t i32() {
+        if (!take(4)) return 0;
+        uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+        p += 4;
+        return (int32_t)v;
+    }
+    float f32() {
+        uint32_t bits = (uint32_t)i32();
+        float v;
+        memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    String str() {
+        uint16_t len = u16();
+        if (!take(len)) return String();
+        String s;
+        s.reserve(len);
+        s.concat((const char*)p, len);
+        p += len;
+        return s;
+    }
+    void ints(std::vector<int>& values) {
+        uint16_t count = u16();
+        values.clear();
+        for (uint16_t i = 0; i < count && ok; ++i) values.push_back(i32());
+    }
+};
+
+void encodeIOConfig(SnapshotWriter& w, const IOConfiguration& io) {
+    const DirectRelayConfig& relays = io.directIO.relayOutputs;
+    w.i32(relays.count);
+    w.str(relays.controlMethod);
+    w.i32(relays.pins.data);
+    w.i32(relays.pins.clock);
+    w.i32(relays.pins.latch);
+    w.i32(relays.pins.oe);
+    w.ints(relays.gpioPins);
+    w.str(relays.pointIdPrefix);
+    w.i32(relays.pointIdStartIndex);
+
+    const DirectDigitalInputConfig& di = io.directIO.digitalInputs;
+    w.i32(di.count);
+    w.ints(di.pins);
+    w.str(di.pointIdPrefix);
+    w.i32(di.pointIdStartIndex);
+
+    w.u16((uint16_t)io.directIO.analogInputs.size());
+    for (const DirectAnalogInputConfig& ai : io.directIO.analogInputs) {
+        w.str(ai.type);
+        w.i32(ai.count);
+        w.i32(ai.resolutionBits);
+        w.ints(ai.pins);
+        w.str(ai.pointIdPrefix);
+        w.i32(ai.pointIdStartIndex);
+    }
+    w.u16((uint16_t)io.directIO.analogOutputs.size());
+    for (const DirectAnalogOutputConfig& ao : io.directIO.analogOutputs) {
+        w.str(ao.type);
+        w.i32(ao.count);
+        w.i32(ao.resolutionBits);
+        w.ints(ao.pins);
+        w.str(ao.pointIdPrefix);
+        w.i32(ao.pointIdStartIndex);
+    }
+    w.u16((uint16_t)io.directIO.flowMeters.size());
+    for (const DirectFlowMeterConfig& fm : io.directIO.flowMeters) {
+        w.str(fm.pointId);
+        w.i32(fm.pin);
+        w.f32(fm.pulsesPerLiter);
+        w.str(fm.outputPointId);
+    }
+
+    w.u16((uint16_t)io.modbusInterfaces.size());
+    for (const ModbusInterfaceConfig& mi : io.modbusInterfaces) {
+        w.str(mi.interfaceId);
+        w.i32(mi.uartPort);
+        w.i32((int32_t)mi.baudRate);
+        w.str(mi.config);
+        w.i32(mi.txPin);
+        w.i32(mi.rxPin);
+        w.i32(mi.rtsPin);
+    }
+    w.u16((uint16_t)io.modbusDevices.size());
+    for (const ModbusDeviceConfig& md : io.modbusDevices) {
+        w.str(md.deviceId);
+        w.str(md.profileId);
+        w.str(md.interfaceId);
+        w.i32(md.slaveAddress);
+        w.i32((int32_t)md.pollingIntervalMs);
+        w.u8(md.enabled ? 1 : 0);
+        w.str(md.overrideDescription);
+    }
+}
+
+void decodeIOConfig(SnapshotReader& r, IOConfiguration& io) {
+    io = IOConfiguration();
+    DirectRelayConfig& relays = io.directIO.relayOutputs;
+    relays.count = r.i32();
+    relays.controlMethod = r.str();
+    relays.pins.data = r.i32();
+    relays.pins.clock = r.i32();
+    relays.pins.latch = r.i32();
+    relays.pins.oe = r.i32();
+    r.ints(relays.gpioPins);
+    relays.pointIdPrefix = r.str();
+    relays.pointIdStartIndex = r.i32();
+
+    DirectDigitalInputConfig& di = io.directIO.digitalInputs;
+    di.count = r.i32();
+    r.ints(di.pins);
+    di.pointIdPrefix = r.str();
+    di.pointIdStartIndex = r.i32();
+
+    uint16_t count = r.u16();
+    for (uint16_t i = 0; i < count && r.ok; ++i) {
+        DirectAnalogInputConfig ai;
+        ai.type = r.str();
+        ai.count = r.i32();
+        ai.resolutionBits = r.i32();
+        r.ints(ai.pins);
+        ai.pointIdPrefix = r.str();
+        ai.pointIdStartIndex = r.i32();
+        io.directIO.analogInputs.push_back(ai);
+    }
+    count = r.u16();
+    for (uint16_t i = 0; i < count && r.ok; ++i) {
+        DirectAnalogOutputConfig ao;
+        ao.type = r.str();
+        ao.count = r.i32();
+        ao.resolutionBits = r.i32();
+        r.ints(ao.pins);
+        ao.pointIdPrefix = r.str();
+        ao.pointIdStartIndex = r.i32();
+        io.directIO.analogOutputs.push_back(ao);
+    }
+    count = r.u16();
+    for (uint16_t i = 0; i < count && r.ok; ++i) {
+        DirectFlowMeterConfig fm;
+        fm.pointId = r.str();
+        fm.pin = r.i32();
+        fm.pulsesPerLiter = r.f32();
+        fm.outputPointId = r.str();
+        io.directIO.flowMeters.push_back(fm);
+    }
+
+    count = r.u16();
+    for (uint16_t i = 0; i < count && r.ok; ++i) {
+        ModbusInterfaceConfig mi;
+        mi.interfaceId = r.str();
+        mi.uartPort = r.i32();
+        mi.baudRate = r.i32();
+        mi.config = r.str();
+        mi.txPin = r.i32();
+        mi.rxPin = r.i32();
+        mi.rtsPin = r.i32();
+        io.modbusInterfaces.push_back(mi);
+    }
+    count = r.u16();
+    for (uint16_t i = 0; i < count && r.ok; ++i) {
+        ModbusDeviceConfig md;
+        md.deviceId = r.str();
+        md.profileId = r.str();
+        md.interfaceId = r.str();
+        md.slaveAddress = r.i32();
+        md.pollingIntervalMs = r.i32();
+        md.enabled = r.u8() != 0;
+        md.overrideDescription = r.str();
+        io.modbusDevices.push_back(md);
+    }
+}
+
+// Only the fields loadRelayTypes() fills in; the JsonVariant constraints are never parsed
+void encodeOutputTypes(SnapshotWriter& w, const std::vector<OutputTypeDefinition>& types) {
+    w.u16((uint16_t)types.size());
+    for (const OutputTypeDefinition& type : types) {
+        w.str(type.typeId);
+        w.str(type.displayName);
+        w.str(type.description);
+        w.u8((type.supportsVolume ? 0x01 : 0) | (type.supportsAutopilotInput ? 0x02 : 0)
+           | (type.supportsVerificationInput ? 0x04 : 0) | (type.resumeStateOnReboot ? 0x08 : 0));
+        w.u16((uint16_t)type.configParams.size());
+        for (const OutputTypeConfigParam& param : type.configParams) {
+            w.str(param.id);
+            w.str(param.label);
+            w.str(param.type);
+            w.u8((param.required ? 0x01 : 0) | (param.readonly ? 0x02 : 0));
+        }
+    }
+}
+
+void decodeOutputTypes(SnapshotReader& r, std::vector<OutputTypeDefinition>& types) {
+    types.clear();
+    uint16_t count = r.u16();
+    for (uint16_t i = 0; i < count && r.ok; ++i) {
+        OutputTypeDefinition type;
+        type.typeId = r.str();
+        type.displayName = r.str();
+        type.description = r.str();
+        uint8_t flags = r.u8();
+        type.supportsVolume = flags & 0x01;
+        type.supportsAutopilotInput = flags & 0x02;
+        type.supportsVerificationInput = flags & 0x04;
+        type.resumeStateOnReboot = flags & 0x08;
+        uint16_t paramCount = r.u16();
+        for (uint16_t j = 0; j < paramCount && r.ok; ++j) {
+            OutputTypeConfigParam param;
+            param.id = r.str();
+            param.label = r.str();
+            param.type = r.str();
+            uint8_t paramFlags = r.u8();
+            param.required = paramFlags & 0x01;
+            param.readonly = paramFlags & 0x02;
+            type.configParams.push_back(param);
+        }
+        types.push_back(type);
+    }
+}
+
+bool sameStamp(const ConfigSourceStamp& a, const ConfigSourceStamp& b) {
+    return a.size == b.size && a.crc == b.crc;
+}
+} // namespace
+
+bool stampConfigSource(const String& path, ConfigSourceStamp& stamp) {
+    stamp = {0, 0};
+    File file = LittleFS.open(path, "r");
+    if (!file || file.isDirectory()) return false;
+    uint8_t chunk[ATOMIC_FILE_CHUNK_SIZE];
+    size_t got;
+    while ((got = file.read(chunk, sizeof(chunk))) > 0) {
+        stamp.crc = esp_rom_crc32_le(stamp.crc, chunk, got);
+        stamp.size += got;
+    }
+    file.close();
+    runtimeMetrics.recordFsRead(stamp.size);
+    return true;
+}
+
+bool writeConfigSnapshot(const String& path, const ConfigSourceStamp& board, const ConfigSourceStamp& relayTypes,
+                         const IOConfiguration& ioConfig, const std::vector<OutputTypeDefinition>& outputTypes) {
+    SnapshotWriter payload;
+    encodeIOConfig(payload, ioConfig);
+    encodeOutputTypes(payload, outputTypes);
+    if (payload.data.size() > CONFIG_SNAPSHOT_MAX_PAYLOAD) {
+        Serial.printf("Config snapshot too large (%u bytes); not written.\n", (unsigned)payload.data.size());
+        return false;
+    }
+
+    ConfigSnapshotHeader header = {};
+    header.magic = CONFIG_SNAPSHOT_MAGIC;
+    header.version = CONFIG_SNAPSHOT_VERSION;
+    header.headerSize = sizeof(ConfigSnapshotHeader);
+    header.payloadSize = payload.data.size();
+    header.payloadCrc = esp_rom_crc32_le(0, payload.data.data(), payload.data.size());
+    header.board = board;
+    header.relayTypes = relayTypes;
+
+    AtomicFileWriter file;
+    if (!file.open(path)) {
+        Serial.printf("Failed to open config snapshot for writing: %s\n", path.c_str());
+        return false;
+    }
+    size_t expected = sizeof(header) + payload.data.size();
+    size_t written = file.write((const uint8_t*)&header, sizeof(header));
+    written += file.write(payload.data.data(), payload.data.size());
+    if (written != expected || !file.commit()) {
+        Serial.printf("Short write on config snapshot %s (%u of %u bytes).\n",
+                      path.c_str(), (unsigned)written, (unsigned)expected);
+        file.abort();
+        return false;
+    }
+    return true;
+}
+
+bool readConfigSnapshot(const String& path, const ConfigSourceStamp& board, const ConfigSourceStamp& relayTypes,
+                        IOConfiguration& ioConfig, std::vector<OutputTypeDefinition>& outputTypes) {
+    File file = LittleFS.open(path, "r");
+    if (!file) return false;
+
+    ConfigSnapshotHeader header;
+    bool valid = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header)
+              && header.magic == CONFIG_SNAPSHOT_MAGIC
+              && header.version == CONFIG_SNAPSHOT_VERSION
+              && header.headerSize == sizeof(ConfigSnapshotHeader)
+              && header.payloadSize <= CONFIG_SNAPSHOT_MAX_PAYLOAD
+              && file.size() == sizeof(header) + header.payloadSize;
+    if (!valid || !sameStamp(header.board, board) || !sameStamp(header.relayTypes, relayTypes)) {
+        file.close();
+        return false; // Other version or built from different sources
+    }
+
+    std::unique_ptr<uint8_t[]> payload(new (std::nothrow) uint8_t[header.payloadSize]);
+    if (!payload) {
+        file.close();
+        return false;
+    }
+    size_t got = file.read(payload.get(), header.payloadSize);
+    file.close();
+    runtimeMetrics.recordFsRead(sizeof(header) + got);
+    if (got != header.payloadSize || esp_rom_crc32_le(0, payload.get(), got) != header.payloadCrc) {
+        Serial.printf("Config snapshot %s is corrupt.\n", path.c_str());
+        return false;
+    }
+
+    SnapshotReader reader(payload.get(), got);
+    decodeIOConfig(reader, ioConfig);
+    decodeOutputTypes(reader, outputTypes);
+    if (!reader.ok || reader.left != 0) {
+        Serial.printf("Config snapshot %s does not decode.\n", path.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,300 @@
+#include "CycleManager.h"
+#include "ScheduleEngine.h"  // Relay bindings of the current step
+#include "AutopilotEngine.h" // Autopilot windows of the current step
+#include "AtomicFile.h"      // Temp + rename writes of the cycle files
+#include "PersistenceWorker.h" // Cycle files are written off the IO core
+#include "DebugConfig.h" // LOGx macros
+#include <LittleFS.h>
+#include <ArduinoJson.h> // V7
+
+// FreeRTOS includes
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Longest cycle expanded into the day table (one byte of RAM per day)
+#define CYCLE_MAX_DAYS 730
+
+extern ScheduleEngine scheduleEngine;
+extern AutopilotEngine autopilotEngine;
+extern PersistenceWorker persistenceWorker;
+
+namespace {
+// Scoped helper that holds the cycle mutex (engine task at rollover, persistence worker, web server lock requests)
+struct CycleGuard {
+    SemaphoreHandle_t mutex;
+    explicit CycleGuard(void* m) : mutex((SemaphoreHandle_t)m) {
+        if (mutex) xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+    ~CycleGuard() {
+        if (mutex) xSemaphoreGive(mutex);
+    }
+};
+
+// Days since 1970-01-01 of a proleptic Gregorian date (H. Hinnant's days_from_civil)
+int32_t daysFromCivil(int32_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int32_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+} // namespace
+
+size_t CycleManager::StringHash::operator()(const String& s) const {
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < s.length(); ++i) {
+        hash = (hash ^ (uint8_t)s[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+bool CycleManager::begin() {
+    if (!cycleMutex) {
+        cycleMutex = xSemaphoreCreateMutex();
+        if (!cycleMutex) {
+            LOGE(SCHEDULE, "Failed to create cycle mutex.");
+            return false;
+        }
+    }
+
+    File dir = LittleFS.open(SCHEDULE_ENGINE_CYCLE_DIR);
+    if (!dir || !dir.isDirectory()) {
+        return true; // No cycles
+    }
+    std::vector<String> paths;
+    File file = dir.openNextFile();
+    while (file) {
+        String name = file.name();
+        if (!file.isDirectory() && name.endsWith(".json")) {
+            paths.push_back(String(SCHEDULE_ENGINE_CYCLE_DIR) + "/" + name);
+        }
+        file.close();
+        file = dir.openNextFile();
+    }
+    dir.close();
+
+    CycleGuard guard(cycleMutex);
+    cycles.clear();
+    for (const String& path : paths) {
+        CycleRuntime cycle;
+        if (loadCycle(path, cycle)) cycles.push_back(cycle);
+    }
+    // The cycle list is fixed from here on; only currentIndex changes
+    rebuildActiveResources();
+
+    LOGI(SCHEDULE, "Loaded %u active cycle(s).", (unsigned)cycles.size());
+    return true;
+}
+
+// Parses one SAVED_ACTIVE cycle and expands its sequence into the day table
+bool CycleManager::loadCycle(const String& path, CycleRuntime& cycle) {
+    JsonDocument doc;
+    if (readJsonFile(path, doc) != FileReadResult::OK || doc.isNull()) {
+        LOGE(SCHEDULE, "Failed to read cycle %s.", path.c_str());
+        return false;
+    }
+    // Sample files ship with the UI data and must never drive relays
+    if (!doc["_sample"].isNull() || stringToCycleState(doc["cycleState"] | "") != SAVED_ACTIVE) {
+        return false;
+    }
+
+    cycle.cycleId = doc["cycleId"] | "";
+    cycle.filePath = path;
+    if (!parseIsoDay(doc["cycleStartDate"] | "", cycle.startDay)) {
+        LOGW(SCHEDULE, "Cycle %s has no valid cycleStartDate.", cycle.cycleId.c_str());
+        return false;
+    }
+    for (JsonObject stepObj : doc["cycleSequence"].as<JsonArray>()) {
+        ActiveCycleStep step;
+        step.step = stepObj["step"] | 0;
+        step.scheduleInstanceId = stepObj["scheduleInstanceId"] | "";
+        step.libraryScheduleId = stepObj["libraryScheduleId"] | "";
+        step.durationDays = stepObj["durationDays"] | 0;
+        cycle.steps.push_back(step);
+    }
+    if (cycle.steps.empty() || cycle.steps.size() > 0xFF) {
+        LOGW(SCHEDULE, "Cycle %s has %u steps (1..255 supported).",
+             cycle.cycleId.c_str(), (unsigned)cycle.steps.size());
+        return false;
+    }
+
+    for (size_t i = 0; i < cycle.steps.size(); ++i) {
+        int days = cycle.steps[i].durationDays;
+        if (days <= 0) continue; // Zero-length steps are never current
+        if (cycle.stepByDay.size() + days > CYCLE_MAX_DAYS) {
+            LOGW(SCHEDULE, "Cycle %s is longer than %d days.", cycle.cycleId.c_str(), CYCLE_MAX_DAYS);
+            return false;
+        }
+        cycle.stepByDay.insert(cycle.stepByDay.end(), (size_t)days, (uint8_t)i);
+    }
+    for (JsonObject output : doc["associatedOutputs"].as<JsonArray>()) {
+        cycle.outputIds.push_back(output["pointId"] | "");
+    }
+    for (JsonObject input : doc["associatedInputs"].as<JsonArray>()) {
+        if ((input["role"] | "") == String(AUTOPILOT_INPUT_ROLE)) cycle.controlInputIds.push_back(input["pointId"] | "");
+    }
+
+    // What the engines bound from the file; onDayChanged() corrects it once the clock is known
+    int currentStep = doc["currentStep"] | 0;
+    for (size_t i = 0; i < cycle.steps.size(); ++i) {
+        if (cycle.steps[i].step == currentStep) {
+            cycle.currentIndex = (int)i;
+            break;
+        }
+    }
+    return true;
+}
+
+void CycleManager::onDayChanged(time_t now) {
+    struct tm local;
+    localtime_r(&now, &local);
+    int32_t today = daysFromCivil(local.tm_year + 1900, (unsigned)local.tm_mon + 1, (unsigned)local.tm_mday);
+
+    std::vector<std::pair<size_t, int>> transitions;
+    bool pending = false;
+    {
+        CycleGuard guard(cycleMutex);
+        for (size_t i = 0; i < cycles.size(); ++i) {
+            int index = stepIndexForDay(cycles[i], today);
+            if (index != cycles[i].currentIndex) {
+                transitions.push_back({i, index});
+                cycles[i].currentIndex = index;
+                cycles[i].persistPending = true;
+                cycles[i].persistDay = today;
+            }
+            pending = pending || cycles[i].persistPending; // Also retries a job that didn't fit the queue
+        }
+        if (!transitions.empty()) rebuildActiveResources();
+    }
+    // Only the step fields are written after begin(), so the rest is read without the mutex
+    for (const auto& transition : transitions) {
+        enterStep(cycles[transition.first], transition.second);
+    }
+    if (pending && !persistenceWorker.submit(persistJob, this)) {
+        LOGW(SCHEDULE, "Persistence queue full; cycle state is written at the next rollover.");
+    }
+}
+
+// Rebinds the cycle's relays and autopilot zone to step @p index (-1: none)
+void CycleManager::enterStep(CycleRuntime& cycle, int index) {
+    String scheduleUID = index >= 0 ? cycle.steps[index].libraryScheduleId : String();
+    scheduleEngine.unbindSource(cycle.cycleId);
+    if (!scheduleUID.isEmpty()) {
+        for (const String& pointId : cycle.outputIds) {
+            scheduleEngine.bindSchedule(scheduleUID, pointId, cycle.cycleId);
+        }
+    }
+    autopilotEngine.rebindCycle(cycle.cycleId, scheduleUID, cycle.controlInputIds, cycle.outputIds);
+
+    if (index >= 0) {
+        LOGI(SCHEDULE, "Cycle %s entered step %d ('%s').",
+             cycle.cycleId.c_str(), cycle.steps[index].step, scheduleUID.c_str());
+    } else {
+        LOGI(SCHEDULE, "Cycle %s has no step today.", cycle.cycleId.c_str());
+    }
+}
+
+void CycleManager::persistJob(void* context) {
+    static_cast<CycleManager*>(context)->persistPendingSteps();
+}
+
+// Runs on the persistence worker: writes the step changes back to the cycle files
+void CycleManager::persistPendingSteps() {
+    for (CycleRuntime& cycle : cycles) {
+        int index;
+        int32_t day;
+        {
+            CycleGuard guard(cycleMutex);
+            if (!cycle.persistPending) continue;
+            cycle.persistPending = false;
+            index = cycle.currentIndex;
+            day = cycle.persistDay;
+        }
+        persistStep(cycle, index, day);
+    }
+}
+
+// Writes currentStep / stepStartDate (or COMPLETED past the last day) back to the cycle file
+bool CycleManager::persistStep(const CycleRuntime& cycle, int index, int32_t today) {
+    JsonDocument doc;
+    if (readJsonFile(cycle.filePath, doc) != FileReadResult::OK || doc.isNull()) {
+        LOGE(SCHEDULE, "Failed to read cycle %s for update.", cycle.filePath.c_str());
+        return false;
+    }
+    if (index >= 0) {
+        int32_t stepStart = today;
+        while (stepStart > cycle.startDay && cycle.stepByDay[stepStart - 1 - cycle.startDay] == index) --stepStart;
+        doc["currentStep"] = cycle.steps[index].step;
+        doc["stepStartDate"] = isoFromDay(stepStart);
+    } else if (today >= cycle.startDay + (int32_t)cycle.stepByDay.size()) {
+        doc["cycleState"] = cycleStateToString(COMPLETED);
+    } else {
+        return true; // Not started yet: nothing to record
+    }
+    return writeJsonFileAtomic(cycle.filePath, doc);
+}
+
+// Caller holds cycleMutex
+void CycleManager::rebuildActiveResources() {
+    activeResources.clear();
+    for (const CycleRuntime& cycle : cycles) {
+        if (cycle.currentIndex < 0) continue;
+        const ActiveCycleStep& step = cycle.steps[cycle.currentIndex];
+        activeResources.insert(CYCLE_SCHEDULE_RESOURCE_PREFIX + step.libraryScheduleId);
+    }
+}
+
+bool CycleManager::isResourceInActiveCycle(const String& resourceId) const {
+    CycleGuard guard(cycleMutex);
+    return activeResources.count(resourceId) != 0;
+}
+
+String CycleManager::scheduleForDay(const String& cycleId, int32_t dayNumber) const {
+    CycleGuard guard(cycleMutex);
+    for (const CycleRuntime& cycle : cycles) {
+        if (cycle.cycleId != cycleId) continue;
+        int index = stepIndexForDay(cycle, dayNumber);
+        return index >= 0 ? cycle.steps[index].libraryScheduleId : String();
+    }
+    return String();
+}
+
+std::vector<CycleBinding> CycleManager::currentBindings() const {
+    CycleGuard guard(cycleMutex);
+    std::vector<CycleBinding> result;
+    for (const CycleRuntime& cycle : cycles) {
+        if (cycle.currentIndex < 0) continue;
+        CycleBinding binding;
+        binding.cycleId = cycle.cycleId;
+        binding.scheduleUID = cycle.steps[cycle.currentIndex].libraryScheduleId;
+        binding.outputIds = cycle.outputIds;
+        binding.controlInputIds = cycle.controlInputIds;
+        result.push_back(binding);
+    }
+    return result;
+}
+
+int CycleManager::stepIndexForDay(const CycleRuntime& cycle, int32_t dayNumber) {
+    int32_t offset = dayNumber - cycle.startDay;
+    if (offset < 0 || offset >= (int32_t)cycle.stepByDay.size()) return -1;
+    return cycle.stepByDay[offset];
+}
+
+// Only the date part is used and taken as a local calendar day ("2025-04-08T00:00:00Z")
+bool CycleManager::parseIsoDay(const String& iso, int32_t& dayNumber) {
+    int year, month, day;
+    if (sscanf(iso.c_str(), "%d-%d-%d", &year, &month, &day) != 3) return false;
+    if (month < 1 || month > 12 || day < 1 || day > 31) return false;
+    dayNumber = daysFromCivil(year, (unsigned)month, (unsigned)day);
+    return true;
+}
+
+String CycleManager::isoFromDay(int32_t dayNumber) {
+    time_t t = (time_t)dayNumber * 86400;
+    struct tm utc;
+    gmtime_r(&t, &utc);
+    char buffer[24];
+    strftime(buffer, sizeof(buffer), "%Y-%m-%dT00:00:00Z", &utc);
+    return String(buffer);
+}
@@ -0,0 +1,226 @@
+#include "FlowMeterManager.h"
+#include "OutputPointManager.h" // Volume doses end in endVolumeDose()
+#include <math.h>
+#include <algorithm>
+
+#include <driver/pcnt.h>
+#include <soc/pcnt_struct.h>
+
+extern PointRegistry pointRegistry;
+extern OutputPointManager outputManager;
+
+bool FlowMeterManager::begin(const IOConfiguration& ioConfig) {
+    count = 0;
+    for (const DirectFlowMeterConfig& config : ioConfig.directIO.flowMeters) {
+        if (count >= FLOW_MAX_METERS) {
+            Serial.printf("[FlowMeter] More than %d flow meters configured; %s ignored.\n", FLOW_MAX_METERS, config.pointId.c_str());
+            continue;
+        }
+        if (config.pin < 0 || config.pulsesPerLiter <= 0.0f) {
+            Serial.printf("[FlowMeter] %s needs a pin and pulsesPerLiter > 0.\n", config.pointId.c_str());
+            continue;
+        }
+        FlowMeter& meter = meters[count];
+        meter = FlowMeter();
+        meter.unit = (int)count;
+        meter.pulsesPerLiter = config.pulsesPerLiter;
+        const PointEntry* relay = pointRegistry.get(pointRegistry.resolve(config.outputPointId, PointKind::RELAY_OUTPUT));
+        if (relay) {
+            meter.relayIndex = relay->localIndex;
+        } else if (!config.outputPointId.isEmpty()) {
+            Serial.printf("[FlowMeter] %s: unknown relay %s; volume doses will be timed.\n",
+                          config.pointId.c_str(), config.outputPointId.c_str());
+        }
+
+        // Count rising edges on channel 0, no control input
+        pcnt_config_t pcntConfig = {};
+        pcntConfig.pulse_gpio_num = config.pin;
+        pcntConfig.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+        pcntConfig.channel = PCNT_CHANNEL_0;
+        pcntConfig.unit = (pcnt_unit_t)meter.unit;
+        pcntConfig.pos_mode = PCNT_COUNT_INC;
+        pcntConfig.neg_mode = PCNT_COUNT_DIS;
+        pcntConfig.lctrl_mode = PCNT_MODE_KEEP;
+        pcntConfig.hctrl_mode = PCNT_MODE_KEEP;
+        pcntConfig.counter_h_lim = FLOW_PCNT_MAX_WINDOW;
+        pcntConfig.counter_l_lim = 0;
+        if (pcnt_unit_config(&pcntConfig) != ESP_OK) {
+            Serial.printf("[FlowMeter] PCNT unit %d configuration failed for %s.\n", meter.unit, config.pointId.c_str());
+            continue;
+        }
+        pcnt_set_filter_value((pcnt_unit_t)meter.unit, FLOW_PCNT_FILTER_CYCLES);
+        pcnt_filter_enable((pcnt_unit_t)meter.unit);
+        pcnt_event_enable((pcnt_unit_t)meter.unit, PCNT_EVT_H_LIM);
+        pcnt_counter_pause((pcnt_unit_t)meter.unit);
+        pcnt_counter_clear((pcnt_unit_t)meter.unit);
+
+        meter.point = pointRegistry.registerPoint(config.pointId, PointKind::FLOW_METER, (int16_t)count);
+        if (meter.point == INVALID_POINT_HANDLE) {
+            Serial.printf("[FlowMeter] Point %s could not be registered.\n", config.pointId.c_str());
+            continue; // The unit is configured again for the next meter
+        }
+        ++count;
+    }
+    if (count == 0) {
+        return true;
+    }
+
+    // One handler for all units: it reads and clears the status under flowMux itself
+    if (!isrHandle && pcnt_isr_register(pcntIsr, this, 0, (pcnt_isr_handle_t*)&isrHandle) != ESP_OK) {
+        Serial.println("[FlowMeter] Failed to register the PCNT interrupt.");
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        pcnt_intr_enable((pcnt_unit_t)meters[i].unit);
+        pcnt_counter_resume((pcnt_unit_t)meters[i].unit);
+    }
+    Serial.printf("[FlowMeter] Counting %u flow meter(s).\n", (unsigned)count);
+    return true;
+}
+
+int FlowMeterManager::meterForRelay(int relayIndex) const {
+    for (size_t i = 0; i < count; ++i) {
+        if (relayIndex >= 0 && meters[i].relayIndex == relayIndex) return (int)i;
+    }
+    return -1;
+}
+
+int FlowMeterManager::meterForOutput(PointHandle output) const {
+    const PointEntry* entry = pointRegistry.get(output);
+    if (!entry || entry->kind != PointKind::RELAY_OUTPUT) return -1;
+    return meterForRelay(entry->localIndex);
+}
+
+int FlowMeterManager::meterSlot(PointHandle meterPoint) const {
+    const PointEntry* entry = pointRegistry.get(meterPoint);
+    if (!entry || entry->kind != PointKind::FLOW_METER || entry->localIndex < 0 || entry->localIndex >= (int)count) return -1;
+    return entry->localIndex;
+}
+
+float FlowMeterManager::getTotalLiters(PointHandle meterPoint) const {
+    int slot = meterSlot(meterPoint);
+    if (slot < 0) return -1.0f;
+    const FlowMeter& meter = meters[slot];
+    int16_t windowCount = 0;
+    portENTER_CRITICAL(&flowMux);
+    int64_t pulses = (int64_t)meter.totalPulses;
+    pcnt_get_counter_value((pcnt_unit_t)meter.unit, &windowCount);
+    if (PCNT.int_raw.val & BIT(meter.unit)) pulses += meter.windowLimit; // Window ended, interrupt not serviced yet
+    portEXIT_CRITICAL(&flowMux);
+    return (float)(pulses + windowCount) / meter.pulsesPerLiter;
+}
+
+bool FlowMeterManager::armDose(int relayIndex, uint32_t volumeMl, uint16_t doseSeq) {
+    int slot = meterForRelay(relayIndex);
+    if (slot < 0) return false;
+    FlowMeter& meter = meters[slot];
+    uint32_t pulses = (uint32_t)lroundf((float)volumeMl * meter.pulsesPerLiter / 1000.0f);
+    if (pulses == 0) pulses = 1;
+
+    portENTER_CRITICAL(&flowMux);
+    foldPendingWindow(meter);
+    meter.dosing = false;
+    restartWindow(meter); // Pulses before the dose only go to the total
+    meter.dosing = true;
+    meter.doseRemaining = pulses;
+    meter.doseSeq = doseSeq;
+    restartWindow(meter); // Window limit = first chunk of the dose
+    portEXIT_CRITICAL(&flowMux);
+    reportFinishedDoses(); // An immediate finish needs one pulse in the few instructions above
+    return true;
+}
+
+bool FlowMeterManager::cancelDose(int relayIndex) {
+    int slot = meterForRelay(relayIndex);
+    if (slot < 0) return false;
+    FlowMeter& meter = meters[slot];
+    portENTER_CRITICAL(&flowMux);
+    bool wasDosing = meter.dosing;
+    if (wasDosing) {
+        foldPendingWindow(meter);
+        meter.dosing = false;
+        restartWindow(meter);
+    }
+    portEXIT_CRITICAL(&flowMux);
+    reportFinishedDoses(); // restartWindow() may have completed the dose
+    return wasDosing;
+}
+
+// Caller holds flowMux. Accounts a window whose limit interrupt is raised but not yet
+// serviced (the status is cleared, so the interrupt won't count it again).
+void FlowMeterManager::foldPendingWindow(FlowMeter& meter) {
+    if (!(PCNT.int_raw.val & BIT(meter.unit))) return;
+    meter.totalPulses += meter.windowLimit;
+    if (meter.dosing) {
+        meter.doseRemaining -= std::min(meter.doseRemaining, (uint32_t)meter.windowLimit);
+    }
+    PCNT.int_clr.val = BIT(meter.unit);
+}
+
+// Caller holds flowMux. Folds the running window into the totals and restarts the counter
+// with the limit for the rest of the dose (FLOW_PCNT_MAX_WINDOW when idle).
+void FlowMeterManager::restartWindow(FlowMeter& meter) {
+    pcnt_unit_t unit = (pcnt_unit_t)meter.unit;
+    pcnt_counter_pause(unit);
+    int16_t windowCount = 0;
+    pcnt_get_counter_value(unit, &windowCount);
+    meter.totalPulses += (uint32_t)windowCount;
+    if (meter.dosing) {
+        if ((uint32_t)windowCount >= meter.doseRemaining) finishDose(meter);
+        else meter.doseRemaining -= (uint32_t)windowCount;
+    }
+    meter.windowLimit = meter.dosing ? (int16_t)std::min(meter.doseRemaining, (uint32_t)FLOW_PCNT_MAX_WINDOW)
+                                     : (int16_t)FLOW_PCNT_MAX_WINDOW;
+    pcnt_set_event_value(unit, PCNT_EVT_H_LIM, meter.windowLimit);
+    pcnt_counter_clear(unit);
+    pcnt_counter_resume(unit);
+}
+
+// Caller holds flowMux: the relay is only switched off or staged here (no FreeRTOS
+// calls); reportFinishedDoses() commits a staged write and does the rest
+void FlowMeterManager::finishDose(FlowMeter& meter) {
+    meter.dosing = false;
+    meter.doseRemaining = 0;
+    outputManager.endVolumeDose(meter.relayIndex);
+    meter.endPending = true;
+    meter.endedSeq = meter.doseSeq;
+}
+
+// Hands finished doses to OutputPointManager outside flowMux: volumeDoseEnded() commits
+// remote relay writes and defers the bookkeeping, both of which notify tasks.
+// Every path that can reach finishDose() calls this after releasing flowMux.
+void FlowMeterManager::reportFinishedDoses() {
+    for (size_t i = 0; i < count; ++i) {
+        FlowMeter& meter = meters[i];
+        portENTER_CRITICAL_SAFE(&flowMux);
+        bool ended = meter.endPending;
+        uint16_t seq = meter.endedSeq;
+        meter.endPending = false;
+        portEXIT_CRITICAL_SAFE(&flowMux);
+        if (ended) outputManager.volumeDoseEnded(meter.relayIndex, seq);
+    }
+}
+
+// Caller holds flowMux. The counter reached windowLimit and restarted from 0 in hardware.
+void FlowMeterManager::onWindowEnd(FlowMeter& meter) {
+    meter.totalPulses += meter.windowLimit;
+    if (meter.dosing) {
+        meter.doseRemaining -= std::min(meter.doseRemaining, (uint32_t)meter.windowLimit);
+        if (meter.doseRemaining == 0) finishDose(meter);
+    }
+    if (meter.dosing || meter.windowLimit != FLOW_PCNT_MAX_WINDOW) {
+        restartWindow(meter); // Next chunk of the dose, or back to the idle window
+    }
+}
+
+void FlowMeterManager::pcntIsr(void* arg) {
+    FlowMeterManager* self = static_cast<FlowMeterManager*>(arg);
+    portENTER_CRITICAL_ISR(&self->flowMux);
+    uint32_t status = PCNT.int_st.val;
+    for (size_t i = 0; i < self->count; ++i) {
+        if (status & BIT(self->meters[i].unit)) self->onWindowEnd(self->meters[i]);
+    }
+    PCNT.int_clr.val = status;
+    portEXIT_CRITICAL_ISR(&self->flowMux);
+    self->reportFinishedDoses();
+}
@@ -0,0 +1,449 @@
+#include "HistoryStore.h"
+#include "ScheduleEngine.h" // SCHEDULE_ENGINE_MIN_VALID_EPOCH
+#include "InputPointManager.h"
+#include "OutputPointManager.h"
+#include "FlowMeterManager.h"
+#include "RuntimeMetrics.h" // LittleFS op counters
+#include "PersistenceWorker.h" // Runs the sampling / flush job
+#include <LittleFS.h>
+#include <math.h>
+#include <ctime>
+
+// FreeRTOS includes
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+extern PointRegistry pointRegistry;
+extern InputPointManager inputManager;
+extern OutputPointManager outputManager;
+extern FlowMeterManager flowMeterManager;
+extern RuntimeMetrics runtimeMetrics;
+extern PersistenceWorker persistenceWorker;
+
+namespace {
+// Scoped helper that holds the store mutex (persistence worker vs. web server queries)
+struct StoreGuard {
+    SemaphoreHandle_t mutex;
+    explicit StoreGuard(void* m) : mutex((SemaphoreHandle_t)m) {
+        if (mutex) xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+    ~StoreGuard() {
+        if (mutex) xSemaphoreGive(mutex);
+    }
+};
+
+const uint32_t kSegmentMagic = 0x48524E53; // "SNRH"
+const char kRollupFile[] = "/rollup.bin";
+
+// First bytes of every segment file; the header sample is the segment's first sample
+struct SegmentHeader {
+    uint32_t magic;
+    uint32_t startEpoch;
+    int32_t startValue; ///< Fixed point (HISTORY_VALUE_SCALE)
+    uint32_t reserved;
+};
+static_assert(sizeof(SegmentHeader) == 16, "SegmentHeader is stored on flash");
+
+// Slot (bucketStart / HISTORY_ROLLUP_BUCKET_S) % HISTORY_ROLLUP_BUCKETS of the rollup file
+struct RollupRecord {
+    uint32_t bucketStart; ///< 0: never written
+    float min;
+    float max;
+    float mean;
+};
+static_assert(sizeof(RollupRecord) == 16, "RollupRecord is stored on flash");
+
+size_t putVarint(uint8_t* out, uint32_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+bool readSegmentHeader(File& file, SegmentHeader& header) {
+    return file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) && header.magic == kSegmentMagic;
+}
+} // namespace
+
+// --- HistoryStore Implementation ---
+
+bool HistoryStore::begin() {
+    if (storeMutex) {
+        return true;
+    }
+    storeMutex = xSemaphoreCreateMutex();
+    if (!storeMutex) {
+        Serial.println("[History] Failed to create store mutex.");
+        return false;
+    }
+    if (!LittleFS.exists(HISTORY_DIR) && !LittleFS.mkdir(HISTORY_DIR)) {
+        Serial.printf("[History] Failed to create %s.\n", HISTORY_DIR);
+        return false;
+    }
+
+    // Sensors first, then flow totals and relays (zone run times), then digital inputs
+    points.reserve(HISTORY_MAX_POINTS);
+    const PointKind order[] = {PointKind::ANALOG_INPUT, PointKind::MODBUS_INPUT, PointKind::FLOW_METER,
+                               PointKind::RELAY_OUTPUT, PointKind::DIGITAL_INPUT};
+    size_t skipped = 0;
+    for (PointKind kind : order) {
+        for (size_t h = 0; h < pointRegistry.size(); ++h) {
+            if (pointRegistry.get((PointHandle)h)->kind != kind) continue;
+            if (points.size() < HISTORY_MAX_POINTS) addPoint((PointHandle)h);
+            else ++skipped;
+        }
+    }
+    if (skipped > 0) {
+        Serial.printf("[History] %u point(s) not recorded (HISTORY_MAX_POINTS is %d).\n", (unsigned)skipped, HISTORY_MAX_POINTS);
+    }
+
+    lastFlushMs = millis();
+    if (!persistenceWorker.addPeriodic(sampleJob, this, HISTORY_SAMPLE_INTERVAL_MS)) {
+        return false;
+    }
+    Serial.printf("[History] Recording %u point(s).\n", (unsigned)points.size());
+    return true;
+}
+
+void HistoryStore::addPoint(PointHandle point) {
+    const PointEntry* entry = pointRegistry.get(point);
+    HistoryPointState state;
+    state.point = point;
+    state.dir = String(HISTORY_DIR) + "/" + entry->pointId;
+    state.rollupSkipsUnknown = entry->kind == PointKind::ANALOG_INPUT || entry->kind == PointKind::MODBUS_INPUT;
+    if (!LittleFS.exists(state.dir) && !LittleFS.mkdir(state.dir)) {
+        Serial.printf("[History] Failed to create %s.\n", state.dir.c_str());
+        return;
+    }
+    scanSegments(state);
+    points.push_back(state);
+}
+
+// Finds the existing segment ring; recording continues in a new segment after it
+void HistoryStore::scanSegments(HistoryPointState& state) {
+    File dir = LittleFS.open(state.dir);
+    if (!dir || !dir.isDirectory()) return;
+    File file = dir.openNextFile();
+    while (file) {
+        String name = file.name();
+        if (!file.isDirectory() && name.endsWith(".seg")) {
+            uint32_t seq = (uint32_t)strtoul(name.c_str(), nullptr, 10);
+            if (!state.hasSegments) {
+                state.firstSeq = state.lastSeq = seq;
+                state.hasSegments = true;
+            } else {
+                if (seq < state.firstSeq) state.firstSeq = seq;
+                if (seq > state.lastSeq) state.lastSeq = seq;
+            }
+        }
+        file.close();
+        file = dir.openNextFile();
+    }
+    dir.close();
+}
+
+bool HistoryStore::isRecorded(PointHandle point) const {
+    return findPoint(point) != nullptr;
+}
+
+const HistoryPointState* HistoryStore::findPoint(PointHandle point) const {
+    for (const HistoryPointState& state : points) {
+        if (state.point == point) return &state;
+    }
+    return nullptr;
+}
+
+String HistoryStore::segmentPath(const String& dir, uint32_t seq) {
+    char name[20];
+    snprintf(name, sizeof(name), "/%08lu.seg", (unsigned long)seq);
+    return dir + name;
+}
+
+float HistoryStore::readPoint(PointHandle point) const {
+    switch (pointRegistry.get(point)->kind) {
+        case PointKind::RELAY_OUTPUT:  return outputManager.getRelayState(point) ? 1.0f : 0.0f;
+        case PointKind::DIGITAL_INPUT: return inputManager.getCurrentState(point) ? 1.0f : 0.0f;
+        case PointKind::FLOW_METER:    return flowMeterManager.getTotalLiters(point);
+        default:                       return inputManager.getCurrentValue(point);
+    }
+}
+
+void HistoryStore::flush() {
+    StoreGuard guard(storeMutex);
+    for (HistoryPointState& state : points) {
+        flushPoint(state);
+        if (state.bucketCount > 0) writeRollup(state); // Partial bucket; rewritten when it completes
+    }
+}
+
+void HistoryStore::sampleJob(void* context) {
+    static_cast<HistoryStore*>(context)->sample();
+}
+
+// Runs on the persistence worker every HISTORY_SAMPLE_INTERVAL_MS
+void HistoryStore::sample() {
+    time_t now = time(nullptr);
+    if (now < SCHEDULE_ENGINE_MIN_VALID_EPOCH) return; // Samples need wall time
+
+    for (HistoryPointState& state : points) {
+        float value = readPoint(state.point); // Outside the store mutex
+        StoreGuard guard(storeMutex);
+        recordSample(state, (uint32_t)now, value);
+    }
+    if (millis() - lastFlushMs >= HISTORY_FLUSH_INTERVAL_MS) {
+        StoreGuard guard(storeMutex);
+        for (HistoryPointState& state : points) flushPoint(state);
+        lastFlushMs = millis();
+    }
+}
+
+// Caller holds storeMutex
+void HistoryStore::recordSample(HistoryPointState& state, uint32_t epoch, float value) {
+    int32_t fixed = (int32_t)lroundf(value * HISTORY_VALUE_SCALE);
+    addToRollup(state, epoch, value);
+
+    if (!state.segmentStarted || epoch < state.lastEpoch) {
+        // First sample since boot, or the clock went back: deltas restart in a new segment
+        flushPoint(state);
+        startSegment(state, epoch, fixed);
+        return;
+    }
+    if (fixed == state.lastValue && epoch - state.lastEpoch < HISTORY_HEARTBEAT_S) {
+        return; // Unchanged: the previous sample still describes it
+    }
+
+    uint8_t record[10];
+    size_t n = putVarint(record, epoch - state.lastEpoch);
+    n += putVarint(record + n, zigzag((int32_t)((uint32_t)fixed - (uint32_t)state.lastValue)));
+    if (state.segmentBytes + n > HISTORY_SEGMENT_BYTES) {
+        flushPoint(state);
+        startSegment(state, epoch, fixed);
+        return;
+    }
+    if (state.bufferUsed + n > HISTORY_WRITE_BUFFER_BYTES) {
+        flushPoint(state);
+    }
+    memcpy(state.buffer + state.bufferUsed, record, n);
+    state.bufferUsed += n;
+    state.segmentBytes += n;
+    state.lastEpoch = epoch;
+    state.lastValue = fixed;
+}
+
+// Caller holds storeMutex and has flushed the previous segment
+void HistoryStore::startSegment(HistoryPointState& state, uint32_t epoch, int32_t value) {
+    uint32_t seq = state.hasSegments ? state.lastSeq + 1 : 0;
+    while (state.hasSegments && seq - state.firstSeq >= HISTORY_SEGMENTS_PER_POINT) {
+        LittleFS.remove(segmentPath(state.dir, state.firstSeq));
+        ++state.firstSeq;
+    }
+    if (!state.hasSegments) state.firstSeq = seq;
+    state.lastSeq = seq;
+    state.hasSegments = true;
+
+    SegmentHeader header = {kSegmentMagic, epoch, value, 0};
+    memcpy(state.buffer, &header, sizeof(header));
+    state.bufferUsed = sizeof(header);
+    state.segmentBytes = sizeof(header);
+    state.segmentStarted = true;
+    state.segmentOnFlash = false;
+    state.lastEpoch = epoch;
+    state.lastValue = value;
+}
+
+// Caller holds storeMutex
+void HistoryStore::flushPoint(HistoryPointState& state) {
+    if (state.bufferUsed == 0) return;
+    String path = segmentPath(state.dir, state.lastSeq);
+    File file = LittleFS.open(path, state.segmentOnFlash ? "a" : "w");
+    size_t written = file ? file.write(state.buffer, state.bufferUsed) : 0;
+    if (file) file.close();
+    runtimeMetrics.recordFsWrite(written);
+    if (written != state.bufferUsed) {
+        Serial.printf("[History] Append to %s failed; %u byte(s) dropped.\n", path.c_str(), (unsigned)state.bufferUsed);
+        state.segmentStarted = state.segmentOnFlash; // A segment without its header can't be continued
+    } else {
+        state.segmentOnFlash = true;
+    }
+    state.bufferUsed = 0;
+}
+
+// Caller holds storeMutex
+void HistoryStore::addToRollup(HistoryPointState& state, uint32_t epoch, float value) {
+    if (state.rollupSkipsUnknown && value == -1.0f) return;
+    uint32_t bucket = epoch - epoch % HISTORY_ROLLUP_BUCKET_S;
+    if (state.bucketCount > 0 && bucket != state.bucketStart) {
+        writeRollup(state);
+        state.bucketCount = 0;
+    }
+    if (state.bucketCount == 0) {
+        state.bucketStart = bucket;
+        state.bucketMin = state.bucketMax = value;
+        state.bucketSum = 0;
+    }
+    if (value < state.bucketMin) state.bucketMin = value;
+    if (value > state.bucketMax) state.bucketMax = value;
+    state.bucketSum += value;
+    ++state.bucketCount;
+}
+
+// Overwrites the bucket's slot in the ring file; the file grows to its full size over the first pass
+void HistoryStore::writeRollup(HistoryPointState& state) {
+    RollupRecord record = {state.bucketStart, state.bucketMin, state.bucketMax,
+                           (float)(state.bucketSum / state.bucketCount)};
+    String path = state.dir + kRollupFile;
+    File file = LittleFS.open(path, LittleFS.exists(path) ? "r+" : "w");
+    if (!file) {
+        Serial.printf("[History] Failed to open %s.\n", path.c_str());
+        return;
+    }
+    size_t pos = (size_t)((state.bucketStart / HISTORY_ROLLUP_BUCKET_S) % HISTORY_ROLLUP_BUCKETS) * sizeof(RollupRecord);
+    size_t size = file.size();
+    size_t written = 0;
+    if (pos > size) {
+        const RollupRecord empty = {0, 0, 0, 0};
+        file.seek(size);
+        for (; size < pos; size += sizeof(empty)) written += file.write((const uint8_t*)&empty, sizeof(empty));
+    }
+    file.seek(pos);
+    written += file.write((const uint8_t*)&record, sizeof(record));
+    file.close();
+    runtimeMetrics.recordFsWrite(written);
+}
+
+// --- HistoryCursor Implementation ---
+
+bool HistoryCursor::open(HistoryStore& store, PointHandle point, uint32_t rangeFrom, uint32_t rangeTo, bool useRollup) {
+    const HistoryPointState* state = store.findPoint(point);
+    if (!state || rangeFrom > rangeTo) return false;
+    dir = state->dir;
+    from = rangeFrom;
+    to = rangeTo;
+    rollup = useRollup;
+
+    if (rollup) {
+        bucket = from - from % HISTORY_ROLLUP_BUCKET_S;
+        lastBucket = to - to % HISTORY_ROLLUP_BUCKET_S;
+        const uint32_t span = (HISTORY_ROLLUP_BUCKETS - 1) * HISTORY_ROLLUP_BUCKET_S;
+        if (lastBucket - bucket > span) bucket = lastBucket - span; // Older buckets are overwritten
+        String path = dir + kRollupFile;
+        if (LittleFS.exists(path)) file = LittleFS.open(path, "r");
+        return true;
+    }
+
+    uint32_t firstSeq;
+    {
+        StoreGuard guard(store.storeMutex);
+        if (!state->hasSegments) {
+            seq = 1;
+            lastSeq = 0; // Nothing recorded yet
+            return true;
+        }
+        firstSeq = state->firstSeq;
+        lastSeq = state->lastSeq;
+    }
+    // Start at the newest segment that begins at or before 'from'
+    seq = firstSeq;
+    for (uint32_t s = lastSeq + 1; s-- > firstSeq;) {
+        File segment = LittleFS.open(HistoryStore::segmentPath(dir, s), "r");
+        SegmentHeader header;
+        bool valid = segment && readSegmentHeader(segment, header);
+        if (segment) segment.close();
+        if (valid && header.startEpoch <= from) {
+            seq = s;
+            break;
+        }
+    }
+    return true;
+}
+
+bool HistoryCursor::openSegment(uint32_t segmentSeq) {
+    file = LittleFS.open(HistoryStore::segmentPath(dir, segmentSeq), "r");
+    if (!file) return false; // Rotated out or not flushed yet
+    SegmentHeader header;
+    if (!readSegmentHeader(file, header)) {
+        file.close();
+        return false;
+    }
+    epoch = header.startEpoch;
+    value = header.startValue;
+    haveBase = true;
+    bufferLength = bufferPos = 0;
+    segmentOpen = true;
+    return true;
+}
+
+bool HistoryCursor::readByte(uint8_t& byte) {
+    if (bufferPos == bufferLength) {
+        bufferLength = file.read(buffer, sizeof(buffer));
+        bufferPos = 0;
+        if (bufferLength == 0) return false;
+    }
+    byte = buffer[bufferPos++];
+    return true;
+}
+
+bool HistoryCursor::readVarint(uint32_t& out) {
+    out = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        uint8_t byte;
+        if (!readByte(byte)) return false;
+        out |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+bool HistoryCursor::next(HistorySample& sample) {
+    if (rollup) {
+        if (!file) return false;
+        while (bucket <= lastBucket) {
+            uint32_t current = bucket;
+            bucket += HISTORY_ROLLUP_BUCKET_S;
+            RollupRecord record;
+            size_t pos = (size_t)((current / HISTORY_ROLLUP_BUCKET_S) % HISTORY_ROLLUP_BUCKETS) * sizeof(RollupRecord);
+            if (!file.seek(pos) || file.read((uint8_t*)&record, sizeof(record)) != sizeof(record)) continue;
+            if (record.bucketStart != current) continue; // Empty slot or an older pass of the ring
+            sample = {record.bucketStart, record.mean, record.min, record.max};
+            return true;
+        }
+        return false;
+    }
+
+    while (true) {
+        if (!segmentOpen) {
+            if (seq > lastSeq) return false;
+            openSegment(seq++);
+            continue;
+        }
+        if (haveBase) {
+            haveBase = false;
+        } else {
+            uint32_t dt, dv;
+            if (!readVarint(dt) || !readVarint(dv)) {
+                // End of the segment (a torn last record ends it too)
+                file.close();
+                segmentOpen = false;
+                continue;
+            }
+            epoch += dt;
+            value = (int32_t)((uint32_t)value + (uint32_t)unzigzag(dv));
+        }
+        if (epoch > to) return false;
+        if (epoch < from) continue;
+        float v = (float)value / HISTORY_VALUE_SCALE;
+        sample = {epoch, v, v, v};
+        return true;
+    }
+}
@@ -1,33 +1,76 @@
 #include "InputPointManager.h"
+#include "TaskConfig.h"
+#include "DebugConfig.h" // LOGx macros
 #include <FS.h>
 #include <LittleFS.h>
 #include <ArduinoJson.h> // V7, see how_to_upgrade_from_ArduinoJSON6_to_ArduinoJSON7.md
+#include "AtomicFile.h" // Temp + rename writes
 
-#define DEBUG_INPUT_MANAGER 1
+
+// FreeRTOS includes
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <soc/gpio_struct.h>
+#include <esp_timer.h>
+#include <algorithm>
+#include <utility>
+
+// Global point registry (defined in main.cpp)
+extern PointRegistry pointRegistry;
+
+static portMUX_TYPE diStateMux = portMUX_INITIALIZER_UNLOCKED;
+static portMUX_TYPE curveMux = portMUX_INITIALIZER_UNLOCKED;
 
 InputPointManager::InputPointManager()
-    : valueMutex(nullptr), inputReaderTaskHandle(nullptr) {}
+    : diStateLock(&diStateMux), curveLock(&curveMux), inputReaderTaskHandle(nullptr) {
+    memset(aiFrames, 0, sizeof(aiFrames));
+    memset(aiScaled, 0, sizeof(aiScaled));
+}
 
 bool InputPointManager::begin(const IOConfiguration& config) {
     ioConfig = config;
     buildDirectInputMaps();
     initializeDirectInputHardware();
-    // TODO: Initialize FreeRTOS mutex and create inputReaderTask
-    // valueMutex = xSemaphoreCreateMutex(); // Example for FreeRTOS
-    // xTaskCreatePinnedToCore(inputReaderTaskWrapper, "InputReaderTask", 4096, this, 1, &inputReaderTaskHandle, 1);
+
+    // First samples before anyone can read, so readers never see an empty frame
+    resyncDigitalInputs();
+    sampleAnalogInputs();
+
+    BaseType_t taskCreated = xTaskCreatePinnedToCore(
+        inputReaderTaskWrapper,
+        "InputReaderTask",
+        3072,
+        this,
+        TASK_PRIORITY_INPUT_SAMPLER,
+        (TaskHandle_t*)&inputReaderTaskHandle,
+        IO_CORE
+    );
+    if (taskCreated != pdPASS) {
+        LOGE(INPUTS, "Failed to create input reader task.");
+        return false;
+    }
+    LOGI(INPUTS, "Sampling %d DI (interrupt) and %d AI (%dx oversampled every %d ms).\n",
+                  (int)diPins.size(), (int)aiPins.size(), INPUT_AI_OVERSAMPLE, INPUT_SAMPLE_PERIOD_MS);
     return true;
 }
 
 void InputPointManager::buildDirectInputMaps() {
-    directDIPointIdToPinMap.clear();
-    directAIPointIdToPinMap.clear();
+    diPins.clear();
+    aiPins.clear();
     // Digital Inputs
     String prefix = ioConfig.directIO.digitalInputs.pointIdPrefix;
     int startIdx = ioConfig.directIO.digitalInputs.pointIdStartIndex;
     for (int i = 0; i < ioConfig.directIO.digitalInputs.count; ++i) {
         String pointId = prefix + String(startIdx + i);
         int pin = (i < ioConfig.directIO.digitalInputs.pins.size()) ? ioConfig.directIO.digitalInputs.pins[i] : -1;
-        directDIPointIdToPinMap[pointId] = pin;
+        if (diPins.size() >= INPUT_MAX_DIGITAL_INPUTS) {
+            Serial.printf("[InputPointManager] Too many DIs, ignoring %s (max %d).\n", pointId.c_str(), INPUT_MAX_DIGITAL_INPUTS);
+            continue;
+        }
+        if (pointRegistry.registerPoint(pointId, PointKind::DIGITAL_INPUT, (int16_t)diPins.size()) == INVALID_POINT_HANDLE) {
+            continue;
+        }
+        diPins.push_back(pin);
     }
     // Analog Inputs
     for (const auto& aiConfig : ioConfig.directIO.analogInputs) {
@@ -36,82 +79,300 @@ void InputPointManager::buildDirectInputMaps() {
         for (int i = 0; i < aiConfig.count; ++i) {
             String pointId = prefix + String(startIdx + i);
             int pin = (i < aiConfig.pins.size()) ? aiConfig.pins[i] : -1;
-            directAIPointIdToPinMap[pointId] = pin;
+            if (aiPins.size() >= INPUT_MAX_ANALOG_INPUTS) {
+                Serial.printf("[InputPointManager] Too many AIs, ignoring %s (max %d).\n", pointId.c_str(), INPUT_MAX_ANALOG_INPUTS);
+                continue;
+            }
+            if (pointRegistry.registerPoint(pointId, PointKind::ANALOG_INPUT, (int16_t)aiPins.size()) == INVALID_POINT_HANDLE) {
+                continue;
+            }
+            aiPins.push_back(pin);
         }
     }
 }
 
 void InputPointManager::initializeDirectInputHardware() {
-    // Set up DI pins as INPUT, configure ADC for AI pins
-    for (const auto& pair : directDIPointIdToPinMap) {
-        int pin = pair.second;
+    // Set up DI pins as INPUT with a CHANGE interrupt each, configure ADC for AI pins
+    for (size_t i = 0; i < diPins.size(); ++i) {
+        int pin = diPins[i];
         if (pin >= 0) {
             pinMode(pin, INPUT);
-            #if DEBUG_INPUT_MANAGER
-            Serial.printf("[InputPointManager] Set pinMode INPUT for DI pin %d (pointId: %s)\n", pin, pair.first.c_str());
-            #endif
+            diIsrContexts[i] = { this, (uint8_t)i, (uint8_t)pin };
+            attachInterruptArg(pin, &InputPointManager::digitalInputIsr, &diIsrContexts[i], CHANGE);
+            LOGD(INPUTS, "DI pin %d -> bit %d, interrupt on CHANGE\n", pin, (int)i);
         }
     }
-    for (const auto& pair : directAIPointIdToPinMap) {
-        int pin = pair.second;
+    for (size_t i = 0; i < aiPins.size(); ++i) {
+        int pin = aiPins[i];
         if (pin >= 0) {
             // On ESP32, analogRead does not require explicit pinMode, but you may configure attenuation, etc.
-            #if DEBUG_INPUT_MANAGER
-            Serial.printf("[InputPointManager] Registered AI pin %d (pointId: %s)\n", pin, pair.first.c_str());
-            #endif
+            LOGD(INPUTS, "AI pin %d -> slot %d\n", pin, (int)i);
         }
     }
 }
 
-float InputPointManager::getCurrentValue(const String& pointId) {
-    auto it = lastAIRawValues.find(pointId);
-    if (it != lastAIRawValues.end()) {
-        return static_cast<float>(it->second);
+// --- Readers (lock-free) ---
+
+// Maps a registry handle to an AI slot, or -1 if it is not a usable analog input
+int InputPointManager::analogSlot(PointHandle handle) const {
+    const PointEntry* entry = pointRegistry.get(handle);
+    if (!entry || entry->kind != PointKind::ANALOG_INPUT) return -1;
+    int slot = entry->localIndex;
+    if (slot < 0 || slot >= (int)aiPins.size() || aiPins[slot] < 0) return -1;
+    return slot;
+}
+
+int InputPointManager::remoteSlot(PointHandle handle) const {
+    const PointEntry* entry = pointRegistry.get(handle);
+    if (!entry || entry->kind != PointKind::MODBUS_INPUT) return -1;
+    int slot = entry->localIndex;
+    if (slot < 0 || slot >= remoteCount) return -1;
+    return slot;
+}
+
+PointHandle InputPointManager::registerRemotePoint(const String& pointId) {
+    PointHandle existing = pointRegistry.resolve(pointId, PointKind::MODBUS_INPUT);
+    if (existing != INVALID_POINT_HANDLE) {
+        return existing; // begin() of the remote source ran twice
+    }
+    if (remoteCount >= INPUT_MAX_REMOTE_POINTS) {
+        Serial.printf("[InputPointManager] Too many remote points, ignoring %s (max %d).\n", pointId.c_str(), INPUT_MAX_REMOTE_POINTS);
+        return INVALID_POINT_HANDLE;
+    }
+    PointHandle handle = pointRegistry.registerPoint(pointId, PointKind::MODBUS_INPUT, (int16_t)remoteCount);
+    if (handle == INVALID_POINT_HANDLE) {
+        return INVALID_POINT_HANDLE;
+    }
+    remoteValid[remoteCount] = false;
+    remoteValues[remoteCount] = 0.0f;
+    ++remoteCount;
+    return handle;
+}
+
+void InputPointManager::publishRemoteValue(PointHandle handle, float value) {
+    int slot = remoteSlot(handle);
+    if (slot < 0) return;
+    remoteValues[slot] = value;
+    __sync_synchronize(); // Value visible before the valid flag
+    remoteValid[slot] = true;
+    checkWatches(handle, value);
+}
+
+void InputPointManager::invalidateRemoteValue(PointHandle handle) {
+    int slot = remoteSlot(handle);
+    if (slot >= 0) remoteValid[slot] = false;
+}
+
+float InputPointManager::getCurrentValue(PointHandle handle) const {
+    int remote = remoteSlot(handle);
+    if (remote >= 0) {
+        return remoteValid[remote] ? remoteValues[remote] : -1.0f;
+    }
+    int slot = analogSlot(handle);
+    if (slot < 0) {
+        return -1.0f; // Error value
     }
-    return -1.0f; // Error value
+    // A single aligned 32-bit load from the published frame is atomic
+    return aiScaled[aiFrontIndex][slot];
 }
 
-bool InputPointManager::getCurrentState(const String& pointId) {
-    auto it = lastDIStates.find(pointId);
-    if (it != lastDIStates.end()) {
-        return it->second;
+float InputPointManager::getRawValue(PointHandle handle) const {
+    int slot = analogSlot(handle);
+    if (slot < 0) {
+        return -1.0f;
     }
-    return false; // Default state
+    return static_cast<float>(aiFrames[aiFrontIndex][slot]);
+}
+
+float InputPointManager::getCurrentValue(const String& pointId) const {
+    return getCurrentValue(pointRegistry.resolve(pointId));
+}
+
+bool InputPointManager::getCurrentState(PointHandle handle) const {
+    int remote = remoteSlot(handle);
+    if (remote >= 0) {
+        return remoteValid[remote] && remoteValues[remote] != 0.0f;
+    }
+    const PointEntry* entry = pointRegistry.get(handle);
+    if (!entry || entry->kind != PointKind::DIGITAL_INPUT || entry->localIndex < 0 || entry->localIndex >= (int)diPins.size()) {
+        return false; // Default state
+    }
+    return (diStateBits >> entry->localIndex) & 1U;
+}
+
+bool InputPointManager::getCurrentState(const String& pointId) const {
+    return getCurrentState(pointRegistry.resolve(pointId));
+}
+
+int InputPointManager::getAnalogSnapshot(uint16_t* out, int maxCount) const {
+    if (!out || maxCount <= 0) return 0;
+    int count = min(maxCount, (int)aiPins.size());
+    uint32_t seq;
+    do {
+        seq = aiFrameSeq;
+        memcpy(out, aiFrames[aiFrontIndex], count * sizeof(uint16_t));
+        __sync_synchronize();
+    } while (seq != aiFrameSeq); // Retry if the sampler flipped while copying
+    return count;
+}
+
+// --- Sampling engine ---
+
+// GPIO CHANGE interrupt for one DI: reads the pin level from the input register
+void IRAM_ATTR InputPointManager::digitalInputIsr(void* arg) {
+    DigitalIsrContext* ctx = static_cast<DigitalIsrContext*>(arg);
+    uint32_t level = (ctx->pin < 32) ? ((GPIO.in >> ctx->pin) & 1U) : ((GPIO.in1.val >> (ctx->pin - 32)) & 1U);
+    portMUX_TYPE* mux = static_cast<portMUX_TYPE*>(ctx->manager->diStateLock);
+    portENTER_CRITICAL_ISR(mux);
+    if (level) ctx->manager->diStateBits |= (1UL << ctx->bit);
+    else ctx->manager->diStateBits &= ~(1UL << ctx->bit);
+    portEXIT_CRITICAL_ISR(mux);
+}
+
+// Re-reads every DI pin and publishes the whole word at once
+void InputPointManager::resyncDigitalInputs() {
+    uint32_t bits = 0;
+    for (size_t i = 0; i < diPins.size(); ++i) {
+        if (readDirectDIState(diPins[i])) bits |= (1UL << i);
+    }
+    portMUX_TYPE* mux = static_cast<portMUX_TYPE*>(diStateLock);
+    portENTER_CRITICAL(mux);
+    diStateBits = bits;
+    portEXIT_CRITICAL(mux);
+}
+
+// Fills the back frame with oversampled readings, then publishes it
+void InputPointManager::sampleAnalogInputs() {
+    uint8_t back = aiFrontIndex ^ 1;
+    for (size_t i = 0; i < aiPins.size(); ++i) {
+        int pin = aiPins[i];
+        if (pin < 0) {
+            aiFrames[back][i] = 0;
+            continue;
+        }
+        uint32_t sum = 0;
+        for (int n = 0; n < INPUT_AI_OVERSAMPLE; ++n) {
+            sum += readDirectAIValueRaw(pin);
+        }
+        aiFrames[back][i] = (uint16_t)((sum + INPUT_AI_OVERSAMPLE / 2) / INPUT_AI_OVERSAMPLE);
+    }
+    scaleAnalogFrame(back);
+    __sync_synchronize(); // Frame contents must be visible before the flip
+    aiFrontIndex = back;
+    aiFrameSeq = aiFrameSeq + 1;
+    checkAnalogWatches(); // After the flip: a notified subscriber reads the new value
+}
+
+// Converts a whole raw frame to engineering units in one pass: per sample one bucket
+// lookup, rarely a segment step, and a multiply-add. No config strings are touched here.
+void InputPointManager::scaleAnalogFrame(uint8_t frame) {
+    uint32_t nowMs = millis();
+    portMUX_TYPE* mux = static_cast<portMUX_TYPE*>(curveLock);
+    portENTER_CRITICAL(mux);
+    for (size_t i = 0; i < aiPins.size(); ++i) {
+        AnalogCurve& curve = aiCurves[i];
+        uint16_t raw = min(aiFrames[frame][i], (uint16_t)INPUT_ADC_MAX_COUNT);
+        if (curve.segmentCount == 0) {
+            aiScaled[frame][i] = raw;
+            continue;
+        }
+        if (curve.tempSource != INVALID_POINT_HANDLE
+            && (curve.tempPending || nowMs - curve.tempUpdatedMs >= curve.tempIntervalMs)) {
+            updateTempCompensation(curve, nowMs);
+        }
+        uint8_t seg = curve.bucketSegment[raw >> INPUT_CAL_BUCKET_SHIFT];
+        while (seg + 1 < curve.segmentCount && raw >= curve.segmentStart[seg + 1]) ++seg;
+        aiScaled[frame][i] = curve.slope[seg] * raw + curve.intercept[seg] + curve.tempCorrection;
+    }
+    portEXIT_CRITICAL(mux);
+}
+
+// Recomputes the additive temperature term; caller holds curveLock. The source is read
+// lock-free; while it is unknown (-1) the previous correction is kept and retried next pass.
+void InputPointManager::updateTempCompensation(AnalogCurve& curve, uint32_t nowMs) {
+    float temperature = getCurrentValue(curve.tempSource);
+    if (temperature == -1.0f) return;
+    curve.tempCorrection = curve.tempSlope * (temperature - curve.tempCenter) + curve.tempOffset;
+    curve.tempUpdatedMs = nowMs;
+    curve.tempPending = false;
 }
 
-// Periodic input reading task (for direct DI/AI)
+// --- Threshold watches ---
+
+int InputPointManager::addThresholdWatch(PointHandle point, float threshold, float hysteresis, void* task, uint32_t notifyBits) {
+    const PointEntry* entry = pointRegistry.get(point);
+    if (!entry || (entry->kind != PointKind::ANALOG_INPUT && entry->kind != PointKind::MODBUS_INPUT) || !task) {
+        return -1;
+    }
+    for (int id = 0; id < INPUT_MAX_WATCHES; ++id) {
+        ThresholdWatch& watch = watches[id];
+        if (watch.active) continue;
+        watch.point = point;
+        watch.threshold = threshold;
+        watch.hysteresis = hysteresis;
+        watch.above = false;
+        watch.crossedUs = 0;
+        watch.task = task;
+        watch.notifyBits = notifyBits;
+        __sync_synchronize(); // Fields visible before the producers see the watch
+        watch.active = true;
+        return id;
+    }
+    LOGW(INPUTS, "No free threshold watch for %s (max %d).\n", entry->pointId.c_str(), INPUT_MAX_WATCHES);
+    return -1;
+}
+
+void InputPointManager::setWatchThreshold(int watchId, float threshold) {
+    if (watchId >= 0 && watchId < INPUT_MAX_WATCHES) watches[watchId].threshold = threshold;
+}
+
+void InputPointManager::removeThresholdWatch(int watchId) {
+    if (watchId >= 0 && watchId < INPUT_MAX_WATCHES) watches[watchId].active = false;
+}
+
+bool InputPointManager::isAboveThreshold(int watchId) const {
+    return watchId >= 0 && watchId < INPUT_MAX_WATCHES && watches[watchId].active && watches[watchId].above;
+}
+
+uint32_t InputPointManager::watchCrossedUs(int watchId) const {
+    return (watchId >= 0 && watchId < INPUT_MAX_WATCHES) ? watches[watchId].crossedUs : 0;
+}
+
+// Flips the watch state on a crossing and notifies the subscriber; a few compares otherwise
+void InputPointManager::evaluateWatch(ThresholdWatch& watch, float value) {
+    if (value == -1.0f) return;
+    bool above = watch.above ? (value >= watch.threshold - watch.hysteresis) : (value >= watch.threshold);
+    if (above == watch.above) return;
+    watch.crossedUs = (uint32_t)esp_timer_get_time();
+    watch.above = above;
+    xTaskNotify((TaskHandle_t)watch.task, watch.notifyBits, eSetBits);
+}
+
+void InputPointManager::checkWatches(PointHandle point, float value) {
+    for (ThresholdWatch& watch : watches) {
+        if (watch.active && watch.point == point) evaluateWatch(watch, value);
+    }
+}
+
+void InputPointManager::checkAnalogWatches() {
+    for (ThresholdWatch& watch : watches) {
+        if (!watch.active) continue;
+        int slot = analogSlot(watch.point);
+        if (slot >= 0) evaluateWatch(watch, aiScaled[aiFrontIndex][slot]);
+    }
+}
+
+// Periodic sampler task (AI every period, DI resync every INPUT_DI_RESYNC_PERIODS)
 void InputPointManager::inputReaderTask() {
-    // This would run as a FreeRTOS task in production
-    // Example loop:
+    TickType_t lastWakeTime = xTaskGetTickCount();
+    uint32_t period = 0;
     while (true) {
-        // Read all digital inputs
-        for (const auto& pair : directDIPointIdToPinMap) {
-            const String& pointId = pair.first;
-            int pin = pair.second;
-            bool state = false;
-            if (pin >= 0) {
-                state = digitalRead(pin);
-                lastDIStates[pointId] = state;
-                #if DEBUG_INPUT_MANAGER
-                Serial.printf("[InputPointManager] DI %s (pin %d) = %d\n", pointId.c_str(), pin, state ? 1 : 0);
-                #endif
-            }
-        }
-        // Read all analog inputs
-        for (const auto& pair : directAIPointIdToPinMap) {
-            const String& pointId = pair.first;
-            int pin = pair.second;
-            int value = 0;
-            if (pin >= 0) {
-                value = analogRead(pin);
-                lastAIRawValues[pointId] = value;
-                #if DEBUG_INPUT_MANAGER
-                Serial.printf("[InputPointManager] AI %s (pin %d) = %d\n", pointId.c_str(), pin, value);
-                #endif
-            }
+        sampleAnalogInputs();
+        if (++period >= INPUT_DI_RESYNC_PERIODS) {
+            resyncDigitalInputs();
+            period = 0;
         }
-        // vTaskDelayUntil(&lastWakeTime, pdMS_TO_TICKS(1000)); // For FreeRTOS
-        delay(1000); // For single-threaded test/debug
+        vTaskDelayUntil(&lastWakeTime, pdMS_TO_TICKS(INPUT_SAMPLE_PERIOD_MS));
     }
 }
 
@@ -141,34 +402,157 @@ int InputPointManager::readDirectAIValueRaw(int pin) {
 bool InputPointManager::saveInputPointConfig(const InputPointConfig& config) {
     String path = getInputConfigPath(config.pointId);
     ensureDirectoryExists("/data/input_configs/");
-    File file = LittleFS.open(path, "w");
-    if (!file) {
-        #if DEBUG_INPUT_MANAGER
-        Serial.println("[InputPointManager] Failed to open input config file for writing.");
-        #endif
+    AtomicFileWriter file;
+    if (!file.open(path)) {
+        LOGE(INPUTS, "Failed to open input config file for writing.");
         return false;
     }
     String jsonString = config.serialize();
     size_t written = file.print(jsonString);
-    file.close();
-    return (written > 0);
+    if (written == 0 || !file.commit()) {
+        return false;
+    }
+    applyCalibration(config);
+    return true;
 }
 
 bool InputPointManager::loadInputPointConfig(const String& pointId, InputPointConfig& config) {
     String path = getInputConfigPath(pointId);
-    File file = LittleFS.open(path, "r");
-    if (!file) {
-        #if DEBUG_INPUT_MANAGER
-        Serial.println("[InputPointManager] Failed to open input config file for reading.");
-        #endif
+    JsonDocument doc;
+    if (!readFileToJsonDocument(path, doc)) {
+        LOGE(INPUTS, "Failed to read input config file %s.\n", path.c_str());
         return false;
     }
-    String jsonString;
-    while (file.available()) {
-        jsonString += (char)file.read();
+    return config.deserialize(doc.as<JsonObjectConst>());
+}
+
+// --- Calibration curves ---
+
+void InputPointManager::loadCalibrations() {
+    int compiled = 0;
+    for (PointHandle h = 0; h < (PointHandle)pointRegistry.size(); ++h) {
+        const PointEntry* entry = pointRegistry.get(h);
+        if (entry->kind != PointKind::ANALOG_INPUT) continue;
+        if (!LittleFS.exists(getInputConfigPath(entry->pointId))) continue; // Uncalibrated: raw counts
+        InputPointConfig config;
+        if (loadInputPointConfig(entry->pointId, config)) {
+            applyCalibration(config);
+            ++compiled;
+        }
+    }
+    LOGI(INPUTS, "Compiled calibration curves for %d analog input(s).\n", compiled);
+}
+
+// Compiles outside the lock (allocates, compares strings), then swaps the curve in
+void InputPointManager::applyCalibration(const InputPointConfig& config) {
+    PointHandle handle = pointRegistry.resolve(config.pointId, PointKind::ANALOG_INPUT);
+    const PointEntry* entry = pointRegistry.get(handle);
+    if (!entry || entry->localIndex < 0 || entry->localIndex >= (int)aiPins.size()) {
+        return; // Config for a point this board does not sample
+    }
+    AnalogCurve curve;
+    if (!compileCurve(config, curve)) {
+        LOGW(INPUTS, "Invalid scaling for %s; reporting raw counts.\n", config.pointId.c_str());
+    }
+    portMUX_TYPE* mux = static_cast<portMUX_TYPE*>(curveLock);
+    portENTER_CRITICAL(mux);
+    aiCurves[entry->localIndex] = curve;
+    portEXIT_CRITICAL(mux);
+    LOGD(INPUTS, "%s: %d calibration segment(s)%s\n", config.pointId.c_str(), curve.segmentCount,
+         curve.tempSource != INVALID_POINT_HANDLE ? ", temperature compensated" : "");
+}
+
+/**
+ * @brief Folds scaling, calibration and the range mapping into one piecewise-linear curve over raw counts.
+ *
+ * Raw counts are first scaled to the input quantity x = (volts + offset) * multiplier / divisor
+ * ("dc_voltage"; other reference types use the count itself). x maps to the engineering value via
+ * the calibration points (data and custom, merged) if enabled with at least two points, otherwise
+ * linearly from input_range to output_range, otherwise identity. The end segments extrapolate.
+ * Because x is linear in the raw count, every breakpoint can be moved into the raw domain and
+ * each segment reduced to one slope and intercept.
+ *
+ * @return False (and an empty curve: raw passthrough) if the scaling is degenerate.
+ */
+bool InputPointManager::compileCurve(const InputPointConfig& config, AnalogCurve& curve) {
+    curve = AnalogCurve();
+    const InputScalingConfig& scaling = config.inputConfig.input_scaling;
+    if (scaling.divisor == 0.0f || scaling.multiplier == 0.0f) {
+        return false;
+    }
+    float unitsPerCount = scaling.reference_type.equalsIgnoreCase("dc_voltage")
+        ? INPUT_ADC_REFERENCE_VOLTS / INPUT_ADC_MAX_COUNT : 1.0f;
+    float a = unitsPerCount * scaling.multiplier / scaling.divisor; // x = a * raw + b
+    float b = scaling.offset * scaling.multiplier / scaling.divisor;
+
+    // (x, value) breakpoints
+    std::vector<std::pair<float, float>> points;
+    const CalibrationConfig& calibration = config.inputConfig.calibration;
+    if (calibration.enabled) {
+        for (const CalibrationPoint& p : calibration.data_points) points.push_back({p.voltage, p.pressure});
+        for (const CalibrationPoint& p : calibration.custom_points) points.push_back({p.voltage, p.pressure});
     }
-    file.close();
-    return config.deserialize(jsonString);
+    if (points.size() < 2) {
+        points.clear();
+        const Range& in = scaling.input_range;
+        const Range& out = scaling.output_range;
+        if (in.max_voltage != in.min_voltage) {
+            points.push_back({in.min_voltage, out.min_pressure});
+            points.push_back({in.max_voltage, out.max_pressure});
+        } else {
+            points.push_back({0.0f, 0.0f});
+            points.push_back({1.0f, 1.0f});
+        }
+    }
+    std::sort(points.begin(), points.end());
+    points.erase(std::unique(points.begin(), points.end(),
+        [](const std::pair<float, float>& l, const std::pair<float, float>& r) { return l.first == r.first; }),
+        points.end());
+    if (points.size() < 2) {
+        return false;
+    }
+    if (points.size() > INPUT_CAL_MAX_SEGMENTS + 1) {
+        LOGW(INPUTS, "%s: %d calibration points, using the first %d.\n",
+             config.pointId.c_str(), (int)points.size(), INPUT_CAL_MAX_SEGMENTS + 1);
+        points.resize(INPUT_CAL_MAX_SEGMENTS + 1);
+    }
+
+    // Breakpoints in raw counts (a negative multiplier reverses their order)
+    for (auto& p : points) p.first = (p.first - b) / a;
+    std::sort(points.begin(), points.end());
+
+    uint8_t count = 0;
+    for (size_t i = 0; i + 1 < points.size(); ++i) {
+        int start = (i == 0) ? 0 : constrain((int)ceilf(points[i].first), 0, INPUT_ADC_MAX_COUNT + 1);
+        if (start > INPUT_ADC_MAX_COUNT) break; // Remaining segments lie above the ADC range
+        if (count > 0 && start <= curve.segmentStart[count - 1]) --count; // Previous one lies below 0
+        float slope = (points[i + 1].second - points[i].second) / (points[i + 1].first - points[i].first);
+        curve.segmentStart[count] = (uint16_t)start;
+        curve.slope[count] = slope;
+        curve.intercept[count] = points[i].second - slope * points[i].first;
+        ++count;
+    }
+    curve.segmentCount = count;
+    uint8_t seg = 0;
+    for (int bucket = 0; bucket < INPUT_CAL_BUCKETS; ++bucket) {
+        int first = bucket << INPUT_CAL_BUCKET_SHIFT;
+        while (seg + 1 < count && curve.segmentStart[seg + 1] <= first) ++seg;
+        curve.bucketSegment[bucket] = seg;
+    }
+
+    const TempCompensationConfig& temp = config.inputConfig.temperature_compensation;
+    if (temp.enabled && temp.source_pointId.length() > 0) {
+        curve.tempSource = pointRegistry.resolve(temp.source_pointId);
+        if (curve.tempSource == INVALID_POINT_HANDLE) {
+            LOGW(INPUTS, "%s: temperature source %s not found, compensation off.\n",
+                 config.pointId.c_str(), temp.source_pointId.c_str());
+        }
+        curve.tempCenter = temp.center_point;
+        curve.tempSlope = temp.slope;
+        curve.tempOffset = temp.offset;
+        curve.tempIntervalMs = (uint32_t)max(temp.update_interval_minutes, 1) * 60000UL;
+    }
+    return true;
 }
 
 // Helper functions
@@ -185,19 +569,11 @@ String InputPointManager::sanitizeFilename(const String& input) {
 }
 
 bool InputPointManager::readFileToJsonDocument(const String& path, JsonDocument& doc) {
-    File file = LittleFS.open(path, "r");
-    if (!file) return false;
-    DeserializationError error = deserializeJson(doc, file);
-    file.close();
-    return !error;
+    return readJsonFile(path, doc) == FileReadResult::OK && !doc.isNull();
 }
 
 bool InputPointManager::writeJsonDocumentToFile(const String& path, JsonDocument& doc) {
-    File file = LittleFS.open(path, "w");
-    if (!file) return false;
-    bool ok = (serializeJson(doc, file) > 0);
-    file.close();
-    return ok;
+    return writeJsonFileAtomic(path, doc);
 }
 
 void InputPointManager::ensureDirectoryExists(const String& path) {
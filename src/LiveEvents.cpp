@@ -0,0 +1,231 @@
+#include "LiveEvents.h"
+#include "TaskConfig.h"
+#include "PointRegistry.h"
+#include "OutputPointManager.h"
+#include "InputPointManager.h"
+#include "FlowMeterManager.h"
+#include <ESPAsyncWebServer.h>
+#include <ArduinoJson.h> // V7
+#include <math.h>
+#include <memory>
+#include <algorithm>
+
+// FreeRTOS includes
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+namespace {
+// RAII holder for the outbox mutex
+struct OutboxGuard {
+    SemaphoreHandle_t mutex;
+    explicit OutboxGuard(void* m) : mutex((SemaphoreHandle_t)m) {
+        if (mutex) xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+    ~OutboxGuard() {
+        if (mutex) xSemaphoreGive(mutex);
+    }
+};
+} // namespace
+
+// Per-connection read position in the outbox; only touched by the async TCP task
+struct LiveEvents::ClientStream {
+    uint32_t nextSeq = 0; ///< Next outbox message to send
+    String frame;         ///< Message being copied out
+    size_t pos = 0;       ///< Bytes of frame already sent
+};
+
+extern PointRegistry pointRegistry;
+extern OutputPointManager outputManager;
+extern InputPointManager inputManager;
+extern FlowMeterManager flowMeterManager;
+
+void LiveEvents::attach(AsyncWebServer& server, std::function<bool(AsyncWebServerRequest*)> authorize) {
+    if (outboxMutex) return;
+    outboxMutex = xSemaphoreCreateMutex();
+    if (!outboxMutex) {
+        Serial.println("[LiveEvents] Failed to create outbox mutex; push channel disabled.");
+        return;
+    }
+    // Runs on the async TCP task: the stream starts at the next message, which the
+    // publisher makes a snapshot for this client
+    server.on(LIVE_EVENTS_PATH, HTTP_GET, [this, authorize](AsyncWebServerRequest *request) {
+        if (authorize && !authorize(request)) {
+            request->send(401, "application/json", "{\"error\":\"Not authenticated\"}");
+            return;
+        }
+        std::shared_ptr<ClientStream> client = std::make_shared<ClientStream>();
+        {
+            OutboxGuard guard(outboxMutex);
+            client->nextSeq = outboxSeq;
+        }
+        clientCount.fetch_add(1);
+        request->onDisconnect([this]() { clientCount.fetch_sub(1); });
+        AsyncWebServerResponse *response = request->beginChunkedResponse("text/event-stream",
+            [this, client](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                (void)index;
+                return fillClient(*client, buffer, maxLen);
+            });
+        response->addHeader("Cache-Control", "no-store");
+        request->send(response);
+        notify(LIVE_CHANGE_CONNECT);
+    });
+}
+
+bool LiveEvents::begin() {
+    if (publisherTaskHandle) {
+        return true;
+    }
+    if (!outboxMutex) {
+        Serial.println("[LiveEvents] attach() was not called; push channel disabled.");
+        return false;
+    }
+    sentValues.assign(pointRegistry.size(), NAN);
+    BaseType_t taskCreated = xTaskCreatePinnedToCore(
+        publisherTaskWrapper,
+        "LiveEventsTask",
+        4096,
+        this,
+        TASK_PRIORITY_LIVE_EVENTS,
+        (TaskHandle_t*)&publisherTaskHandle,
+        SERVICE_CORE
+    );
+    if (taskCreated != pdPASS) {
+        publisherTaskHandle = nullptr;
+        Serial.println("[LiveEvents] Failed to create publisher task.");
+        return false;
+    }
+    return true;
+}
+
+void LiveEvents::notify(uint32_t changeBits) {
+    TaskHandle_t task = (TaskHandle_t)publisherTaskHandle;
+    if (task) xTaskNotify(task, changeBits, eSetBits);
+}
+
+void LiveEvents::publisherTaskWrapper(void* parameter) {
+    static_cast<LiveEvents*>(parameter)->publisherTask();
+}
+
+void LiveEvents::publisherTask() {
+    uint32_t pending = 0;
+    uint32_t lastBroadcastMs = millis() - LIVE_EVENTS_MIN_INTERVAL_MS;
+    while (true) {
+        // Without clients there is nothing to compare against: sleep until a change or a connect
+        TickType_t wait = clientCount.load() > 0 ? pdMS_TO_TICKS(LIVE_EVENTS_INPUT_CHECK_MS) : portMAX_DELAY;
+        uint32_t bits = 0;
+        if (xTaskNotifyWait(0, UINT32_MAX, &bits, wait) == pdFALSE) {
+            bits = LIVE_CHANGE_INPUTS; // Periodic input comparison
+        }
+        pending |= bits;
+        if (clientCount.load() == 0) {
+            pending = 0;
+            continue;
+        }
+
+        // Coalesce: anything notified during the rest of the window joins this broadcast
+        uint32_t elapsed = millis() - lastBroadcastMs;
+        if (elapsed < LIVE_EVENTS_MIN_INTERVAL_MS) {
+            vTaskDelay(pdMS_TO_TICKS(LIVE_EVENTS_MIN_INTERVAL_MS - elapsed));
+            if (xTaskNotifyWait(0, UINT32_MAX, &bits, 0) == pdTRUE) pending |= bits;
+        }
+        broadcast(pending);
+        pending = 0;
+        lastBroadcastMs = millis();
+    }
+}
+
+float LiveEvents::readPoint(size_t handle) const {
+    const PointEntry* entry = pointRegistry.get((PointHandle)handle);
+    switch (entry->kind) {
+        case PointKind::RELAY_OUTPUT:  return outputManager.getRelayState((PointHandle)handle) ? 1.0f : 0.0f;
+        case PointKind::DIGITAL_INPUT: return inputManager.getCurrentState((PointHandle)handle) ? 1.0f : 0.0f;
+        case PointKind::FLOW_METER:    return flowMeterManager.getTotalLiters((PointHandle)handle);
+        default:                       return inputManager.getCurrentValue((PointHandle)handle);
+    }
+}
+
+// Binary points push every flip; analog and Modbus values only past the deadband
+// (going to or from "unknown" (-1) always exceeds it for any real reading)
+bool LiveEvents::valueChanged(size_t handle, float value) const {
+    float sent = sentValues[handle];
+    if (isnan(sent)) return true;
+    PointKind kind = pointRegistry.get((PointHandle)handle)->kind;
+    if (kind == PointKind::RELAY_OUTPUT || kind == PointKind::DIGITAL_INPUT) return value != sent;
+    return fabsf(value - sent) >= LIVE_EVENTS_ANALOG_DEADBAND;
+}
+
+/**
+ * @brief Serializes the changes since the last broadcast once and queues them to every client.
+ *
+ * With LIVE_CHANGE_CONNECT the full state is sent as a "snapshot" instead, so a new
+ * client never depends on deltas it did not see; already connected clients simply
+ * replace their state with it.
+ */
+void LiveEvents::broadcast(uint32_t changeBits) {
+    bool full = (changeBits & LIVE_CHANGE_CONNECT) != 0;
+    if (changeBits & LIVE_CHANGE_SCHEDULES) ++schedulesRev;
+    if (changeBits & LIVE_CHANGE_LOCKS) ++locksRev;
+    if (sentValues.size() != pointRegistry.size()) sentValues.resize(pointRegistry.size(), NAN);
+
+    JsonDocument doc;
+    bool changed = false;
+    for (size_t h = 0; h < sentValues.size(); ++h) {
+        float value = readPoint(h);
+        if (!full && !valueChanged(h, value)) continue;
+        doc["points"][pointRegistry.get((PointHandle)h)->pointId] = value;
+        sentValues[h] = value;
+        changed = true;
+    }
+    if (full || (changeBits & LIVE_CHANGE_SCHEDULES)) {
+        doc["schedulesRev"] = schedulesRev;
+        changed = true;
+    }
+    if (full || (changeBits & LIVE_CHANGE_LOCKS)) {
+        doc["locksRev"] = locksRev;
+        changed = true;
+    }
+    if (!changed) return;
+
+    String frame = "id: " + String(++eventId) + "\nevent: " + (full ? "snapshot" : "delta") + "\ndata: ";
+    serializeJson(doc, frame);
+    frame += "\n\n";
+    publish(std::move(frame));
+}
+
+// Publisher task: the client streams pick the message up on their next ack or poll
+void LiveEvents::publish(String frame) {
+    OutboxGuard guard(outboxMutex);
+    outbox[outboxSeq % LIVE_EVENTS_OUTBOX_LENGTH] = std::move(frame);
+    ++outboxSeq;
+}
+
+/**
+ * @brief Chunk filler of one client stream; runs on the async TCP task.
+ *
+ * Never returns 0 (that would end the stream): with nothing new it asks to be called
+ * again. A client that fell more than LIVE_EVENTS_OUTBOX_LENGTH messages behind skips
+ * to the newest one and a fresh snapshot is requested, so it never applies a delta on
+ * top of missing ones.
+ */
+size_t LiveEvents::fillClient(ClientStream& client, uint8_t* buffer, size_t maxLen) {
+    if (client.pos >= client.frame.length()) {
+        bool resync = false;
+        {
+            OutboxGuard guard(outboxMutex);
+            if (client.nextSeq == outboxSeq) return RESPONSE_TRY_AGAIN;
+            if (outboxSeq - client.nextSeq > LIVE_EVENTS_OUTBOX_LENGTH) {
+                client.nextSeq = outboxSeq - 1;
+                resync = true;
+            }
+            client.frame = outbox[client.nextSeq % LIVE_EVENTS_OUTBOX_LENGTH];
+            ++client.nextSeq;
+        }
+        client.pos = 0;
+        if (resync) notify(LIVE_CHANGE_CONNECT);
+    }
+    size_t len = std::min(maxLen, client.frame.length() - client.pos);
+    memcpy(buffer, client.frame.c_str() + client.pos, len);
+    client.pos += len;
+    return len;
+}
@@ -3,7 +3,36 @@
 #include <LittleFS.h>
 #include <ArduinoJson.h> // V7
 #include <vector>
-#include <algorithm> // For std::remove_if
+#include "Benchmark.h" // BENCH_SCOPE (benchmark builds only)
+#include "AtomicFile.h" // Temp + rename writes, CRC-checked reads
+#include "LiveEvents.h" // Lock change notifications for /api/events
+#include "CycleManager.h" // Schedules of running cycles are not lockable
+#include "PersistenceWorker.h" // Write-behind flushes
+
+// FreeRTOS includes (mutex guarding the in-memory lock table)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+namespace {
+// Scoped helper that holds the lock table (or lock file) mutex for the lifetime of the
+// object, or until release(). Web requests (async TCP task), the main loop and the
+// persistence worker all touch the table.
+struct LockTableGuard {
+    SemaphoreHandle_t mutex;
+    explicit LockTableGuard(void* m) : mutex((SemaphoreHandle_t)m) {
+        if (mutex) xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+    ~LockTableGuard() { release(); }
+    void release() {
+        if (mutex) xSemaphoreGive(mutex);
+        mutex = nullptr;
+    }
+};
+} // namespace
+
+extern LiveEvents liveEvents;
+extern CycleManager cycleManager;
+extern PersistenceWorker persistenceWorker;
 
 // --- LockManager Implementation ---
 
@@ -23,15 +52,32 @@ LockManager::LockManager(const char* lockFilePath) : _lockFilePath(lockFilePath)
 /**
  * @brief Initializes the LockManager.
  *
- * Ensures the parent directory for the lock file exists, creating it if necessary.
+ * Creates the mutex guarding the in-memory lock table. Ensures the parent
+ * directory for the lock file exists, creating it if necessary.
  * Checks if the lock file itself exists; if not, it creates an empty, valid
- * JSON array file. This ensures the manager starts in a consistent state.
+ * JSON array file. Otherwise it loads the persisted locks into the in-memory
+ * table, which is the source of truth from then on.
  *
  * @return True if initialization is successful (directory and file exist or
  *         were created), false if directory creation fails.
  */
 bool LockManager::begin() {
     Serial.println("Initializing LockManager...");
+    if (!tableMutex) {
+        tableMutex = xSemaphoreCreateMutex();
+        if (!tableMutex) {
+            Serial.println("FATAL: Failed to create lock table mutex.");
+            return false;
+        }
+    }
+    if (!fileMutex) {
+        fileMutex = xSemaphoreCreateMutex();
+        if (!fileMutex) {
+            Serial.println("FATAL: Failed to create lock file mutex.");
+            return false;
+        }
+    }
+
     // Ensure the parent directory exists
     String parentDir = "/locks";
     if (!LittleFS.exists(parentDir)) {
@@ -45,59 +91,79 @@ bool LockManager::begin() {
     // Check if lock file exists, create an empty one if not
     if (!LittleFS.exists(_lockFilePath)) {
         Serial.printf("Lock file '%s' not found. Creating empty lock file.\n", _lockFilePath.c_str());
-        std::vector<FileLock> emptyLocks;
-        if (!saveAllLocks(emptyLocks)) {
+        {
+            LockTableGuard guard(tableMutex);
+            activeLocks.clear();
+        }
+        if (!saveAllLocks()) {
             Serial.printf("FATAL: Failed to create empty lock file '%s'.\n", _lockFilePath.c_str());
             return false;
         }
     } else {
-        // Optional: Validate existing lock file format on startup?
         Serial.printf("Lock file found: %s\n", _lockFilePath.c_str());
+        LockTableGuard guard(tableMutex);
+        if (!loadAllLocks()) {
+            // Corrupt file: start with an empty table and overwrite it on the next flush
+            Serial.println("Lock file could not be loaded. Starting with an empty lock table.");
+            activeLocks.clear();
+            markDirty();
+        }
     }
-    Serial.println("LockManager initialized successfully.");
+    persistenceWorker.addPeriodic(flushJob, this, LOCK_FLUSH_CHECK_MS);
+    Serial.printf("LockManager initialized successfully (%u lock(s) loaded).\n", (unsigned)activeLocks.size());
     return true;
 }
 
+// Internal helper to flag the lock table as changed
+/**
+ * @brief Marks the in-memory lock table as having unflushed changes.
+ * @note Internal helper function. Caller must hold `tableMutex`.
+ *
+ * Only the first change after a successful flush starts the flush window, so
+ * a burst of acquire/release calls is written out as a single batch.
+ */
+void LockManager::markDirty() {
+    liveEvents.notify(LIVE_CHANGE_LOCKS); // Every lock table change passes through here
+    tableGeneration++;
+    if (!locksDirty) {
+        locksDirty = true;
+        firstDirtyTime = millis();
+    }
+}
+
 // Internal helper to load all active locks
 /**
- * @brief Loads all active locks from the lock file into a vector.
- * @note Internal helper function.
+ * @brief Loads all active locks from the lock file into the in-memory table.
+ * @note Internal helper function. Called once from `begin()`.
  *
  * Opens the lock file, reads its content, and parses it as a JSON array
- * of FileLock objects. Populates the provided vector with valid locks found
- * in the file. Clears the vector before loading. Handles empty files and
+ * of FileLock objects. Populates `activeLocks` with valid locks found
+ * in the file. Clears the table before loading. Handles empty files and
  * JSON parsing errors gracefully.
  *
- * @param locks A reference to a std::vector<FileLock> to be populated with the loaded locks.
  * @return True if the file was opened and parsed successfully (even if empty),
  *         false if the file could not be opened or if JSON parsing failed.
  */
-bool LockManager::loadAllLocks(std::vector<FileLock>& locks) { // Corrected: &
-    locks.clear(); // Clear the vector before loading
-
-    File lockFile = LittleFS.open(_lockFilePath, "r");
-    if (!lockFile) {
-        Serial.printf("Failed to open lock file for reading: %s\n", _lockFilePath.c_str());
-        return false;
-    }
-    if (lockFile.size() == 0) {
-        // File is empty, which is valid (no locks)
-        lockFile.close();
-        return true;
-    }
+bool LockManager::loadAllLocks() {
+    activeLocks.clear(); // Clear the table before loading
 
     // V7: Use JsonDocument
     JsonDocument doc;
-    // StaticJsonDocument<4096> doc; // Consider static if max size known
-
-    DeserializationError error = deserializeJson(doc, lockFile);
-    lockFile.close();
 
-    if (error) {
-        Serial.printf("Failed to parse lock file %s: %s\n", _lockFilePath.c_str(), error.c_str());
+    FileReadResult result = readJsonFile(_lockFilePath, doc);
+    if (result == FileReadResult::NOT_FOUND) {
+        Serial.printf("Failed to open lock file for reading: %s\n", _lockFilePath.c_str());
+        return false;
+    }
+    if (result != FileReadResult::OK) {
+        Serial.printf("Failed to parse lock file %s\n", _lockFilePath.c_str());
         Serial.println("Lock file might be corrupted. Treating as empty.");
         return false; // Indicate failure
     }
+    if (doc.isNull()) {
+        // File is empty, which is valid (no locks)
+        return true;
+    }
 
     JsonArray array = doc.as<JsonArray>();
     if (array.isNull()) {
@@ -114,41 +180,39 @@ bool LockManager::loadAllLocks(std::vector<FileLock>& locks) { // Corrected: &
         lock.timestamp = lockObj["timestamp"] | 0UL;
 
         if (lock.isValid()) {
-            locks.push_back(lock);
+            activeLocks[lock.resourceId] = lock;
         } else {
              Serial.println("Warning: Found invalid lock data in lock file. Skipping.");
         }
     }
-    // Serial.printf("Loaded %d locks from file.\n", locks.size()); // Debug
     return true;
 }
 
 // Internal helper to save all active locks
 /**
- * @brief Saves a vector of active locks to the lock file.
- * @note Internal helper function.
+ * @brief Saves the in-memory lock table to the lock file.
+ * @note Internal helper function. Caller must not hold `tableMutex`.
  *
- * Opens the lock file in write mode (truncating existing content).
- * Serializes the provided vector of FileLock objects into a JSON array
- * and writes it to the file. Only valid locks from the vector are saved.
+ * Serializes all entries of `activeLocks` into a JSON array while holding
+ * `tableMutex` (only valid locks are saved), then writes the copy through
+ * writeJsonFileAtomic() (temp file + rename, CRC) without it, so lock checks on
+ * the web server task never wait for flash. `fileMutex` keeps concurrent flushes
+ * in order. Clears the dirty flag on success unless the table changed meanwhile.
  *
- * @param locks A constant reference to a std::vector<FileLock> containing the locks to save.
  * @return True if the file was opened and the JSON was serialized successfully,
  *         false otherwise.
  */
-bool LockManager::saveAllLocks(const std::vector<FileLock>& locks) { // Corrected: &
-    File lockFile = LittleFS.open(_lockFilePath, "w"); // Open for writing (truncates)
-    if (!lockFile) {
-        Serial.printf("Failed to open lock file for writing: %s\n", _lockFilePath.c_str());
-        return false;
-    }
-
+bool LockManager::saveAllLocks() {
+    LockTableGuard fileGuard(fileMutex);
     // V7: Use JsonDocument
     JsonDocument doc;
-    // StaticJsonDocument<4096> doc; // Consider static if max size known
     JsonArray array = doc.to<JsonArray>();
+    uint32_t generation;
 
-    for (const auto& lock : locks) {
+    LockTableGuard tableGuard(tableMutex);
+    generation = tableGeneration;
+    for (const auto& pair : activeLocks) {
+        const FileLock& lock = pair.second;
         if (lock.isValid()) { // Only save valid locks
             JsonObject lockObj = array.add<JsonObject>(); // V7: Use add<T>()
             lockObj["resourceId"] = lock.resourceId;
@@ -159,14 +223,37 @@ bool LockManager::saveAllLocks(const std::vector<FileLock>& locks) { // Correcte
         }
     }
 
-    if (serializeJson(doc, lockFile) == 0) {
+    tableGuard.release();
+
+    // An empty array still serializes to "[]", so 0 bytes always means a write failure
+    // Atomic + CRC: a power cut mid-save keeps the previous lock table instead of an unparsable file
+    if (!writeJsonFileAtomic(_lockFilePath, doc, true)) {
         Serial.printf("Failed to write lock data to file: %s\n", _lockFilePath.c_str());
-        lockFile.close();
         return false;
     }
 
-    lockFile.close();
-    // Serial.printf("Saved %d locks to file.\n", locks.size()); // Debug
+    LockTableGuard doneGuard(tableMutex);
+    if (generation == tableGeneration) locksDirty = false;
+    return true;
+}
+
+/**
+ * @brief Writes pending lock table changes to the lock file.
+ *
+ * Does nothing (and returns true) if the table has no unflushed changes.
+ * On failure the table stays dirty so the next flush retries the write.
+ *
+ * @return True if the table was clean or was written successfully, false otherwise.
+ */
+bool LockManager::flushLocks() {
+    {
+        LockTableGuard guard(tableMutex);
+        if (!locksDirty) return true;
+    }
+    if (!saveAllLocks()) {
+        Serial.println("Error flushing lock table to file.");
+        return false;
+    }
     return true;
 }
 
@@ -174,61 +261,47 @@ bool LockManager::saveAllLocks(const std::vector<FileLock>& locks) { // Correcte
 /**
  * @brief Attempts to acquire a lock on a specific resource for a given session.
  *
- * Loads the current locks, checks if the resource is already locked by a
- * different session. If locked by the same session, it updates the timestamp
- * (idempotent acquire). If not locked, it creates a new lock entry with the
- * current timestamp and saves the updated lock list.
+ * Looks up the resource in the in-memory lock table. Fails if the resource is
+ * already locked by a different session. If locked by the same session, it
+ * updates the timestamp (idempotent acquire). If not locked, it creates a new
+ * lock entry with the current timestamp. Schedules run by the current step of
+ * an active cycle (CycleManager) cannot be locked. The change is written to the
+ * lock file on the next batched flush.
  *
  * @param resourceId The unique identifier of the resource to lock (e.g., "schedule_abc").
  * @param lockType The type of lock being acquired (e.g., EDITING_SCHEDULE).
  * @param session A constant reference to the SessionData object of the user acquiring the lock.
  * @return True if the lock was acquired successfully (or already held by the session),
- *         false if the resource is locked by another session, if parameters are invalid,
- *         or if loading/saving locks fails.
+ *         false if the resource is locked by another session or if parameters are invalid.
  */
 bool LockManager::acquireLock(const String& resourceId, LockType lockType, const SessionData& session) {
+    BENCH_SCOPE(benchAcquireLock);
     if (resourceId.isEmpty() || !session.isValid()) {
         Serial.println("Error: Invalid parameters for acquireLock.");
         return false;
     }
 
-    std::vector<FileLock> currentLocks;
-    if (!loadAllLocks(currentLocks)) {
-        Serial.println("Error loading locks, cannot acquire new lock.");
-        // This indicates a potentially serious filesystem/parsing issue.
-        return false;
-    }
+    LockTableGuard guard(tableMutex);
 
     // Check if resource is already locked by *another* session
-    for (const auto& existingLock : currentLocks) {
-        if (existingLock.resourceId == resourceId) {
-            if (existingLock.sessionId != session.sessionId) {
-                // Locked by someone else
-                Serial.printf("Resource '%s' already locked by session '%s' (User: %s).\n",
-                              resourceId.c_str(), existingLock.sessionId.c_str(), existingLock.username.c_str());
-                return false;
-            } else {
-                // Already locked by the *same* session - allow re-acquiring? Or just return true?
-                // Let's update the timestamp and return true (idempotent acquire)
-                Serial.printf("Resource '%s' already locked by this session. Updating timestamp.\n", resourceId.c_str());
-                // Find the lock and update its timestamp (mutable vector needed, or reload/save)
-                // Easiest is to remove the old one and add a new one.
-                 currentLocks.erase(std::remove_if(currentLocks.begin(), currentLocks.end(),
-                                   [&](const FileLock& l){ return l.resourceId == resourceId && l.sessionId == session.sessionId; }),
-                                   currentLocks.end());
-                 // Now add the new one below
-                 break; // Exit loop after finding the lock
-            }
+    auto it = activeLocks.find(resourceId);
+    if (it != activeLocks.end()) {
+        const FileLock& existingLock = it->second;
+        if (existingLock.sessionId != session.sessionId) {
+            // Locked by someone else
+            Serial.printf("Resource '%s' already locked by session '%s' (User: %s).\n",
+                          resourceId.c_str(), existingLock.sessionId.c_str(), existingLock.username.c_str());
+            return false;
         }
+        // Already locked by the *same* session - refresh the timestamp below (idempotent acquire)
+        Serial.printf("Resource '%s' already locked by this session. Updating timestamp.\n", resourceId.c_str());
     }
 
-    // --- TODO: Add check here: Is resource part of an ACTIVE cycle? ---
-    // This requires access to cycle management logic, which isn't built yet.
-    // bool isActive = CycleManager::isResourceInActiveCycle(resourceId);
-    // if (isActive) {
-    //    Serial.printf("Cannot acquire lock: Resource '%s' is part of an active cycle.\n", resourceId.c_str());
-    //    return false;
-    // }
+    // Schedules run by an active cycle's current step can't be edited
+    if (cycleManager.isResourceInActiveCycle(resourceId)) {
+        Serial.printf("Cannot acquire lock: Resource '%s' is part of an active cycle.\n", resourceId.c_str());
+        return false;
+    }
 
     // Acquire the lock
     FileLock newLock;
@@ -243,97 +316,71 @@ bool LockManager::acquireLock(const String& resourceId, LockType lockType, const
         return false;
     }
 
-    currentLocks.push_back(newLock);
+    activeLocks[resourceId] = newLock;
+    markDirty();
 
-    if (saveAllLocks(currentLocks)) {
-        Serial.printf("Lock acquired for resource '%s' by session '%s' (User: %s).\n",
-                      resourceId.c_str(), session.sessionId.c_str(), session.username.c_str());
-        return true;
-    } else {
-        Serial.println("Error saving locks after acquiring new lock.");
-        return false;
-    }
+    Serial.printf("Lock acquired for resource '%s' by session '%s' (User: %s).\n",
+                  resourceId.c_str(), session.sessionId, session.username);
+    return true;
 }
 
 /**
  * @brief Releases a specific lock held by a specific session.
  *
- * Loads the current locks, finds the lock matching the resource ID and session ID,
- * removes it from the list, and saves the updated list.
+ * Looks up the resource in the in-memory lock table and removes the entry
+ * if it is held by the given session. The change is written to the lock
+ * file on the next batched flush.
  *
  * @param resourceId The unique identifier of the resource whose lock is to be released.
  * @param sessionId The ID of the session that holds the lock.
- * @return True if the lock was found and successfully removed and saved,
- *         false if the lock was not found for the given resource/session,
- *         or if loading/saving locks fails.
+ * @return True if the lock was found and removed, false if the lock was not
+ *         found for the given resource/session.
  */
 bool LockManager::releaseLock(const String& resourceId, const String& sessionId) {
      if (resourceId.isEmpty() || sessionId.isEmpty()) return false;
 
-    std::vector<FileLock> currentLocks;
-    if (!loadAllLocks(currentLocks)) {
-        Serial.println("Error loading locks, cannot release lock.");
-        return false;
-    }
-
-    size_t initialSize = currentLocks.size();
-    currentLocks.erase(std::remove_if(currentLocks.begin(), currentLocks.end(),
-                       [&](const FileLock& lock){ return lock.resourceId == resourceId && lock.sessionId == sessionId; }),
-                       currentLocks.end());
+    LockTableGuard guard(tableMutex);
 
-    if (currentLocks.size() < initialSize) {
-        // Lock was found and removed
-        if (saveAllLocks(currentLocks)) {
-             Serial.printf("Lock released for resource '%s' by session '%s'.\n", resourceId.c_str(), sessionId.c_str());
-             return true;
-        } else {
-            Serial.println("Error saving locks after releasing lock.");
-            // Attempt to restore? Or just report error? Report error for now.
-            return false;
-        }
-    } else {
+    auto it = activeLocks.find(resourceId);
+    if (it == activeLocks.end() || it->second.sessionId != sessionId) {
         // Lock not found for this resource/session combination
-        // Serial.printf("Lock not found for release: Resource '%s', Session '%s'.\n", resourceId.c_str(), sessionId.c_str()); // Debug
         return false;
     }
+
+    activeLocks.erase(it);
+    markDirty();
+    Serial.printf("Lock released for resource '%s' by session '%s'.\n", resourceId.c_str(), sessionId.c_str());
+    return true;
 }
 
 /**
  * @brief Releases all locks held by a specific session.
  *
- * Loads the current locks, removes all entries associated with the given session ID,
- * and saves the updated list. Useful for cleaning up locks on user logout or session expiry.
+ * Removes all entries associated with the given session ID from the in-memory
+ * lock table. Useful for cleaning up locks on user logout or session expiry.
  *
  * @param sessionId The ID of the session whose locks should be released.
- * @return The number of locks that were successfully released and saved. Returns 0
- *         if no locks were found for the session or if loading/saving fails.
+ * @return The number of locks that were released. Returns 0 if no locks were
+ *         found for the session.
  */
 int LockManager::releaseLocksForSession(const String& sessionId) {
     if (sessionId.isEmpty()) return 0;
 
-    std::vector<FileLock> currentLocks;
-    if (!loadAllLocks(currentLocks)) {
-        Serial.println("Error loading locks, cannot release locks for session.");
-        return 0;
-    }
-
-    size_t initialSize = currentLocks.size();
-    currentLocks.erase(std::remove_if(currentLocks.begin(), currentLocks.end(),
-                       [&](const FileLock& lock){ return lock.sessionId == sessionId; }),
-                       currentLocks.end());
+    LockTableGuard guard(tableMutex);
 
-    int releasedCount = initialSize - currentLocks.size();
-
-    if (releasedCount > 0) {
-        if (saveAllLocks(currentLocks)) {
-             Serial.printf("Released %d lock(s) for session '%s'.\n", releasedCount, sessionId.c_str());
+    int releasedCount = 0;
+    for (auto it = activeLocks.begin(); it != activeLocks.end(); ) {
+        if (it->second.sessionId == sessionId) {
+            it = activeLocks.erase(it);
+            releasedCount++;
         } else {
-            Serial.printf("Error saving locks after releasing %d lock(s) for session '%s'.\n", releasedCount, sessionId.c_str());
-            // Locks might be released in memory but not saved - problematic.
-            // Return 0 to indicate failure? Or return count but log error? Log error, return count.
+            ++it;
         }
-    } else {
-         // Serial.printf("No locks found to release for session '%s'.\n", sessionId.c_str()); // Debug
+    }
+
+    if (releasedCount > 0) {
+        markDirty();
+        Serial.printf("Released %d lock(s) for session '%s'.\n", releasedCount, sessionId.c_str());
     }
     return releasedCount;
 }
@@ -341,30 +388,25 @@ int LockManager::releaseLocksForSession(const String& sessionId) {
 /**
  * @brief Checks if a specific resource is currently locked.
  *
- * Loads the current locks and searches for an entry matching the given resource ID.
+ * Looks up the resource ID in the in-memory lock table (no filesystem access).
  * Optionally copies the lock information if found.
  *
  * @param resourceId The unique identifier of the resource to check.
  * @param lockInfo Optional. A pointer to a FileLock struct. If provided and the
  *                 resource is locked, the details of the lock will be copied here.
- * @return True if the resource is currently locked, false otherwise or if loading locks fails.
+ * @return True if the resource is currently locked, false otherwise.
  */
 bool LockManager::isLocked(const String& resourceId, FileLock* lockInfo) {
-    std::vector<FileLock> currentLocks;
-    // Don't print error here, just check status
-    if (!loadAllLocks(currentLocks)) {
-        return false; // Treat load failure as "not locked" for safety? Or indicate error? Let's say not locked.
-    }
+    LockTableGuard guard(tableMutex);
 
-    for (const auto& lock : currentLocks) {
-        if (lock.resourceId == resourceId) {
-            if (lockInfo) {
-                *lockInfo = lock; // Copy lock info if pointer provided
-            }
-            return true; // Resource is locked
-        }
+    auto it = activeLocks.find(resourceId);
+    if (it == activeLocks.end()) {
+        return false; // Resource not found in locks
+    }
+    if (lockInfo) {
+        *lockInfo = it->second; // Copy lock info if pointer provided
     }
-    return false; // Resource not found in locks
+    return true; // Resource is locked
 }
 
 /**
@@ -384,47 +426,60 @@ bool LockManager::getLockInfo(const String& resourceId, FileLock& lockInfo) {
 
 
 /**
- * @brief Periodically cleans up locks that have exceeded their timeout duration.
+ * @brief Periodically cleans up expired locks.
  *
  * This function should be called regularly within the main application loop.
- * It checks if the configured cleanup interval has passed since the last run.
- * If so, it loads all locks, removes any whose timestamp is older than the
- * current time minus `LOCK_TIMEOUT_MS`, and saves the updated list.
- * Requires `LOCK_TIMEOUT_MS` to be defined and greater than 0 for cleanup to occur.
+ * It checks if the configured cleanup interval has passed since the last run
+ * (without the table mutex, which is only taken for a due sweep). If so, it removes any locks from the in-memory table whose timestamp is older
+ * than the current time minus `LOCK_TIMEOUT_MS`. Only the in-memory table is
+ * changed; flushIfDue() writes it out.
+ * Requires `LOCK_TIMEOUT_MS` to be defined and greater than 0 for expiry to occur.
  */
 void LockManager::cleanupExpiredLocks() {
     #if LOCK_TIMEOUT_MS > 0
+    // Called on every loop() pass: the mutex is only taken when a sweep is due
     unsigned long currentTime = millis();
-    if (currentTime - lastCleanupTime >= LOCK_CLEANUP_INTERVAL_MS) {
-        // Serial.println("Running lock cleanup..."); // Debug
-        std::vector<FileLock> currentLocks;
-        if (!loadAllLocks(currentLocks)) {
-            Serial.println("Error loading locks during cleanup.");
-            lastCleanupTime = currentTime; // Still update time to prevent spamming errors
-            return;
+    if (currentTime - lastCleanupTime.load() < LOCK_CLEANUP_INTERVAL_MS) return;
+    lastCleanupTime.store(currentTime);
+
+    LockTableGuard guard(tableMutex);
+    int cleanedCount = 0;
+    for (auto it = activeLocks.begin(); it != activeLocks.end(); ) {
+        const FileLock& lock = it->second;
+        if (currentTime - lock.timestamp > LOCK_TIMEOUT_MS) {
+            Serial.printf("Lock expired: Resource '%s', Session '%s', User '%s'\n",
+                          lock.resourceId.c_str(), lock.sessionId.c_str(), lock.username.c_str());
+            it = activeLocks.erase(it);
+            cleanedCount++;
+        } else {
+            ++it;
         }
+    }
 
-        size_t initialSize = currentLocks.size();
-        currentLocks.erase(std::remove_if(currentLocks.begin(), currentLocks.end(),
-                           [&](const FileLock& lock){
-                               if (currentTime - lock.timestamp > LOCK_TIMEOUT_MS) {
-                                   Serial.printf("Lock expired: Resource '%s', Session '%s', User '%s'\n",
-                                                 lock.resourceId.c_str(), lock.sessionId.c_str(), lock.username.c_str());
-                                   return true; // Mark for removal
-                               }
-                               return false;
-                           }),
-                           currentLocks.end());
-
-        int cleanedCount = initialSize - currentLocks.size();
-        if (cleanedCount > 0) {
-            if (saveAllLocks(currentLocks)) {
-                Serial.printf("Lock cleanup finished. Removed %d expired lock(s).\n", cleanedCount);
-            } else {
-                 Serial.printf("Error saving locks after cleaning %d expired lock(s).\n", cleanedCount);
-            }
-        }
-        lastCleanupTime = currentTime;
+    if (cleanedCount > 0) {
+        markDirty();
+        Serial.printf("Lock cleanup finished. Removed %d expired lock(s).\n", cleanedCount);
     }
     #endif // LOCK_TIMEOUT_MS > 0
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Writes the batched table changes once `LOCK_FLUSH_INTERVAL_MS` has passed since
+ *        the first unflushed change. The file is never touched when the table is unchanged.
+ */
+void LockManager::flushIfDue() {
+    unsigned long currentTime = millis();
+    {
+        LockTableGuard guard(tableMutex);
+        if (!locksDirty || currentTime - firstDirtyTime < LOCK_FLUSH_INTERVAL_MS) return;
+    }
+    if (!saveAllLocks()) {
+        Serial.println("Error flushing lock table to file. Will retry.");
+        LockTableGuard guard(tableMutex);
+        firstDirtyTime = currentTime; // Back off for another interval before retrying
+    }
+}
+
+void LockManager::flushJob(void* context) {
+    static_cast<LockManager*>(context)->flushIfDue();
+}
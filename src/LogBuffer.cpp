@@ -0,0 +1,131 @@
+#include "LogBuffer.h"
+#include "TaskConfig.h"
+#include <cstring>
+
+// FreeRTOS includes
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+extern LogBuffer logBuffer;
+
+bool LogBuffer::begin() {
+    if (drainTaskHandle) {
+        return true;
+    }
+#if LOG_SERIAL_SINK
+    // Lowest useful priority: printing waits for everything else
+    BaseType_t taskCreated = xTaskCreatePinnedToCore(
+        drainTaskWrapper,
+        "LogDrainTask",
+        3072,
+        this,
+        TASK_PRIORITY_LOG_DRAIN,
+        (TaskHandle_t*)&drainTaskHandle,
+        SERVICE_CORE
+    );
+    if (taskCreated != pdPASS) {
+        drainTaskHandle = nullptr;
+        Serial.println("[LogBuffer] Failed to create drain task.");
+        return false;
+    }
+#endif
+    return true;
+}
+
+void LogBuffer::write(uint8_t level, const char* module, const char* format, va_list args) {
+    uint32_t seq = __atomic_add_fetch(&nextSeq, 1, __ATOMIC_ACQ_REL);
+    LogRecord& record = records[seq % LOG_BUFFER_RECORDS];
+    __atomic_store_n(&record.seq, 0, __ATOMIC_RELEASE); // Readers skip the slot while it is written
+
+    record.timestampMs = millis();
+    record.level = level;
+    record.module = module;
+    int length = vsnprintf(record.text, sizeof(record.text), format, args);
+    if (length < 0) {
+        record.text[0] = '\0';
+    } else {
+        size_t end = min((size_t)length, sizeof(record.text) - 1);
+        while (end > 0 && (record.text[end - 1] == '\n' || record.text[end - 1] == '\r')) {
+            record.text[--end] = '\0';
+        }
+    }
+    __atomic_store_n(&record.seq, seq, __ATOMIC_RELEASE);
+}
+
+uint32_t LogBuffer::oldestSeq() const {
+    uint32_t latest = latestSeq();
+    return (latest > LOG_BUFFER_RECORDS) ? latest - LOG_BUFFER_RECORDS + 1 : 1;
+}
+
+int LogBuffer::read(uint32_t seq, LogRecord& out) const {
+    const LogRecord& record = records[seq % LOG_BUFFER_RECORDS];
+    uint32_t before = __atomic_load_n(&record.seq, __ATOMIC_ACQUIRE);
+    if (before != seq) {
+        // 0 = in progress; a smaller number = writer claimed seq but has not started yet
+        return (before == 0 || before < seq) ? 0 : -1;
+    }
+    out.timestampMs = record.timestampMs;
+    out.level = record.level;
+    out.module = record.module;
+    memcpy(out.text, record.text, sizeof(out.text));
+    out.text[sizeof(out.text) - 1] = '\0';
+    // Seqlock check: a writer that lapped the ring while we copied changes seq
+    if (__atomic_load_n(&record.seq, __ATOMIC_ACQUIRE) != seq) {
+        return -1;
+    }
+    out.seq = seq;
+    return 1;
+}
+
+const char* LogBuffer::levelName(uint8_t level) {
+    switch (level) {
+        case LOG_LEVEL_ERROR: return "E";
+        case LOG_LEVEL_WARN: return "W";
+        case LOG_LEVEL_INFO: return "I";
+        default: return "D";
+    }
+}
+
+void LogBuffer::drainTaskWrapper(void* parameter) {
+    static_cast<LogBuffer*>(parameter)->drainTask();
+}
+
+void LogBuffer::drainTask() {
+    drainCursor = 1;
+    LogRecord record;
+    for (;;) {
+        uint32_t latest = latestSeq();
+        uint32_t oldest = oldestSeq();
+        if (drainCursor < oldest) {
+            Serial.printf("[LogBuffer] %u messages dropped\n", (unsigned)(oldest - drainCursor));
+            drainCursor = oldest;
+        }
+        while (drainCursor <= latest) {
+            int result = read(drainCursor, record);
+            if (result == 0) {
+                break; // Writer still busy with this slot; pick it up next period
+            }
+            if (result > 0) {
+                Serial.printf("[%8lu] %s %s: %s\n", (unsigned long)record.timestampMs,
+                              levelName(record.level), record.module, record.text);
+            }
+            ++drainCursor;
+        }
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_PERIOD_MS));
+    }
+}
+
+void logPrintf(uint8_t level, const char* module, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    logBuffer.write(level, module, format, args);
+    va_end(args);
+}
+
+void logPrint(uint8_t level, const char* module, const char* text) {
+    logPrintf(level, module, "%s", text ? text : "");
+}
+
+void logPrint(uint8_t level, const char* module, const String& text) {
+    logPrintf(level, module, "%s", text.c_str());
+}
@@ -0,0 +1,597 @@
+#include "ModbusMaster.h"
+#include "TaskConfig.h"
+#include "ConfigManager.h"
+#include "InputPointManager.h"
+#include <algorithm>
+#include <cstring>
+#include "DebugConfig.h" // LOGx macros
+
+// FreeRTOS includes
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+
+extern InputPointManager inputManager;
+
+// Utilisation is reported over windows of this length
+#define MODBUS_STATS_WINDOW_US (10ULL * 1000 * 1000)
+
+namespace {
+// A profile point before it is placed in a block
+struct PendingPoint {
+    uint8_t functionCode;
+    uint16_t address;
+    uint16_t width;
+    uint32_t intervalMs;
+    ModbusPollPoint point;
+};
+
+bool pendingLess(const PendingPoint& a, const PendingPoint& b) {
+    if (a.functionCode != b.functionCode) return a.functionCode < b.functionCode;
+    return a.address < b.address;
+}
+
+// A DO coil before it is placed in a coil block
+struct PendingCoil {
+    uint16_t address;
+    String pointId;
+};
+
+bool pendingCoilLess(const PendingCoil& a, const PendingCoil& b) {
+    return a.address < b.address;
+}
+
+inline uint16_t registerAt(const uint8_t* data, uint16_t index) {
+    return (uint16_t)((data[index * 2] << 8) | data[index * 2 + 1]);
+}
+} // namespace
+
+ModbusMaster::ModbusMaster() {}
+
+/**
+ * @brief Builds the read blocks of all enabled devices and starts the bus tasks.
+ *
+ * Devices whose interface, slave address or profile is invalid are skipped with a log
+ * line; the remaining devices are still polled.
+ *
+ * @param ioConfig The parsed board configuration.
+ * @param configManager Used to load each device's profile.
+ * @return False if a bus task could not be started, true otherwise.
+ */
+bool ModbusMaster::begin(const IOConfiguration& ioConfig, ConfigManager& configManager) {
+    if (!buses.empty()) {
+        return true; // Already running
+    }
+
+    for (const ModbusInterfaceConfig& iface : ioConfig.modbusInterfaces) {
+        HardwareSerial* serial = nullptr;
+        if (iface.uartPort == 1) serial = &Serial1;
+        else if (iface.uartPort == 2) serial = &Serial2;
+        if (!serial || iface.baudRate <= 0) {
+            // UART0 is the console
+            Serial.printf("[ModbusMaster] Interface '%s': unsupported uartPort %d, skipped.\n", iface.interfaceId.c_str(), iface.uartPort);
+            continue;
+        }
+
+        ModbusBus* bus = new ModbusBus();
+        bus->owner = this;
+        bus->config = iface;
+        bus->serial = serial;
+        // t3.5 = 3.5 character times (11 bits each); fixed 1750 us above 19200 baud per the spec
+        bus->interFrameUs = (iface.baudRate > 19200) ? 1750 : (uint32_t)(38500000UL / iface.baudRate);
+
+        for (const ModbusDeviceConfig& device : ioConfig.modbusDevices) {
+            if (!device.enabled || device.interfaceId != iface.interfaceId) continue;
+            if (device.slaveAddress < 1 || device.slaveAddress > 247) {
+                Serial.printf("[ModbusMaster] Device '%s': invalid slaveAddress %d, skipped.\n", device.deviceId.c_str(), device.slaveAddress);
+                continue;
+            }
+            ModbusDeviceProfile profile;
+            if (!configManager.loadModbusProfile(device.profileId, profile)) {
+                Serial.printf("[ModbusMaster] Device '%s': profile '%s' not loaded, skipped.\n", device.deviceId.c_str(), device.profileId.c_str());
+                continue;
+            }
+            addDevice(*bus, device, profile);
+        }
+
+        if (bus->blocks.empty() && bus->coilBlocks.empty()) {
+            delete bus;
+            continue;
+        }
+
+        serial->begin(iface.baudRate, serialConfig(iface.config), iface.rxPin, iface.txPin);
+        serial->setTimeout(MODBUS_RESPONSE_TIMEOUT_MS);
+        if (iface.rtsPin >= 0) {
+            pinMode(iface.rtsPin, OUTPUT);
+            digitalWrite(iface.rtsPin, LOW); // Receive
+        }
+        buses.push_back(bus);
+
+        String taskName = "ModbusRTU_" + iface.interfaceId;
+        BaseType_t taskCreated = xTaskCreatePinnedToCore(
+            busTaskWrapper,
+            taskName.c_str(),
+            4096,
+            bus,
+            TASK_PRIORITY_MODBUS,
+            (TaskHandle_t*)&bus->taskHandle,
+            IO_CORE
+        );
+        if (taskCreated != pdPASS) {
+            Serial.printf("[ModbusMaster] Failed to create task for interface '%s'.\n", iface.interfaceId.c_str());
+            bus->taskHandle = nullptr;
+            return false;
+        }
+
+        size_t pointCount = 0;
+        for (const ModbusReadBlock& block : bus->blocks) pointCount += block.points.size();
+        size_t coilCount = 0;
+        for (const ModbusCoilBlock& block : bus->coilBlocks) coilCount += block.count;
+        Serial.printf("[ModbusMaster] Interface '%s': %u devices, %u points in %u read blocks, %u coils in %u write blocks.\n",
+                      iface.interfaceId.c_str(), (unsigned)bus->devices.size(), (unsigned)pointCount, (unsigned)bus->blocks.size(),
+                      (unsigned)coilCount, (unsigned)bus->coilBlocks.size());
+    }
+    return true;
+}
+
+/**
+ * @brief Registers a device's input points and merges them into read blocks.
+ *
+ * Points are sorted by function code and address. A point joins the current block if
+ * it uses the same function code, starts at most MODBUS_MAX_BLOCK_GAP past the block's
+ * end and the block stays within the per-request limit. The block then polls at the
+ * fastest interval of its points: reading a few extra registers is cheaper than a
+ * separate request frame, even when the slower point does not need the update.
+ *
+ * DO coils are grouped the same way into coil blocks, but only without gaps: an FC15
+ * request writes every coil it spans, including ones the profile does not define.
+ *
+ * @return True if at least one point or coil was added.
+ */
+bool ModbusMaster::addDevice(ModbusBus& bus, const ModbusDeviceConfig& device, const ModbusDeviceProfile& profile) {
+    if (bus.devices.size() >= 255) return false;
+    uint8_t deviceIndex = (uint8_t)bus.devices.size();
+    uint32_t deviceInterval = (uint32_t)max((long)MODBUS_MIN_INTERVAL_MS, device.pollingIntervalMs);
+
+    std::vector<PendingPoint> pending;
+    std::vector<PendingCoil> pendingCoils;
+    for (const ModbusProfilePoint& profilePoint : profile.points) {
+        if (profilePoint.ioType == "DO") {
+            PendingCoil coil;
+            uint8_t functionCode;
+            if (!parseRegisterType(profilePoint.modbus.registerType, profilePoint.modbus.address, functionCode, coil.address) ||
+                functionCode != 1) {
+                Serial.printf("[ModbusMaster] Device '%s': output '%s' is not a coil, skipped.\n",
+                              device.deviceId.c_str(), profilePoint.pointIdSuffix.c_str());
+                continue;
+            }
+            coil.pointId = device.deviceId + profilePoint.pointIdSuffix;
+            pendingCoils.push_back(coil);
+            continue;
+        }
+        if (profilePoint.ioType != "AI" && profilePoint.ioType != "DI") {
+            continue; // AO (holding register writes) is not supported
+        }
+        PendingPoint p;
+        ModbusDataType type;
+        if (!parseRegisterType(profilePoint.modbus.registerType, profilePoint.modbus.address, p.functionCode, p.address) ||
+            !parseDataType(profilePoint.modbus.dataType, type)) {
+            Serial.printf("[ModbusMaster] Device '%s': point '%s' has an unsupported register or data type, skipped.\n",
+                          device.deviceId.c_str(), profilePoint.pointIdSuffix.c_str());
+            continue;
+        }
+        String pointId = device.deviceId + profilePoint.pointIdSuffix;
+        PointHandle handle = inputManager.registerRemotePoint(pointId);
+        if (handle == INVALID_POINT_HANDLE) {
+            continue;
+        }
+        p.width = valueWidth(p.functionCode, type);
+        p.intervalMs = (profilePoint.updateIntervalMs > 0)
+            ? (uint32_t)max((long)MODBUS_MIN_INTERVAL_MS, profilePoint.updateIntervalMs)
+            : deviceInterval;
+        p.point = { handle, 0, type, profilePoint.modbus.wordOrder.equalsIgnoreCase("LittleEndian"),
+                    profilePoint.modbus.scaleFactor, profilePoint.modbus.offset };
+        pending.push_back(p);
+    }
+    if (pending.empty() && pendingCoils.empty()) {
+        return false;
+    }
+    std::sort(pending.begin(), pending.end(), pendingLess);
+
+    ModbusReadBlock* current = nullptr;
+    uint32_t now = millis();
+    for (const PendingPoint& p : pending) {
+        uint16_t limit = (p.functionCode <= 2) ? MODBUS_MAX_READ_BITS : MODBUS_MAX_READ_REGISTERS;
+        bool joins = current && current->functionCode == p.functionCode &&
+                     p.address <= (uint32_t)current->startAddress + current->count + MODBUS_MAX_BLOCK_GAP &&
+                     (uint32_t)p.address + p.width - current->startAddress <= limit;
+        if (!joins) {
+            bus.blocks.push_back(ModbusReadBlock{ deviceIndex, p.functionCode, p.address, 0, p.intervalMs, now, {} });
+            current = &bus.blocks.back();
+        }
+        uint16_t end = max((uint32_t)current->startAddress + current->count, (uint32_t)p.address + p.width) - current->startAddress;
+        current->count = end;
+        current->intervalMs = min(current->intervalMs, p.intervalMs);
+        ModbusPollPoint point = p.point;
+        point.blockOffset = p.address - current->startAddress;
+        current->points.push_back(point);
+    }
+
+    std::sort(pendingCoils.begin(), pendingCoils.end(), pendingCoilLess);
+    ModbusCoilBlock* coilBlock = nullptr;
+    for (size_t i = 0; i < pendingCoils.size(); ++i) {
+        const PendingCoil& coil = pendingCoils[i];
+        if (i > 0 && coil.address == pendingCoils[i - 1].address) {
+            Serial.printf("[ModbusMaster] Device '%s': output '%s' reuses coil %u, skipped.\n",
+                          device.deviceId.c_str(), coil.pointId.c_str(), coil.address);
+            continue;
+        }
+        bool joins = coilBlock && coil.address == (uint32_t)coilBlock->startAddress + coilBlock->count &&
+                     coilBlock->count < MODBUS_MAX_WRITE_COILS;
+        if (!joins) {
+            bus.coilBlocks.push_back(ModbusCoilBlock{ deviceIndex, coil.address, 0, {} });
+            coilBlock = &bus.coilBlocks.back();
+        }
+        coilOutputs.push_back(ModbusCoilOutput{ coil.pointId, &bus, (uint16_t)(bus.coilBlocks.size() - 1), coilBlock->count });
+        coilBlock->count++;
+        coilBlock->staged.assign((coilBlock->count + 7) / 8, 0);
+    }
+
+    ModbusPolledDevice polled;
+    polled.deviceId = device.deviceId;
+    polled.slaveAddress = (uint8_t)device.slaveAddress;
+    bus.devices.push_back(polled);
+    return true;
+}
+
+/**
+ * @brief Maps a profile registerType + address to a read function code and protocol address.
+ */
+bool ModbusMaster::parseRegisterType(const String& registerType, int address, uint8_t& functionCode, uint16_t& protocolAddress) {
+    int modiconBase;
+    if (registerType.equalsIgnoreCase("Coil")) { functionCode = 1; modiconBase = 1; }
+    else if (registerType.equalsIgnoreCase("DiscreteInput")) { functionCode = 2; modiconBase = 10001; }
+    else if (registerType.equalsIgnoreCase("InputRegister")) { functionCode = 4; modiconBase = 30001; }
+    else if (registerType.equalsIgnoreCase("HoldingRegister")) { functionCode = 3; modiconBase = 40001; }
+    else return false;
+
+    if (address < 0) return false;
+    // Five-digit Modicon references (e.g. 40001) start at 1 within their table
+    if (functionCode != 1 && address >= modiconBase && address < modiconBase + 9999) {
+        address -= modiconBase;
+    }
+    if (address > 0xFFFF) return false;
+    protocolAddress = (uint16_t)address;
+    return true;
+}
+
+bool ModbusMaster::parseDataType(const String& dataType, ModbusDataType& type) {
+    if (dataType.equalsIgnoreCase("BOOLEAN")) type = ModbusDataType::BOOLEAN;
+    else if (dataType.equalsIgnoreCase("UINT16")) type = ModbusDataType::UINT16;
+    else if (dataType.equalsIgnoreCase("INT16")) type = ModbusDataType::INT16;
+    else if (dataType.equalsIgnoreCase("UINT32")) type = ModbusDataType::UINT32;
+    else if (dataType.equalsIgnoreCase("INT32")) type = ModbusDataType::INT32;
+    else if (dataType.equalsIgnoreCase("FLOAT32")) type = ModbusDataType::FLOAT32;
+    else return false;
+    return true;
+}
+
+// Bits for FC01/02, registers for FC03/04
+uint16_t ModbusMaster::valueWidth(uint8_t functionCode, ModbusDataType type) {
+    if (functionCode <= 2) return 1;
+    return (type == ModbusDataType::UINT32 || type == ModbusDataType::INT32 || type == ModbusDataType::FLOAT32) ? 2 : 1;
+}
+
+uint32_t ModbusMaster::serialConfig(const String& config) {
+    if (config == "SERIAL_8E1") return SERIAL_8E1;
+    if (config == "SERIAL_8O1") return SERIAL_8O1;
+    if (config == "SERIAL_8N2") return SERIAL_8N2;
+    return SERIAL_8N1;
+}
+
+// Modbus CRC-16 (polynomial 0xA001, initial 0xFFFF)
+uint16_t ModbusMaster::crc16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+        }
+    }
+    return crc;
+}
+
+bool ModbusMaster::getBusStats(size_t busIndex, ModbusBusStats& out) const {
+    if (busIndex >= buses.size()) return false;
+    const ModbusBus* bus = buses[busIndex];
+    out.interfaceId = bus->config.interfaceId;
+    out.requests = bus->requests;
+    out.failures = bus->failures;
+    out.blocks = (uint16_t)bus->blocks.size();
+    size_t points = 0;
+    for (const ModbusReadBlock& block : bus->blocks) points += block.points.size();
+    out.points = (uint16_t)points;
+    out.utilisationPermille = bus->utilisationPermille;
+    out.stackHighWaterBytes = bus->taskHandle ? uxTaskGetStackHighWaterMark((TaskHandle_t)bus->taskHandle) : 0;
+    return true;
+}
+
+void ModbusMaster::stageCoil(size_t index, bool on) {
+    if (index >= coilOutputs.size()) return;
+    const ModbusCoilOutput& output = coilOutputs[index];
+    ModbusBus& bus = *output.bus;
+    ModbusCoilBlock& block = bus.coilBlocks[output.blockIndex];
+    uint8_t mask = (uint8_t)(1 << (output.bit % 8));
+    portENTER_CRITICAL_SAFE(&bus.coilMux);
+    uint8_t& coilByte = block.staged[output.bit / 8];
+    uint8_t updated = on ? (coilByte | mask) : (coilByte & ~mask);
+    if (updated != coilByte) {
+        coilByte = updated;
+        block.dirty = true;
+        bus.coilsStaged = true;
+    }
+    portEXIT_CRITICAL_SAFE(&bus.coilMux);
+}
+
+void ModbusMaster::commitCoils() {
+    bool inIsr = xPortInIsrContext();
+    BaseType_t woken = pdFALSE;
+    for (ModbusBus* bus : buses) {
+        if (!bus->coilsStaged || !bus->taskHandle) continue;
+        bus->coilsStaged = false;
+        if (inIsr) vTaskNotifyGiveFromISR((TaskHandle_t)bus->taskHandle, &woken);
+        else xTaskNotifyGive((TaskHandle_t)bus->taskHandle);
+    }
+    if (woken) portYIELD_FROM_ISR();
+}
+
+void ModbusMaster::busTaskWrapper(void* parameter) {
+    ModbusBus* bus = static_cast<ModbusBus*>(parameter);
+    bus->owner->busTask(*bus);
+}
+
+/**
+ * @brief Bus task: writes staged coil blocks first, then runs whichever read block is
+ * due next, sleeping in between. commitCoils() cuts the sleep short.
+ */
+void ModbusMaster::busTask(ModbusBus& bus) {
+    bus.windowStartUs = esp_timer_get_time();
+    for (;;) {
+        uint64_t startUs = esp_timer_get_time();
+        uint32_t retryMs = writeStagedCoils(bus);
+        bus.busyUs += esp_timer_get_time() - startUs;
+
+        ModbusReadBlock* next = nullptr;
+        for (ModbusReadBlock& block : bus.blocks) {
+            if (!next || (int32_t)(block.nextDueMs - next->nextDueMs) < 0) next = &block;
+        }
+        int32_t waitMs = next ? (int32_t)(next->nextDueMs - millis()) : INT32_MAX;
+        if (waitMs > 0) {
+            if ((uint32_t)waitMs > retryMs) waitMs = (int32_t)retryMs;
+            ulTaskNotifyTake(pdTRUE, (waitMs == INT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(waitMs));
+            continue;
+        }
+
+        startUs = esp_timer_get_time();
+        bool success = readBlock(bus, *next);
+        if (success) {
+            publishBlock(bus, *next);
+        }
+        uint64_t endUs = esp_timer_get_time();
+        bus.busyUs += endUs - startUs;
+        if (endUs - bus.windowStartUs >= MODBUS_STATS_WINDOW_US) {
+            bus.utilisationPermille = (uint16_t)min<uint64_t>(1000, bus.busyUs * 1000 / (endUs - bus.windowStartUs));
+            bus.busyUs = 0;
+            bus.windowStartUs = endUs;
+        }
+        recordResult(bus, *next, success);
+    }
+}
+
+/**
+ * @brief Sends one request frame (CRC already appended), after the t3.5 silent interval.
+ */
+void ModbusMaster::sendRequest(ModbusBus& bus, const uint8_t* request, size_t length) {
+    while (bus.serial->available()) bus.serial->read(); // Drop late bytes of a previous response
+    delayMicroseconds(bus.interFrameUs);
+
+    if (bus.config.rtsPin >= 0) digitalWrite(bus.config.rtsPin, HIGH);
+    bus.serial->write(request, length);
+    bus.serial->flush(); // Returns once the last stop bit is out
+    if (bus.config.rtsPin >= 0) digitalWrite(bus.config.rtsPin, LOW);
+    bus.requests++;
+}
+
+/**
+ * @brief Sends one read request and receives the response into bus.rxBuffer.
+ * @return True if a well-formed, CRC-valid, non-exception response arrived in time.
+ */
+bool ModbusMaster::readBlock(ModbusBus& bus, const ModbusReadBlock& block) {
+    const ModbusPolledDevice& device = bus.devices[block.deviceIndex];
+    uint8_t request[8] = {
+        device.slaveAddress, block.functionCode,
+        (uint8_t)(block.startAddress >> 8), (uint8_t)(block.startAddress & 0xFF),
+        (uint8_t)(block.count >> 8), (uint8_t)(block.count & 0xFF), 0, 0
+    };
+    uint16_t crc = crc16(request, 6);
+    request[6] = (uint8_t)(crc & 0xFF);
+    request[7] = (uint8_t)(crc >> 8);
+    sendRequest(bus, request, sizeof(request));
+
+    uint16_t dataBytes = (block.functionCode <= 2) ? (block.count + 7) / 8 : block.count * 2;
+    size_t expected = 5 + dataBytes;
+    uint8_t* rx = bus.rxBuffer;
+    if (bus.serial->readBytes(rx, 3) != 3 || rx[0] != device.slaveAddress) {
+        return false;
+    }
+    if (rx[1] == (block.functionCode | 0x80)) {
+        // Exception response: address, function, code, CRC
+        bus.serial->readBytes(rx + 3, 2);
+        LOGD(MODBUS, "%s: exception %u for FC%u @%u", device.deviceId.c_str(), rx[2], block.functionCode, block.startAddress);
+        return false;
+    }
+    if (rx[1] != block.functionCode || rx[2] != dataBytes || expected > sizeof(bus.rxBuffer)) {
+        return false;
+    }
+    if (bus.serial->readBytes(rx + 3, expected - 3) != expected - 3) {
+        return false;
+    }
+    uint16_t receivedCrc = (uint16_t)(rx[expected - 2] | (rx[expected - 1] << 8));
+    return receivedCrc == crc16(rx, expected - 2);
+}
+
+/**
+ * @brief Writes every staged coil block that is due, one FC15 request each.
+ *
+ * The staged image is copied into the request under coilMux and the block marked
+ * clean before the transaction, so a change staged meanwhile is written next round.
+ * A failed write marks the block dirty again and retries it after
+ * MODBUS_WRITE_RETRY_MS (MODBUS_OFFLINE_RETRY_MS while the device is offline).
+ *
+ * @return Milliseconds until the earliest pending retry, UINT32_MAX if none.
+ */
+uint32_t ModbusMaster::writeStagedCoils(ModbusBus& bus) {
+    uint32_t retryMs = UINT32_MAX;
+    for (ModbusCoilBlock& block : bus.coilBlocks) {
+        size_t dataBytes = block.staged.size();
+        uint32_t now = millis();
+        portENTER_CRITICAL(&bus.coilMux);
+        bool due = block.dirty && (int32_t)(now - block.retryAtMs) >= 0;
+        if (due) {
+            memcpy(bus.txBuffer + 7, block.staged.data(), dataBytes);
+            block.dirty = false;
+        } else if (block.dirty) {
+            retryMs = min(retryMs, block.retryAtMs - now);
+        }
+        portEXIT_CRITICAL(&bus.coilMux);
+        if (!due) continue;
+
+        bool success = writeCoilBlock(bus, block, dataBytes);
+        recordDeviceResult(bus, block.deviceIndex, success);
+        if (!success) {
+            uint32_t retry = bus.devices[block.deviceIndex].online ? MODBUS_WRITE_RETRY_MS : MODBUS_OFFLINE_RETRY_MS;
+            portENTER_CRITICAL(&bus.coilMux);
+            block.dirty = true;
+            block.retryAtMs = millis() + retry;
+            portEXIT_CRITICAL(&bus.coilMux);
+            retryMs = min(retryMs, retry);
+        }
+    }
+    return retryMs;
+}
+
+/**
+ * @brief Sends one FC15 request whose coil data is already in bus.txBuffer + 7.
+ * @return True if the slave echoed the start address and quantity with a valid CRC.
+ */
+bool ModbusMaster::writeCoilBlock(ModbusBus& bus, const ModbusCoilBlock& block, size_t dataBytes) {
+    const ModbusPolledDevice& device = bus.devices[block.deviceIndex];
+    uint8_t* request = bus.txBuffer;
+    request[0] = device.slaveAddress;
+    request[1] = 15;
+    request[2] = (uint8_t)(block.startAddress >> 8);
+    request[3] = (uint8_t)(block.startAddress & 0xFF);
+    request[4] = (uint8_t)(block.count >> 8);
+    request[5] = (uint8_t)(block.count & 0xFF);
+    request[6] = (uint8_t)dataBytes;
+    size_t length = 7 + dataBytes;
+    uint16_t crc = crc16(request, length);
+    request[length] = (uint8_t)(crc & 0xFF);
+    request[length + 1] = (uint8_t)(crc >> 8);
+    sendRequest(bus, request, length + 2);
+
+    // Response: address, function, start address, quantity, CRC
+    uint8_t* rx = bus.rxBuffer;
+    if (bus.serial->readBytes(rx, 3) != 3 || rx[0] != device.slaveAddress) {
+        return false;
+    }
+    if (rx[1] == (15 | 0x80)) {
+        bus.serial->readBytes(rx + 3, 2);
+        LOGD(MODBUS, "%s: exception %u for FC15 @%u", device.deviceId.c_str(), rx[2], block.startAddress);
+        return false;
+    }
+    if (rx[1] != 15 || bus.serial->readBytes(rx + 3, 5) != 5) {
+        return false;
+    }
+    uint16_t receivedCrc = (uint16_t)(rx[6] | (rx[7] << 8));
+    return receivedCrc == crc16(rx, 6) && memcmp(rx + 2, request + 2, 4) == 0;
+}
+
+/**
+ * @brief Decodes and scales the points of a successfully read block.
+ */
+void ModbusMaster::publishBlock(ModbusBus& bus, const ModbusReadBlock& block) {
+    const uint8_t* data = bus.rxBuffer + 3;
+    for (const ModbusPollPoint& point : block.points) {
+        float raw;
+        if (block.functionCode <= 2) {
+            raw = (float)((data[point.blockOffset / 8] >> (point.blockOffset % 8)) & 1);
+        } else {
+            uint16_t first = registerAt(data, point.blockOffset);
+            switch (point.type) {
+                case ModbusDataType::BOOLEAN: raw = first ? 1.0f : 0.0f; break;
+                case ModbusDataType::INT16: raw = (float)(int16_t)first; break;
+                case ModbusDataType::UINT16: raw = (float)first; break;
+                default: {
+                    uint16_t second = registerAt(data, point.blockOffset + 1);
+                    uint32_t word = point.swapWords ? ((uint32_t)second << 16) | first : ((uint32_t)first << 16) | second;
+                    if (point.type == ModbusDataType::FLOAT32) {
+                        memcpy(&raw, &word, sizeof(raw));
+                    } else if (point.type == ModbusDataType::INT32) {
+                        raw = (float)(int32_t)word;
+                    } else {
+                        raw = (float)word;
+                    }
+                    break;
+                }
+            }
+        }
+        inputManager.publishRemoteValue(point.handle, raw * point.scaleFactor + point.offset);
+    }
+}
+
+/**
+ * @brief Updates the device's online state after a read or write request.
+ *
+ * A device that fails MODBUS_MAX_CONSECUTIVE_ERRORS requests in a row goes offline:
+ * all of its points read as unknown until a request succeeds again.
+ */
+void ModbusMaster::recordDeviceResult(ModbusBus& bus, uint8_t deviceIndex, bool success) {
+    ModbusPolledDevice& device = bus.devices[deviceIndex];
+    if (success) {
+        if (!device.online) {
+            Serial.printf("[ModbusMaster] Device '%s' back online.\n", device.deviceId.c_str());
+        }
+        device.online = true;
+        device.consecutiveErrors = 0;
+    } else {
+        bus.failures++;
+        if (device.consecutiveErrors < 255) device.consecutiveErrors++;
+        if (device.online && device.consecutiveErrors >= MODBUS_MAX_CONSECUTIVE_ERRORS) {
+            device.online = false;
+            Serial.printf("[ModbusMaster] Device '%s' not responding, marked offline.\n", device.deviceId.c_str());
+            for (const ModbusReadBlock& other : bus.blocks) {
+                if (other.deviceIndex != deviceIndex) continue;
+                for (const ModbusPollPoint& point : other.points) inputManager.invalidateRemoteValue(point.handle);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Records the result of a read and schedules the block's next run.
+ *
+ * Blocks of an offline device are retried only every MODBUS_OFFLINE_RETRY_MS, so dead
+ * slaves do not eat bus time with timeouts. A block that fell behind is rescheduled
+ * from now rather than run back-to-back to catch up.
+ */
+void ModbusMaster::recordResult(ModbusBus& bus, ModbusReadBlock& block, bool success) {
+    recordDeviceResult(bus, block.deviceIndex, success);
+    const ModbusPolledDevice& device = bus.devices[block.deviceIndex];
+    uint32_t interval = device.online ? block.intervalMs : max(block.intervalMs, (uint32_t)MODBUS_OFFLINE_RETRY_MS);
+    uint32_t now = millis();
+    block.nextDueMs += interval;
+    if ((int32_t)(now - block.nextDueMs) > 0) {
+        block.nextDueMs = now + interval;
+    }
+}
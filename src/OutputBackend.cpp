@@ -0,0 +1,124 @@
+#include "OutputBackend.h"
+#include "ModbusMaster.h"
+
+#include <soc/gpio_struct.h>
+#include <algorithm>
+
+extern ModbusMaster modbusMaster;
+
+// Direct GPIO register write (W1TS/W1TC), avoids the digitalWrite() pin lookup per edge
+static inline void IRAM_ATTR fastGpioWrite(int pin, bool level) {
+    if (pin < 32) {
+        if (level) GPIO.out_w1ts = (1UL << pin);
+        else GPIO.out_w1tc = (1UL << pin);
+    } else {
+        if (level) GPIO.out1_w1ts.val = (1UL << (pin - 32));
+        else GPIO.out1_w1tc.val = (1UL << (pin - 32));
+    }
+}
+
+// --- ShiftRegisterBackend ---
+
+ShiftRegisterBackend::ShiftRegisterBackend(int firstRelay, int relayCount, const RelayControlPins& pins)
+    : OutputBackend(firstRelay, relayCount), dataPin(pins.data), clockPin(pins.clock),
+      latchPin(pins.latch), oePin(pins.oe), latched((relayCount + 7) / 8, 0) {
+    chainBytes = std::max((int)latched.size(), RELAY_SHIFT_CHAIN_MIN_BYTES);
+}
+
+void ShiftRegisterBackend::begin() {
+    pinMode(dataPin, OUTPUT);
+    pinMode(clockPin, OUTPUT);
+    pinMode(latchPin, OUTPUT);
+    pinMode(oePin, OUTPUT);
+    digitalWrite(oePin, HIGH);    // Disable outputs during initialization
+    digitalWrite(clockPin, LOW);
+    digitalWrite(latchPin, HIGH);
+    portENTER_CRITICAL(&shiftMux);
+    std::fill(latched.begin(), latched.end(), 0);
+    shiftOutLatched();
+    portEXIT_CRITICAL(&shiftMux);
+    digitalWrite(oePin, LOW);     // Enable outputs after initialization
+}
+
+void ShiftRegisterBackend::shiftOutByte(uint8_t dat) {
+    for (int i = 8; i >= 1; i--) {
+        fastGpioWrite(dataPin, (dat & 0x80) != 0);
+        dat <<= 1;
+        fastGpioWrite(clockPin, false);
+        fastGpioWrite(clockPin, true);
+    }
+}
+
+// Shifts `latched` through the chain and latches once. Caller holds shiftMux.
+// Relay byte 0 is shifted first (furthest register, as on the original 8-relay
+// board), followed by higher relay bytes and zero padding up to the chain length.
+void ShiftRegisterBackend::shiftOutLatched() {
+    for (int i = 0; i < chainBytes; ++i) {
+        shiftOutByte(i < (int)latched.size() ? latched[i] : 0x00);
+    }
+    fastGpioWrite(latchPin, false);
+    fastGpioWrite(latchPin, true);
+}
+
+// A few microseconds under shiftMux. The image is read under the same lock as
+// switchOff() writes `latched`, so a dose ending meanwhile is never re-latched on.
+void ShiftRegisterBackend::flush(const std::vector<uint8_t>& image) {
+    portENTER_CRITICAL_SAFE(&shiftMux);
+    for (int i = 0; i < count; ++i) {
+        uint8_t mask = (uint8_t)(1 << (i % 8));
+        if (relayBit(image, first + i)) latched[i / 8] |= mask;
+        else latched[i / 8] &= ~mask;
+    }
+    shiftOutLatched();
+    portEXIT_CRITICAL_SAFE(&shiftMux);
+}
+
+// Only this relay's bit changes in the chain: `latched`, not the staged image, is re-shifted
+void ShiftRegisterBackend::switchOff(int relayIndex) {
+    if (!owns(relayIndex)) return;
+    int bit = relayIndex - first;
+    portENTER_CRITICAL_SAFE(&shiftMux);
+    latched[bit / 8] &= ~(uint8_t)(1 << (bit % 8));
+    shiftOutLatched();
+    portEXIT_CRITICAL_SAFE(&shiftMux);
+}
+
+// --- DirectGpioBackend ---
+
+void DirectGpioBackend::begin() {
+    // Set each relay's pin LOW (off) before making it an output: no glitch on
+    for (int pin : pins) {
+        digitalWrite(pin, LOW);
+        pinMode(pin, OUTPUT);
+    }
+}
+
+void DirectGpioBackend::flush(const std::vector<uint8_t>& image) {
+    for (int i = 0; i < count; ++i) {
+        fastGpioWrite(pins[i], relayBit(image, first + i));
+    }
+}
+
+void DirectGpioBackend::switchOff(int relayIndex) {
+    if (owns(relayIndex)) fastGpioWrite(pins[relayIndex - first], false);
+}
+
+// --- ModbusCoilBackend ---
+
+// Unchanged coils are not marked dirty, so only blocks with a change are written
+void ModbusCoilBackend::flush(const std::vector<uint8_t>& image) {
+    for (int i = 0; i < count; ++i) {
+        modbusMaster.stageCoil((size_t)i, relayBit(image, first + i));
+    }
+    modbusMaster.commitCoils();
+}
+
+// Staged only (spinlock); commit() wakes the bus task once the caller left its critical section
+void ModbusCoilBackend::switchOff(int relayIndex) {
+    if (!owns(relayIndex)) return;
+    modbusMaster.stageCoil((size_t)(relayIndex - first), false);
+}
+
+void ModbusCoilBackend::commit() {
+    modbusMaster.commitCoils();
+}
@@ -1,53 +1,126 @@
 #include "OutputPointManager.h"
+#include "TaskConfig.h"
+#include "DebugConfig.h" // LOGx macros
 #include <FS.h>
 #include <LittleFS.h>
 #include <ArduinoJson.h> // V7, see how_to_upgrade_from_ArduinoJSON6_to_ArduinoJSON7.md
+#include "AtomicFile.h" // Temp + rename writes
+#include "LiveEvents.h" // Relay change notifications for /api/events
+#include "FlowMeterManager.h" // Volume doses (TURN_ON_VOLUME)
+#include "ModbusMaster.h" // Modbus DO coils appended as relays
 
-#define DEBUG_OUTPUT_MANAGER 1
 
 // FreeRTOS includes
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/queue.h>
 #include <freertos/semphr.h>
+#include <esp_timer.h>
+#include <driver/gpio.h> // GPIO_IS_VALID_OUTPUT_GPIO
 
-uint8_t relayState = 0; // Member variable, not static in a function
-std::vector<TaskHandle_t> activeTimerTasks; // One per relay
+#include <algorithm>
+
+// Global point registry (defined in main.cpp)
+extern PointRegistry pointRegistry;
+extern LiveEvents liveEvents;
+extern FlowMeterManager flowMeterManager;
+extern ModbusMaster modbusMaster;
+
+// Task notification bits of the command processor
+#define OUTPUT_EVENT_COMMANDS   (1UL << 0) // Commands queued
+#define OUTPUT_EVENT_RELAY_TIMER (1UL << 1) // Earliest off-deadline reached
+#define OUTPUT_EVENT_DOSE_ENDED (1UL << 2) // doseEndQueue has entries
 
 OutputPointManager::OutputPointManager()
-    : directRelayCount(0), stateMutex(nullptr), timerListMutex(nullptr),
-      commandQueue(nullptr), commandProcessorTaskHandle(nullptr) {}
+    : directRelayCount(0), relayCount(0), stateMutex(nullptr), sendMutex(nullptr),
+      commandQueue(nullptr), doseEndQueue(nullptr), commandProcessorTaskHandle(nullptr), offTimer(nullptr) {}
 
-void OutputPointManager::Send_Bytes(uint8_t dat, int dataPin, int clockPin) {
-    for (int i = 8; i >= 1; i--) {
-        digitalWrite(dataPin, (dat & 0x80) ? HIGH : LOW);
-        dat <<= 1;
-        digitalWrite(clockPin, LOW);
-        digitalWrite(clockPin, HIGH);
-    }
+// Takes ownership; the backend's relays are driven off right away
+void OutputPointManager::addBackend(OutputBackend* backend) {
+    backend->begin();
+    relayBackend.resize(backend->firstRelay() + backend->relayCount(), (uint8_t)backends.size());
+    backendDirty.push_back(false);
+    backends.emplace_back(backend);
 }
 
-void OutputPointManager::Send_74HC595(uint8_t relayData, int dataPin, int clockPin, int latchPin) {
-    Send_Bytes(relayData, dataPin, clockPin);
-    Send_Bytes(0x00, dataPin, clockPin); // Not used for relays, but matches your working code
-    Send_Bytes(0x00, dataPin, clockPin); // Not used for relays
-    digitalWrite(latchPin, LOW);
-    digitalWrite(latchPin, HIGH);
+// Runs before the RTOS objects exist: only touches pins and the relay image
+void OutputPointManager::enterSafeState(const IOConfiguration& config) {
+    ioConfig = config;
+    directRelayCount = ioConfig.directIO.relayOutputs.count;
+    backends.clear();
+    relayBackend.clear();
+    backendDirty.clear();
+    const DirectRelayConfig& relays = ioConfig.directIO.relayOutputs;
+    if (directRelayCount > 0 && !relays.controlMethod.equalsIgnoreCase("ShiftRegister")) {
+        // DirectGPIO: a relay without a usable pin would silently never switch
+        bool pinsValid = (int)relays.gpioPins.size() >= directRelayCount;
+        for (int i = 0; pinsValid && i < directRelayCount; ++i) {
+            pinsValid = GPIO_IS_VALID_OUTPUT_GPIO(relays.gpioPins[i]);
+        }
+        if (!pinsValid) {
+            LOGE(OUTPUTS, "DirectGPIO needs a valid output pin per relay in relayOutputs.gpioPins (%d relays, %d pins); direct relays not registered.",
+                          directRelayCount, (int)relays.gpioPins.size());
+            directRelayCount = 0;
+        }
+    }
+    relayCount = directRelayCount;
+    relayImage.assign((relayCount + 7) / 8, 0);
+    if (directRelayCount > 0) {
+        if (relays.controlMethod.equalsIgnoreCase("ShiftRegister")) {
+            addBackend(new ShiftRegisterBackend(0, directRelayCount, relays.pins));
+        } else {
+            std::vector<int> pins(relays.gpioPins.begin(), relays.gpioPins.begin() + directRelayCount);
+            addBackend(new DirectGpioBackend(0, pins));
+        }
+    }
+    hardwareInitialized = true;
+    LOGI(OUTPUTS, "Relays in safe state (%d direct relay(s) off).", directRelayCount);
 }
 
 bool OutputPointManager::begin(const IOConfiguration& config) {
-    ioConfig = config;
-    directRelayCount = ioConfig.directIO.relayOutputs.count;
-    buildDirectRelayMap();
-    initializeDirectRelayHardware();
-    activeTimerTasks.resize(directRelayCount, nullptr);
+    if (!hardwareInitialized) {
+        enterSafeState(config);
+    }
+    // Modbus DO coils follow the direct relays; no command has been processed yet, so
+    // the image is still all off (ModbusMaster writes the coils off at start)
+    size_t coilCount = modbusMaster.coilOutputCount();
+    if (coilCount > 0) {
+        relayCount = directRelayCount + (int)coilCount;
+        relayImage.assign((relayCount + 7) / 8, 0);
+        addBackend(new ModbusCoilBackend(directRelayCount, (int)coilCount));
+    }
+    registerRelayPoints();
+
+    // Timer heap storage is sized once here so scheduling never allocates
+    timerHeap.clear();
+    timerHeap.reserve(relayCount);
+    timerHeapPos.assign(relayCount, -1);
+    relayOffDeadlineUs.assign(relayCount, 0);
+    relayDoseSeq.assign(relayCount, 0);
+
+    stateMutex = xSemaphoreCreateMutex();
+    sendMutex = xSemaphoreCreateMutex();
+    if (!stateMutex || !sendMutex) {
+        LOGE(OUTPUTS, "Failed to create mutexes.");
+        return false;
+    }
+
+    // Single one-shot timer that owns every relay off-deadline
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = &OutputPointManager::offTimerCallback;
+    timerArgs.arg = this;
+    timerArgs.dispatch_method = ESP_TIMER_TASK;
+    timerArgs.name = "RelayOffTimer";
+    if (esp_timer_create(&timerArgs, (esp_timer_handle_t*)&offTimer) != ESP_OK) {
+        LOGE(OUTPUTS, "Failed to create relay off timer.");
+        return false;
+    }
 
     // Create FreeRTOS queue for OutputCommand
-    commandQueue = xQueueCreate(10, sizeof(OutputCommand));
-    if (!commandQueue) {
-        #if DEBUG_OUTPUT_MANAGER
-        Serial.println("[OutputPointManager] Failed to create command queue.");
-        #endif
+    commandQueue = xQueueCreate(OUTPUT_COMMAND_QUEUE_LENGTH, sizeof(OutputCommand));
+    doseEndQueue = xQueueCreate(OUTPUT_DOSE_END_QUEUE_LENGTH, sizeof(uint32_t));
+    if (!commandQueue || !doseEndQueue) {
+        LOGE(OUTPUTS, "Failed to create command queue.");
         return false;
     }
 
@@ -57,137 +130,203 @@ bool OutputPointManager::begin(const IOConfiguration& config) {
         "OutputCmdProcTask",
         4096,
         this,
-        1,
+        TASK_PRIORITY_OUTPUT_COMMANDS,
         (TaskHandle_t*)&commandProcessorTaskHandle,
-        1
+        IO_CORE
     );
     if (taskCreated != pdPASS) {
-        #if DEBUG_OUTPUT_MANAGER
-        Serial.println("[OutputPointManager] Failed to create command processor task.");
-        #endif
+        LOGE(OUTPUTS, "Failed to create command processor task.");
         return false;
     }
 
-    #if DEBUG_OUTPUT_MANAGER
-    Serial.println("[OutputPointManager] OutputPointManager initialized and command processor task started.");
-    #endif
+    for (const std::unique_ptr<OutputBackend>& backend : backends) {
+        LOGI(OUTPUTS, "Relays %d-%d: %s", backend->firstRelay(), backend->firstRelay() + backend->relayCount() - 1, backend->name());
+    }
+    LOGI(OUTPUTS, "OutputPointManager initialized and command processor task started.");
     return true;
 }
 
-void OutputPointManager::buildDirectRelayMap() {
-    #if DEBUG_OUTPUT_MANAGER
-    Serial.printf("[OutputPointManager] buildDirectRelayMap: Starting relay mapping process\n");
-    Serial.printf("[OutputPointManager] Total relay count: %d\n", directRelayCount);
-    #endif
-    
-    directRelayPointIdToIndexMap.clear();
-    
-    #if DEBUG_OUTPUT_MANAGER
-    Serial.printf("[OutputPointManager] Cleared existing relay map\n");
-    #endif
+void OutputPointManager::registerRelayPoints() {
+    LOGD(OUTPUTS, "registerRelayPoints: Total relay count: %d\n", relayCount);
     
     String prefix = ioConfig.directIO.relayOutputs.pointIdPrefix;
     int startIdx = ioConfig.directIO.relayOutputs.pointIdStartIndex;
     
-    #if DEBUG_OUTPUT_MANAGER
-    Serial.printf("[OutputPointManager] Relay ID prefix: '%s', starting index: %d\n", 
-                  prefix.c_str(), startIdx);
-    #endif
-    
-    for (int i = 0; i < directRelayCount; ++i) {
-        String pointId = prefix + String(startIdx + i);
-        directRelayPointIdToIndexMap[pointId] = i;
+    for (int i = 0; i < relayCount; ++i) {
+        String pointId = (i < directRelayCount) ? prefix + String(startIdx + i)
+                                                : modbusMaster.coilOutputPointId(i - directRelayCount);
+        PointHandle handle = pointRegistry.registerPoint(pointId, PointKind::RELAY_OUTPUT, (int16_t)i);
         
-        #if DEBUG_OUTPUT_MANAGER
-        Serial.printf("[OutputPointManager] Mapped relay %d: '%s' -> index %d\n", 
-                     i, pointId.c_str(), i);
-        #endif
+        LOGD(OUTPUTS, "Registered relay %d: '%s' -> handle %d\n", 
+                     i, pointId.c_str(), handle);
     }
-    
-    #if DEBUG_OUTPUT_MANAGER
-    Serial.printf("[OutputPointManager] buildDirectRelayMap: Completed with %d relay mappings\n", 
-                 directRelayPointIdToIndexMap.size());
-    #endif
-}
-
-void OutputPointManager::initializeDirectRelayHardware() {
-    String method = ioConfig.directIO.relayOutputs.controlMethod;
-    if (method.equalsIgnoreCase("DirectGPIO")) {
-        // For each relay, set the control pin as OUTPUT and set to OFF
-        for (int i = 0; i < directRelayCount; ++i) {
-            int pin = 0; /* get pin for relayIndex i from your mapping */
-            if (pin >= 0) {
-                pinMode(pin, OUTPUT);
-                digitalWrite(pin, LOW); // OFF
-            }
-        }
-    } else if (method.equalsIgnoreCase("ShiftRegister")) {
-        int dataPin = ioConfig.directIO.relayOutputs.pins.data;
-        int clockPin = ioConfig.directIO.relayOutputs.pins.clock;
-        int latchPin = ioConfig.directIO.relayOutputs.pins.latch;
-        int oePin = ioConfig.directIO.relayOutputs.pins.oe;
-        pinMode(dataPin, OUTPUT);
-        pinMode(clockPin, OUTPUT);
-        pinMode(latchPin, OUTPUT);
-        pinMode(oePin, OUTPUT);
-        digitalWrite(oePin, HIGH);    // Disable outputs during initialization
-        digitalWrite(clockPin, LOW);
-        digitalWrite(latchPin, HIGH);
-        relayState = 0;
-        Send_74HC595(relayState, dataPin, clockPin, latchPin);
-        digitalWrite(oePin, LOW);     // Enable outputs after initialization
-    }
-}
-
-void OutputPointManager::setDirectRelayStatePhysical(int relayIndex, bool on) {
-    String method = ioConfig.directIO.relayOutputs.controlMethod;
-    if (method.equalsIgnoreCase("DirectGPIO")) {
-        int pin = 0; // LOOK HERE - get the pin for relayIndex from your mapping, NEED TO IMPLEMENT MAPPING
-        if (pin >= 0) {
-            digitalWrite(pin, on ? HIGH : LOW);
-        }
-    } else if (method.equalsIgnoreCase("ShiftRegister")) {
-        if (on) {
-            relayState |= (1 << relayIndex);
-        } else {
-            relayState &= ~(1 << relayIndex);
-        }
-        int dataPin = ioConfig.directIO.relayOutputs.pins.data;
-        int clockPin = ioConfig.directIO.relayOutputs.pins.clock;
-        int latchPin = ioConfig.directIO.relayOutputs.pins.latch;
-        int oePin = ioConfig.directIO.relayOutputs.pins.oe;
-        #if DEBUG_OUTPUT_MANAGER
-        Serial.printf("[OutputPointManager] setDirectRelayStatePhysical: relayIndex=%d, on=%d\n", relayIndex, on);
-        Serial.printf("[OutputPointManager] Pins: data=%d, clock=%d, latch=%d, oe=%d\n", dataPin, clockPin, latchPin, oePin);
-        Serial.printf("[OutputPointManager] relayState before Send_74HC595: 0x%02X\n", relayState);
-        #endif
-        Send_74HC595(relayState, dataPin, clockPin, latchPin);
-        #if DEBUG_OUTPUT_MANAGER
-        Serial.printf("[OutputPointManager] relayState after Send_74HC595: 0x%02X\n", relayState);
-        #endif
+}
+
+// Updates the relay image only; the backends are written by latchRelayImage()
+void OutputPointManager::stageRelayState(int relayIndex, bool on) {
+    if (relayIndex < 0 || relayIndex >= relayCount) return;
+    if (stateMutex) xSemaphoreTake((SemaphoreHandle_t)stateMutex, portMAX_DELAY);
+    portENTER_CRITICAL(&relayMux);
+    uint8_t& relayByte = relayImage[relayIndex / 8];
+    uint8_t mask = (uint8_t)(1 << (relayIndex % 8));
+    uint8_t updated = on ? (relayByte | mask) : (relayByte & ~mask);
+    bool changed = (updated != relayByte);
+    if (changed) {
+        relayByte = updated;
     }
+    portEXIT_CRITICAL(&relayMux);
+    if (changed) backendDirty[relayBackend[relayIndex]] = true;
+    if (stateMutex) xSemaphoreGive((SemaphoreHandle_t)stateMutex);
 }
 
-bool OutputPointManager::sendCommand(const OutputCommand& command) {
-    
-    #if DEBUG_OUTPUT_MANAGER
-    Serial.printf("Inside  OutputPointManager::sendCommand\n");
-    #endif
+// Writes all staged relay changes: one flush (shift-register latch, FC15 request per
+// coil block) per backend with a change
+void OutputPointManager::latchRelayImage() {
+    if (stateMutex) xSemaphoreTake((SemaphoreHandle_t)stateMutex, portMAX_DELAY);
+    bool latched = false;
+    for (size_t i = 0; i < backends.size(); ++i) {
+        if (!backendDirty[i]) continue;
+        backends[i]->flush(relayImage);
+        backendDirty[i] = false;
+        latched = true;
+        LOGD(OUTPUTS, "Flushed %s relays %d-%d\n", backends[i]->name(),
+                      backends[i]->firstRelay(), backends[i]->firstRelay() + backends[i]->relayCount() - 1);
+    }
+    if (stateMutex) xSemaphoreGive((SemaphoreHandle_t)stateMutex);
+    if (latched) liveEvents.notify(LIVE_CHANGE_RELAYS);
+}
 
-    if (!commandQueue) return false;
+// Single byte read of the relay image: no lock needed, may trail a concurrent latch
+bool OutputPointManager::getRelayState(PointHandle handle) const {
+    const PointEntry* entry = pointRegistry.get(handle);
+    if (!entry || entry->kind != PointKind::RELAY_OUTPUT) return false;
+    int relayIndex = entry->localIndex;
+    if (relayIndex < 0 || relayIndex >= relayCount) return false;
+    return (relayImage[relayIndex / 8] & (1 << (relayIndex % 8))) != 0;
+}
+
+// The image bit is cleared before the backend switches off, so a concurrent flush
+// either sees the cleared bit or is followed by switchOff()
+void OutputPointManager::endVolumeDose(int relayIndex) {
+    if (relayIndex < 0 || relayIndex >= relayCount) return;
+    uint8_t mask = (uint8_t)(1 << (relayIndex % 8));
+    portENTER_CRITICAL_SAFE(&relayMux);
+    relayImage[relayIndex / 8] &= ~mask;
+    portEXIT_CRITICAL_SAFE(&relayMux);
+    backends[relayBackend[relayIndex]]->switchOff(relayIndex);
+}
 
-    #if DEBUG_OUTPUT_MANAGER
-    Serial.printf("commandQueue returns true\n");
-    #endif
+void OutputPointManager::volumeDoseEnded(int relayIndex, uint16_t doseSeq) {
+    if (relayIndex < 0 || relayIndex >= relayCount || !doseEndQueue) return;
+    backends[relayBackend[relayIndex]]->commit(); // Sends what endVolumeDose() staged
+    uint32_t packed = ((uint32_t)doseSeq << 16) | (uint16_t)relayIndex;
+    if (xPortInIsrContext()) {
+        BaseType_t woken = pdFALSE;
+        // A full queue only loses the early timer cancel: the safety timeout switches off again
+        xQueueSendFromISR((QueueHandle_t)doseEndQueue, &packed, &woken);
+        xTaskNotifyFromISR((TaskHandle_t)commandProcessorTaskHandle, OUTPUT_EVENT_DOSE_ENDED, eSetBits, &woken);
+        if (woken) portYIELD_FROM_ISR();
+    } else {
+        xQueueSendToBack((QueueHandle_t)doseEndQueue, &packed, 0);
+        notifyProcessor(OUTPUT_EVENT_DOSE_ENDED);
+    }
+}
 
-    BaseType_t result = xQueueSendToBack((QueueHandle_t)commandQueue, &command, 0);
-    #if DEBUG_OUTPUT_MANAGER
-    Serial.printf("[OutputPointManager] sendCommand: pointId=%s, type=%d, durationMs=%lu, result=%d\n",
-                  command.pointId.c_str(), static_cast<int>(command.commandType), command.durationMs, result == pdPASS);
-    #endif
+// Command task: drops the safety timeout unless a newer command already took the relay over
+void OutputPointManager::processEndedDoses() {
+    uint32_t packed;
+    while (xQueueReceive((QueueHandle_t)doseEndQueue, &packed, 0) == pdPASS) {
+        int relayIndex = (int)(packed & 0xFFFF);
+        uint16_t doseSeq = (uint16_t)(packed >> 16);
+        if (relayIndex >= (int)relayDoseSeq.size() || relayDoseSeq[relayIndex] != doseSeq) continue;
+        cancelRelayOff(relayIndex);
+        LOGI(OUTPUTS, "Volume dose on relay %d complete.\n", relayIndex);
+        liveEvents.notify(LIVE_CHANGE_RELAYS);
+    }
+}
+
+void OutputPointManager::notifyProcessor(uint32_t events) {
+    if (commandProcessorTaskHandle) {
+        xTaskNotify((TaskHandle_t)commandProcessorTaskHandle, events, eSetBits);
+    }
+}
+
+bool OutputPointManager::sendCommand(const OutputCommand& command) {
+    if (!commandQueue) return false;
+
+    OutputCommand single = command;
+    single.batchRemaining = 0;
+#if SNR_BENCHMARK
+    single.enqueuedUs = esp_timer_get_time();
+#endif
+    xSemaphoreTake((SemaphoreHandle_t)sendMutex, portMAX_DELAY);
+    BaseType_t result = xQueueSendToBack((QueueHandle_t)commandQueue, &single, 0);
+    noteQueueDepth(result == pdPASS);
+    xSemaphoreGive((SemaphoreHandle_t)sendMutex);
+    if (result == pdPASS) notifyProcessor(OUTPUT_EVENT_COMMANDS);
+    LOGD(OUTPUTS, "sendCommand: point=%d, type=%d, durationMs=%lu, result=%d\n",
+                  command.point, static_cast<int>(command.commandType), (unsigned long)command.durationMs, result == pdPASS);
     return (result == pdPASS);
 }
 
+bool OutputPointManager::sendCommand(const String& pointId, RelayCommandType commandType, uint32_t durationMs) {
+    OutputCommand command;
+    command.point = pointRegistry.resolve(pointId, PointKind::RELAY_OUTPUT);
+    if (command.point == INVALID_POINT_HANDLE) {
+        LOGW(OUTPUTS, "sendCommand: Unknown relay pointId: %s\n", pointId.c_str());
+        return false;
+    }
+    command.commandType = commandType;
+    command.durationMs = durationMs;
+    return sendCommand(command);
+}
+
+bool OutputPointManager::sendCommands(const std::vector<OutputCommand>& commands) {
+    if (!commandQueue || commands.empty()) return false;
+    if (commands.size() > OUTPUT_COMMAND_QUEUE_LENGTH) {
+        LOGW(OUTPUTS, "sendCommands: batch of %d exceeds queue length %d\n",
+                      (int)commands.size(), OUTPUT_COMMAND_QUEUE_LENGTH);
+        return false;
+    }
+
+    // All-or-nothing: the whole batch must fit so the processor never waits on a partial batch
+    xSemaphoreTake((SemaphoreHandle_t)sendMutex, portMAX_DELAY);
+    if (uxQueueSpacesAvailable((QueueHandle_t)commandQueue) < commands.size()) {
+        noteQueueDepth(false);
+        xSemaphoreGive((SemaphoreHandle_t)sendMutex);
+        LOGW(OUTPUTS, "sendCommands: not enough queue space for batch");
+        return false;
+    }
+    size_t count = commands.size();
+    for (size_t i = 0; i < count; ++i) {
+        OutputCommand cmd = commands[i];
+        cmd.batchRemaining = (uint8_t)(count - 1 - i);
+#if SNR_BENCHMARK
+        cmd.enqueuedUs = esp_timer_get_time();
+#endif
+        xQueueSendToBack((QueueHandle_t)commandQueue, &cmd, 0);
+    }
+    noteQueueDepth(true);
+    xSemaphoreGive((SemaphoreHandle_t)sendMutex);
+    notifyProcessor(OUTPUT_EVENT_COMMANDS);
+    LOGD(OUTPUTS, "sendCommands: queued batch of %d command(s)\n", (int)count);
+    return true;
+}
+
+size_t OutputPointManager::getQueueDepth() const {
+    return commandQueue ? uxQueueMessagesWaiting((QueueHandle_t)commandQueue) : 0;
+}
+
+// Updates the queue statistics after a send attempt; caller holds sendMutex
+void OutputPointManager::noteQueueDepth(bool accepted) {
+    if (!accepted) {
+        rejectedCommands = rejectedCommands + 1;
+        return;
+    }
+    size_t depth = getQueueDepth();
+    if (depth > queuePeakDepth) queuePeakDepth = depth;
+}
+
 // FreeRTOS task wrapper
 void OutputPointManager::commandProcessorTaskWrapper(void* parameter) {
     OutputPointManager* self = static_cast<OutputPointManager*>(parameter);
@@ -195,85 +334,199 @@ void OutputPointManager::commandProcessorTaskWrapper(void* parameter) {
 }
 
 // Command processor task
+// Sole owner of the timer heap and dose sequence numbers: the off timer and dose ends
+// only set notification bits. Expired relays, then every command already waiting in
+// the queue (and every command of an announced batch) are applied to the relay image
+// first, then each backend is flushed once.
 void OutputPointManager::processCommandQueueTask() {
     OutputCommand cmd;
     while (true) {
-        if (xQueueReceive((QueueHandle_t)commandQueue, &cmd, portMAX_DELAY) == pdPASS) {
-            #if DEBUG_OUTPUT_MANAGER
-            Serial.printf("[OutputPointManager] Processing command: pointId=%s, type=%d, durationMs=%lu\n",
-                          cmd.pointId.c_str(), static_cast<int>(cmd.commandType), cmd.durationMs);
-            #endif
-            auto it = directRelayPointIdToIndexMap.find(cmd.pointId);
-            if (it != directRelayPointIdToIndexMap.end()) {
-                int relayIndex = it->second;
-                switch (cmd.commandType) {
-                    case RelayCommandType::TURN_ON:
-                        setDirectRelayStatePhysical(relayIndex, true);
-                        break;
-                    case RelayCommandType::TURN_OFF:
-                        setDirectRelayStatePhysical(relayIndex, false);
-                        break;
-                    case RelayCommandType::TURN_ON_TIMED:
-                        setDirectRelayStatePhysical(relayIndex, true);
-                        // Cancel any existing timer for this relay
-                        if (relayIndex < activeTimerTasks.size() && activeTimerTasks[relayIndex] != nullptr) {
-                            vTaskDelete(activeTimerTasks[relayIndex]);
-                            activeTimerTasks[relayIndex] = nullptr;
-                        }
-                        // Start a new timer task for this relay
-                        struct TimerParams {
-                            OutputPointManager* manager;
-                            int relayIndex;
-                            unsigned long durationMs;
-                        };
-                        TimerParams* params = new TimerParams{this, relayIndex, cmd.durationMs};
-                        xTaskCreate(
-                            [](void* p) {
-                                TimerParams* tp = static_cast<TimerParams*>(p);
-                                vTaskDelay(pdMS_TO_TICKS(tp->durationMs));
-                                // Send TURN_OFF command for this relay
-                                OutputCommand offCmd;
-                                offCmd.pointId = "DirectRelay_" + String(tp->relayIndex); // Adjust as needed for your pointId mapping
-                                offCmd.commandType = RelayCommandType::TURN_OFF;
-                                offCmd.durationMs = 0;
-                                tp->manager->sendCommand(offCmd);
-                                // Clean up
-                                tp->manager->activeTimerTasks[tp->relayIndex] = nullptr;
-                                delete tp;
-                                vTaskDelete(nullptr);
-                            },
-                            "RelayTimerTask",
-                            2048,
-                            params,
-                            1,
-                            &activeTimerTasks[relayIndex]
-                        );
-                    break;
-                }
-            } else {
-                #if DEBUG_OUTPUT_MANAGER
-                Serial.printf("[OutputPointManager] Unknown pointId: %s\n", cmd.pointId.c_str());
-                #endif
+        uint32_t events = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
+        if (events & OUTPUT_EVENT_DOSE_ENDED) {
+            processEndedDoses();
+        }
+        if (events & OUTPUT_EVENT_RELAY_TIMER) {
+            processExpiredRelayTimers();
+        }
+        // A notification can outlive the commands it announced (drained by an earlier round)
+        if (xQueueReceive((QueueHandle_t)commandQueue, &cmd, 0) == pdPASS) {
+            applyCommand(cmd);
+#if SNR_BENCHMARK
+            int64_t oldestEnqueuedUs = cmd.enqueuedUs;
+#endif
+            while (true) {
+                TickType_t wait = (cmd.batchRemaining > 0) ? pdMS_TO_TICKS(OUTPUT_BATCH_WAIT_MS) : 0;
+                if (xQueueReceive((QueueHandle_t)commandQueue, &cmd, wait) != pdPASS) break;
+                applyCommand(cmd);
             }
+            latchRelayImage();
+#if SNR_BENCHMARK
+            BENCH_RECORD(benchRelayLatch, (uint32_t)(esp_timer_get_time() - oldestEnqueuedUs));
+#endif
+        } else {
+            latchRelayImage(); // Expired relays only
         }
     }
 }
 
+// Applies one command to the relay image and timer heap. Command task only.
+void OutputPointManager::applyCommand(const OutputCommand& cmd) {
+    LOGD(OUTPUTS, "Processing command: point=%d, type=%d, durationMs=%lu\n",
+                  cmd.point, static_cast<int>(cmd.commandType), (unsigned long)cmd.durationMs);
+    const PointEntry* entry = pointRegistry.get(cmd.point);
+    if (!entry || entry->kind != PointKind::RELAY_OUTPUT || entry->localIndex >= relayCount) {
+        LOGW(OUTPUTS, "Unknown relay handle: %d\n", cmd.point);
+        return;
+    }
+    int relayIndex = entry->localIndex;
+    // Every command takes the relay over from a running volume dose
+    ++relayDoseSeq[relayIndex];
+    flowMeterManager.cancelDose(relayIndex);
+    switch (cmd.commandType) {
+        case RelayCommandType::TURN_ON:
+            cancelRelayOff(relayIndex);
+            stageRelayState(relayIndex, true);
+            break;
+        case RelayCommandType::TURN_OFF:
+            cancelRelayOff(relayIndex);
+            stageRelayState(relayIndex, false);
+            break;
+        case RelayCommandType::TURN_ON_TIMED:
+            stageRelayState(relayIndex, true);
+            // Replaces any pending deadline for this relay
+            scheduleRelayOff(relayIndex, cmd.durationMs);
+            break;
+        case RelayCommandType::TURN_ON_VOLUME:
+            stageRelayState(relayIndex, true);
+            scheduleRelayOff(relayIndex, cmd.durationMs); // Safety timeout if the meter stops counting
+            if (!flowMeterManager.armDose(relayIndex, cmd.volumeMl, relayDoseSeq[relayIndex])) {
+                LOGW(OUTPUTS, "Relay %d has no flow meter; %lu mL dose runs for %lu ms instead.\n",
+                              relayIndex, (unsigned long)cmd.volumeMl, (unsigned long)cmd.durationMs);
+            }
+            break;
+    }
+}
+
+// --- Relay off-deadline scheduling (min-heap + single esp_timer) ---
+// All functions below except offTimerCallback run on the command processor task.
+
+bool OutputPointManager::timerHeapLess(size_t a, size_t b) const {
+    return relayOffDeadlineUs[timerHeap[a]] < relayOffDeadlineUs[timerHeap[b]];
+}
+
+void OutputPointManager::timerHeapSwap(size_t a, size_t b) {
+    std::swap(timerHeap[a], timerHeap[b]);
+    timerHeapPos[timerHeap[a]] = (int)a;
+    timerHeapPos[timerHeap[b]] = (int)b;
+}
+
+void OutputPointManager::timerHeapSiftUp(size_t pos) {
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (!timerHeapLess(pos, parent)) break;
+        timerHeapSwap(pos, parent);
+        pos = parent;
+    }
+}
+
+void OutputPointManager::timerHeapSiftDown(size_t pos) {
+    size_t n = timerHeap.size();
+    while (true) {
+        size_t left = 2 * pos + 1;
+        size_t right = left + 1;
+        size_t smallest = pos;
+        if (left < n && timerHeapLess(left, smallest)) smallest = left;
+        if (right < n && timerHeapLess(right, smallest)) smallest = right;
+        if (smallest == pos) break;
+        timerHeapSwap(pos, smallest);
+        pos = smallest;
+    }
+}
+
+void OutputPointManager::timerHeapRemoveAt(size_t pos) {
+    size_t last = timerHeap.size() - 1;
+    int relayIndex = timerHeap[pos];
+    if (pos != last) timerHeapSwap(pos, last);
+    timerHeap.pop_back();
+    timerHeapPos[relayIndex] = -1;
+    if (pos < timerHeap.size()) {
+        timerHeapSiftDown(pos);
+        timerHeapSiftUp(pos);
+    }
+}
+
+void OutputPointManager::scheduleRelayOff(int relayIndex, unsigned long durationMs) {
+    if (relayIndex < 0 || relayIndex >= (int)timerHeapPos.size()) return;
+    relayOffDeadlineUs[relayIndex] = esp_timer_get_time() + (int64_t)durationMs * 1000;
+    int pos = timerHeapPos[relayIndex];
+    if (pos >= 0) {
+        // Re-trigger: move the existing entry to its new place
+        timerHeapSiftUp(pos);
+        timerHeapSiftDown(timerHeapPos[relayIndex]);
+    } else {
+        timerHeap.push_back(relayIndex);
+        timerHeapPos[relayIndex] = (int)timerHeap.size() - 1;
+        timerHeapSiftUp(timerHeap.size() - 1);
+    }
+    LOGD(OUTPUTS, "Relay %d off in %lu ms (%d timer(s) pending)\n",
+                  relayIndex, durationMs, (int)timerHeap.size());
+    armOffTimer();
+}
+
+void OutputPointManager::cancelRelayOff(int relayIndex) {
+    if (relayIndex < 0 || relayIndex >= (int)timerHeapPos.size()) return;
+    int pos = timerHeapPos[relayIndex];
+    if (pos < 0) return;
+    bool wasEarliest = (pos == 0);
+    timerHeapRemoveAt(pos);
+    if (wasEarliest) armOffTimer();
+}
+
+void OutputPointManager::armOffTimer() {
+    if (!offTimer) return;
+    esp_timer_stop((esp_timer_handle_t)offTimer); // Fails harmlessly if not running
+    if (timerHeap.empty()) return;
+    int64_t delayUs = relayOffDeadlineUs[timerHeap[0]] - esp_timer_get_time();
+    if (delayUs < 1) delayUs = 1;
+    esp_timer_start_once((esp_timer_handle_t)offTimer, (uint64_t)delayUs);
+}
+
+// esp_timer callback (runs in the shared esp_timer task): never waits on relay I/O
+void OutputPointManager::offTimerCallback(void* parameter) {
+    OutputPointManager* self = static_cast<OutputPointManager*>(parameter);
+    if (self) self->notifyProcessor(OUTPUT_EVENT_RELAY_TIMER);
+}
+
+// Stages every expired relay off; the caller latches them together with its commands
+void OutputPointManager::processExpiredRelayTimers() {
+    int64_t now = esp_timer_get_time();
+    while (!timerHeap.empty() && relayOffDeadlineUs[timerHeap[0]] <= now) {
+        int relayIndex = timerHeap[0];
+        timerHeapRemoveAt(0);
+        LOGD(OUTPUTS, "Timed off reached for relay %d\n", relayIndex);
+        if (flowMeterManager.cancelDose(relayIndex)) {
+            LOGW(OUTPUTS, "Volume dose on relay %d timed out before reaching its volume.\n", relayIndex);
+        }
+        stageRelayState(relayIndex, false);
+    }
+    armOffTimer();
+}
+
 // Persistence helpers using ArduinoJSON 7
 
 // Save OutputPointDefinition to file (ArduinoJSON 7 compliant)
 bool OutputPointManager::saveOutputPointDefinition(const OutputPointDefinition& definition, const JsonObject& configValues) {
     String path = getOutputDefinitionPath(definition.pointId);
     ensureDirectoryExists("/data/output_definitions/");
-    File file = LittleFS.open(path, "w");
-    if (!file) {
+    AtomicFileWriter file;
+    if (!file.open(path)) {
         Serial.println("Failed to open output definition file for writing.");
         return false;
     }
     String jsonString = definition.serialize(configValues);
     size_t written = file.print(jsonString);
-    file.close();
-    return (written > 0);
+    return (written > 0) && file.commit();
 }
 
 // Load OutputPointDefinition from file (ArduinoJSON 7 compliant)
@@ -307,6 +560,16 @@ bool OutputPointManager::loadOutputPointDefinition(const String& pointId, Output
     return true;
 }
 
+// Used for volume events on relays without a flow meter: they run for volume / flow
+float OutputPointManager::getConfiguredFlowMlPerSec(const String& pointId) {
+    JsonDocument doc;
+    if (!readFileToJsonDocument(getOutputDefinitionPath(pointId), doc)) return 0.0f;
+    float flowGph = doc["configValues"]["flowRateGPH"] | 0.0f;
+    int emitters = doc["configValues"]["emittersPerPlant"] | 1;
+    if (flowGph <= 0.0f || emitters < 1) return 0.0f;
+    return flowGph * emitters * OUTPUT_ML_PER_GALLON / 3600.0f;
+}
+
 // Helper functions
 
 String OutputPointManager::getOutputDefinitionPath(const String& pointId) {
@@ -321,19 +584,11 @@ String OutputPointManager::sanitizeFilename(const String& input) {
 }
 
 bool OutputPointManager::readFileToJsonDocument(const String& path, JsonDocument& doc) {
-    File file = LittleFS.open(path, "r");
-    if (!file) return false;
-    DeserializationError error = deserializeJson(doc, file);
-    file.close();
-    return !error;
+    return readJsonFile(path, doc) == FileReadResult::OK && !doc.isNull();
 }
 
 bool OutputPointManager::writeJsonDocumentToFile(const String& path, JsonDocument& doc) {
-    File file = LittleFS.open(path, "w");
-    if (!file) return false;
-    bool ok = (serializeJson(doc, file) > 0);
-    file.close();
-    return ok;
+    return writeJsonFileAtomic(path, doc);
 }
 
 void OutputPointManager::ensureDirectoryExists(const String& path) {
@@ -0,0 +1,94 @@
+#include "PersistenceWorker.h"
+#include "TaskConfig.h"
+
+// FreeRTOS includes
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+
+bool PersistenceWorker::begin() {
+    if (taskHandle) {
+        return true;
+    }
+    jobQueue = xQueueCreate(PERSISTENCE_QUEUE_LENGTH, sizeof(PersistenceJob));
+    if (!jobQueue) {
+        Serial.println("[Persistence] Failed to create job queue.");
+        return false;
+    }
+    BaseType_t taskCreated = xTaskCreatePinnedToCore(
+        taskWrapper,
+        "PersistenceTask",
+        6144, // JSON serialization of the lock table and cycle files
+        this,
+        TASK_PRIORITY_PERSISTENCE,
+        (TaskHandle_t*)&taskHandle,
+        SERVICE_CORE
+    );
+    if (taskCreated != pdPASS) {
+        taskHandle = nullptr;
+        Serial.println("[Persistence] Failed to create worker task.");
+        return false;
+    }
+    return true;
+}
+
+bool PersistenceWorker::submit(void (*run)(void*), void* context) {
+    if (!jobQueue || !run) return false;
+    PersistenceJob job;
+    job.run = run;
+    job.context = context;
+    return xQueueSend((QueueHandle_t)jobQueue, &job, 0) == pdTRUE;
+}
+
+bool PersistenceWorker::addPeriodic(void (*run)(void*), void* context, uint32_t periodMs) {
+    bool added = false;
+    portENTER_CRITICAL(&periodicMux);
+    if (run && periodMs > 0 && periodicCount < PERSISTENCE_MAX_PERIODIC) {
+        PeriodicJob& entry = periodic[periodicCount];
+        entry.job.run = run;
+        entry.job.context = context;
+        entry.periodMs = periodMs;
+        entry.lastRunMs = millis();
+        ++periodicCount; // Published last: the worker only reads complete entries
+        added = true;
+    }
+    portEXIT_CRITICAL(&periodicMux);
+    if (!added) {
+        Serial.println("[Persistence] Cannot register periodic job.");
+    }
+    return added;
+}
+
+void PersistenceWorker::taskWrapper(void* parameter) {
+    static_cast<PersistenceWorker*>(parameter)->task();
+}
+
+void PersistenceWorker::task() {
+    while (true) {
+        uint32_t waitMs = runDuePeriodic();
+        PersistenceJob job;
+        if (xQueueReceive((QueueHandle_t)jobQueue, &job, pdMS_TO_TICKS(waitMs)) == pdTRUE) {
+            job.run(job.context);
+        }
+    }
+}
+
+// Runs every periodic job that is due and returns the time until the next one
+uint32_t PersistenceWorker::runDuePeriodic() {
+    uint32_t waitMs = 60UL * 1000; // Idle wake-up without periodic jobs
+    portENTER_CRITICAL(&periodicMux);
+    size_t count = periodicCount;
+    portEXIT_CRITICAL(&periodicMux);
+    for (size_t i = 0; i < count; ++i) {
+        PeriodicJob& entry = periodic[i];
+        uint32_t elapsed = millis() - entry.lastRunMs;
+        if (elapsed >= entry.periodMs) {
+            entry.job.run(entry.job.context);
+            entry.lastRunMs += entry.periodMs * (elapsed / entry.periodMs); // Skip missed runs, keep the phase
+            elapsed = millis() - entry.lastRunMs;
+        }
+        uint32_t untilDue = elapsed < entry.periodMs ? entry.periodMs - elapsed : 0;
+        if (untilDue < waitMs) waitMs = untilDue;
+    }
+    return waitMs;
+}
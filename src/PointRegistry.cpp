@@ -0,0 +1,58 @@
+#include "PointRegistry.h"
+
+/**
+ * @brief Registers a point and assigns it the next free handle.
+ *
+ * Re-registering the same pointId with the same kind returns the existing handle
+ * (and updates its local index), so a manager's begin() can safely run twice.
+ *
+ * @param pointId The configured point identifier.
+ * @param kind The point type / owning manager.
+ * @param localIndex Index of the point inside the owning manager.
+ * @return The assigned handle, or INVALID_POINT_HANDLE on conflict or an empty pointId.
+ */
+PointHandle PointRegistry::registerPoint(const String& pointId, PointKind kind, int16_t localIndex) {
+    if (pointId.isEmpty()) return INVALID_POINT_HANDLE;
+
+    auto it = handleByPointId.find(pointId);
+    if (it != handleByPointId.end()) {
+        PointEntry& existing = entries[it->second];
+        if (existing.kind != kind) {
+            Serial.printf("[PointRegistry] pointId '%s' already registered with another kind.\n", pointId.c_str());
+            return INVALID_POINT_HANDLE;
+        }
+        existing.localIndex = localIndex;
+        return it->second;
+    }
+    if (entries.size() >= 0x7FFF) {
+        Serial.println("[PointRegistry] Registry full.");
+        return INVALID_POINT_HANDLE;
+    }
+
+    PointHandle handle = (PointHandle)entries.size();
+    entries.push_back({pointId, kind, localIndex});
+    handleByPointId[pointId] = handle;
+    return handle;
+}
+
+/**
+ * @brief Looks up the handle of a pointId.
+ * @param pointId The configured point identifier.
+ * @return The handle, or INVALID_POINT_HANDLE if the point is unknown.
+ */
+PointHandle PointRegistry::resolve(const String& pointId) const {
+    auto it = handleByPointId.find(pointId);
+    return (it != handleByPointId.end()) ? it->second : INVALID_POINT_HANDLE;
+}
+
+/**
+ * @brief Looks up the handle of a pointId and checks its kind.
+ * @param pointId The configured point identifier.
+ * @param kind The expected point kind.
+ * @return The handle, or INVALID_POINT_HANDLE if unknown or of another kind.
+ */
+PointHandle PointRegistry::resolve(const String& pointId, PointKind kind) const {
+    PointHandle handle = resolve(pointId);
+    const PointEntry* entry = get(handle);
+    return (entry && entry->kind == kind) ? handle : INVALID_POINT_HANDLE;
+}
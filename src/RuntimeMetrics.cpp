@@ -0,0 +1,207 @@
+#include "RuntimeMetrics.h"
+#include "OutputPointManager.h"
+#include "ModbusMaster.h"
+#include "LogBuffer.h"
+
+// FreeRTOS includes
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+
+extern OutputPointManager outputManager;
+extern ModbusMaster modbusMaster;
+extern LogBuffer logBuffer;
+extern RuntimeMetrics runtimeMetrics;
+
+namespace {
+// Upper bounds (us) of the finite latency buckets
+const uint32_t kLatencyBucketBoundsUs[METRICS_LATENCY_BUCKETS] = {
+    500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000
+};
+
+// Tasks whose stack high-water mark is reported (looked up by name; absent ones are skipped).
+// Modbus bus tasks have per-interface names and are reported with the bus counters.
+const char* const kMonitoredTasks[] = {
+    "loopTask", "async_tcp", "OutputCmdProcTask", "InputReaderTask", "ScheduleEngineTask",
+    "LoginTask", "LogDrainTask", "LiveEventsTask", "AutopilotTask", "PersistenceTask", "BenchmarkTask"
+};
+
+inline void atomicAdd(uint32_t& counter, uint32_t value) {
+    __atomic_fetch_add(&counter, value, __ATOMIC_RELAXED);
+}
+
+inline uint32_t atomicLoad(const uint32_t& counter) {
+    return __atomic_load_n(&counter, __ATOMIC_RELAXED);
+}
+
+inline void atomicMax(uint32_t& counter, uint32_t value) {
+    uint32_t current = atomicLoad(counter);
+    while (value > current
+           && !__atomic_compare_exchange_n(&counter, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+} // namespace
+
+void RuntimeMetrics::recordRoute(MetricRoute route, uint32_t micros) {
+    if (route >= MetricRoute::COUNT) return;
+    record(routes[(size_t)route], micros);
+}
+
+void RuntimeMetrics::recordAutopilotReaction(uint32_t micros) {
+    record(autopilotReaction, micros);
+}
+
+void RuntimeMetrics::record(RouteCounters& counters, uint32_t micros) {
+    size_t bucket = 0;
+    while (bucket < METRICS_LATENCY_BUCKETS && micros > kLatencyBucketBoundsUs[bucket]) ++bucket;
+    atomicAdd(counters.buckets[bucket], 1);
+    atomicAdd(counters.sumUs, micros);
+    atomicMax(counters.maxUs, micros);
+    atomicAdd(counters.count, 1);
+}
+
+void RuntimeMetrics::recordFsRead(size_t bytes) {
+    atomicAdd(fsReads, 1);
+    atomicAdd(fsReadBytes, (uint32_t)bytes);
+}
+
+void RuntimeMetrics::recordFsWrite(size_t bytes) {
+    atomicAdd(fsWrites, 1);
+    atomicAdd(fsWriteBytes, (uint32_t)bytes);
+}
+
+const char* RuntimeMetrics::routeName(MetricRoute route) {
+    switch (route) {
+        case MetricRoute::LOGIN:           return "login";
+        case MetricRoute::LOGOUT:          return "logout";
+        case MetricRoute::USER:            return "user";
+        case MetricRoute::LOGS:            return "logs";
+        case MetricRoute::METRICS:         return "metrics";
+        case MetricRoute::SCHEDULES:       return "schedules";
+        case MetricRoute::SCHEDULE_GET:    return "schedule_get";
+        case MetricRoute::SCHEDULE_SAVE:   return "schedule_save";
+        case MetricRoute::SCHEDULE_DELETE: return "schedule_delete";
+        case MetricRoute::SCHEDULE_LOCK:   return "schedule_lock";
+        case MetricRoute::SCHEDULE_UNLOCK: return "schedule_unlock";
+        case MetricRoute::HISTORY:         return "history";
+        case MetricRoute::SCHEDULE_IMPORT: return "schedule_import";
+        case MetricRoute::SCHEDULE_EXPORT: return "schedule_export";
+        default:                           return "unknown";
+    }
+}
+
+/**
+ * @brief Writes the per-route request counters and latency histograms.
+ *
+ * Routes that have not been requested since boot are omitted to keep the payload small.
+ * Buckets are reported cumulatively as the format requires.
+ */
+void RuntimeMetrics::writeRoutes(Print& out) const {
+    out.print("# TYPE snr_http_request_duration_us histogram\n");
+    for (size_t i = 0; i < (size_t)MetricRoute::COUNT; ++i) {
+        const RouteCounters& counters = routes[i];
+        uint32_t count = atomicLoad(counters.count);
+        if (count == 0) continue;
+        const char* name = routeName((MetricRoute)i);
+        uint32_t cumulative = 0;
+        for (size_t b = 0; b < METRICS_LATENCY_BUCKETS; ++b) {
+            cumulative += atomicLoad(counters.buckets[b]);
+            out.printf("snr_http_request_duration_us_bucket{route=\"%s\",le=\"%lu\"} %lu\n",
+                       name, (unsigned long)kLatencyBucketBoundsUs[b], (unsigned long)cumulative);
+        }
+        cumulative += atomicLoad(counters.buckets[METRICS_LATENCY_BUCKETS]);
+        // Recorders bump count last, so a concurrent update never makes +Inf exceed it
+        out.printf("snr_http_request_duration_us_bucket{route=\"%s\",le=\"+Inf\"} %lu\n", name, (unsigned long)cumulative);
+        out.printf("snr_http_request_duration_us_sum{route=\"%s\"} %lu\n", name, (unsigned long)atomicLoad(counters.sumUs));
+        out.printf("snr_http_request_duration_us_count{route=\"%s\"} %lu\n", name, (unsigned long)cumulative);
+    }
+    out.print("# TYPE snr_http_request_duration_max_us gauge\n");
+    for (size_t i = 0; i < (size_t)MetricRoute::COUNT; ++i) {
+        if (atomicLoad(routes[i].count) == 0) continue;
+        out.printf("snr_http_request_duration_max_us{route=\"%s\"} %lu\n",
+                   routeName((MetricRoute)i), (unsigned long)atomicLoad(routes[i].maxUs));
+    }
+}
+
+/** @brief Writes the least free stack (bytes) of each monitored task that exists. */
+void RuntimeMetrics::writeTasks(Print& out) {
+    out.print("# TYPE snr_task_stack_free_min_bytes gauge\n");
+    for (const char* name : kMonitoredTasks) {
+        TaskHandle_t handle = xTaskGetHandle(name);
+        if (!handle) continue;
+        out.printf("snr_task_stack_free_min_bytes{task=\"%s\"} %lu\n",
+                   name, (unsigned long)uxTaskGetStackHighWaterMark(handle));
+    }
+    ModbusBusStats bus;
+    for (size_t i = 0; modbusMaster.getBusStats(i, bus); ++i) {
+        out.printf("snr_task_stack_free_min_bytes{task=\"ModbusRTU_%s\"} %lu\n",
+                   bus.interfaceId.c_str(), (unsigned long)bus.stackHighWaterBytes);
+    }
+}
+
+/** @brief Writes the autopilot reaction-time histogram (omitted until the first dose). */
+void RuntimeMetrics::writeAutopilot(Print& out) const {
+    if (atomicLoad(autopilotReaction.count) == 0) return;
+    out.print("# TYPE snr_autopilot_reaction_us histogram\n");
+    uint32_t cumulative = 0;
+    for (size_t b = 0; b < METRICS_LATENCY_BUCKETS; ++b) {
+        cumulative += atomicLoad(autopilotReaction.buckets[b]);
+        out.printf("snr_autopilot_reaction_us_bucket{le=\"%lu\"} %lu\n",
+                   (unsigned long)kLatencyBucketBoundsUs[b], (unsigned long)cumulative);
+    }
+    cumulative += atomicLoad(autopilotReaction.buckets[METRICS_LATENCY_BUCKETS]);
+    out.printf("snr_autopilot_reaction_us_bucket{le=\"+Inf\"} %lu\n", (unsigned long)cumulative);
+    out.printf("snr_autopilot_reaction_us_sum %lu\n", (unsigned long)atomicLoad(autopilotReaction.sumUs));
+    out.printf("snr_autopilot_reaction_us_count %lu\n", (unsigned long)cumulative);
+    out.printf("# TYPE snr_autopilot_reaction_max_us gauge\nsnr_autopilot_reaction_max_us %lu\n",
+               (unsigned long)atomicLoad(autopilotReaction.maxUs));
+}
+
+void RuntimeMetrics::writeText(Print& out) const {
+    out.printf("# TYPE snr_uptime_seconds counter\nsnr_uptime_seconds %lu\n",
+               (unsigned long)(esp_timer_get_time() / 1000000));
+
+    // Heap: a large gap between free and largest block means fragmentation
+    out.printf("# TYPE snr_heap_free_bytes gauge\nsnr_heap_free_bytes %lu\n", (unsigned long)ESP.getFreeHeap());
+    out.printf("# TYPE snr_heap_min_free_bytes gauge\nsnr_heap_min_free_bytes %lu\n", (unsigned long)ESP.getMinFreeHeap());
+    out.printf("# TYPE snr_heap_largest_block_bytes gauge\nsnr_heap_largest_block_bytes %lu\n", (unsigned long)ESP.getMaxAllocHeap());
+
+    writeTasks(out);
+    writeRoutes(out);
+    writeAutopilot(out);
+
+    out.printf("# TYPE snr_fs_reads_total counter\nsnr_fs_reads_total %lu\n", (unsigned long)atomicLoad(fsReads));
+    out.printf("# TYPE snr_fs_read_bytes_total counter\nsnr_fs_read_bytes_total %lu\n", (unsigned long)atomicLoad(fsReadBytes));
+    out.printf("# TYPE snr_fs_writes_total counter\nsnr_fs_writes_total %lu\n", (unsigned long)atomicLoad(fsWrites));
+    out.printf("# TYPE snr_fs_write_bytes_total counter\nsnr_fs_write_bytes_total %lu\n", (unsigned long)atomicLoad(fsWriteBytes));
+
+    out.printf("# TYPE snr_output_queue_depth gauge\nsnr_output_queue_depth %lu\n", (unsigned long)outputManager.getQueueDepth());
+    out.printf("# TYPE snr_output_queue_peak_depth gauge\nsnr_output_queue_peak_depth %lu\n", (unsigned long)outputManager.getQueuePeakDepth());
+    out.printf("# TYPE snr_output_queue_capacity gauge\nsnr_output_queue_capacity %d\n", OUTPUT_COMMAND_QUEUE_LENGTH);
+    out.printf("# TYPE snr_output_commands_rejected_total counter\nsnr_output_commands_rejected_total %lu\n",
+               (unsigned long)outputManager.getRejectedCommands());
+
+    out.printf("# TYPE snr_log_records_total counter\nsnr_log_records_total %lu\n", (unsigned long)logBuffer.latestSeq());
+
+    if (modbusMaster.busCount() > 0) {
+        ModbusBusStats bus;
+        out.print("# TYPE snr_modbus_requests_total counter\n");
+        for (size_t i = 0; modbusMaster.getBusStats(i, bus); ++i) {
+            out.printf("snr_modbus_requests_total{interface=\"%s\"} %lu\n", bus.interfaceId.c_str(), (unsigned long)bus.requests);
+        }
+        out.print("# TYPE snr_modbus_failures_total counter\n");
+        for (size_t i = 0; modbusMaster.getBusStats(i, bus); ++i) {
+            out.printf("snr_modbus_failures_total{interface=\"%s\"} %lu\n", bus.interfaceId.c_str(), (unsigned long)bus.failures);
+        }
+        out.print("# TYPE snr_modbus_bus_utilisation_permille gauge\n");
+        for (size_t i = 0; modbusMaster.getBusStats(i, bus); ++i) {
+            out.printf("snr_modbus_bus_utilisation_permille{interface=\"%s\"} %u\n", bus.interfaceId.c_str(), (unsigned)bus.utilisationPermille);
+        }
+    }
+}
+
+RouteTimer::RouteTimer(MetricRoute r) : route(r), startUs(esp_timer_get_time()) {}
+
+RouteTimer::~RouteTimer() {
+    runtimeMetrics.recordRoute(route, (uint32_t)(esp_timer_get_time() - startUs));
+}
@@ -0,0 +1,224 @@
+#include "ScheduleBinary.h"
+#include "ScheduleManager.h" // For the event comparison helpers
+#include <LittleFS.h>
+#include <vector>
+#include <algorithm> // For std::sort
+#include "RuntimeMetrics.h" // LittleFS op counters
+#include "AtomicFile.h"
+
+extern RuntimeMetrics runtimeMetrics;
+
+/**
+ * @brief Writes the packed binary sidecar for a schedule.
+ *
+ * Builds the header and fixed-size records, sorts each record array by start
+ * time and writes everything with one write per section.
+ *
+ * @param path Path of the sidecar file to (over)write.
+ * @param schedule The schedule to encode.
+ * @param jsonSize Size in bytes of the JSON file written for the same schedule.
+ * @param jsonCrc CRC-32 of that JSON file.
+ * @return True if every byte was written, false if the file could not be opened
+ *         or a write came up short.
+ */
+bool writeScheduleBinary(const String& path, const Schedule& schedule, uint32_t jsonSize, uint32_t jsonCrc) {
+    std::vector<AutopilotWindow> apSorted(schedule.autopilotWindows);
+    std::vector<DurationEvent> durSorted(schedule.durationEvents);
+    std::vector<VolumeEvent> volSorted(schedule.volumeEvents);
+    std::sort(apSorted.begin(), apSorted.end(), ScheduleManager::compareAutopilotWindows);
+    std::sort(durSorted.begin(), durSorted.end(), ScheduleManager::compareDurationEvents);
+    std::sort(volSorted.begin(), volSorted.end(), ScheduleManager::compareVolumeEvents);
+
+    ScheduleBinHeader header = {};
+    header.magic = SCHEDULE_BIN_MAGIC;
+    header.version = SCHEDULE_BIN_VERSION;
+    header.headerSize = sizeof(ScheduleBinHeader);
+    header.jsonSize = jsonSize;
+    header.jsonCrc = jsonCrc;
+    header.lightsOnTime = (int16_t)schedule.lightsOnTime;
+    header.lightsOffTime = (int16_t)schedule.lightsOffTime;
+    header.apCount = (uint16_t)apSorted.size();
+    header.durCount = (uint16_t)durSorted.size();
+    header.volCount = (uint16_t)volSorted.size();
+
+    std::vector<ScheduleBinAutopilot> apRecords;
+    apRecords.reserve(apSorted.size());
+    for (const auto& apw : apSorted) {
+        ScheduleBinAutopilot rec = {};
+        rec.startTime = (uint16_t)apw.startTime;
+        rec.endTime = (uint16_t)apw.endTime;
+        rec.matricTension = apw.matricTension;
+        rec.doseVolume = apw.doseVolume;
+        rec.settlingTime = (uint16_t)apw.settlingTime;
+        rec.doseDuration = (uint16_t)apw.doseDuration;
+        apRecords.push_back(rec);
+    }
+
+    std::vector<ScheduleBinDuration> durRecords;
+    durRecords.reserve(durSorted.size());
+    for (const auto& de : durSorted) {
+        ScheduleBinDuration rec = {};
+        rec.startTime = (uint16_t)de.startTime;
+        rec.endTime = (uint16_t)de.endTime;
+        rec.duration = (uint32_t)de.duration;
+        durRecords.push_back(rec);
+    }
+
+    std::vector<ScheduleBinVolume> volRecords;
+    volRecords.reserve(volSorted.size());
+    for (const auto& ve : volSorted) {
+        ScheduleBinVolume rec = {};
+        rec.startTime = (uint16_t)ve.startTime;
+        rec.doseVolume = ve.doseVolume;
+        rec.calculatedDuration = ve.calculatedDuration;
+        volRecords.push_back(rec);
+    }
+
+    // Temp + rename: a reader never sees a half-written sidecar (the header and size checks stay as a backstop)
+    AtomicFileWriter file;
+    if (!file.open(path)) {
+        Serial.printf("Failed to open schedule sidecar for writing: %s\n", path.c_str());
+        return false;
+    }
+
+    size_t expected = sizeof(header)
+                    + apRecords.size() * sizeof(ScheduleBinAutopilot)
+                    + durRecords.size() * sizeof(ScheduleBinDuration)
+                    + volRecords.size() * sizeof(ScheduleBinVolume);
+    size_t written = file.write((const uint8_t*)&header, sizeof(header));
+    if (!apRecords.empty()) written += file.write((const uint8_t*)apRecords.data(), apRecords.size() * sizeof(ScheduleBinAutopilot));
+    if (!durRecords.empty()) written += file.write((const uint8_t*)durRecords.data(), durRecords.size() * sizeof(ScheduleBinDuration));
+    if (!volRecords.empty()) written += file.write((const uint8_t*)volRecords.data(), volRecords.size() * sizeof(ScheduleBinVolume));
+
+    if (written != expected || !file.commit()) {
+        Serial.printf("Short write on schedule sidecar %s (%u of %u bytes). Removing.\n",
+                      path.c_str(), (unsigned)written, (unsigned)expected);
+        file.abort();
+        LittleFS.remove(path); // The old sidecar no longer matches the JSON
+        return false;
+    }
+    return true;
+}
+
+// --- ScheduleBinaryReader Implementation ---
+
+/**
+ * @brief Opens a sidecar file and validates its header.
+ *
+ * Checks magic, version, header size, the recorded JSON size and CRC and that the
+ * file is large enough to hold all records announced by the header.
+ *
+ * @param path Path of the sidecar file.
+ * @param expectedJsonSize Current size of the matching JSON file.
+ * @param expectedJsonCrc Current CRC-32 of the matching JSON file.
+ * @return True if the sidecar is usable, false if it is missing, malformed or stale.
+ */
+bool ScheduleBinaryReader::open(const String& path, uint32_t expectedJsonSize, uint32_t expectedJsonCrc) {
+    close();
+    if (!LittleFS.exists(path)) return false;
+    _file = LittleFS.open(path, "r");
+    if (!_file) return false;
+    runtimeMetrics.recordFsRead(sizeof(_header));
+
+    if (_file.read((uint8_t*)&_header, sizeof(_header)) != sizeof(_header)
+        || _header.magic != SCHEDULE_BIN_MAGIC
+        || _header.version != SCHEDULE_BIN_VERSION
+        || _header.headerSize != sizeof(ScheduleBinHeader)) {
+        Serial.printf("Schedule sidecar %s has an invalid header.\n", path.c_str());
+        _file.close();
+        return false;
+    }
+    if (_header.jsonSize != expectedJsonSize || _header.jsonCrc != expectedJsonCrc) {
+        // JSON was rewritten without the sidecar (e.g. uploaded directly, same size or not)
+        _file.close();
+        return false;
+    }
+    size_t expected = sizeof(ScheduleBinHeader)
+                    + _header.apCount * sizeof(ScheduleBinAutopilot)
+                    + _header.durCount * sizeof(ScheduleBinDuration)
+                    + _header.volCount * sizeof(ScheduleBinVolume);
+    if (_file.size() < expected) {
+        Serial.printf("Schedule sidecar %s is truncated.\n", path.c_str());
+        _file.close();
+        return false;
+    }
+    _open = true;
+    return true;
+}
+
+/**
+ * @brief Closes the underlying file. Safe to call when not open.
+ */
+void ScheduleBinaryReader::close() {
+    if (_open) {
+        _file.close();
+        _open = false;
+    }
+}
+
+// Internal helper: seek to an absolute offset and read exactly len bytes
+bool ScheduleBinaryReader::readRecord(size_t offset, void* dst, size_t len) {
+    if (!_open) return false;
+    if (!_file.seek(offset, SeekSet)) return false;
+    runtimeMetrics.recordFsRead(len);
+    return _file.read((uint8_t*)dst, len) == len;
+}
+
+/**
+ * @brief Reads a single autopilot window record.
+ * @param index Record index, 0..apCount-1 (sorted by start time).
+ * @param out Populated with the decoded window on success.
+ * @return True on success, false if the index is out of range or the read fails.
+ */
+bool ScheduleBinaryReader::readAutopilotWindow(uint16_t index, AutopilotWindow& out) {
+    if (index >= _header.apCount) return false;
+    ScheduleBinAutopilot rec;
+    size_t offset = sizeof(ScheduleBinHeader) + index * sizeof(ScheduleBinAutopilot);
+    if (!readRecord(offset, &rec, sizeof(rec))) return false;
+    out.startTime = rec.startTime;
+    out.endTime = rec.endTime;
+    out.matricTension = rec.matricTension;
+    out.doseVolume = rec.doseVolume;
+    out.settlingTime = rec.settlingTime;
+    out.doseDuration = rec.doseDuration;
+    return true;
+}
+
+/**
+ * @brief Reads a single duration event record.
+ * @param index Record index, 0..durCount-1 (sorted by start time).
+ * @param out Populated with the decoded event on success.
+ * @return True on success, false if the index is out of range or the read fails.
+ */
+bool ScheduleBinaryReader::readDurationEvent(uint16_t index, DurationEvent& out) {
+    if (index >= _header.durCount) return false;
+    ScheduleBinDuration rec;
+    size_t offset = sizeof(ScheduleBinHeader)
+                  + _header.apCount * sizeof(ScheduleBinAutopilot)
+                  + index * sizeof(ScheduleBinDuration);
+    if (!readRecord(offset, &rec, sizeof(rec))) return false;
+    out.startTime = rec.startTime;
+    out.endTime = rec.endTime;
+    out.duration = (int)rec.duration;
+    return true;
+}
+
+/**
+ * @brief Reads a single volume event record.
+ * @param index Record index, 0..volCount-1 (sorted by start time).
+ * @param out Populated with the decoded event on success.
+ * @return True on success, false if the index is out of range or the read fails.
+ */
+bool ScheduleBinaryReader::readVolumeEvent(uint16_t index, VolumeEvent& out) {
+    if (index >= _header.volCount) return false;
+    ScheduleBinVolume rec;
+    size_t offset = sizeof(ScheduleBinHeader)
+                  + _header.apCount * sizeof(ScheduleBinAutopilot)
+                  + _header.durCount * sizeof(ScheduleBinDuration)
+                  + index * sizeof(ScheduleBinVolume);
+    if (!readRecord(offset, &rec, sizeof(rec))) return false;
+    out.startTime = rec.startTime;
+    out.doseVolume = rec.doseVolume;
+    out.calculatedDuration = rec.calculatedDuration;
+    return true;
+}
@@ -0,0 +1,390 @@
+#include "ScheduleEngine.h"
+#include "TaskConfig.h"
+#include "ScheduleManager.h"
+#include "ScheduleBinary.h"
+#include "OutputPointManager.h"
+#include "CycleManager.h"
+#include "FlowMeterManager.h"
+#include "DebugConfig.h" // LOGx macros
+#include <algorithm>
+#include <ctime>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+extern ScheduleManager scheduleManager;
+extern OutputPointManager outputManager;
+extern PointRegistry pointRegistry;
+extern CycleManager cycleManager;
+extern FlowMeterManager flowMeterManager;
+
+namespace {
+// Scoped helper that holds the timeline mutex (web server task vs. engine task)
+struct TimelineGuard {
+    SemaphoreHandle_t mutex;
+    explicit TimelineGuard(void* m) : mutex((SemaphoreHandle_t)m) {
+        if (mutex) xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+    ~TimelineGuard() {
+        if (mutex) xSemaphoreGive(mutex);
+    }
+};
+
+const uint32_t SECONDS_PER_DAY = 24UL * 60 * 60;
+
+// Volume events are metered on relays with a flow meter; elsewhere they run for their
+// precomputed duration, or else doseVolume / the relay's configured flow (flowMlPerSec,
+// 0 if unknown). Events with neither are skipped.
+void appendVolumeEntry(std::vector<ScheduleTimelineEntry>& out, const String& scheduleUID, uint16_t bindingIndex,
+                       PointHandle point, int startTime, float doseVolume, int32_t calculatedDuration,
+                       float flowMlPerSec) {
+    if (doseVolume > 0.0f && flowMeterManager.meterForOutput(point) >= 0) {
+        uint32_t timeoutMs = calculatedDuration > 0 ? (uint32_t)calculatedDuration * 1000 * FLOW_DOSE_TIMEOUT_FACTOR
+                                                    : FLOW_DOSE_DEFAULT_TIMEOUT_MS;
+        uint32_t volumeMl = (uint32_t)std::max(1L, lroundf(doseVolume));
+        out.push_back({(uint32_t)startTime * 60, bindingIndex, point, timeoutMs, volumeMl});
+        return;
+    }
+    int32_t seconds = calculatedDuration;
+    if (seconds <= 0 && doseVolume > 0.0f && flowMlPerSec > 0.0f) {
+        seconds = (int32_t)ceilf(doseVolume / flowMlPerSec);
+    }
+    if (seconds > 0) {
+        out.push_back({(uint32_t)startTime * 60, bindingIndex, point, (uint32_t)seconds * 1000, 0});
+    } else {
+        LOGW(SCHEDULE, "'%s': volume event at %d has no duration (no flow meter or flowRateGPH on %s), skipped.",
+             scheduleUID.c_str(), startTime, pointRegistry.get(point)->pointId.c_str());
+    }
+}
+
+// Flow used for the volume events of a binding without a flow meter; 0 when metered
+// (or when there are no volume events, so the output definition is not read)
+float bindingFlowMlPerSec(PointHandle point, size_t volumeCount) {
+    if (volumeCount == 0 || flowMeterManager.meterForOutput(point) >= 0) return 0.0f;
+    return outputManager.getConfiguredFlowMlPerSec(pointRegistry.get(point)->pointId);
+}
+} // namespace
+
+ScheduleEngine::ScheduleEngine() {}
+
+bool ScheduleEngine::begin() {
+    if (!timelineMutex) {
+        timelineMutex = xSemaphoreCreateMutex();
+        if (!timelineMutex) {
+            LOGE(SCHEDULE, "Failed to create timeline mutex.");
+            return false;
+        }
+    }
+
+    loadActiveCycleBindings();
+
+    BaseType_t taskCreated = xTaskCreatePinnedToCore(
+        engineTaskWrapper,
+        "ScheduleEngineTask",
+        4096,
+        this,
+        TASK_PRIORITY_SCHEDULE_ENGINE,
+        (TaskHandle_t*)&engineTaskHandle,
+        IO_CORE
+    );
+    if (taskCreated != pdPASS) {
+        LOGE(SCHEDULE, "Failed to create engine task.");
+        return false;
+    }
+
+    LOGI(SCHEDULE, "Started with %u binding(s), %u timeline entries.",
+         (unsigned)bindings.size(), (unsigned)timelineSize());
+    return true;
+}
+
+// Binds the current step's schedule of every active cycle to its associated relay
+// outputs (CycleManager parsed the cycle files).
+void ScheduleEngine::loadActiveCycleBindings() {
+    for (const CycleBinding& binding : cycleManager.currentBindings()) {
+        if (binding.scheduleUID.isEmpty()) {
+            LOGW(SCHEDULE, "Cycle %s has no schedule for its current step.", binding.cycleId.c_str());
+            continue;
+        }
+        for (const String& pointId : binding.outputIds) {
+            bindSchedule(binding.scheduleUID, pointId, binding.cycleId);
+        }
+    }
+}
+
+bool ScheduleEngine::bindSchedule(const String& scheduleUID, const String& pointId, const String& sourceId) {
+    PointHandle point = pointRegistry.resolve(pointId, PointKind::RELAY_OUTPUT);
+    if (scheduleUID.isEmpty() || point == INVALID_POINT_HANDLE) {
+        LOGW(SCHEDULE, "Cannot bind schedule '%s' to unknown relay '%s'.", scheduleUID.c_str(), pointId.c_str());
+        return false;
+    }
+
+    uint16_t bindingIndex;
+    {
+        TimelineGuard guard(timelineMutex);
+        for (const ScheduleBinding& b : bindings) {
+            if (b.active && b.point == point && b.scheduleUID == scheduleUID) return true; // Already bound
+        }
+        if (bindings.size() >= 0xFFFF) return false;
+        ScheduleBinding binding;
+        binding.scheduleUID = scheduleUID;
+        binding.sourceId = sourceId;
+        binding.point = point;
+        binding.active = true;
+        bindings.push_back(binding);
+        bindingIndex = (uint16_t)(bindings.size() - 1);
+    }
+
+    std::vector<ScheduleTimelineEntry> entries;
+    compileBinding(bindingIndex, entries);
+    replaceBindingEntries(bindingIndex, entries);
+
+    LOGD(SCHEDULE, "Bound schedule '%s' to %s (%u entries, source '%s').",
+         scheduleUID.c_str(), pointId.c_str(), (unsigned)entries.size(), sourceId.c_str());
+    return true;
+}
+
+void ScheduleEngine::unbindSchedule(const String& scheduleUID) {
+    {
+        TimelineGuard guard(timelineMutex);
+        for (size_t i = 0; i < bindings.size(); ++i) {
+            if (bindings[i].active && bindings[i].scheduleUID == scheduleUID) {
+                bindings[i].active = false;
+            }
+        }
+        timeline.erase(std::remove_if(timeline.begin(), timeline.end(),
+            [this](const ScheduleTimelineEntry& e) { return !bindings[e.bindingIndex].active; }),
+            timeline.end());
+    }
+    wakeEngineTask();
+}
+
+void ScheduleEngine::unbindSource(const String& sourceId) {
+    {
+        TimelineGuard guard(timelineMutex);
+        for (size_t i = 0; i < bindings.size(); ++i) {
+            if (bindings[i].active && bindings[i].sourceId == sourceId) {
+                bindings[i].active = false;
+            }
+        }
+        timeline.erase(std::remove_if(timeline.begin(), timeline.end(),
+            [this](const ScheduleTimelineEntry& e) { return !bindings[e.bindingIndex].active; }),
+            timeline.end());
+    }
+    wakeEngineTask();
+}
+
+// Recompiles only the bindings that use the saved schedule
+void ScheduleEngine::onScheduleSaved(const String& scheduleUID) {
+    if (!timelineMutex) return; // Not started yet; begin() compiles everything
+
+    std::vector<uint16_t> affected;
+    {
+        TimelineGuard guard(timelineMutex);
+        for (size_t i = 0; i < bindings.size(); ++i) {
+            if (bindings[i].active && bindings[i].scheduleUID == scheduleUID) affected.push_back((uint16_t)i);
+        }
+    }
+    for (uint16_t bindingIndex : affected) {
+        std::vector<ScheduleTimelineEntry> entries;
+        compileBinding(bindingIndex, entries);
+        replaceBindingEntries(bindingIndex, entries);
+        LOGD(SCHEDULE, "Recompiled '%s' for binding %u (%u entries).",
+             scheduleUID.c_str(), bindingIndex, (unsigned)entries.size());
+    }
+}
+
+// Drops the entries of a deleted schedule but keeps its bindings, so a re-created
+// schedule with the same UID runs again after its next save
+void ScheduleEngine::onScheduleDeleted(const String& scheduleUID) {
+    if (!timelineMutex) return;
+
+    {
+        TimelineGuard guard(timelineMutex);
+        timeline.erase(std::remove_if(timeline.begin(), timeline.end(),
+            [&](const ScheduleTimelineEntry& e) { return bindings[e.bindingIndex].scheduleUID == scheduleUID; }),
+            timeline.end());
+    }
+    wakeEngineTask();
+}
+
+size_t ScheduleEngine::timelineSize() const {
+    TimelineGuard guard(timelineMutex);
+    return timeline.size();
+}
+
+// Produces the binding's entries sorted by start time, from the cached schedule snapshot
+// if one is resident (e.g. just edited through the API), otherwise from the sidecar.
+// Runs without the timeline mutex (flash reads); only the binding lookup is guarded.
+bool ScheduleEngine::compileBinding(uint16_t bindingIndex, std::vector<ScheduleTimelineEntry>& out) {
+    out.clear();
+    String scheduleUID;
+    PointHandle point;
+    {
+        TimelineGuard guard(timelineMutex);
+        if (bindingIndex >= bindings.size() || !bindings[bindingIndex].active) return false;
+        scheduleUID = bindings[bindingIndex].scheduleUID;
+        point = bindings[bindingIndex].point;
+    }
+
+    // Both event lists are sorted by start time, in the snapshot as in the sidecar; merge them
+    ScheduleSnapshot cached = scheduleManager.peekCachedSchedule(scheduleUID);
+    if (cached) {
+        const auto& durations = cached->durationEvents;
+        const auto& volumes = cached->volumeEvents;
+        float flowMlPerSec = bindingFlowMlPerSec(point, volumes.size());
+        out.reserve(durations.size() + volumes.size());
+        size_t durIndex = 0, volIndex = 0;
+        while (durIndex < durations.size() || volIndex < volumes.size()) {
+            if (durIndex < durations.size()
+                && (volIndex >= volumes.size() || durations[durIndex].startTime <= volumes[volIndex].startTime)) {
+                const DurationEvent& de = durations[durIndex++];
+                out.push_back({(uint32_t)de.startTime * 60, bindingIndex, point, (uint32_t)de.duration * 1000, 0});
+            } else {
+                const VolumeEvent& ve = volumes[volIndex++];
+                appendVolumeEntry(out, scheduleUID, bindingIndex, point, ve.startTime, ve.doseVolume, ve.calculatedDuration,
+                                  flowMlPerSec);
+            }
+        }
+        return true;
+    }
+
+    ScheduleBinaryReader reader;
+    if (!scheduleManager.openScheduleBinary(scheduleUID, reader)) {
+        LOGW(SCHEDULE, "Schedule '%s' is not readable; binding %u has no entries.", scheduleUID.c_str(), bindingIndex);
+        return false;
+    }
+
+    const ScheduleBinHeader& header = reader.header();
+    out.reserve(header.durCount + header.volCount);
+    float flowMlPerSec = bindingFlowMlPerSec(point, header.volCount);
+
+    uint16_t durIndex = 0, volIndex = 0;
+    DurationEvent de;
+    VolumeEvent ve;
+    bool haveDur = durIndex < header.durCount && reader.readDurationEvent(durIndex, de);
+    bool haveVol = volIndex < header.volCount && reader.readVolumeEvent(volIndex, ve);
+    while (haveDur || haveVol) {
+        if (haveDur && (!haveVol || de.startTime <= ve.startTime)) {
+            out.push_back({(uint32_t)de.startTime * 60, bindingIndex, point, (uint32_t)de.duration * 1000, 0});
+            ++durIndex;
+            haveDur = durIndex < header.durCount && reader.readDurationEvent(durIndex, de);
+        } else {
+            appendVolumeEntry(out, scheduleUID, bindingIndex, point, ve.startTime, ve.doseVolume, ve.calculatedDuration,
+                              flowMlPerSec);
+            ++volIndex;
+            haveVol = volIndex < header.volCount && reader.readVolumeEvent(volIndex, ve);
+        }
+    }
+    return true;
+}
+
+// Swaps a binding's entries in the timeline: one linear erase plus one merge of the
+// (already sorted) new entries, no full re-sort.
+void ScheduleEngine::replaceBindingEntries(uint16_t bindingIndex, std::vector<ScheduleTimelineEntry>& entries) {
+    {
+        TimelineGuard guard(timelineMutex);
+        timeline.erase(std::remove_if(timeline.begin(), timeline.end(),
+            [bindingIndex](const ScheduleTimelineEntry& e) { return e.bindingIndex == bindingIndex; }),
+            timeline.end());
+        if (bindingIndex < bindings.size() && bindings[bindingIndex].active && !entries.empty()) {
+            size_t mid = timeline.size();
+            timeline.insert(timeline.end(), entries.begin(), entries.end());
+            std::inplace_merge(timeline.begin(), timeline.begin() + mid, timeline.end(), entryEarlier);
+        }
+    }
+    wakeEngineTask();
+}
+
+bool ScheduleEngine::entryEarlier(const ScheduleTimelineEntry& a, const ScheduleTimelineEntry& b) {
+    return a.secondOfDay < b.secondOfDay;
+}
+
+void ScheduleEngine::wakeEngineTask() {
+    if (engineTaskHandle) xTaskNotifyGive((TaskHandle_t)engineTaskHandle);
+}
+
+void ScheduleEngine::engineTaskWrapper(void* parameter) {
+    static_cast<ScheduleEngine*>(parameter)->engineTask();
+}
+
+void ScheduleEngine::engineTask() {
+    bool clockWarningShown = false;
+    int rolloverDay = -1;
+    while (true) {
+        time_t now = time(nullptr);
+        if (now < SCHEDULE_ENGINE_MIN_VALID_EPOCH) {
+            if (!clockWarningShown) {
+                LOGW(SCHEDULE, "Wall clock not set; schedules are paused until it is.");
+                clockWarningShown = true;
+            }
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SCHEDULE_ENGINE_CLOCK_RETRY_MS));
+            continue;
+        }
+        clockWarningShown = false;
+
+        struct tm local;
+        localtime_r(&now, &local);
+        uint32_t nowSecond = (uint32_t)(local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec);
+        int today = local.tm_year * 366 + local.tm_yday;
+        if (today != rolloverDay) {
+            // Cycle steps follow the local day; rebinding wakes this task again
+            cycleManager.onDayChanged(now);
+            rolloverDay = today;
+        }
+
+        uint32_t sleepMs = dispatchDueEntries(nowSecond, today);
+        // Sleep until the next entry is due, or until the timeline changes
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleepMs));
+    }
+}
+
+// Sends every entry in [cursorSecond, nowSecond] (minus stale ones) and returns the
+// time until the next entry, or until midnight if nothing else is due today.
+uint32_t ScheduleEngine::dispatchDueEntries(uint32_t nowSecond, int today) {
+    std::vector<OutputCommand> batch;
+    uint32_t nextSecond = SECONDS_PER_DAY;
+    {
+        TimelineGuard guard(timelineMutex);
+        if (cursorDay < 0) {
+            cursorSecond = nowSecond; // First run: don't replay the morning after a reboot
+            cursorDay = today;
+        } else if (today != cursorDay) {
+            cursorSecond = 0;         // New day
+            cursorDay = today;
+        }
+
+        auto it = std::lower_bound(timeline.begin(), timeline.end(), cursorSecond,
+            [](const ScheduleTimelineEntry& e, uint32_t second) { return e.secondOfDay < second; });
+        for (; it != timeline.end() && it->secondOfDay <= nowSecond; ++it) {
+            if (nowSecond - it->secondOfDay > SCHEDULE_ENGINE_LATE_GRACE_S) {
+                LOGW(SCHEDULE, "Skipping stale event at %02u:%02u for binding %u.",
+                     (unsigned)(it->secondOfDay / 3600), (unsigned)(it->secondOfDay / 60 % 60), it->bindingIndex);
+                continue;
+            }
+            OutputCommand cmd;
+            cmd.point = it->point;
+            cmd.commandType = it->volumeMl > 0 ? RelayCommandType::TURN_ON_VOLUME : RelayCommandType::TURN_ON_TIMED;
+            cmd.durationMs = it->durationMs;
+            cmd.volumeMl = it->volumeMl;
+            batch.push_back(cmd);
+        }
+        if (it != timeline.end()) nextSecond = it->secondOfDay;
+        if (nowSecond + 1 > cursorSecond) cursorSecond = nowSecond + 1;
+    }
+
+    // Entries due in the same second switch together (one latch per queue-sized chunk)
+    for (size_t start = 0; start < batch.size(); start += OUTPUT_COMMAND_QUEUE_LENGTH) {
+        size_t end = std::min(batch.size(), start + (size_t)OUTPUT_COMMAND_QUEUE_LENGTH);
+        std::vector<OutputCommand> chunk(batch.begin() + start, batch.begin() + end);
+        if (!outputManager.sendCommands(chunk)) {
+            LOGE(SCHEDULE, "Failed to queue %u relay command(s).", (unsigned)chunk.size());
+        }
+    }
+    if (!batch.empty()) {
+        LOGD(SCHEDULE, "Dispatched %u event(s) at %02u:%02u:%02u.", (unsigned)batch.size(),
+             (unsigned)(nowSecond / 3600), (unsigned)(nowSecond / 60 % 60), (unsigned)(nowSecond % 60));
+    }
+
+    uint32_t sleepMs = (nextSecond - nowSecond) * 1000UL; // nextSecond > nowSecond here
+    return std::min(sleepMs, (uint32_t)SCHEDULE_ENGINE_MAX_SLEEP_MS);
+}
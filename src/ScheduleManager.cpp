@@ -1,5 +1,14 @@
 #include "ScheduleManager.h"
 #include "LockManager.h" // Need to interact with LockManager
+#include "ScheduleBinary.h" // Packed sidecar files
+#include "ScheduleEngine.h" // Recompile running schedules on save/delete
+#include "DebugConfig.h" // LOGx macros
+#include "Benchmark.h" // BENCH_SCOPE (benchmark builds only)
+#include "RuntimeMetrics.h" // LittleFS op counters
+#include "AtomicFile.h" // Temp + rename writes, CRC-checked reads
+#include "ConfigSnapshot.h" // stampConfigSource(): size + CRC of the JSON file for the sidecar
+#include "LiveEvents.h" // Schedule change notifications for /api/events
+#include "AutopilotEngine.h" // Reload autopilot windows on save/delete
 #include <FS.h>
 #include <LittleFS.h>
 #include <ArduinoJson.h> // V7
@@ -7,8 +16,31 @@
 #include <algorithm> // For std::sort, std::remove_if
 #include <ctime>     // For timestamp in UID generation
 
+// FreeRTOS includes (snapshot cache mutex)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
 // Make sure LockManager instance is declared globally (e.g., in main.cpp)
 extern LockManager lockManager;
+extern ScheduleEngine scheduleEngine;
+extern RuntimeMetrics runtimeMetrics;
+extern LiveEvents liveEvents;
+extern AutopilotEngine autopilotEngine;
+
+namespace {
+// Scoped helper that holds one of the manager's mutexes (snapshot cache or index) for
+// the lifetime of the object. The web server task, the schedule engine task and the
+// persistence worker (bulk import) all go through the cache and the index.
+struct ScheduleMutexGuard {
+    SemaphoreHandle_t mutex;
+    explicit ScheduleMutexGuard(void* m) : mutex((SemaphoreHandle_t)m) {
+        if (mutex) xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+    ~ScheduleMutexGuard() {
+        if (mutex) xSemaphoreGive(mutex);
+    }
+};
+} // namespace
 
 // --- ScheduleManager Implementation ---
 
@@ -27,22 +59,41 @@ ScheduleManager::ScheduleManager(const char* scheduleDir, const char* indexFile)
     if (!_scheduleDir.endsWith("/")) {
         _scheduleDir += "/";
     }
+    // Journal lives next to the index: /allSchedules.json -> /allSchedules.journal
+    _journalFile = _indexFile.endsWith(".json") ? _indexFile.substring(0, _indexFile.length() - 5) : _indexFile;
+    _journalFile += SCHEDULE_INDEX_JOURNAL_EXTENSION;
 }
 
 /**
  * @brief Initializes the ScheduleManager.
  *
  * Ensures the schedule directory exists, creating it if necessary.
- * Loads the schedule index file (`allSchedules.json`). If loading fails or the
- * file doesn't exist, it attempts to create an empty index file.
- * Finally, it calls `maintainScheduleIndex()` to synchronize the index with
- * the actual files in the schedule directory and update lock statuses.
+ * Loads the schedule index file (`allSchedules.json`) and replays the index
+ * journal on top of it. The schedule directory is only rescanned by
+ * `maintainScheduleIndex()` when the index is missing or unreadable, or
+ * when the journal itself is torn. A save/delete interrupted by an unclean
+ * shutdown is repaired from the one schedule file it touched.
+ * A long journal is compacted into the index file.
  *
  * @return True if initialization is successful (directory exists, index loaded or created),
  *         false if critical failures occur (e.g., cannot create directory or initial index file).
  */
 bool ScheduleManager::begin() {
     Serial.println("Initializing ScheduleManager...");
+    if (!_cacheMutex) {
+        _cacheMutex = xSemaphoreCreateMutex();
+        if (!_cacheMutex) {
+            Serial.println("FATAL: Failed to create schedule cache mutex.");
+            return false;
+        }
+    }
+    if (!_indexMutex) {
+        _indexMutex = xSemaphoreCreateMutex();
+        if (!_indexMutex) {
+            Serial.println("FATAL: Failed to create schedule index mutex.");
+            return false;
+        }
+    }
     // Ensure the schedule directory exists
     if (!LittleFS.exists(_scheduleDir)) {
         Serial.printf("Schedule directory '%s' not found. Creating.\n", _scheduleDir.c_str());
@@ -52,18 +103,30 @@ bool ScheduleManager::begin() {
         }
     }
 
-    // Load index and perform maintenance
-    if (!loadScheduleIndex()) {
-         Serial.println("Warning: Failed to load schedule index. Attempting to create/use empty index.");
-         // Attempt to save an empty index to ensure the file exists
-         if (!saveScheduleIndex()) {
-             Serial.println("FATAL: Failed to create initial schedule index file. Halting.");
-             return false;
-         }
+    // Load index and journal; rescan the directory only if they can't be trusted
+    ScheduleMutexGuard guard(_indexMutex);
+    bool indexLoaded = loadScheduleIndex(); // Also recovers an index left as a temp file
+    bool needsRescan = !LittleFS.exists(_indexFile);
+    if (!indexLoaded) {
+         Serial.println("Warning: Failed to load schedule index. Rebuilding from schedule directory.");
+         needsRescan = true;
+    }
+    if (!replayIndexJournal(needsRescan)) {
+        needsRescan = true;
+    }
+
+    if (needsRescan) {
+        maintainScheduleIndex(); // Full directory rescan, compacts the result
+        if (!LittleFS.exists(_indexFile) && !compactScheduleIndex()) {
+            Serial.println("FATAL: Failed to create initial schedule index file. Halting.");
+            return false;
+        }
+    } else if (_journalRecords >= SCHEDULE_INDEX_JOURNAL_MAX_RECORDS) {
+        compactScheduleIndex();
     }
-    maintainScheduleIndex(); // Sync with actual files and lock status
 
-    Serial.println("ScheduleManager initialized successfully.");
+    Serial.printf("ScheduleManager initialized successfully (%u schedules%s).\n",
+                  (unsigned)_scheduleIndex.size(), needsRescan ? ", rescanned" : "");
     return true;
 }
 
@@ -73,7 +136,7 @@ bool ScheduleManager::begin() {
  * @brief Loads the schedule index from the JSON file (`allSchedules.json`).
  *
  * Clears the internal `_scheduleIndex` vector. Opens and parses the index file.
- * Populates the `_scheduleIndex` with valid `ScheduleFile` entries found.
+ * Populates the `_scheduleIndex` with the entries found and sorts it by UID.
  * Handles cases where the file doesn't exist or is empty (returns true, empty index).
  *
  * @return True if the index was loaded successfully (or file was empty/not found),
@@ -81,49 +144,46 @@ bool ScheduleManager::begin() {
  */
 bool ScheduleManager::loadScheduleIndex() {
     _scheduleIndex.clear();
-    File file = LittleFS.open(_indexFile, "r");
-    if (!file) {
+    // V7: Use JsonDocument
+    JsonDocument doc;
+    FileReadResult result = readJsonFile(_indexFile, doc);
+    if (result == FileReadResult::NOT_FOUND) {
         Serial.printf("Schedule index file not found: %s\n", _indexFile.c_str());
         // Return true, indicating okay to proceed with an empty index (will be created by save)
         return true;
     }
-     if (file.size() == 0) {
+    if (result != FileReadResult::OK) {
+        Serial.printf("Failed to read schedule index %s\n", _indexFile.c_str());
+        return false; // Indicate failure
+    }
+    if (doc.isNull()) {
         // File is empty, valid state
-        file.close();
         return true;
     }
 
-    // V7: Use JsonDocument
-    JsonDocument doc;
-    // Consider StaticJsonDocument if max size is known and memory is tight
-    // StaticJsonDocument<4096> doc;
-
-    DeserializationError error = deserializeJson(doc, file);
-    file.close();
-
-    if (error) {
-        Serial.printf("Failed to parse schedule index %s: %s\n", _indexFile.c_str(), error.c_str());
-        return false; // Indicate failure
-    }
-
     JsonArray array = doc.as<JsonArray>();
      if (array.isNull()) {
          Serial.printf("Schedule index file %s does not contain a valid JSON array.\n", _indexFile.c_str());
          return false; // Treat as error
     }
 
+    _scheduleIndex.reserve(array.size());
     for (JsonObject obj : array) { // V7: Iterate directly
         ScheduleFile sf;
         sf.scheduleUID = obj["scheduleUID"] | "";
         sf.persistentLockLevel = obj["locked"] | 0; // Default to unlocked
         // lockedBy is determined dynamically by LockManager, not stored persistently here
+        // (name is not persisted either, so only the UID is required)
 
-        if (sf.isValid()) {
+        if (!sf.scheduleUID.isEmpty()) {
             _scheduleIndex.push_back(sf);
         } else {
-            Serial.printf("Warning: Skipping invalid entry in schedule index: UID=%s\n", sf.scheduleUID.c_str());
+            Serial.println("Warning: Skipping schedule index entry without UID.");
         }
     }
+    // Written sorted by compactScheduleIndex(); sort anyway for hand-edited files
+    std::sort(_scheduleIndex.begin(), _scheduleIndex.end(),
+              [](const ScheduleFile& a, const ScheduleFile& b) { return a.scheduleUID < b.scheduleUID; });
     Serial.printf("Loaded %d entries from schedule index.\n", _scheduleIndex.size());
     return true;
 }
@@ -131,21 +191,16 @@ bool ScheduleManager::loadScheduleIndex() {
 /**
  * @brief Saves the current in-memory schedule index to the JSON file.
  *
- * Opens the index file in write mode (truncating existing content).
+ * Writes the index file through writeJsonFileAtomic() (temp file + rename, CRC).
  * Serializes the internal `_scheduleIndex` vector into a JSON array containing
  * only the `scheduleUID` and persistent `locked` status for each entry.
  * The dynamic `lockedBy` field (editing lock) is not saved here.
+ * Normally called through `compactScheduleIndex()`.
  *
  * @return True if the index was saved successfully, false if file operations
  *         or JSON serialization failed.
  */
 bool ScheduleManager::saveScheduleIndex() {
-    File file = LittleFS.open(_indexFile, "w");
-    if (!file) {
-        Serial.printf("Failed to open schedule index for writing: %s\n", _indexFile.c_str());
-        return false;
-    }
-
     // V7: Use JsonDocument
     JsonDocument doc;
     // StaticJsonDocument<4096> doc;
@@ -158,30 +213,211 @@ bool ScheduleManager::saveScheduleIndex() {
         // Don't save editing lock info (lockedBy) here
     }
 
-    if (serializeJson(doc, file) == 0) {
+    // Written atomically with a CRC, so a power cut never leaves a truncated index
+    if (!writeJsonFileAtomic(_indexFile, doc, true)) {
         Serial.printf("Failed to write schedule index to file: %s\n", _indexFile.c_str());
-        file.close();
         return false;
     }
 
-    file.close();
     // Serial.printf("Saved %d entries to schedule index.\n", _scheduleIndex.size()); // Debug
     return true;
 }
 
+/**
+ * @brief Rewrites the index file from memory and truncates the journal.
+ *
+ * The index is written first, so a crash before the journal is removed only
+ * leaves records that replay to the same state.
+ *
+ * @return True on success, false if the index could not be saved (the journal is kept).
+ */
+bool ScheduleManager::compactScheduleIndex() {
+    if (!saveScheduleIndex()) {
+        return false;
+    }
+    if (LittleFS.exists(_journalFile)) {
+        LittleFS.remove(_journalFile);
+    }
+    _journalRecords = 0;
+    return true;
+}
+
+/**
+ * @brief Appends one record to the index journal.
+ *
+ * Records are single text lines: `~uid` (save/delete in progress), `+uid level`
+ * (indexed with persistent lock level) and `-uid` (removed). Compacts the
+ * journal once it holds SCHEDULE_INDEX_JOURNAL_MAX_RECORDS records.
+ *
+ * @param op The record type ('~', '+' or '-').
+ * @param uid The schedule UID.
+ * @param lockLevel Persistent lock level for '+' records.
+ * @return True if the record was written.
+ */
+bool ScheduleManager::appendIndexJournal(char op, const String& uid, int lockLevel) {
+    // A '+'/'-' on a full journal is folded into the index instead of appended
+    if (op != '~' && _journalRecords >= SCHEDULE_INDEX_JOURNAL_MAX_RECORDS) {
+        if (compactScheduleIndex()) return true;
+    }
+
+    File journal = LittleFS.open(_journalFile, "a");
+    if (!journal) {
+        Serial.printf("Failed to open schedule index journal: %s\n", _journalFile.c_str());
+        return false;
+    }
+    char line[16];
+    size_t written = journal.write((const uint8_t*)&op, 1);
+    written += journal.write((const uint8_t*)uid.c_str(), uid.length());
+    int len = (op == '+') ? snprintf(line, sizeof(line), " %d\n", lockLevel) : snprintf(line, sizeof(line), "\n");
+    written += journal.write((const uint8_t*)line, len);
+    journal.close();
+    runtimeMetrics.recordFsWrite(written);
+
+    _journalRecords++;
+    if (written != 1 + uid.length() + (size_t)len) {
+        Serial.printf("Short write on schedule index journal for '%s'.\n", uid.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Applies the index journal on top of the index loaded from the JSON file.
+ *
+ * A UID whose last record is `~` had a save or delete interrupted, so the
+ * schedule file and the index may disagree. Schedule files are written
+ * atomically, so the file's presence is authoritative: the entry is added or
+ * removed to match and the fix is journaled, without a directory rescan.
+ * A truncated line (power loss while appending) or an unknown record still
+ * sets `needsRescan`.
+ *
+ * @param needsRescan Set to true if a full directory rescan is required.
+ * @return True if the journal was read or does not exist, false if it exists but
+ *         cannot be opened.
+ */
+bool ScheduleManager::replayIndexJournal(bool& needsRescan) {
+    _journalRecords = 0;
+    if (!LittleFS.exists(_journalFile)) return true;
+    File journal = LittleFS.open(_journalFile, "r");
+    if (!journal) {
+        Serial.printf("Failed to open schedule index journal: %s\n", _journalFile.c_str());
+        return false;
+    }
+
+    runtimeMetrics.recordFsRead(journal.size());
+    String pendingUid; // Last '~' not yet followed by '+'/'-' for the same UID
+    std::vector<String> interrupted; // UIDs whose change never finished
+    while (journal.available()) {
+        String line = journal.readStringUntil('\n');
+        if (line.length() < 2) {
+            needsRescan = true; // Torn write
+            continue;
+        }
+        _journalRecords++;
+        char op = line[0];
+        String rest = line.substring(1);
+        if (op == '~') {
+            if (!pendingUid.isEmpty() && pendingUid != rest) interrupted.push_back(pendingUid); // Previous change never finished
+            pendingUid = rest;
+            continue;
+        }
+        String uid = rest;
+        int lockLevel = 0;
+        int space = rest.indexOf(' ');
+        if (space > 0) {
+            uid = rest.substring(0, space);
+            lockLevel = rest.substring(space + 1).toInt();
+        }
+        if (uid == pendingUid) pendingUid = "";
+
+        if (op == '+') {
+            ScheduleFile* existing = findIndexEntry(uid);
+            if (existing) {
+                existing->persistentLockLevel = lockLevel;
+            } else {
+                ScheduleFile sf;
+                sf.scheduleUID = uid;
+                sf.persistentLockLevel = lockLevel;
+                insertIndexEntry(sf);
+            }
+        } else if (op == '-') {
+            removeIndexEntry(uid);
+        } else {
+            needsRescan = true; // Unknown record
+        }
+    }
+    journal.close();
+
+    if (!pendingUid.isEmpty()) interrupted.push_back(pendingUid);
+    Serial.printf("Replayed %u schedule index journal record(s).\n", (unsigned)_journalRecords);
+
+    for (const String& uid : interrupted) {
+        bool present = LittleFS.exists(_scheduleDir + uid + ".json");
+        Serial.printf("Schedule index journal: change to '%s' was interrupted, schedule %s.\n",
+                      uid.c_str(), present ? "kept" : "removed");
+        if (present) {
+            ScheduleFile sf;
+            sf.scheduleUID = uid;
+            sf.persistentLockLevel = 0;
+            insertIndexEntry(sf); // No-op if already indexed
+            const ScheduleFile* entry = findIndexEntry(uid);
+            appendIndexJournal('+', uid, entry ? entry->persistentLockLevel : 0);
+        } else {
+            removeIndexEntry(uid);
+            appendIndexJournal('-', uid);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Binary-searches the UID-sorted index.
+ * @param uid The schedule UID.
+ * @return Pointer to the entry, or nullptr if the UID is not indexed.
+ */
+ScheduleFile* ScheduleManager::findIndexEntry(const String& uid) {
+    auto it = std::lower_bound(_scheduleIndex.begin(), _scheduleIndex.end(), uid,
+        [](const ScheduleFile& sf, const String& key) { return sf.scheduleUID < key; });
+    return (it != _scheduleIndex.end() && it->scheduleUID == uid) ? &(*it) : nullptr;
+}
+
+/**
+ * @brief Inserts an entry at its sorted position.
+ * @param sf The entry to insert.
+ * @return True if inserted, false if the UID was already indexed.
+ */
+bool ScheduleManager::insertIndexEntry(const ScheduleFile& sf) {
+    auto it = std::lower_bound(_scheduleIndex.begin(), _scheduleIndex.end(), sf.scheduleUID,
+        [](const ScheduleFile& entry, const String& key) { return entry.scheduleUID < key; });
+    if (it != _scheduleIndex.end() && it->scheduleUID == sf.scheduleUID) return false;
+    _scheduleIndex.insert(it, sf);
+    return true;
+}
+
+/**
+ * @brief Removes an entry from the sorted index.
+ * @param uid The schedule UID.
+ * @return True if removed, false if the UID was not indexed.
+ */
+bool ScheduleManager::removeIndexEntry(const String& uid) {
+    auto it = std::lower_bound(_scheduleIndex.begin(), _scheduleIndex.end(), uid,
+        [](const ScheduleFile& sf, const String& key) { return sf.scheduleUID < key; });
+    if (it == _scheduleIndex.end() || it->scheduleUID != uid) return false;
+    _scheduleIndex.erase(it);
+    return true;
+}
+
 /**
  * @brief Synchronizes the in-memory schedule index with the actual files on the filesystem.
  *
- * Performs the following steps:
- * 1. Lists all `.json` files in the schedule directory.
- * 2. Removes entries from the in-memory index that correspond to deleted files.
- * 3. Adds entries to the in-memory index for new files found in the directory.
- * 4. Updates the dynamic `lockedBy` field for each index entry based on the current
- *    status reported by the LockManager (this is not saved persistently in the index file).
- * 5. If any changes were made to the index (added/removed entries), saves the updated index file.
+ * Only run by `begin()` when the index or journal cannot be trusted. Performs the following steps:
+ * 1. Lists all `.json` files in the schedule directory and sorts their UIDs.
+ * 2. Walks the sorted file list and the sorted index together, dropping entries for
+ *    deleted files and adding entries for new files (O(n log n) instead of O(n·m)).
+ * 3. If any changes were made, compacts the index (rewrite + journal truncation).
  */
 void ScheduleManager::maintainScheduleIndex() {
-    Serial.println("Maintaining schedule index...");
+    Serial.println("Maintaining schedule index (full rescan)...");
     bool indexChanged = false;
 
     // 1. List actual files in the schedule directory
@@ -208,86 +444,58 @@ void ScheduleManager::maintainScheduleIndex() {
         file = root.openNextFile();
     }
     root.close();
-
-    // 2. Remove entries from index that no longer have files
-    auto removeIter = std::remove_if(_scheduleIndex.begin(), _scheduleIndex.end(),
-        [&](const ScheduleFile& sf) {
-            bool found = false;
-            for (const String& actualUid : actualFiles) {
-                if (sf.scheduleUID == actualUid) {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                Serial.printf("Index Maintenance: Removing entry for deleted file: %s\n", sf.scheduleUID.c_str());
-                indexChanged = true;
-                return true; // Mark for removal
-            }
-            return false;
-        });
-    if (removeIter != _scheduleIndex.end()) { // Check if erase is needed
-        _scheduleIndex.erase(removeIter, _scheduleIndex.end());
-        indexChanged = true; // Mark changed if elements were removed
-    }
-
-
-    // 3. Add entries to index for files that are not listed
-    for (const String& actualUid : actualFiles) {
-        bool foundInIndex = false;
-        for (const ScheduleFile& sf : _scheduleIndex) {
-            if (sf.scheduleUID == actualUid) {
-                foundInIndex = true;
-                break;
-            }
-        }
-        if (!foundInIndex) {
-            Serial.printf("Index Maintenance: Adding entry for new file: %s\n", actualUid.c_str());
+    std::sort(actualFiles.begin(), actualFiles.end());
+
+    // 2. Merge-walk both sorted lists
+    std::vector<ScheduleFile> merged;
+    merged.reserve(actualFiles.size());
+    size_t i = 0, j = 0;
+    while (i < actualFiles.size() || j < _scheduleIndex.size()) {
+        if (j >= _scheduleIndex.size() || (i < actualFiles.size() && actualFiles[i] < _scheduleIndex[j].scheduleUID)) {
+            Serial.printf("Index Maintenance: Adding entry for new file: %s\n", actualFiles[i].c_str());
             ScheduleFile newSf;
-            newSf.scheduleUID = actualUid;
+            newSf.scheduleUID = actualFiles[i];
             newSf.persistentLockLevel = 0; // Default to unlocked
-            _scheduleIndex.push_back(newSf);
+            merged.push_back(newSf);
             indexChanged = true;
+            ++i;
+        } else if (i >= actualFiles.size() || _scheduleIndex[j].scheduleUID < actualFiles[i]) {
+            Serial.printf("Index Maintenance: Removing entry for deleted file: %s\n", _scheduleIndex[j].scheduleUID.c_str());
+            indexChanged = true;
+            ++j;
+        } else {
+            merged.push_back(_scheduleIndex[j]); // Present in both, keep persistent lock level
+            ++i;
+            ++j;
         }
     }
+    _scheduleIndex.swap(merged);
 
-    // 4. Update dynamic 'lockedBy' based on LockManager (doesn't change persistent 'locked' field)
-    // This info is primarily for the getScheduleList response, not saved in allSchedules.json
-    for (ScheduleFile& sf : _scheduleIndex) {
-         FileLock lockInfo;
-         String resourceId = "schedule_" + sf.scheduleUID; // Consistent resource ID
-         if (lockManager.isLocked(resourceId, &lockInfo)) {
-             sf.lockedBy = lockInfo.username; // Set who holds the editing lock
-         } else {
-             sf.lockedBy = ""; // Clear if no editing lock
-         }
-    }
-
-
-    // 5. Save index if changes were made
-    if (indexChanged) {
+    // 3. Save index if changes were made (the journal is folded in either way)
+    if (indexChanged || _journalRecords > 0) {
         Serial.println("Index changed, saving...");
-        if (!saveScheduleIndex()) {
+        if (!compactScheduleIndex()) {
             Serial.println("Error saving schedule index after maintenance!");
         }
-    } else {
-         // Serial.println("No changes to schedule index."); // Debug
     }
 }
 
 /**
  * @brief Gets the list of schedules currently in the index.
  *
- * Updates the dynamic `lockedBy` status for each schedule based on the LockManager
- * before returning the cached index.
+ * Copies the index under the index mutex, then fills in the dynamic `lockedBy`
+ * status of each entry of the copy from the LockManager.
  *
  * @param list A reference to a std::vector<ScheduleFile> that will be populated
  *             with the current schedule index data.
  * @return True (currently always returns true, assuming the index is valid if begin() succeeded).
  */
 bool ScheduleManager::getScheduleList(std::vector<ScheduleFile>& list) {
-    // Update lock status before returning list
-    for (ScheduleFile& sf : _scheduleIndex) {
+    {
+        ScheduleMutexGuard guard(_indexMutex);
+        list = _scheduleIndex; // Copy of the index; lock status is filled in outside the mutex
+    }
+    for (ScheduleFile& sf : list) {
          FileLock lockInfo;
          String resourceId = "schedule_" + sf.scheduleUID;
          if (lockManager.isLocked(resourceId, &lockInfo)) {
@@ -296,7 +504,6 @@ bool ScheduleManager::getScheduleList(std::vector<ScheduleFile>& list) {
              sf.lockedBy = "";
          }
     }
-    list = _scheduleIndex; // Return the cached index
     return true; // Assuming cache is valid if begin() succeeded
 }
 
@@ -304,7 +511,120 @@ bool ScheduleManager::getScheduleList(std::vector<ScheduleFile>& list) {
 // --- Schedule Loading/Saving/Deleting ---
 
 /**
- * @brief Loads a specific schedule from its JSON file.
+ * @brief Loads a specific schedule into a caller-owned (modifiable) copy.
+ *
+ * Served from the snapshot cache via `getSchedule()`; only a miss reads flash.
+ * Callers that only read should use `getSchedule()` and skip the copy.
+ *
+ * @param uid The unique identifier of the schedule to load.
+ * @param schedule A reference to a `Schedule` object to be populated with the loaded data.
+ * @return True if the schedule was loaded and parsed successfully and the basic
+ *         schedule data is valid, false otherwise (file not found, parse error, invalid data).
+ */
+bool ScheduleManager::loadSchedule(const String& uid, Schedule& schedule) {
+    ScheduleSnapshot snapshot = getSchedule(uid);
+    if (!snapshot) return false;
+    schedule = *snapshot;
+    return true;
+}
+
+/**
+ * @brief Returns the parsed schedule, reading the file only on a cache miss.
+ *
+ * The file is read outside the cache mutex. If a save or delete invalidated the
+ * cache meanwhile, the result is returned but not cached, so a stale parse can
+ * never replace a newer file.
+ *
+ * @param uid The unique identifier of the schedule.
+ * @return The shared snapshot, or nullptr if the schedule is missing or invalid.
+ */
+ScheduleSnapshot ScheduleManager::getSchedule(const String& uid) {
+    uint32_t generation;
+    {
+        ScheduleMutexGuard guard(_cacheMutex);
+        for (CachedSchedule& entry : _scheduleCache) {
+            if (entry.uid == uid) {
+                entry.lastUsed = ++_cacheClock;
+                return entry.snapshot;
+            }
+        }
+        generation = _cacheGeneration;
+    }
+
+    std::shared_ptr<Schedule> parsed = std::make_shared<Schedule>();
+    if (!readScheduleFile(uid, *parsed)) {
+        return nullptr;
+    }
+    ScheduleSnapshot snapshot = parsed;
+    cacheSchedule(uid, snapshot, generation);
+    return snapshot;
+}
+
+ScheduleSnapshot ScheduleManager::peekCachedSchedule(const String& uid) {
+    ScheduleMutexGuard guard(_cacheMutex);
+    for (CachedSchedule& entry : _scheduleCache) {
+        if (entry.uid == uid) {
+            entry.lastUsed = ++_cacheClock;
+            return entry.snapshot;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Inserts a snapshot into the cache.
+ *
+ * Skipped if the cache was invalidated since @p generation was read, or if the
+ * schedule alone exceeds the budget. Otherwise least recently used entries are
+ * evicted until it fits.
+ */
+void ScheduleManager::cacheSchedule(const String& uid, const ScheduleSnapshot& snapshot, uint32_t generation) {
+    size_t bytes = estimateScheduleBytes(*snapshot);
+    if (bytes > SCHEDULE_CACHE_BUDGET_BYTES) return;
+
+    ScheduleMutexGuard guard(_cacheMutex);
+    if (generation != _cacheGeneration) return;
+    for (const CachedSchedule& entry : _scheduleCache) {
+        if (entry.uid == uid) return; // Another reader cached it first
+    }
+    while (!_scheduleCache.empty() && _cacheBytes + bytes > SCHEDULE_CACHE_BUDGET_BYTES) {
+        auto oldest = std::min_element(_scheduleCache.begin(), _scheduleCache.end(),
+            [](const CachedSchedule& a, const CachedSchedule& b) { return a.lastUsed < b.lastUsed; });
+        _cacheBytes -= oldest->bytes;
+        _scheduleCache.erase(oldest);
+    }
+    CachedSchedule entry;
+    entry.uid = uid;
+    entry.snapshot = snapshot;
+    entry.bytes = bytes;
+    entry.lastUsed = ++_cacheClock;
+    _scheduleCache.push_back(entry);
+    _cacheBytes += bytes;
+}
+
+void ScheduleManager::invalidateCachedSchedule(const String& uid) {
+    ScheduleMutexGuard guard(_cacheMutex);
+    ++_cacheGeneration;
+    for (auto it = _scheduleCache.begin(); it != _scheduleCache.end(); ++it) {
+        if (it->uid == uid) {
+            _cacheBytes -= it->bytes;
+            _scheduleCache.erase(it);
+            return;
+        }
+    }
+}
+
+// Object, control block, strings and vector storage (heap block overhead is not counted)
+size_t ScheduleManager::estimateScheduleBytes(const Schedule& schedule) {
+    return sizeof(Schedule) + 16
+         + schedule.scheduleName.length() + 1 + schedule.scheduleUID.length() + 1
+         + schedule.autopilotWindows.capacity() * sizeof(AutopilotWindow)
+         + schedule.durationEvents.capacity() * sizeof(DurationEvent)
+         + schedule.volumeEvents.capacity() * sizeof(VolumeEvent);
+}
+
+/**
+ * @brief Reads a specific schedule from its JSON file (bypasses the cache).
  *
  * Constructs the file path based on the schedule directory and UID.
  * Opens the file, parses the JSON content, and populates the provided `Schedule` object.
@@ -316,23 +636,15 @@ bool ScheduleManager::getScheduleList(std::vector<ScheduleFile>& list) {
  * @return True if the schedule was loaded and parsed successfully and the basic
  *         schedule data is valid, false otherwise (file not found, parse error, invalid data).
  */
-bool ScheduleManager::loadSchedule(const String& uid, Schedule& schedule) {
+bool ScheduleManager::readScheduleFile(const String& uid, Schedule& schedule) {
+    BENCH_SCOPE(benchLoadSchedule);
     String filePath = _scheduleDir + uid + ".json";
-    File file = LittleFS.open(filePath, "r");
-    if (!file) {
-        Serial.printf("Failed to open schedule file for reading: %s\n", filePath.c_str());
-        return false;
-    }
-
     // V7: Use JsonDocument
     JsonDocument doc;
-    // StaticJsonDocument<8192> doc; // Consider if size is predictable
-
-    DeserializationError error = deserializeJson(doc, file);
-    file.close();
-
-    if (error) {
-        Serial.printf("Failed to parse schedule file %s: %s\n", filePath.c_str(), error.c_str());
+    FileReadResult result = readJsonFile(filePath, doc);
+    if (result != FileReadResult::OK || doc.isNull()) {
+        Serial.printf("Failed to %s schedule file: %s\n",
+                      result == FileReadResult::NOT_FOUND ? "open" : "parse", filePath.c_str());
         return false;
     }
 
@@ -350,9 +662,9 @@ bool ScheduleManager::loadSchedule(const String& uid, Schedule& schedule) {
 
     // Parse Autopilot Windows (V7 API)
     JsonArray apArray = obj["autopilotWindows"];
-    Serial.printf("loadSchedule: Found autopilotWindows array? %s\n", apArray.isNull() ? "NO" : "YES"); // DEBUG
+    LOGD(SCHEDULE, "loadSchedule: Found autopilotWindows array? %s\n", apArray.isNull() ? "NO" : "YES");
     if (!apArray.isNull()) {
-        Serial.printf("loadSchedule: autopilotWindows array size: %d\n", apArray.size()); // DEBUG
+        LOGD(SCHEDULE, "loadSchedule: autopilotWindows array size: %d\n", (int)apArray.size());
         for (JsonObject apObj : apArray) {
             AutopilotWindow apw;
             apw.startTime = apObj["startTime"] | 0;
@@ -360,48 +672,49 @@ bool ScheduleManager::loadSchedule(const String& uid, Schedule& schedule) {
             apw.matricTension = apObj["matricTension"] | 0.0f;
             apw.doseVolume = apObj["doseVolume"] | 0;
             apw.settlingTime = apObj["settlingTime"] | 0;
+            apw.doseDuration = apObj["doseDuration"] | 0;
             // DEBUG Log parsed values
-            Serial.printf("loadSchedule: Parsed APW: start=%d, end=%d, tension=%.2f, dose=%d, settle=%d\n",
+            LOGD(SCHEDULE, "loadSchedule: Parsed APW: start=%d, end=%d, tension=%.2f, dose=%d, settle=%d\n",
                           apw.startTime, apw.endTime, apw.matricTension, apw.doseVolume, apw.settlingTime);
             bool valid = apw.isValid(); // DEBUG check validity
-            Serial.printf("loadSchedule: APW isValid? %s\n", valid ? "YES" : "NO");
+            LOGD(SCHEDULE, "loadSchedule: APW isValid? %s\n", valid ? "YES" : "NO");
             if (valid) schedule.autopilotWindows.push_back(apw);
         }
     }
 
     // Parse Duration Events (V7 API)
     JsonArray durArray = obj["durationEvents"];
-    Serial.printf("loadSchedule: Found durationEvents array? %s\n", durArray.isNull() ? "NO" : "YES"); // DEBUG
+    LOGD(SCHEDULE, "loadSchedule: Found durationEvents array? %s\n", durArray.isNull() ? "NO" : "YES");
      if (!durArray.isNull()) {
-        Serial.printf("loadSchedule: durationEvents array size: %d\n", durArray.size()); // DEBUG
+        LOGD(SCHEDULE, "loadSchedule: durationEvents array size: %d\n", (int)durArray.size());
         for (JsonObject durObj : durArray) {
             DurationEvent de;
             de.startTime = durObj["startTime"] | 0;
             de.duration = durObj["duration"] | 0;
             de.endTime = durObj["endTime"] | 0; // Load calculated end time
             // DEBUG Log parsed values
-            Serial.printf("loadSchedule: Parsed DUR: start=%d, duration=%d, end=%d\n",
+            LOGD(SCHEDULE, "loadSchedule: Parsed DUR: start=%d, duration=%d, end=%d\n",
                           de.startTime, de.duration, de.endTime);
             bool valid = de.isValid(); // DEBUG check validity
-            Serial.printf("loadSchedule: DUR isValid? %s\n", valid ? "YES" : "NO");
+            LOGD(SCHEDULE, "loadSchedule: DUR isValid? %s\n", valid ? "YES" : "NO");
             if (valid) schedule.durationEvents.push_back(de);
         }
     }
 
      // Parse Volume Events (V7 API)
     JsonArray volArray = obj["volumeEvents"];
-    Serial.printf("loadSchedule: Found volumeEvents array? %s\n", volArray.isNull() ? "NO" : "YES"); // DEBUG
+    LOGD(SCHEDULE, "loadSchedule: Found volumeEvents array? %s\n", volArray.isNull() ? "NO" : "YES");
      if (!volArray.isNull()) {
-        Serial.printf("loadSchedule: volumeEvents array size: %d\n", volArray.size()); // DEBUG
+        LOGD(SCHEDULE, "loadSchedule: volumeEvents array size: %d\n", (int)volArray.size());
         for (JsonObject volObj : volArray) {
             VolumeEvent ve;
             ve.startTime = volObj["startTime"] | 0;
             ve.doseVolume = volObj["doseVolume"] | 0;
              // DEBUG Log parsed values
-            Serial.printf("loadSchedule: Parsed VOL: start=%d, dose=%d\n",
+            LOGD(SCHEDULE, "loadSchedule: Parsed VOL: start=%d, dose=%d\n",
                           ve.startTime, ve.doseVolume);
             bool valid = ve.isValid(); // DEBUG check validity
-            Serial.printf("loadSchedule: VOL isValid? %s\n", valid ? "YES" : "NO");
+            LOGD(SCHEDULE, "loadSchedule: VOL isValid? %s\n", valid ? "YES" : "NO");
             if (valid) schedule.volumeEvents.push_back(ve);
         }
     }
@@ -415,11 +728,50 @@ bool ScheduleManager::loadSchedule(const String& uid, Schedule& schedule) {
     return schedule.isValid(); // Check if basic schedule info is valid
 }
 
+/**
+ * @brief Opens the packed binary sidecar of a schedule for lazy, record-at-a-time reads.
+ *
+ * The sidecar is checked against the current size and CRC-32 of the JSON file (one
+ * streaming pass, as for the config snapshot). If it is missing
+ * or stale (e.g. the JSON was written without going through `saveSchedule()`), it is
+ * rebuilt once from the JSON file and reopened.
+ *
+ * @param uid The unique identifier of the schedule.
+ * @param reader Reader to open on the sidecar file.
+ * @return True if the reader is open on a current sidecar, false if the schedule does
+ *         not exist or the sidecar could not be built.
+ */
+bool ScheduleManager::openScheduleBinary(const String& uid, ScheduleBinaryReader& reader) {
+    String jsonPath = _scheduleDir + uid + ".json";
+    String binPath = _scheduleDir + uid + SCHEDULE_BIN_EXTENSION;
+
+    ConfigSourceStamp json;
+    if (!stampConfigSource(jsonPath, json)) {
+        Serial.printf("Schedule file not found: %s\n", jsonPath.c_str());
+        return false;
+    }
+    runtimeMetrics.recordFsRead(json.size);
+
+    if (reader.open(binPath, json.size, json.crc)) {
+        return true;
+    }
+
+    Serial.printf("Schedule sidecar missing or stale for '%s'. Rebuilding.\n", uid.c_str());
+    Schedule schedule;
+    if (!readScheduleFile(uid, schedule)) {
+        return false;
+    }
+    if (!writeScheduleBinary(binPath, schedule, json.size, json.crc)) {
+        return false;
+    }
+    return reader.open(binPath, json.size, json.crc);
+}
+
 /**
  * @brief Saves a schedule object to its corresponding JSON file.
  *
  * Validates the schedule object first. Constructs the file path based on the
- * schedule's UID. Opens the file in write mode (truncating existing content).
+ * schedule's UID. Writes the file atomically (temp file + rename, CRC trailer).
  * Serializes the `Schedule` object (including its event vectors) into JSON format
  * and writes it to the file.
  * If the schedule being saved is new (not found in the current index), it adds
@@ -429,15 +781,21 @@ bool ScheduleManager::loadSchedule(const String& uid, Schedule& schedule) {
  * @return True if the schedule is valid and was saved successfully, false otherwise.
  */
 bool ScheduleManager::saveSchedule(const Schedule& schedule) {
+    BENCH_SCOPE(benchSaveSchedule);
      if (!schedule.isValid()) {
         Serial.println("Attempted to save invalid schedule data.");
         return false;
     }
     String filePath = _scheduleDir + schedule.scheduleUID + ".json";
-    File file = LittleFS.open(filePath, "w");
-    if (!file) {
-        Serial.printf("Failed to open schedule file for writing: %s\n", filePath.c_str());
-        return false;
+    // New schedules are journaled before the file appears, so an interrupted save
+    // is detected (and repaired by a rescan) on the next boot
+    bool isNew;
+    {
+        ScheduleMutexGuard guard(_indexMutex);
+        isNew = findIndexEntry(schedule.scheduleUID) == nullptr;
+        if (isNew) {
+            appendIndexJournal('~', schedule.scheduleUID);
+        }
     }
 
     // V7: Use JsonDocument
@@ -449,13 +807,6 @@ bool ScheduleManager::saveSchedule(const Schedule& schedule) {
     doc["lightsOffTime"] = schedule.lightsOffTime;
     doc["scheduleUID"] = schedule.scheduleUID;
 
-    // *** ADDED DEBUG LOGS ***
-    Serial.printf("saveSchedule: Event counts before serialization: AP=%d, DUR=%d, VOL=%d\n",
-                  schedule.autopilotWindows.size(),
-                  schedule.durationEvents.size(),
-                  schedule.volumeEvents.size());
-    // ***********************
-
     JsonArray apArray = doc["autopilotWindows"].to<JsonArray>(); // V7: Use to<T>()
     for (const auto& apw : schedule.autopilotWindows) {
         JsonObject apObj = apArray.add<JsonObject>(); // V7: Use add<T>()
@@ -464,6 +815,7 @@ bool ScheduleManager::saveSchedule(const Schedule& schedule) {
         apObj["matricTension"] = apw.matricTension;
         apObj["doseVolume"] = apw.doseVolume;
         apObj["settlingTime"] = apw.settlingTime;
+        apObj["doseDuration"] = apw.doseDuration;
     }
 
     JsonArray durArray = doc["durationEvents"].to<JsonArray>(); // V7: Use to<T>()
@@ -481,37 +833,79 @@ bool ScheduleManager::saveSchedule(const Schedule& schedule) {
         volObj["doseVolume"] = ve.doseVolume;
     }
 
-    size_t bytesWritten = serializeJson(doc, file); // Capture bytes written
-    if (bytesWritten == 0) {
+    // Atomic write: an interrupted save keeps the previous version of the schedule
+    size_t bytesWritten = 0; // File size, CRC trailer included
+    bool written = writeJsonFileAtomic(filePath, doc, true, &bytesWritten);
+    // Dropped after the rename, so a reader that parsed the old file meanwhile cannot cache it;
+    // readers still holding the old snapshot keep it until they re-fetch
+    invalidateCachedSchedule(schedule.scheduleUID);
+    if (!written) {
         Serial.printf("Failed to write schedule data to file: %s\n", filePath.c_str());
-        file.close();
         return false;
     }
-
-    file.close();
     Serial.printf("Successfully saved schedule: %s (%d bytes written)\n", filePath.c_str(), bytesWritten); // Log bytes written
 
-    // --- Update in-memory index if this is a new schedule ---
-    bool foundInIndex = false;
-    for (const auto& sf : _scheduleIndex) {
-        if (sf.scheduleUID == schedule.scheduleUID) {
-            foundInIndex = true;
-            break;
-        }
+    // Packed sidecar for runtime readers. JSON stays authoritative, so a failure here is not fatal.
+    // Stamped from the file as written (size + CRC, the sidecar's staleness check)
+    String binPath = _scheduleDir + schedule.scheduleUID + SCHEDULE_BIN_EXTENSION;
+    ConfigSourceStamp json;
+    bool stamped = stampConfigSource(filePath, json);
+    if (stamped) runtimeMetrics.recordFsRead(json.size);
+    if (!stamped || !writeScheduleBinary(binPath, schedule, json.size, json.crc)) {
+        Serial.printf("Warning: Failed to write schedule sidecar: %s\n", binPath.c_str());
     }
-    if (!foundInIndex) {
+
+    // --- Update in-memory index if this is a new schedule ---
+    if (isNew) {
         Serial.printf("Adding newly saved schedule '%s' to in-memory index.\n", schedule.scheduleUID.c_str());
         ScheduleFile newSf;
         newSf.scheduleUID = schedule.scheduleUID;
         newSf.persistentLockLevel = 0; // Assume unlocked initially
         newSf.lockedBy = "";
-        _scheduleIndex.push_back(newSf);
-        // Optionally save the index file immediately? Or rely on next maintain/shutdown?
-        // Let's save it immediately for consistency.
-        saveScheduleIndex();
+        ScheduleMutexGuard guard(_indexMutex);
+        insertIndexEntry(newSf); // No-op if a concurrent save of the same UID indexed it first
+        if (_bulkSave) {
+            _bulkIndexChanged = true; // Committed by endBulkSave()
+        } else {
+            appendIndexJournal('+', newSf.scheduleUID, newSf.persistentLockLevel); // Closes the '~' record
+        }
     }
     // --- End index update ---
 
+    scheduleEngine.onScheduleSaved(schedule.scheduleUID);
+    autopilotEngine.onScheduleSaved(schedule.scheduleUID);
+    liveEvents.notify(LIVE_CHANGE_SCHEDULES);
+    return true;
+}
+
+/**
+ * @brief Starts a bulk save: saveSchedule() defers index commits to endBulkSave().
+ */
+void ScheduleManager::beginBulkSave() {
+    ScheduleMutexGuard guard(_indexMutex);
+    _bulkSave = true;
+    _bulkIndexChanged = false;
+}
+
+/**
+ * @brief Ends a bulk save and writes the index once.
+ *
+ * The '~' records journaled by the bulk's saveSchedule() calls are left unclosed;
+ * compaction truncates them together with the journal. If the index cannot be
+ * written they stay behind, and the next boot resolves each one by the presence of
+ * its schedule file.
+ *
+ * @return True if the index was committed or unchanged, false if it could not be written.
+ */
+bool ScheduleManager::endBulkSave() {
+    ScheduleMutexGuard guard(_indexMutex);
+    _bulkSave = false;
+    if (!_bulkIndexChanged) return true;
+    _bulkIndexChanged = false;
+    if (!compactScheduleIndex()) {
+        Serial.println("Error saving schedule index after bulk save!");
+        return false;
+    }
     return true;
 }
 
@@ -533,33 +927,38 @@ bool ScheduleManager::deleteSchedule(const String& uid) {
         return false; // Or true if "already deleted" is okay? Let's say false.
     }
 
-    if (!LittleFS.remove(filePath)) {
+    {
+        ScheduleMutexGuard guard(_indexMutex);
+        appendIndexJournal('~', uid); // Detects a delete interrupted before the index update
+    }
+    bool removed = LittleFS.remove(filePath);
+    invalidateCachedSchedule(uid);
+    if (!removed) {
         Serial.printf("Failed to delete schedule file: %s\n", filePath.c_str());
         return false;
     }
 
     Serial.printf("Deleted schedule file: %s\n", filePath.c_str());
 
-    // Remove from index and save
-    bool removedFromIndex = false;
-    auto removeIter = std::remove_if(_scheduleIndex.begin(), _scheduleIndex.end(),
-        [&](const ScheduleFile& sf) {
-            if (sf.scheduleUID == uid) {
-                removedFromIndex = true;
-                return true;
-            }
-            return false;
-        });
-
-    if (removedFromIndex) {
-        _scheduleIndex.erase(removeIter, _scheduleIndex.end());
-        if (!saveScheduleIndex()) {
-            Serial.println("Error saving schedule index after deleting file!");
-            // File is deleted, but index is inconsistent. Critical?
+    String binPath = _scheduleDir + uid + SCHEDULE_BIN_EXTENSION;
+    if (LittleFS.exists(binPath)) {
+        LittleFS.remove(binPath);
+    }
+    scheduleEngine.onScheduleDeleted(uid);
+    autopilotEngine.onScheduleSaved(uid); // Missing schedule: windows cleared
+    liveEvents.notify(LIVE_CHANGE_SCHEDULES);
+
+    // Remove from index and journal the removal
+    ScheduleMutexGuard guard(_indexMutex);
+    if (removeIndexEntry(uid)) {
+        if (!appendIndexJournal('-', uid)) {
+            Serial.println("Error journaling schedule index removal!");
+            // File is deleted, but the on-flash index is inconsistent until the next rescan
             return false; // Indicate failure due to index save error
         }
     } else {
          Serial.printf("Warning: Deleted file %s was not found in the index.\n", uid.c_str());
+         appendIndexJournal('-', uid); // Close the '~' record
     }
 
     return true;
@@ -639,14 +1038,135 @@ String ScheduleManager::sanitizeFilename(const String& name) {
 
 
 // --- Event Validation and Addition ---
+// The event vectors of a Schedule are kept sorted by start time (loadSchedule sorts
+// them, the add functions below merge into them), so overlap checks binary-search
+// the neighbourhood of the new event instead of scanning every existing event.
+
+namespace {
+// Index of the first event starting at or after `minute` (vector sorted by startTime)
+template <typename T>
+size_t lowerBoundByStart(const std::vector<T>& events, int minute) {
+    return std::lower_bound(events.begin(), events.end(), minute,
+        [](const T& e, int m) { return e.startTime < m; }) - events.begin();
+}
+
+// Sorts a vector only if a caller filled it out of order
+template <typename T, typename Compare>
+void ensureSorted(std::vector<T>& events, Compare cmp) {
+    if (!std::is_sorted(events.begin(), events.end(), cmp)) {
+        std::sort(events.begin(), events.end(), cmp);
+    }
+}
+
+// Appends a batch (sorted in place first) and merges it into the sorted vector
+template <typename T, typename Compare>
+void mergeSortedBatch(std::vector<T>& events, std::vector<T>& batch, Compare cmp) {
+    std::stable_sort(batch.begin(), batch.end(), cmp);
+    size_t mid = events.size();
+    events.insert(events.end(), batch.begin(), batch.end());
+    std::inplace_merge(events.begin(), events.begin() + mid, events.end(), cmp);
+}
+
+// Overlap rules for a new window against one existing window
+bool autopilotConflicts(const AutopilotWindow& newEvent, const AutopilotWindow& existing) {
+    if (newEvent.startTime == existing.startTime) return true; // Starts at same time
+    if (newEvent.endTime == existing.endTime) return true; // Ends at same time
+    if (newEvent.startTime < existing.startTime && newEvent.endTime > existing.endTime) return true; // Envelops existing
+    if (newEvent.startTime > existing.startTime && newEvent.startTime < existing.endTime) return true; // Starts within existing
+    if (newEvent.endTime > existing.startTime && newEvent.endTime < existing.endTime) return true; // Ends within existing
+    return false;
+}
+
+// Overlap rules for a new duration event against one existing duration event
+bool durationConflicts(const DurationEvent& newEvent, const DurationEvent& existing) {
+    // Check if start times match
+    if (newEvent.startTime == existing.startTime) return true;
+    // Check if new event starts during existing event
+    if (newEvent.startTime > existing.startTime && newEvent.startTime < existing.endTime) return true;
+    // Check if new event ends during existing event (only if duration > 0)
+    if (newEvent.duration > 0 && newEvent.endTime > existing.startTime && newEvent.endTime < existing.endTime) return true;
+    // Check if new event envelops existing event (only if duration > 0)
+    if (newEvent.duration > 0 && newEvent.startTime < existing.startTime && newEvent.endTime > existing.endTime) return true;
+    return false;
+}
+
+// End of an event in minutes from its day's midnight: an end before the start wraps past
+// midnight (>= 1440); a missing end (-1) counts as the start
+template <typename T>
+int unwrappedEnd(const T& e) {
+    if (e.endTime < 0) return e.startTime;
+    return e.endTime < e.startTime ? e.endTime + 1440 : e.endTime;
+}
+
+// Prefix max of the end times of a sorted event list, built once per validation pass.
+// Stored schedules are not guaranteed free of overlaps, so an earlier event can outlast
+// its successors; with the prefix max each check is one lookup instead of a scan.
+struct EndIndex {
+    std::vector<int> furthestEnd; ///< [k]: furthest unwrapped end of events [0, k), -1 if none
+    int wrappedEnd = 0;           ///< Minutes after midnight still covered by a wrapping event
+
+    template <typename T>
+    explicit EndIndex(const std::vector<T>& events) : furthestEnd(events.size() + 1, -1) {
+        for (size_t k = 0; k < events.size(); ++k) {
+            int end = unwrappedEnd(events[k]);
+            furthestEnd[k + 1] = std::max(furthestEnd[k], end);
+            if (end > 1440) wrappedEnd = std::max(wrappedEnd, end - 1440);
+        }
+    }
+
+    // True if an event before index `before` is still running at minute `time`, or an
+    // event wrapping past midnight still runs at `time` the next morning. O(1).
+    bool coveredBefore(size_t before, int time) const {
+        return furthestEnd[before] > time || wrappedEnd > time;
+    }
+};
+
+// Tests a new event [start, end] against the existing events (sorted by start time,
+// `ends` built from them): one starting earlier conflicts exactly when it is still
+// running at `start` (the same outcome as `conflicts` for both event kinds), and
+// `conflicts` runs against every one starting within [start, end].
+template <typename T, typename NewT, typename Pred>
+bool anyConflictNear(const std::vector<T>& events, const EndIndex& ends, const NewT& newEvent, int start, int end, Pred conflicts) {
+    size_t i = lowerBoundByStart(events, start);
+    if (ends.coveredBefore(i, start)) return true;
+    for (; i < events.size() && events[i].startTime <= end; ++i) {
+        if (conflicts(newEvent, events[i])) return true;
+    }
+    return false;
+}
+
+// Duration event against the existing ones; a new event whose end wraps past midnight
+// falls back to a full scan (a valid schedule holds at most one such event)
+bool durationOverlap(const std::vector<DurationEvent>& events, const EndIndex& ends, const DurationEvent& newEvent) {
+    if (newEvent.duration > 0 && newEvent.endTime < newEvent.startTime) {
+        for (const auto& existing : events) {
+            if (durationConflicts(newEvent, existing)) return true;
+        }
+        return false;
+    }
+    int end = (newEvent.duration > 0) ? newEvent.endTime : newEvent.startTime;
+    return anyConflictNear(events, ends, newEvent, newEvent.startTime, end, durationConflicts);
+}
+
+// Volume event against the volume starts (binary search) and the duration events
+// starting before it (`durationEnds` built from schedule.durationEvents)
+bool volumeOverlap(const Schedule& schedule, const EndIndex& durationEnds, const VolumeEvent& newEvent) {
+    const std::vector<VolumeEvent>& volumes = schedule.volumeEvents;
+    size_t v = lowerBoundByStart(volumes, newEvent.startTime);
+    if (v < volumes.size() && volumes[v].startTime == newEvent.startTime) return true;
+
+    // Only duration events starting before the volume event can contain it
+    const std::vector<DurationEvent>& durations = schedule.durationEvents;
+    return durationEnds.coveredBefore(lowerBoundByStart(durations, newEvent.startTime), newEvent.startTime);
+}
+} // namespace
 
-// TODO: Implement detailed validation logic here based on requirements
 /**
  * @brief Validates and adds a single Autopilot Window event to a schedule.
  *
  * Checks if the event itself is valid, if its times are within bounds (0-1439),
  * and if it overlaps with existing Autopilot windows in the schedule.
- * If valid and non-overlapping, adds the event to the schedule's vector and resorts the vector.
+ * If valid and non-overlapping, inserts the event at its sorted position.
  *
  * @param schedule Reference to the Schedule object to modify.
  * @param event The AutopilotWindow event to validate and add.
@@ -655,10 +1175,11 @@ String ScheduleManager::sanitizeFilename(const String& name) {
 bool ScheduleManager::validateAndAddEvent(Schedule& schedule, const AutopilotWindow& event) {
     if (!event.isValid()) return false;
     if (!checkTimeBounds(event.startTime) || !checkTimeBounds(event.endTime)) return false;
+    ensureSorted(schedule.autopilotWindows, compareAutopilotWindows);
     if (checkAutopilotOverlap(schedule, event)) return false;
 
-    schedule.autopilotWindows.push_back(event);
-    std::sort(schedule.autopilotWindows.begin(), schedule.autopilotWindows.end(), compareAutopilotWindows);
+    auto pos = std::upper_bound(schedule.autopilotWindows.begin(), schedule.autopilotWindows.end(), event, compareAutopilotWindows);
+    schedule.autopilotWindows.insert(pos, event);
     return true;
 }
 
@@ -667,8 +1188,8 @@ bool ScheduleManager::validateAndAddEvent(Schedule& schedule, const AutopilotWin
  *
  * Checks if adding the new events would exceed the combined limit for duration/volume events.
  * Validates each individual event (validity, time bounds, overlap with existing duration events,
- * overlap of start time with existing volume events).
- * If all events are valid and non-overlapping, adds them to the schedule's vector and resorts the vector.
+ * overlap of start time with existing volume events) and the new events against each other.
+ * If all events are valid and non-overlapping, merges them into the sorted vector in one pass.
  *
  * @param schedule Reference to the Schedule object to modify.
  * @param events A vector of DurationEvent objects to validate and add.
@@ -676,24 +1197,30 @@ bool ScheduleManager::validateAndAddEvent(Schedule& schedule, const AutopilotWin
  */
 bool ScheduleManager::validateAndAddEvents(Schedule& schedule, const std::vector<DurationEvent>& events) {
     if (!checkDurationVolumeLimit(schedule, events.size())) return false;
+    ensureSorted(schedule.durationEvents, compareDurationEvents);
+    ensureSorted(schedule.volumeEvents, compareVolumeEvents);
 
-    // Validate each event individually first
-    for(const auto& event : events) {
+    std::vector<DurationEvent> batch(events);
+    std::stable_sort(batch.begin(), batch.end(), compareDurationEvents);
+    // Built once for the whole batch: each check below is a binary search plus lookups
+    EndIndex durationEnds(schedule.durationEvents);
+    EndIndex batchEnds(batch);
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const DurationEvent& event = batch[i];
         if (!event.isValid()) return false;
         if (!checkTimeBounds(event.startTime) || !checkTimeBounds(event.endTime)) return false;
-        if (checkDurationOverlap(schedule, event)) return false;
-        // Corrected: Create temporary VolumeEvent properly
+        if (durationOverlap(schedule.durationEvents, durationEnds, event)) return false;
         VolumeEvent tempVolEvent;
         tempVolEvent.startTime = event.startTime;
         tempVolEvent.doseVolume = 0; // Dose volume doesn't matter for overlap check here
-        if (checkVolumeOverlap(schedule, tempVolEvent)) return false; // Check start time against volume events
+        if (volumeOverlap(schedule, durationEnds, tempVolEvent)) return false; // Check start time against volume events
+        // The batch is sorted: a new event overlaps an earlier one if they start together
+        // or one of them is still running (or wraps round to this start)
+        if (i > 0 && (event.startTime == batch[i - 1].startTime || batchEnds.coveredBefore(i, event.startTime))) return false;
     }
 
-    // If all are valid individually and don't overlap existing, add them
-    for(const auto& event : events) {
-        schedule.durationEvents.push_back(event);
-    }
-    std::sort(schedule.durationEvents.begin(), schedule.durationEvents.end(), compareDurationEvents);
+    mergeSortedBatch(schedule.durationEvents, batch, compareDurationEvents);
     return true;
 }
 
@@ -702,41 +1229,44 @@ bool ScheduleManager::validateAndAddEvents(Schedule& schedule, const std::vector
  *
  * Checks if adding the new events would exceed the combined limit for duration/volume events.
  * Validates each individual event (validity, time bounds, overlap with existing volume events,
- * overlap of start time with existing duration events).
- * If all events are valid and non-overlapping, adds them to the schedule's vector and resorts the vector.
+ * overlap of start time with existing duration events) and the new events against each other.
+ * If all events are valid and non-overlapping, merges them into the sorted vector in one pass.
  *
  * @param schedule Reference to the Schedule object to modify.
  * @param events A vector of VolumeEvent objects to validate and add.
  * @return True if all events were successfully added, false otherwise.
  */
 bool ScheduleManager::validateAndAddEvents(Schedule& schedule, const std::vector<VolumeEvent>& events) {
-     if (!checkDurationVolumeLimit(schedule, events.size())) return false;
+    if (!checkDurationVolumeLimit(schedule, events.size())) return false;
+    ensureSorted(schedule.durationEvents, compareDurationEvents);
+    ensureSorted(schedule.volumeEvents, compareVolumeEvents);
 
-    // Validate each event individually first
-    for(const auto& event : events) {
+    std::vector<VolumeEvent> batch(events);
+    std::stable_sort(batch.begin(), batch.end(), compareVolumeEvents);
+    EndIndex durationEnds(schedule.durationEvents); // Built once for the whole batch
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const VolumeEvent& event = batch[i];
         if (!event.isValid()) return false;
         if (!checkTimeBounds(event.startTime)) return false;
-         if (checkVolumeOverlap(schedule, event)) return false;
-         // Corrected: Create temporary DurationEvent properly
-         DurationEvent tempDurEvent;
-         tempDurEvent.startTime = event.startTime;
-         tempDurEvent.duration = 0; // Duration doesn't matter for start time check
-         tempDurEvent.endTime = event.startTime; // End time is same as start for 0 duration
-         if (checkDurationOverlap(schedule, tempDurEvent)) return false; // Check start time against duration events
+        if (volumeOverlap(schedule, durationEnds, event)) return false;
+        DurationEvent tempDurEvent;
+        tempDurEvent.startTime = event.startTime;
+        tempDurEvent.duration = 0; // Duration doesn't matter for start time check
+        tempDurEvent.endTime = event.startTime; // End time is same as start for 0 duration
+        if (durationOverlap(schedule.durationEvents, durationEnds, tempDurEvent)) return false; // Check start time against duration events
+        // Two new volume events may not share a start time
+        if (i > 0 && batch[i - 1].startTime == event.startTime) return false;
     }
 
-    // If all are valid individually and don't overlap existing, add them
-    for(const auto& event : events) {
-        schedule.volumeEvents.push_back(event);
-    }
-    std::sort(schedule.volumeEvents.begin(), schedule.volumeEvents.end(), compareVolumeEvents);
+    mergeSortedBatch(schedule.volumeEvents, batch, compareVolumeEvents);
     return true;
 }
 
 /**
  * @brief Gets the persistent lock level for a given schedule UID.
  *
- * Looks up the schedule UID in the in-memory index and returns the value
+ * Binary-searches the in-memory index for the UID and returns the value
  * of its `locked` field (0=unlocked, 1=template lock, 2=cycle lock).
  * This represents locks that prevent editing/deletion, not temporary editing locks.
  *
@@ -744,12 +1274,9 @@ bool ScheduleManager::validateAndAddEvents(Schedule& schedule, const std::vector
  * @return The persistent lock level (0, 1, or 2), or -1 if the UID is not found in the index.
  */
 int ScheduleManager::getPersistentLockLevel(const String& uid) {
-    for (const auto& sf : _scheduleIndex) {
-        if (sf.scheduleUID == uid) {
-            return sf.persistentLockLevel; // Return the persistent lock level (0, 1, or 2)
-        }
-    }
-    return -1; // Not found
+    ScheduleMutexGuard guard(_indexMutex);
+    const ScheduleFile* sf = findIndexEntry(uid);
+    return sf ? sf->persistentLockLevel : -1; // -1: Not found
 }
 
 
@@ -766,20 +1293,17 @@ bool ScheduleManager::checkTimeBounds(int timeMinutes) {
 
 /**
  * @brief Checks if a new Autopilot Window overlaps with any existing ones in a schedule.
- * @param schedule The schedule containing existing windows.
+ *
+ * Builds the prefix max end times of the sorted window list (O(n)), then binary-searches
+ * it: earlier windows are checked with one lookup, later ones only within the new window.
+ *
+ * @param schedule The schedule containing existing windows (sorted by start time).
  * @param newEvent The new Autopilot Window to check.
  * @return True if an overlap is detected, false otherwise.
  */
 bool ScheduleManager::checkAutopilotOverlap(const Schedule& schedule, const AutopilotWindow& newEvent) {
-    for (const auto& existing : schedule.autopilotWindows) {
-        // Rules from requirements:
-        if (newEvent.startTime == existing.startTime) return true; // Starts at same time
-        if (newEvent.endTime == existing.endTime) return true; // Ends at same time (unlikely needed if start check passes, but included)
-        if (newEvent.startTime < existing.startTime && newEvent.endTime > existing.endTime) return true; // Envelops existing
-        if (newEvent.startTime > existing.startTime && newEvent.startTime < existing.endTime) return true; // Starts within existing
-        if (newEvent.endTime > existing.startTime && newEvent.endTime < existing.endTime) return true; // Ends within existing
-    }
-    return false;
+    const std::vector<AutopilotWindow>& windows = schedule.autopilotWindows;
+    return anyConflictNear(windows, EndIndex(windows), newEvent, newEvent.startTime, newEvent.endTime, autopilotConflicts);
 }
 
 /**
@@ -795,42 +1319,35 @@ bool ScheduleManager::checkDurationVolumeLimit(const Schedule& schedule, size_t
 
 /**
  * @brief Checks if a new Duration Event overlaps with any existing Duration Events in a schedule.
- * @param schedule The schedule containing existing events.
+ *
+ * Builds the prefix max end times of the sorted event list (O(n)); batch validation
+ * builds it once per pass instead. Earlier events are then checked with one lookup
+ * (including one wrapping past midnight), later ones only within the new event. A new
+ * event whose end time wraps past midnight falls back to a full scan.
+ *
+ * @param schedule The schedule containing existing events (sorted by start time).
  * @param newEvent The new Duration Event to check.
  * @return True if an overlap is detected, false otherwise.
  */
 bool ScheduleManager::checkDurationOverlap(const Schedule& schedule, const DurationEvent& newEvent) {
-     for (const auto& existing : schedule.durationEvents) {
-         // Check if start times match
-         if (newEvent.startTime == existing.startTime) return true;
-         // Check if new event starts during existing event
-         if (newEvent.startTime > existing.startTime && newEvent.startTime < existing.endTime) return true;
-         // Check if new event ends during existing event (only if duration > 0)
-         if (newEvent.duration > 0 && newEvent.endTime > existing.startTime && newEvent.endTime < existing.endTime) return true;
-         // Check if new event envelops existing event (only if duration > 0)
-         if (newEvent.duration > 0 && newEvent.startTime < existing.startTime && newEvent.endTime > existing.endTime) return true;
-     }
-     return false;
+    return durationOverlap(schedule.durationEvents, EndIndex(schedule.durationEvents), newEvent);
 }
 
 /**
  * @brief Checks if a new Volume Event overlaps with any existing Volume or Duration Events.
  *        Volume events cannot start at the same time as another Volume event.
  *        Volume events cannot start during a Duration event.
- * @param schedule The schedule containing existing events.
+ *
+ * The volume check is a binary search; duration events starting earlier are checked with
+ * one lookup in their prefix max end times (including an event wrapping past midnight),
+ * built here in O(n) or once per pass by batch validation.
+ *
+ * @param schedule The schedule containing existing events (sorted by start time).
  * @param newEvent The new Volume Event to check.
  * @return True if an overlap is detected, false otherwise.
  */
 bool ScheduleManager::checkVolumeOverlap(const Schedule& schedule, const VolumeEvent& newEvent) {
-    for (const auto& existingVol : schedule.volumeEvents) {
-        // Check if start times match
-        if (newEvent.startTime == existingVol.startTime) return true;
-    }
-     for (const auto& existingDur : schedule.durationEvents) {
-         // Check if volume event starts during a duration event
-         if (newEvent.startTime > existingDur.startTime && newEvent.startTime < existingDur.endTime) return true;
-     }
-    return false;
+    return volumeOverlap(schedule, EndIndex(schedule.durationEvents), newEvent);
 }
 
 
@@ -1,20 +1,48 @@
 #include "SessionManager.h"
 #include "LockManager.h" // Need to interact with LockManager
-#include <FS.h>
-#include <LittleFS.h>
-#include <ArduinoJson.h> // V7
-#include <vector>
-#include <algorithm> // For std::sort, std::remove_if
-#include <ctime>     // For timestamp in UID generation
-#include "AuthUtils.h" // For hex conversion and potentially hashing fingerprint
+#include "AuthUtils.h" // For hex conversion of session IDs
+#include "Benchmark.h" // BENCH_SCOPE (benchmark builds only)
 #include "esp_random.h" // For secure random session ID generation
-#include "mbedtls/sha256.h" // For fingerprint hashing
-#include <cstring> // For memcpy in hashing
+#include "mbedtls/sha256.h" // For fingerprint hashing (uses the ESP32 SHA accelerator)
+#include <cstring> // For memcmp/memcpy/strstr
+
+// FreeRTOS includes (mutex guarding the session table)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 
 // Make sure LockManager instance is declared globally (e.g., in main.cpp)
 extern LockManager lockManager;
 
+namespace {
+// Scoped helper that holds the session table mutex for the lifetime of the object.
+// Web requests (async TCP task) and the main loop both touch the table.
+struct SessionPoolGuard {
+    SemaphoreHandle_t mutex;
+    explicit SessionPoolGuard(void* m) : mutex((SemaphoreHandle_t)m) {
+        if (mutex) xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+    ~SessionPoolGuard() {
+        if (mutex) xSemaphoreGive(mutex);
+    }
+};
+
+// Decodes one hex digit, returns -1 for anything else
+inline int hexNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Session IDs are uniformly random, so their first bytes are already a good hash
+inline uint32_t slotHash(const uint8_t* id) {
+    uint32_t h;
+    memcpy(&h, id, sizeof(h));
+    return h & (SESSION_POOL_CAPACITY - 1);
+}
+} // namespace
+
 // --- SessionManager Implementation ---
 
 /**
@@ -26,93 +54,224 @@ SessionManager::SessionManager() {
     lastCleanupTime = millis(); // Initialize cleanup timer
 }
 
-// Generates a secure, high-entropy session ID (e.g., 32 random bytes -> 64 hex chars)
+/**
+ * @brief Initializes the SessionManager.
+ *
+ * Creates the mutex guarding the session pool.
+ *
+ * @return True on success, false if the mutex could not be created.
+ */
+bool SessionManager::begin() {
+    if (!poolMutex) {
+        poolMutex = xSemaphoreCreateMutex();
+        if (!poolMutex) {
+            Serial.println("FATAL: Failed to create session pool mutex.");
+            return false;
+        }
+    }
+    Serial.printf("SessionManager initialized (%d slots, max %d sessions).\n", SESSION_POOL_CAPACITY, SESSION_MAX_ACTIVE);
+    return true;
+}
+
+// Generates a secure, high-entropy session ID (32 random bytes)
 /**
  * @brief Generates a cryptographically secure random session ID.
  *
  * Uses the ESP32's hardware random number generator (`esp_fill_random`) to
- * create 32 random bytes and then converts them into a 64-character hexadecimal string.
+ * create SESSION_ID_BYTES random bytes.
  *
- * @return A String containing the generated hexadecimal session ID.
+ * @param out Receives the raw session ID bytes.
  */
-String SessionManager::generateSessionId() {
-    unsigned char randomBytes[32];
-    esp_fill_random(randomBytes, sizeof(randomBytes));
-    return AuthUtils::bytesToHex(randomBytes, sizeof(randomBytes));
+void SessionManager::generateSessionId(uint8_t out[SESSION_ID_BYTES]) {
+    esp_fill_random(out, SESSION_ID_BYTES);
 }
 
 // Generates a client fingerprint from the request (e.g., IP + User-Agent)
 /**
  * @brief Generates a client fingerprint based on the request's source IP and User-Agent.
  *
- * Combines the client's remote IP address and the User-Agent header string.
- * Computes the SHA-256 hash of the combined string.
- * Converts the resulting hash into a hexadecimal string to serve as the fingerprint.
+ * Hashes the client's raw IPv4 address followed by the User-Agent header bytes
+ * with SHA-256. Neither value is copied into a temporary String. On the ESP32,
+ * mbedtls routes SHA-256 through the hardware accelerator.
  * Used to add a layer of security against session hijacking (though not foolproof).
  *
  * @param request Pointer to the AsyncWebServerRequest object containing client information.
- * @return A String containing the hexadecimal representation of the SHA-256 hash
- *         of the combined IP and User-Agent, or an empty string if the request is null.
+ * @param out Receives the SESSION_FINGERPRINT_BYTES raw hash bytes.
+ * @return True on success, false if the request is null.
  */
-String SessionManager::generateFingerprint(AsyncWebServerRequest *request) {
-    if (!request) return "";
-
-    String ip = request->client()->remoteIP().toString();
-    String userAgent = request->header("User-Agent");
+bool SessionManager::generateFingerprint(AsyncWebServerRequest *request, uint8_t out[SESSION_FINGERPRINT_BYTES]) {
+    if (!request) return false;
 
-    String combined = ip + userAgent; // Combine IP and User-Agent
+    uint32_t ip = (uint32_t)request->client()->remoteIP();
+    const AsyncWebHeader* uaHeader = request->getHeader("User-Agent");
 
-    // Hash the combined string using SHA-256
-    unsigned char hashOutput[32];
     mbedtls_sha256_context ctx;
     mbedtls_sha256_init(&ctx);
     mbedtls_sha256_starts(&ctx, 0); // 0 for SHA-256
-    mbedtls_sha256_update(&ctx, (const unsigned char*)combined.c_str(), combined.length());
-    mbedtls_sha256_finish(&ctx, hashOutput);
+    mbedtls_sha256_update(&ctx, (const unsigned char*)&ip, sizeof(ip));
+    if (uaHeader) {
+        const String& userAgent = uaHeader->value();
+        mbedtls_sha256_update(&ctx, (const unsigned char*)userAgent.c_str(), userAgent.length());
+    }
+    mbedtls_sha256_finish(&ctx, out);
     mbedtls_sha256_free(&ctx);
+    return true;
+}
 
-    return AuthUtils::bytesToHex(hashOutput, sizeof(hashOutput));
+/**
+ * @brief Extracts the session_id cookie from a request and decodes it to raw bytes.
+ *
+ * Scans the Cookie header in place; no substrings are allocated. The value must be
+ * exactly SESSION_ID_HEX_LENGTH hex characters, optionally followed by ';' or whitespace.
+ *
+ * @param request The request to read the Cookie header from.
+ * @param out Receives the decoded SESSION_ID_BYTES bytes.
+ * @return True if a well-formed session_id cookie was found, false otherwise.
+ */
+bool SessionManager::parseSessionCookie(AsyncWebServerRequest *request, uint8_t out[SESSION_ID_BYTES]) {
+    if (!request) return false;
+    const AsyncWebHeader* cookieHeader = request->getHeader("Cookie");
+    if (!cookieHeader) return false;
+
+    static const char key[] = "session_id=";
+    const char* cookies = cookieHeader->value().c_str();
+    const char* p = cookies;
+    while ((p = strstr(p, key)) != nullptr) {
+        // Only accept the key at the start of a cookie pair (not e.g. "old_session_id=")
+        if (p == cookies || p[-1] == ' ' || p[-1] == ';') break;
+        p += sizeof(key) - 1;
+    }
+    if (!p) return false;
+    p += sizeof(key) - 1;
+
+    for (int i = 0; i < SESSION_ID_BYTES; i++) {
+        int hi = hexNibble(p[2 * i]);
+        if (hi < 0) return false;
+        int lo = hexNibble(p[2 * i + 1]);
+        if (lo < 0) return false;
+        out[i] = (uint8_t)((hi << 4) | lo);
+    }
+    char terminator = p[SESSION_ID_HEX_LENGTH];
+    return terminator == '\0' || terminator == ';' || terminator == ' ';
 }
 
 /**
- * @brief Creates a new user session and stores it in memory.
+ * @brief Finds the slot holding a session ID by linear probing.
+ * @note Caller must hold `poolMutex`.
+ * @param id The raw session ID.
+ * @return The slot index, or -1 if the ID is not in the table.
+ */
+int SessionManager::findSlot(const uint8_t id[SESSION_ID_BYTES]) const {
+    uint32_t index = slotHash(id);
+    for (int probe = 0; probe < SESSION_POOL_CAPACITY; probe++) {
+        const SessionSlot& slot = pool[index];
+        if (slot.state == SLOT_EMPTY) return -1;
+        if (slot.state == SLOT_USED && memcmp(slot.id, id, SESSION_ID_BYTES) == 0) return (int)index;
+        index = (index + 1) & (SESSION_POOL_CAPACITY - 1);
+    }
+    return -1;
+}
+
+/**
+ * @brief Finds the slot a new session ID should be stored in.
+ * @note Caller must hold `poolMutex`.
+ * @param id The raw session ID.
+ * @return Index of the first tombstone or empty slot on the ID's probe sequence,
+ *         or -1 if every slot is in use.
+ */
+int SessionManager::findInsertSlot(const uint8_t id[SESSION_ID_BYTES]) const {
+    uint32_t index = slotHash(id);
+    for (int probe = 0; probe < SESSION_POOL_CAPACITY; probe++) {
+        if (pool[index].state != SLOT_USED) return (int)index;
+        index = (index + 1) & (SESSION_POOL_CAPACITY - 1);
+    }
+    return -1;
+}
+
+/**
+ * @brief Creates a new user session and stores it in the session pool.
  *
- * Generates a unique session ID and a client fingerprint. Creates a new
- * `SessionData` object containing the username, role, creation time, initial
- * heartbeat time, and fingerprint. Stores the new session in the `activeSessions` map.
+ * Generates a unique session ID and a client fingerprint. Fills a free pool slot
+ * with the username, role, creation time, initial heartbeat time and fingerprint.
+ * If SESSION_MAX_ACTIVE sessions already exist, the session with the oldest
+ * heartbeat is evicted (releasing its locks) to make room.
  *
  * @param username The username associated with the session.
  * @param role The UserRole associated with the session.
  * @param request Pointer to the AsyncWebServerRequest object used to generate the fingerprint.
  * @return A copy of the created `SessionData` object. Returns an invalid `SessionData`
- *         object (where `isValid()` is false) if session ID generation fails or the
- *         resulting session data is invalid.
+ *         object (where `isValid()` is false) if the username is too long, the
+ *         fingerprint cannot be computed or the resulting session data is invalid.
  */
 SessionData SessionManager::createSession(const String& username, UserRole role, AsyncWebServerRequest *request) {
-    SessionData newSession;
-    newSession.sessionId = generateSessionId();
-    if (newSession.sessionId.isEmpty()) {
-        Serial.println("Error: Failed to generate session ID.");
+    if (username.length() > SESSION_USERNAME_MAX_LENGTH) {
+        Serial.printf("Error: Username too long for a session (%u > %d chars).\n", username.length(), SESSION_USERNAME_MAX_LENGTH);
+        return SessionData(); // Return invalid session
+    }
+
+    uint8_t id[SESSION_ID_BYTES];
+    uint8_t fingerprint[SESSION_FINGERPRINT_BYTES];
+    if (!generateFingerprint(request, fingerprint)) {
+        Serial.println("Error: Failed to generate session fingerprint.");
+        return SessionData(); // Return invalid session
+    }
+
+    SessionPoolGuard guard(poolMutex);
+
+    if (activeCount >= SESSION_MAX_ACTIVE) {
+        int oldest = -1;
+        for (int i = 0; i < SESSION_POOL_CAPACITY; i++) {
+            if (pool[i].state != SLOT_USED) continue;
+            if (oldest < 0 || pool[i].data.lastHeartbeat < pool[oldest].data.lastHeartbeat) oldest = i;
+        }
+        if (oldest >= 0) {
+            Serial.printf("Session pool full. Evicting least recently active session: User=%s\n", pool[oldest].data.username);
+            removeSessionInternal(oldest);
+        }
+    }
+
+    // A collision with a live 256-bit random ID is practically impossible, but cheap to rule out
+    do {
+        generateSessionId(id);
+    } while (findSlot(id) >= 0);
+
+    int index = findInsertSlot(id);
+    if (index < 0) {
+        Serial.println("Error: No free session slot.");
         return SessionData(); // Return invalid session
     }
 
-    newSession.username = username;
+    SessionSlot& slot = pool[index];
+    memcpy(slot.id, id, SESSION_ID_BYTES);
+    memcpy(slot.fingerprint, fingerprint, SESSION_FINGERPRINT_BYTES);
+    slot.verifiedClient = request->client();
+    slot.verifiedIp = (uint32_t)request->client()->remoteIP();
+    slot.verifiedPort = request->client()->remotePort();
+
+    SessionData& newSession = slot.data;
+    newSession = SessionData();
+    String hexId = AuthUtils::bytesToHex(id, SESSION_ID_BYTES);
+    strncpy(newSession.sessionId, hexId.c_str(), SESSION_ID_HEX_LENGTH);
+    newSession.sessionId[SESSION_ID_HEX_LENGTH] = '\0';
+    strncpy(newSession.username, username.c_str(), SESSION_USERNAME_MAX_LENGTH);
+    newSession.username[SESSION_USERNAME_MAX_LENGTH] = '\0';
     newSession.userRole = role;
     newSession.creationTime = millis(); // Use millis() for simplicity
+    if (newSession.creationTime == 0) newSession.creationTime = 1; // isValid() treats 0 as unset
     newSession.lastHeartbeat = newSession.creationTime;
-    newSession.fingerprint = generateFingerprint(request);
 
     if (!newSession.isValid()) {
          Serial.println("Error: Newly created session data is invalid.");
-         return SessionData(); // Return invalid session
+         newSession = SessionData();
+         return SessionData(); // Return invalid session (slot was never marked used)
     }
 
-    // Store the session in the map
-    activeSessions[newSession.sessionId] = newSession;
+    slot.state = SLOT_USED;
+    activeCount++;
 
     Serial.printf("Session created: ID=%s, User=%s, Role=%s\n",
-                  newSession.sessionId.c_str(),
-                  newSession.username.c_str(),
+                  newSession.sessionId,
+                  newSession.username,
                   roleToString(newSession.userRole).c_str());
 
     return newSession;
@@ -121,179 +280,145 @@ SessionData SessionManager::createSession(const String& username, UserRole role,
 /**
  * @brief Validates an existing session based on a request's session cookie.
  *
- * Extracts the session ID from the "session_id" cookie in the request headers.
- * Looks up the session ID in the `activeSessions` map.
+ * Decodes the "session_id" cookie into raw bytes and looks it up in the pool.
  * Checks if the session has timed out based on `SESSION_TIMEOUT_MS`.
- * Checks if the client fingerprint matches the one stored in the session.
- * If the session is valid (found, not timed out, fingerprint matches), updates
- * its `lastHeartbeat` timestamp and returns a pointer to the `SessionData`.
- * If validation fails for any reason, the session is removed internally, and
- * nullptr is returned.
+ * Checks the client fingerprint: if the request arrives on the same TCP connection
+ * (client object, remote IP and port) that was last verified for this session, the
+ * cached result is reused; otherwise the fingerprint is recomputed and compared to
+ * the stored hash, and the connection is cached on success.
+ * If the session is valid, updates its `lastHeartbeat` timestamp and returns a
+ * copy of its `SessionData`, taken under the pool mutex: the slot itself may be
+ * evicted or cleaned up by another task as soon as the mutex is released. If it
+ * expired or the fingerprint does not match, the session is removed internally.
  *
  * @param request Pointer to the AsyncWebServerRequest object containing the session cookie.
- * @return A pointer to the valid `SessionData` object if validation succeeds,
- *         nullptr otherwise. The returned pointer points to data within the
- *         `activeSessions` map and should not be deleted by the caller.
+ * @return A copy of the session if validation succeeds, an invalid SessionData
+ *         (isValid() false) otherwise.
  */
-SessionData* SessionManager::validateSession(AsyncWebServerRequest *request) {
-    if (!request) return nullptr;
-
-    // Get session ID from cookie (assuming cookie name is "session_id")
-    const AsyncWebHeader* cookieHeader = request->getHeader("Cookie"); // Added const
-    String sessionId = "";
-    if (cookieHeader) {
-        // Basic cookie parsing - find "session_id=value"
-        String cookies = cookieHeader->value();
-        int startIndex = cookies.indexOf("session_id=");
-        if (startIndex != -1) {
-            startIndex += strlen("session_id=");
-            int endIndex = cookies.indexOf(';', startIndex);
-            if (endIndex == -1) { // Last cookie
-                sessionId = cookies.substring(startIndex);
-            } else {
-                sessionId = cookies.substring(startIndex, endIndex);
-            }
-            // Trim potential whitespace
-             sessionId.trim();
-        }
-    }
-
-    if (sessionId.isEmpty()) {
+SessionData SessionManager::validateSession(AsyncWebServerRequest *request) {
+    BENCH_SCOPE(benchValidateSession);
+    uint8_t id[SESSION_ID_BYTES];
+    if (!parseSessionCookie(request, id)) {
         // Serial.println("Validation failed: No session cookie found."); // Debug only
-        return nullptr; // No session ID cookie
+        return SessionData(); // No (well-formed) session ID cookie
     }
 
-    // Find session in the map
-    auto it = activeSessions.find(sessionId);
-    if (it == activeSessions.end()) {
-        // Serial.printf("Validation failed: Session ID '%s' not found.\n", sessionId.c_str()); // Debug only
+    SessionPoolGuard guard(poolMutex);
+
+    int index = findSlot(id);
+    if (index < 0) {
         // Optionally clear the invalid cookie on the client here?
-        return nullptr; // Session not found
+        return SessionData(); // Session not found
     }
-
-    SessionData& session = it->second; // Get reference to the session data
+    SessionSlot& slot = pool[index];
+    SessionData& session = slot.data;
 
     // Check for timeout
     unsigned long currentTime = millis();
     if (currentTime - session.lastHeartbeat > SESSION_TIMEOUT_MS) {
-        Serial.printf("Session expired: ID=%s, User=%s\n", sessionId.c_str(), session.username.c_str());
-        removeSessionInternal(sessionId); // Remove the expired session
-        // Optionally clear the expired cookie on the client here?
-        return nullptr; // Session expired
+        Serial.printf("Session expired: ID=%s, User=%s\n", session.sessionId, session.username);
+        removeSessionInternal(index); // Remove the expired session
+        return SessionData(); // Session expired
     }
 
-    // Check fingerprint
-    String currentFingerprint = generateFingerprint(request);
-    if (session.fingerprint != currentFingerprint) {
-        Serial.printf("Session validation failed: Fingerprint mismatch for ID=%s, User=%s\n", sessionId.c_str(), session.username.c_str());
-        Serial.printf("  Stored: %s\n", session.fingerprint.c_str());
-        Serial.printf("  Current: %s\n", currentFingerprint.c_str());
-        removeSessionInternal(sessionId); // Treat fingerprint mismatch as potential hijack, invalidate session
-        // Optionally clear the invalid cookie on the client here?
-        return nullptr; // Fingerprint mismatch
+    // Check fingerprint (only when the request comes in on a connection we have not verified yet)
+    AsyncClient* client = request->client();
+    uint32_t remoteIp = (uint32_t)client->remoteIP();
+    uint16_t remotePort = client->remotePort();
+    if (slot.verifiedClient != client || slot.verifiedIp != remoteIp || slot.verifiedPort != remotePort) {
+        uint8_t currentFingerprint[SESSION_FINGERPRINT_BYTES];
+        if (!generateFingerprint(request, currentFingerprint)
+            || memcmp(slot.fingerprint, currentFingerprint, SESSION_FINGERPRINT_BYTES) != 0) {
+            Serial.printf("Session validation failed: Fingerprint mismatch for ID=%s, User=%s\n", session.sessionId, session.username);
+            removeSessionInternal(index); // Treat fingerprint mismatch as potential hijack, invalidate session
+            return SessionData(); // Fingerprint mismatch
+        }
+        slot.verifiedClient = client;
+        slot.verifiedIp = remoteIp;
+        slot.verifiedPort = remotePort;
     }
 
     // Session is valid, update heartbeat
     session.lastHeartbeat = currentTime;
-    // Serial.printf("Session validated: ID=%s, User=%s\n", sessionId.c_str(), session.username.c_str()); // Debug only
-
-    return &session; // Return pointer to the valid session data
+    return session; // Copy, made while the pool mutex is held
 }
 
 /**
  * @brief Invalidates a specific session by its ID.
  *
- * Finds the session in the `activeSessions` map and removes it using `removeSessionInternal`.
- * This also triggers the release of any locks held by the session via the LockManager.
+ * Decodes the hex ID, finds the session in the pool and removes it using
+ * `removeSessionInternal`. This also triggers the release of any locks held by
+ * the session via the LockManager.
  *
- * @param sessionId The ID of the session to invalidate.
+ * @param sessionId The hex ID of the session to invalidate.
  * @return True if the session was found and removed, false otherwise.
  */
 bool SessionManager::invalidateSession(const String& sessionId) {
-    if (sessionId.isEmpty()) return false;
+    if (sessionId.length() != SESSION_ID_HEX_LENGTH) return false;
 
-    auto it = activeSessions.find(sessionId);
-    if (it != activeSessions.end()) {
-        Serial.printf("Invalidating session by ID: %s, User: %s\n", sessionId.c_str(), it->second.username.c_str());
-        removeSessionInternal(sessionId);
-        return true;
-    }
-    return false;
+    uint8_t id[SESSION_ID_BYTES];
+    if (AuthUtils::hexToBytes(sessionId, id, SESSION_ID_BYTES) != SESSION_ID_BYTES) return false;
+
+    SessionPoolGuard guard(poolMutex);
+    int index = findSlot(id);
+    if (index < 0) return false;
+
+    Serial.printf("Invalidating session by ID: %s, User: %s\n", sessionId.c_str(), pool[index].data.username);
+    removeSessionInternal(index);
+    return true;
 }
 
 /**
  * @brief Invalidates the session associated with a given web request.
  *
- * Extracts the session ID from the request's cookie and calls `invalidateSession(sessionId)`.
+ * Decodes the session ID from the request's cookie and removes the matching session.
  *
  * @param request Pointer to the AsyncWebServerRequest object containing the session cookie.
  * @return True if a session ID was found in the cookie and the corresponding session
  *         was successfully invalidated, false otherwise.
  */
 bool SessionManager::invalidateSession(AsyncWebServerRequest *request) {
-     if (!request) return false;
-
-    // Extract session ID from cookie (same logic as in validateSession)
-    const AsyncWebHeader* cookieHeader = request->getHeader("Cookie"); // Added const
-    String sessionId = "";
-     if (cookieHeader) {
-        String cookies = cookieHeader->value();
-        int startIndex = cookies.indexOf("session_id=");
-        if (startIndex != -1) {
-            startIndex += strlen("session_id=");
-            int endIndex = cookies.indexOf(';', startIndex);
-            if (endIndex == -1) sessionId = cookies.substring(startIndex);
-            else sessionId = cookies.substring(startIndex, endIndex);
-            sessionId.trim();
-        }
-    }
+    uint8_t id[SESSION_ID_BYTES];
+    if (!parseSessionCookie(request, id)) return false;
 
-    if (!sessionId.isEmpty()) {
-        return invalidateSession(sessionId);
-    }
-    return false;
+    SessionPoolGuard guard(poolMutex);
+    int index = findSlot(id);
+    if (index < 0) return false;
+
+    Serial.printf("Invalidating session by ID: %s, User: %s\n", pool[index].data.sessionId, pool[index].data.username);
+    removeSessionInternal(index);
+    return true;
 }
 
 
 /**
- * @brief Periodically cleans up expired sessions from the active sessions map.
+ * @brief Periodically cleans up expired sessions from the session pool.
  *
  * This function should be called regularly (e.g., in the main loop).
  * It checks if the configured cleanup interval (`SESSION_CLEANUP_INTERVAL_MS`)
- * has passed since the last cleanup. If so, it iterates through all active sessions,
- * identifies those whose `lastHeartbeat` is older than `SESSION_TIMEOUT_MS`,
- * and removes them using `removeSessionInternal`.
+ * has passed since the last cleanup. If so, it walks the fixed pool, removes
+ * sessions whose `lastHeartbeat` is older than `SESSION_TIMEOUT_MS`, and, once
+ * the table is empty, resets all tombstones so probe sequences stay short.
  */
 void SessionManager::cleanupExpiredSessions() {
     unsigned long currentTime = millis();
     // Check if it's time to run cleanup
     if (currentTime - lastCleanupTime >= SESSION_CLEANUP_INTERVAL_MS) {
-        // Serial.println("Running session cleanup..."); // Debug only
         int cleanedCount = 0;
-        // Iterate through the map - C++11 range-based for is convenient
-        // Need to be careful when removing elements while iterating.
-        // A common pattern is to collect IDs to remove first, then remove them.
-        std::vector<String> idsToRemove;
-        // Use C++11 compatible loop if C++17 isn't enabled, or enable C++17
-        for (const auto& pair : activeSessions) { // C++11 compatible loop
-             const String& id = pair.first;
-             const SessionData& session = pair.second;
-             if (currentTime - session.lastHeartbeat > SESSION_TIMEOUT_MS) {
-                 idsToRemove.push_back(id);
-             }
-        }
-        /* // C++17 version (requires build_flags = -std=c++17)
-        for (auto const& [id, session] : activeSessions) {
-            if (currentTime - session.lastHeartbeat > SESSION_TIMEOUT_MS) {
-                idsToRemove.push_back(id);
+        {
+            SessionPoolGuard guard(poolMutex);
+            for (int i = 0; i < SESSION_POOL_CAPACITY; i++) {
+                SessionSlot& slot = pool[i];
+                if (slot.state != SLOT_USED) continue;
+                if (currentTime - slot.data.lastHeartbeat > SESSION_TIMEOUT_MS) {
+                    Serial.printf("Cleaning up expired session: ID=%s, User=%s\n", slot.data.sessionId, slot.data.username);
+                    removeSessionInternal(i); // Remove the session and handle locks
+                    cleanedCount++;
+                }
+            }
+            if (activeCount == 0) {
+                for (int i = 0; i < SESSION_POOL_CAPACITY; i++) pool[i].state = SLOT_EMPTY;
             }
-        }
-        */
-
-        for (const String& id : idsToRemove) {
-             Serial.printf("Cleaning up expired session: ID=%s, User=%s\n", id.c_str(), activeSessions[id].username.c_str());
-             removeSessionInternal(id); // Remove the session and handle locks
-             cleanedCount++;
         }
 
         if (cleanedCount > 0) {
@@ -307,27 +432,30 @@ void SessionManager::cleanupExpiredSessions() {
 /**
  * @brief Internal helper function to remove a session and release its locks.
  * @note Should not be called directly from outside the class. Use invalidateSession instead.
+ *       Caller must hold `poolMutex`.
  *
- * Finds the session by ID in the `activeSessions` map.
- * Calls `lockManager.releaseLocksForSession()` to release any locks held by this session.
- * Erases the session entry from the `activeSessions` map.
+ * Calls `lockManager.releaseLocksForSession()` to release any locks held by this session,
+ * then turns the slot into a tombstone. The slot's data is cleared but the slot itself
+ * never moves, so lookups for other sessions are unaffected.
  *
- * @param sessionId The ID of the session to remove.
+ * @param slotIndex Index of the slot to remove.
  */
-void SessionManager::removeSessionInternal(const String& sessionId) {
-    auto it = activeSessions.find(sessionId);
-    if (it != activeSessions.end()) {
-        String username = it->second.username; // Get username before erasing
-
-        // --- Phase 4 Integration: Release Locks ---
-        // Call LockManager to release locks associated with this sessionId
-        int locksReleased = lockManager.releaseLocksForSession(sessionId);
-        if (locksReleased > 0) {
-             Serial.printf("Released %d lock(s) due to session removal for %s.\n", locksReleased, username.c_str());
-        }
-
-        // Erase the session from the map
-        activeSessions.erase(it);
-        Serial.printf("Session removed from memory: ID=%s\n", sessionId.c_str());
+void SessionManager::removeSessionInternal(int slotIndex) {
+    if (slotIndex < 0 || slotIndex >= SESSION_POOL_CAPACITY) return;
+    SessionSlot& slot = pool[slotIndex];
+    if (slot.state != SLOT_USED) return;
+
+    // --- Phase 4 Integration: Release Locks ---
+    // Call LockManager to release locks associated with this sessionId
+    int locksReleased = lockManager.releaseLocksForSession(String(slot.data.sessionId));
+    if (locksReleased > 0) {
+         Serial.printf("Released %d lock(s) due to session removal for %s.\n", locksReleased, slot.data.username);
     }
-}
\ No newline at end of file
+
+    Serial.printf("Session removed from memory: ID=%s\n", slot.data.sessionId);
+    slot.state = SLOT_DELETED;
+    slot.verifiedClient = nullptr;
+    memset(slot.id, 0, SESSION_ID_BYTES);
+    slot.data = SessionData();
+    activeCount--;
+}
@@ -0,0 +1,148 @@
+#include "StaticAssetHandler.h"
+#include "DebugConfig.h" // For API_DEBUG macros
+#include <algorithm>
+
+namespace {
+// Orders assets by path for the binary search in findAsset
+bool assetPathLess(const StaticAsset& asset, const String& path) {
+    return asset.path.compareTo(path) < 0;
+}
+} // namespace
+
+/**
+ * @brief Constructs an empty handler; call begin() before registering it.
+ */
+StaticAssetHandler::StaticAssetHandler() {}
+
+/**
+ * @brief Loads the asset manifest into the in-RAM ETag table.
+ *
+ * Each manifest line is "<path> <etag>". Lines that do not parse are skipped.
+ *
+ * @param fs The filesystem holding the assets.
+ * @param root Directory of the assets, e.g. "/www".
+ * @return True if at least one asset was loaded, false otherwise.
+ */
+bool StaticAssetHandler::begin(fs::FS& fs, const char* root) {
+    this->fs = &fs;
+    this->root = root;
+    if (this->root.endsWith("/")) {
+        this->root.remove(this->root.length() - 1);
+    }
+    assets.clear();
+
+    String manifestPath = this->root + "/" + STATIC_ASSET_MANIFEST;
+    File manifest = fs.open(manifestPath, "r");
+    if (!manifest) {
+        Serial.printf("StaticAssetHandler: No manifest at %s, serving uncompressed files.\n", manifestPath.c_str());
+        return false;
+    }
+
+    while (manifest.available()) {
+        String line = manifest.readStringUntil('\n');
+        line.trim();
+        int space = line.indexOf(' ');
+        if (space <= 0 || line.length() - space - 1 != STATIC_ASSET_ETAG_LENGTH || line[0] != '/') {
+            continue;
+        }
+        StaticAsset asset;
+        asset.path = line.substring(0, space);
+        snprintf(asset.etag, sizeof(asset.etag), "\"%s\"", line.c_str() + space + 1);
+        asset.contentType = contentTypeFor(asset.path);
+        assets.push_back(asset);
+    }
+    manifest.close();
+
+    std::sort(assets.begin(), assets.end(), [](const StaticAsset& a, const StaticAsset& b) {
+        return a.path.compareTo(b.path) < 0;
+    });
+    Serial.printf("StaticAssetHandler: Loaded %u precompressed assets.\n", (unsigned)assets.size());
+    return !assets.empty();
+}
+
+/**
+ * @brief Looks up the asset for a request URL ("/" and directory URLs map to index.html).
+ * @param url The request path without query string.
+ * @return Pointer to the table entry, or nullptr if the path is not a known asset.
+ */
+const StaticAsset* StaticAssetHandler::findAsset(const String& url) const {
+    String path = url.endsWith("/") ? url + "index.html" : url;
+    auto it = std::lower_bound(assets.begin(), assets.end(), path, assetPathLess);
+    if (it == assets.end() || !it->path.equals(path)) {
+        return nullptr;
+    }
+    return &(*it);
+}
+
+/**
+ * @brief Claims GET requests for known assets from clients that accept gzip.
+ *
+ * Also marks the conditional request header as interesting; the server strips
+ * all other headers from requests of non-callback handlers.
+ */
+bool StaticAssetHandler::canHandle(AsyncWebServerRequest *request) {
+    if (request->method() != HTTP_GET || !findAsset(request->url())) {
+        return false;
+    }
+    const AsyncWebHeader* acceptEncoding = request->getHeader("Accept-Encoding");
+    if (!acceptEncoding || acceptEncoding->value().indexOf("gzip") < 0) {
+        return false; // Only the .gz copy is stored; let the fallback handler decide
+    }
+    request->addInterestingHeader("If-None-Match");
+    return true;
+}
+
+/**
+ * @brief Answers 304 from the ETag table, or streams the stored gzip file.
+ *
+ * A request whose ?v= matches the current ETag gets the immutable Cache-Control;
+ * everything else must revalidate, which costs one 304 and no flash reads.
+ */
+void StaticAssetHandler::handleRequest(AsyncWebServerRequest *request) {
+    const StaticAsset* asset = findAsset(request->url());
+    if (!asset) {
+        request->send(404);
+        return;
+    }
+
+    const char* cacheControl = STATIC_ASSET_REVALIDATE_CACHE;
+    if (request->hasParam("v")) {
+        const String& version = request->getParam("v")->value();
+        // etag is stored quoted; compare the digits only
+        if (version.length() == STATIC_ASSET_ETAG_LENGTH &&
+            strncmp(version.c_str(), asset->etag + 1, STATIC_ASSET_ETAG_LENGTH) == 0) {
+            cacheControl = STATIC_ASSET_IMMUTABLE_CACHE;
+        }
+    }
+
+    AsyncWebServerResponse* response = nullptr;
+    const AsyncWebHeader* ifNoneMatch = request->getHeader("If-None-Match");
+    if (ifNoneMatch && ifNoneMatch->value().indexOf(asset->etag) >= 0) {
+        response = request->beginResponse(304);
+    } else {
+        String gzPath = root + asset->path + ".gz";
+        response = request->beginResponse(*fs, gzPath, asset->contentType);
+        response->addHeader("Content-Encoding", "gzip");
+        API_DEBUG_PRINTF("StaticAssetHandler: Serving %s\n", gzPath.c_str());
+    }
+    response->addHeader("ETag", asset->etag);
+    response->addHeader("Cache-Control", cacheControl);
+    response->addHeader("Vary", "Accept-Encoding");
+    request->send(response);
+}
+
+/**
+ * @brief Maps a file extension to its MIME type.
+ * @param path The asset path.
+ * @return A static MIME type string.
+ */
+const char* StaticAssetHandler::contentTypeFor(const String& path) {
+    if (path.endsWith(".html")) return "text/html";
+    if (path.endsWith(".css")) return "text/css";
+    if (path.endsWith(".js")) return "application/javascript";
+    if (path.endsWith(".json")) return "application/json";
+    if (path.endsWith(".svg")) return "image/svg+xml";
+    if (path.endsWith(".png")) return "image/png";
+    if (path.endsWith(".ico")) return "image/x-icon";
+    return "application/octet-stream";
+}
@@ -1,9 +1,31 @@
 #include "UserManager.h"
+#include "TaskConfig.h"
 #include "AuthUtils.h"
+#include "AtomicFile.h" // Temp + rename writes, CRC-checked reads
 #include <FS.h>
 #include <LittleFS.h>
 #include <ArduinoJson.h> // V7
 
+// FreeRTOS includes (cache mutex, login queue and worker task)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+namespace {
+// Scoped helper that holds the user cache mutex for the lifetime of the object.
+// The login worker and the web server task both read and fill the cache.
+struct UserCacheGuard {
+    SemaphoreHandle_t mutex;
+    explicit UserCacheGuard(void* m) : mutex((SemaphoreHandle_t)m) {
+        if (mutex) xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+    ~UserCacheGuard() {
+        if (mutex) xSemaphoreGive(mutex);
+    }
+};
+} // namespace
+
 // --- UserManager Implementation ---
 
 /**
@@ -42,16 +64,50 @@ String UserManager::getUserFilePath(const String& username) {
 /**
  * @brief Initializes the UserManager.
  *
+ * Creates the user cache mutex, the login queue and the login worker task.
  * Ensures the user directory exists, creating it if necessary.
  * Checks if any user files exist in the directory. If not, it calls
  * `createDefaultOwner()` to create the initial administrative account.
  *
  * @return True if initialization is successful (directory exists, default owner
  *         created if needed), false if critical failures occur (e.g., cannot
- *         create user directory or default owner account).
+ *         create user directory or default owner account, or the login worker
+ *         cannot be started).
  */
 bool UserManager::begin() {
     Serial.println("Initializing UserManager...");
+    if (!cacheMutex) {
+        cacheMutex = xSemaphoreCreateMutex();
+        if (!cacheMutex) {
+            Serial.println("FATAL: Failed to create user cache mutex.");
+            return false;
+        }
+    }
+    if (!loginQueue) {
+        loginQueue = xQueueCreate(LOGIN_QUEUE_LENGTH, sizeof(LoginJob*));
+        if (!loginQueue) {
+            Serial.println("FATAL: Failed to create login queue.");
+            return false;
+        }
+    }
+    if (!loginTaskHandle) {
+        // Hashing, file reads and JSON parsing run here instead of on the async TCP task
+        BaseType_t taskCreated = xTaskCreatePinnedToCore(
+            loginTaskWrapper,
+            "LoginTask",
+            6144,
+            this,
+            TASK_PRIORITY_LOGIN,
+            (TaskHandle_t*)&loginTaskHandle,
+            SERVICE_CORE
+        );
+        if (taskCreated != pdPASS) {
+            Serial.println("FATAL: Failed to create login task.");
+            loginTaskHandle = nullptr;
+            return false;
+        }
+    }
+
     if (!LittleFS.exists(_userDir)) {
         Serial.printf("User directory '%s' not found. Attempting to create.\n", _userDir.c_str());
         if (!LittleFS.mkdir(_userDir)) {
@@ -94,21 +150,12 @@ bool UserManager::loadUser(const String& username, UserAccount& account) {
         return false;
     }
 
-    File userFile = LittleFS.open(filePath, "r");
-    if (!userFile) {
-        Serial.printf("Failed to open user file for reading: %s\n", filePath.c_str());
-        return false;
-    }
-
     // V7: Use JsonDocument
     JsonDocument doc;
     // StaticJsonDocument<512> doc; // Or static if size is known
 
-    DeserializationError error = deserializeJson(doc, userFile);
-    userFile.close();
-
-    if (error) {
-        Serial.printf("Failed to parse user file %s: %s\n", filePath.c_str(), error.c_str());
+    if (readJsonFile(filePath, doc) != FileReadResult::OK || doc.isNull()) {
+        Serial.printf("Failed to read user file %s\n", filePath.c_str());
         return false;
     }
 
@@ -139,7 +186,7 @@ bool UserManager::loadUser(const String& username, UserAccount& account) {
  * @brief Saves user account data from a UserAccount struct to its file.
  *
  * Validates the `UserAccount` struct first. Gets the file path for the username.
- * Opens the file in write mode (truncating existing content). Serializes the
+ * Writes the file atomically (temp file + rename, CRC trailer). Serializes the
  * `UserAccount` data into JSON format and writes it to the file.
  *
  * @param account A constant reference to the `UserAccount` struct containing the data to save.
@@ -157,11 +204,8 @@ bool UserManager::saveUser(const UserAccount& account) {
          return false;
     }
 
-    File userFile = LittleFS.open(filePath, "w");
-    if (!userFile) {
-        Serial.printf("Failed to open user file for writing: %s\n", filePath.c_str());
-        return false;
-    }
+    // Drop the cached copy first; if the write fails the file content is unknown
+    invalidateCachedUser(account.username);
 
     // V7: Use JsonDocument
     JsonDocument doc;
@@ -172,13 +216,13 @@ bool UserManager::saveUser(const UserAccount& account) {
     doc["salt"] = account.salt;
     doc["role"] = roleToString(account.role);
 
-    if (serializeJson(doc, userFile) == 0) {
+    // Atomic + CRC: a power cut during a password change keeps the old account file
+    if (!writeJsonFileAtomic(filePath, doc, true)) {
         Serial.printf("Failed to write user data to file: %s\n", filePath.c_str());
-        userFile.close();
         return false;
     }
 
-    userFile.close();
+    cacheUser(account); // Keep the cache in step with the file
     // Serial.printf("User saved successfully: %s\n", account.username.c_str()); // Debug only
     return true;
 }
@@ -186,15 +230,152 @@ bool UserManager::saveUser(const UserAccount& account) {
 /**
  * @brief Finds a user by username and loads their data.
  *
- * This is a convenience function that simply calls `loadUser`.
+ * Checks the user cache first. On a miss the account file is loaded with
+ * `loadUser` and the result is cached for the next lookup.
  *
  * @param username The username of the account to find.
  * @param account A reference to a `UserAccount` struct to be populated if the user is found.
  * @return True if the user was found and loaded successfully, false otherwise.
  */
 bool UserManager::findUserByUsername(const String& username, UserAccount& account) {
-    // This is essentially the same as loading the user file
-    return loadUser(username, account);
+    if (lookupCachedUser(username, account)) {
+        return true;
+    }
+    if (!loadUser(username, account)) {
+        return false;
+    }
+    cacheUser(account);
+    return true;
+}
+
+/**
+ * @brief Queues a login verification for the worker task.
+ *
+ * Ownership of the heap-allocated job passes to the worker once it is queued.
+ * Never blocks: a full queue is reported to the caller immediately.
+ *
+ * @param username The username to authenticate.
+ * @param password The plain text password to verify.
+ * @param callback Invoked exactly once, on the worker task, if this call returns true
+ *        (unless the job is cancelled first).
+ * @param cancelled Optional check run before hashing; true drops the job silently.
+ * @return True if the job was queued, false if the queue is full or not created.
+ */
+bool UserManager::verifyLoginAsync(const String& username, const String& password, LoginCallback callback,
+                                   LoginCancelledCheck cancelled) {
+    if (!loginQueue || !callback) {
+        return false;
+    }
+    LoginJob* job = new LoginJob{username, password, callback, cancelled};
+    if (xQueueSend((QueueHandle_t)loginQueue, &job, 0) != pdTRUE) {
+        Serial.println("UserManager: Login queue full, rejecting login.");
+        delete job;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Copies a cached account into @p account and refreshes its LRU stamp.
+ * @param username The username to look up.
+ * @param account Populated on a hit.
+ * @return True on a cache hit, false otherwise.
+ */
+bool UserManager::lookupCachedUser(const String& username, UserAccount& account) {
+    UserCacheGuard guard(cacheMutex);
+    for (CachedUser& entry : userCache) {
+        if (entry.used && entry.account.username.equals(username)) {
+            entry.lastUsed = ++cacheClock;
+            account = entry.account;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Inserts or refreshes an account in the user cache.
+ *
+ * Reuses the entry of the same username if present, otherwise a free entry,
+ * otherwise evicts the least recently used one.
+ *
+ * @param account The account to cache.
+ */
+void UserManager::cacheUser(const UserAccount& account) {
+    UserCacheGuard guard(cacheMutex);
+    CachedUser* target = nullptr;
+    for (CachedUser& entry : userCache) {
+        if (entry.used && entry.account.username.equals(account.username)) {
+            target = &entry; // Refresh in place
+            break;
+        }
+        // Free entries win over used ones, otherwise the oldest stamp loses its slot
+        if (!target || (target->used && (!entry.used || entry.lastUsed < target->lastUsed))) {
+            target = &entry;
+        }
+    }
+    target->used = true;
+    target->lastUsed = ++cacheClock;
+    target->account = account;
+}
+
+/**
+ * @brief Removes a username from the user cache.
+ * @param username The username to drop.
+ */
+void UserManager::invalidateCachedUser(const String& username) {
+    UserCacheGuard guard(cacheMutex);
+    for (CachedUser& entry : userCache) {
+        if (entry.used && entry.account.username.equals(username)) {
+            entry.used = false;
+            entry.account = UserAccount();
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Static FreeRTOS entry point for the login worker task.
+ * @param parameter Pointer to the UserManager instance.
+ */
+void UserManager::loginTaskWrapper(void* parameter) {
+    static_cast<UserManager*>(parameter)->loginTask();
+}
+
+/**
+ * @brief Login worker loop: looks up the user, verifies the password and reports the result.
+ *
+ * Unknown users and wrong passwords both report INVALID_CREDENTIALS so the
+ * response does not reveal which usernames exist.
+ */
+void UserManager::loginTask() {
+    for (;;) {
+        LoginJob* job = nullptr;
+        if (xQueueReceive((QueueHandle_t)loginQueue, &job, portMAX_DELAY) != pdTRUE || !job) {
+            continue;
+        }
+        if (job->cancelled && job->cancelled()) {
+            delete job; // Client gone: skip the user lookup and salted SHA-256 check
+            continue;
+        }
+
+        UserAccount account;
+        LoginResult result = LoginResult::INVALID_CREDENTIALS;
+        if (findUserByUsername(job->username, account)) {
+            if (account.hashedPassword.isEmpty() || account.salt.isEmpty()) {
+                Serial.printf("UserManager: Account '%s' has an empty password hash or salt.\n", job->username.c_str());
+                result = LoginResult::ACCOUNT_CORRUPTED;
+            } else if (AuthUtils::verifyPassword(job->password, account.hashedPassword, account.salt)) {
+                result = LoginResult::OK;
+            }
+        }
+        if (result != LoginResult::OK) {
+            account = UserAccount(); // Only hand out account data for a verified login
+        }
+
+        job->callback(result, account);
+        delete job;
+    }
 }
 
 /**
@@ -269,6 +450,7 @@ bool UserManager::deleteUser(const String& username) {
     // For now, allow deletion.
 
     Serial.printf("Deleting user: %s\n", username.c_str());
+    invalidateCachedUser(username);
     if (!LittleFS.remove(filePath)) {
         Serial.printf("Error: Failed to remove user file: %s\n", filePath.c_str());
         return false;
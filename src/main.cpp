@@ -14,20 +14,50 @@
 #include "esp_task_wdt.h"
 #include "esp_system.h"
 #include "InputPointManager.h"
+#include "ModbusMaster.h"
 #include "OutputPointManager.h"
+#include "FlowMeterManager.h"
+#include "PointRegistry.h"
+#include "ScheduleEngine.h"
+#include "LogBuffer.h"
+#include "Benchmark.h"
+#include "RuntimeMetrics.h"
+#include "LiveEvents.h"
+#include "AutopilotEngine.h"
+#include "CycleManager.h"
+#include "HistoryStore.h"
+#include "PersistenceWorker.h"
+#include "TaskConfig.h"
 #define DEBUG_OUTPUT_TEST_TASK 1
 #define DEBUG_INPUT_TASK 0
+#define NTP_SERVER "pool.ntp.org"
+#define LOCAL_TIMEZONE "UTC0" // POSIX TZ string, e.g. "PST8PDT,M3.2.0,M11.1.0"
 
+RuntimeMetrics runtimeMetrics; // Counters behind /api/metrics; usable before setup()
+LogBuffer logBuffer;         // Log ring behind DebugConfig.h macros; usable before setup()
+PointRegistry pointRegistry; // pointId -> handle, filled by the IO managers' begin()
 InputPointManager inputManager;
 OutputPointManager outputManager;
+FlowMeterManager flowMeterManager; // PCNT flow meters behind TURN_ON_VOLUME doses
 
 #if DEBUG_INPUT_TASK
 void inputReaderTaskWrapper(void* parameter) {
     int loopCount = 0;
     while (true) {
-        Serial.printf("[InputPointManager] inputReaderTaskWrapper: Starting input fetch loop #%d\n", ++loopCount);
-        inputManager.inputReaderTask(); // Reads all inputs and prints debug info
-        Serial.printf("[InputPointManager] inputReaderTaskWrapper: Completed input fetch loop #%d\n", loopCount);
+        Serial.printf("[InputPointManager] inputReaderTaskWrapper: Dumping input values #%d\n", ++loopCount);
+        // InputPointManager samples in its own task; just print the latest values
+        for (PointHandle h = 0; h < (PointHandle)pointRegistry.size(); ++h) {
+            const PointEntry* entry = pointRegistry.get(h);
+            if (entry->kind == PointKind::DIGITAL_INPUT) {
+                Serial.printf("  DI %s = %d\n", entry->pointId.c_str(), inputManager.getCurrentState(h) ? 1 : 0);
+            } else if (entry->kind == PointKind::ANALOG_INPUT) {
+                Serial.printf("  AI %s = %.2f (raw %.0f)\n", entry->pointId.c_str(), inputManager.getCurrentValue(h), inputManager.getRawValue(h));
+            } else if (entry->kind == PointKind::MODBUS_INPUT) {
+                Serial.printf("  MB %s = %.2f\n", entry->pointId.c_str(), inputManager.getCurrentValue(h));
+            } else if (entry->kind == PointKind::FLOW_METER) {
+                Serial.printf("  FM %s = %.3f L\n", entry->pointId.c_str(), flowMeterManager.getTotalLiters(h));
+            }
+        }
         vTaskDelay(pdMS_TO_TICKS(10000)); // Wait 10 seconds
     }
 }
@@ -36,34 +66,35 @@ void inputReaderTaskWrapper(void* parameter) {
 #if DEBUG_OUTPUT_TEST_TASK
 void outputTestTaskWrapper(void* parameter) {
     int loopCount = 0;
+    PointHandle relay0 = pointRegistry.resolve("DirectRelay_0"); // Resolve once, send by handle
     while (true) {
         // 1. TURN ON relay 0
         OutputCommand cmdOn;
-        cmdOn.pointId = "DirectRelay_0";
+        cmdOn.point = relay0;
         cmdOn.commandType = RelayCommandType::TURN_ON;
         cmdOn.durationMs = 0;
         outputManager.sendCommand(cmdOn);
-        Serial.printf("[OutputTestTask] Sent TURN_ON command to %s (loop %d)\n", cmdOn.pointId.c_str(), loopCount);
+        Serial.printf("[OutputTestTask] Sent TURN_ON command to DirectRelay_0 (loop %d)\n", loopCount);
 
         vTaskDelay(pdMS_TO_TICKS(5000)); // Wait 5 seconds
 
         // 2. TURN OFF relay 0
         OutputCommand cmdOff;
-        cmdOff.pointId = "DirectRelay_0";
+        cmdOff.point = relay0;
         cmdOff.commandType = RelayCommandType::TURN_OFF;
         cmdOff.durationMs = 0;
         outputManager.sendCommand(cmdOff);
-        Serial.printf("[OutputTestTask] Sent TURN_OFF command to %s (loop %d)\n", cmdOff.pointId.c_str(), loopCount);
+        Serial.printf("[OutputTestTask] Sent TURN_OFF command to DirectRelay_0 (loop %d)\n", loopCount);
 
         vTaskDelay(pdMS_TO_TICKS(5000)); // Wait 5 seconds
 
         // 3. TURN ON TIMED relay 0 for 2 seconds
         OutputCommand cmdTimed;
-        cmdTimed.pointId = "DirectRelay_0";
+        cmdTimed.point = relay0;
         cmdTimed.commandType = RelayCommandType::TURN_ON_TIMED;
         cmdTimed.durationMs = 2000; // 2 seconds
         outputManager.sendCommand(cmdTimed);
-        Serial.printf("[OutputTestTask] Sent TURN_ON_TIMED (2s) command to %s (loop %d)\n", cmdTimed.pointId.c_str(), loopCount);
+        Serial.printf("[OutputTestTask] Sent TURN_ON_TIMED (2s) command to DirectRelay_0 (loop %d)\n", loopCount);
 
         vTaskDelay(pdMS_TO_TICKS(5000)); // Wait 5 seconds before next cycle
 
@@ -93,6 +124,13 @@ UserManager userManager;
 SessionManager sessionManager;
 LockManager lockManager;
 ScheduleManager scheduleManager; // Add global instance
+ScheduleEngine scheduleEngine;   // Runs bound schedules (needs scheduleManager + outputManager)
+ModbusMaster modbusMaster;       // Polls Modbus RTU devices into inputManager
+LiveEvents liveEvents;           // Pushes point/schedule/lock changes on /api/events
+AutopilotEngine autopilotEngine; // Doses autopilot windows on tension crossings
+CycleManager cycleManager;       // Advances active cycles through their steps
+HistoryStore historyStore;       // Sensor / relay time series on LittleFS (/api/history)
+PersistenceWorker persistenceWorker; // Background LittleFS writes on the service core
 ApiRoutes* apiRoutesPtr = nullptr; // Declare a global pointer
 
 // Web Servers
@@ -149,7 +187,8 @@ String readFileToString(fs::FS &fs, const char * path){
  *
  * This function runs once at startup. It performs the following tasks:
  * 1. Initializes the Serial communication.
- * 2. Initializes and mounts the LittleFS filesystem, formatting if necessary.
+ * 2. Initializes and mounts the LittleFS filesystem, formatting if necessary, loads the
+ *    board I/O configuration (binary snapshot when current) and drives all relays off.
  * 3. Creates the required directory structure within LittleFS if it doesn't exist.
  * 4. Loads the application configuration using ConfigManager.
  * 5. Initializes the UserManager, LockManager, and ScheduleManager.
@@ -162,6 +201,7 @@ void setup() {
   Serial.begin(115200);
   while (!Serial) { ; }
   Serial.println("\n\nStarting setup...");
+  logBuffer.begin(); // Drain task forwards queued log messages to Serial
 
   // Initialize LittleFS
   Serial.println("Initializing LittleFS...");
@@ -175,6 +215,13 @@ void setup() {
     Serial.println("LittleFS mounted successfully.");
   }
 
+  // Relays reach a known (off) state before any of the slower JSON and index work below
+  IOConfiguration ioConfig;
+  bool ioConfigLoaded = configManager.loadIOConfig(ioConfig);
+  if (ioConfigLoaded) {
+    outputManager.enterSafeState(ioConfig);
+  }
+
   // Create directory structure
   Serial.println("Checking/Creating directory structure...");
   for (int i = 0; i < NUM_DIRS; i++) {
@@ -187,6 +234,11 @@ void setup() {
   }
   Serial.println("Directory structure check complete.");
 
+  // Background flash writer; LockManager, CycleManager and HistoryStore hand it their flushes
+  if (!persistenceWorker.begin()) {
+    Serial.println("PersistenceWorker initialization failed; background state will not be saved.");
+  }
+
 
   // Load configuration
   Serial.println("Loading configuration...");
@@ -211,6 +263,13 @@ void setup() {
     while(1) yield();
   }
 
+  // Initialize SessionManager
+  Serial.println("Initializing SessionManager...");
+  if (!sessionManager.begin()) {
+    Serial.println("SessionManager initialization failed. Halting.");
+    while(1) yield();
+  }
+
   // Initialize ScheduleManager
   Serial.println("Initializing ScheduleManager...");
   if (!scheduleManager.begin()) {
@@ -218,28 +277,55 @@ void setup() {
     while(1) yield();
   }
 
-  // Load I/O configuration
-  IOConfiguration ioConfig;
-  if (configManager.loadBoardIOConfig(ioConfig)) {
+  // Start the I/O managers on the configuration loaded at the top of setup()
+  if (ioConfigLoaded) {
       inputManager.begin(ioConfig);
+      if (!modbusMaster.begin(ioConfig, configManager)) {
+        Serial.println("[main] ModbusMaster failed to start. Modbus points will read as unknown.");
+      }
+      inputManager.loadCalibrations(); // After Modbus: compensation sources may be Modbus points
       if (!outputManager.begin(ioConfig)) {
         Serial.println("[main] OutputPointManager initialization failed. Halting.");
         while (1) yield();
     } else {
         Serial.println("[main] OutputPointManager initialized successfully.");
     }
+      // After the relays exist, before the engines that send volume doses
+      if (!flowMeterManager.begin(ioConfig)) {
+        Serial.println("[main] FlowMeterManager failed to start. Volume events fall back to their calculated duration.");
+      }
+  }
+
+  // Load active cycles (the schedule engine applies their steps once the clock is set)
+  if (!cycleManager.begin()) {
+    Serial.println("[main] CycleManager failed to start. Cycles will not advance.");
+  }
+
+  // Start the schedule engine (binds active cycles to their relay outputs)
+  if (!scheduleEngine.begin()) {
+    Serial.println("[main] ScheduleEngine failed to start. Schedules will not run.");
+  }
+
+  // Start the autopilot (needs calibrated inputs for the tension thresholds)
+  if (!autopilotEngine.begin()) {
+    Serial.println("[main] AutopilotEngine failed to start. Autopilot windows will not dose.");
+  }
+
+  // Start recording point history (after ModbusMaster registered its points)
+  if (!historyStore.begin()) {
+    Serial.println("[main] HistoryStore failed to start. No history will be recorded.");
   }
 
   // Start FreeRTOS input reader task (debug only)
   #if DEBUG_INPUT_TASK
   xTaskCreatePinnedToCore(
       inputReaderTaskWrapper,
-      "InputReaderTask",
+      "InputDebugTask",
       4096,
       nullptr,
       1,
       nullptr,
-      1
+      SERVICE_CORE
   );
   #endif
 
@@ -251,7 +337,7 @@ void setup() {
       nullptr,
       1,
       nullptr,
-      1
+      SERVICE_CORE
   );
   #endif
 
@@ -269,6 +355,8 @@ void setup() {
      Serial.println("\nWiFi connected.");
      Serial.print("IP Address: ");
      Serial.println(WiFi.localIP());
+     // Wall clock for the schedule engine (schedule times are local minutes from midnight)
+     configTzTime(LOCAL_TIMEZONE, NTP_SERVER);
   } else {
      Serial.println("\nWiFi connection failed. Starting AP mode...");
      WiFi.mode(WIFI_AP);
@@ -315,8 +403,14 @@ void setup() {
    });
   httpServer.begin();
   Serial.println("HTTP Server started on port 80.");
+  if (!liveEvents.begin()) {
+    Serial.println("[main] LiveEvents failed to start. Pages will not receive live updates.");
+  }
   // --- End Server Setup ---
 
+#if SNR_BENCHMARK
+  startBenchmarks(); // Benchmark env only: synthetic latency runs + periodic percentile/heap report
+#endif
 
   Serial.println("Setup complete.");
 }
@@ -326,7 +420,8 @@ void setup() {
  *
  * This function runs repeatedly after `setup()` completes.
  * It calls the cleanup functions for the SessionManager and LockManager
- * to handle expired sessions and locks.
+ * to handle expired sessions and locks. Both only touch RAM; the lock table
+ * is written to flash by the persistence worker.
  * The AsyncWebServer handles client requests asynchronously in the background,
  * so no explicit server handling or delays are typically needed here.
  */
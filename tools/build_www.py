@@ -0,0 +1,98 @@
+"""
+PlatformIO pre-script: stages the LittleFS image with precompressed web assets.
+
+For `buildfs` / `uploadfs` the project's data/ directory is copied to
+$BUILD_DIR/littlefs_data/ and every file under www/ is replaced by a gzip
+(level 9, fixed mtime so the output is reproducible) copy named <file>.gz.
+Each asset gets a content-hash ETag (first 16 hex digits of the SHA-256 of
+the uncompressed bytes). Root-relative /css/ and /js/ references in the HTML
+pages are rewritten to carry ?v=<etag>, so those URLs change whenever the
+file changes and can be cached as immutable by the browser.
+
+The ETags are written to www/assets.manifest ("<path> <etag>" per line),
+which StaticAssetHandler loads into RAM at boot. The filesystem image is
+then built from the staged directory instead of data/.
+"""
+
+import gzip
+import hashlib
+import os
+import re
+import shutil
+
+Import("env")  # noqa: F821 (provided by PlatformIO)
+
+WWW_DIR = "www"
+MANIFEST_NAME = "assets.manifest"
+FS_TARGETS = ("buildfs", "uploadfs", "uploadfsota")
+
+# href="/css/x.css" or src="/js/x.js" (optionally already versioned)
+ASSET_REF = re.compile(r'((?:href|src)=")(/(?:css|js)/[^"?]+)(\?v=[0-9a-f]+)?(")')
+
+
+def content_etag(data):
+    return hashlib.sha256(data).hexdigest()[:16]
+
+
+def write_gzip(path, data):
+    with open(path, "wb") as raw:
+        # mtime=0 keeps the image byte-identical for unchanged sources
+        with gzip.GzipFile(filename="", mode="wb", fileobj=raw, compresslevel=9, mtime=0) as gz:
+            gz.write(data)
+
+
+def stage_www(www_src, www_dst):
+    assets = {}  # "/js/schedule.js" -> bytes
+    for root, _, files in os.walk(www_src):
+        for name in files:
+            full = os.path.join(root, name)
+            rel = "/" + os.path.relpath(full, www_src).replace(os.sep, "/")
+            if rel == "/" + MANIFEST_NAME or rel.endswith(".gz"):
+                continue
+            with open(full, "rb") as f:
+                assets[rel] = f.read()
+
+    # Hash everything except HTML first; HTML content depends on those hashes
+    etags = {path: content_etag(data) for path, data in assets.items() if not path.endswith(".html")}
+
+    def versioned(match):
+        path = match.group(2)
+        if path not in etags:
+            return match.group(0)
+        return "%s%s?v=%s%s" % (match.group(1), path, etags[path], match.group(4))
+
+    for path, data in assets.items():
+        if path.endswith(".html"):
+            data = ASSET_REF.sub(versioned, data.decode("utf-8")).encode("utf-8")
+            assets[path] = data
+            etags[path] = content_etag(data)
+
+    raw_total = 0
+    gz_total = 0
+    for path, data in sorted(assets.items()):
+        dst = os.path.join(www_dst, path.lstrip("/").replace("/", os.sep)) + ".gz"
+        os.makedirs(os.path.dirname(dst), exist_ok=True)
+        write_gzip(dst, data)
+        raw_total += len(data)
+        gz_total += os.path.getsize(dst)
+
+    with open(os.path.join(www_dst, MANIFEST_NAME), "w", newline="\n") as manifest:
+        for path in sorted(etags):
+            manifest.write("%s %s\n" % (path, etags[path]))
+
+    print("build_www: %d assets, %d -> %d bytes gzip" % (len(assets), raw_total, gz_total))
+
+
+def stage_data_dir():
+    src = env.subst("$PROJECT_DATA_DIR")  # noqa: F821
+    dst = os.path.join(env.subst("$BUILD_DIR"), "littlefs_data")  # noqa: F821
+    if os.path.isdir(dst):
+        shutil.rmtree(dst)
+    shutil.copytree(src, dst, ignore=shutil.ignore_patterns(WWW_DIR))
+    if os.path.isdir(os.path.join(src, WWW_DIR)):
+        stage_www(os.path.join(src, WWW_DIR), os.path.join(dst, WWW_DIR))
+    env.Replace(PROJECT_DATA_DIR=dst)  # noqa: F821
+
+
+if any(target in FS_TARGETS for target in COMMAND_LINE_TARGETS):  # noqa: F821
+    stage_data_dir()